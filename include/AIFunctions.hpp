@@ -15,6 +15,7 @@ BasicValue builtin_sigmoid(NeReLaBasic& vm, const std::vector<BasicValue>& args)
 BasicValue builtin_matmul(NeReLaBasic& vm, const std::vector<BasicValue>& args);
 BasicValue builtin_sum(NeReLaBasic& vm, const std::vector<BasicValue>& args);
 BasicValue builtin_backward(NeReLaBasic& vm, const std::vector<BasicValue>& args);
+BasicValue builtin_tensor_no_grad(NeReLaBasic& vm, const std::vector<BasicValue>& args);
 BasicValue builtin_update(NeReLaBasic& vm, const std::vector<BasicValue>& args);
 BasicValue builtin_save_model(NeReLaBasic& vm, const std::vector<BasicValue>& args);
 BasicValue builtin_load_model(NeReLaBasic& vm, const std::vector<BasicValue>& args);
@@ -27,6 +28,7 @@ BasicValue builtin_tensor_positional_encoding(NeReLaBasic& vm, const std::vector
 BasicValue builtin_tensor_softmax(NeReLaBasic& vm, const std::vector<BasicValue>& args);
 BasicValue builtin_tensor_relu(NeReLaBasic& vm, const std::vector<BasicValue>& args);
 BasicValue builtin_tensor_cross_entropy_loss(NeReLaBasic& vm, const std::vector<BasicValue>& args);
+BasicValue builtin_tensor_poolstats(NeReLaBasic& vm, const std::vector<BasicValue>& args);
 
 // The main registration function for this module
 void register_ai_functions(NeReLaBasic& vm, NeReLaBasic::FunctionTable& table_to_populate);
@@ -20,6 +20,8 @@ BasicValue builtin_getenv_str(NeReLaBasic& vm, const std::vector<BasicValue>& ar
 BasicValue array_sum(NeReLaBasic& vm, const std::vector<BasicValue>& args);
 
 BasicValue json_to_basic_value(const nlohmann::json& j);
+BasicValue json_view(const JsonObject& parent, const nlohmann::json& child);
+void json_array_to_basic(BasicValue& value);
 nlohmann::json basic_to_json_value(const BasicValue& val);
 
 #ifdef JDCOM
@@ -0,0 +1,135 @@
+// Bytecode.hpp
+#pragma once
+#include "Types.hpp"
+#include "Tokens.hpp"
+#include "Variables.hpp"
+#include <vector>
+#include <deque>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <cstdint>
+
+// The register bytecode is a second, lower-level representation that sits next to
+// the token p-code. The p-code stays the source of truth (LIST, DUMP, the debugger
+// and every statement handler read it); the bytecode only caches expressions that
+// have already been parsed once, so hot lines no longer pay for the recursive
+// precedence descent on every evaluation.
+namespace Bytecode {
+
+    enum class Op : uint8_t {
+        LOAD_CONST,     // R[dst] = constants[operand]
+        LOAD_VAR,       // R[dst] = variables[operand]
+        EVAL_PRIMARY,   // R[dst] = parse_primary() at p-code address 'operand' (calls, arrays, members, ...)
+        NEG,            // R[dst] = -R[a]
+        NOT,            // R[dst] = NOT R[a]
+        ADD, SUB,       // R[dst] = R[a] op R[b]
+        MUL, DIV, MOD,
+        POW,
+        EQ, NE, LT, GT, LE, GE,
+        AND, OR, XOR,
+        JUMP_IF_FALSE,  // ANDALSO: if NOT R[a] then jump to instruction 'operand' (R[a] is the result)
+        JUMP_IF_TRUE,   // ORELSE:  if R[a] then jump to instruction 'operand' (R[a] is the result)
+    };
+
+    struct Instr {
+        Op op;
+        uint8_t dst = 0;
+        uint8_t a = 0;
+        uint8_t b = 0;
+        uint32_t operand = 0;
+    };
+
+    // A variable read, resolved to its slots when the chunk is created. The local
+    // slot is only valid while a frame with the same layout is on top of the stack.
+    struct VarRef {
+        std::string name;
+        uint32_t global_slot = 0;
+        int32_t local_slot = -1;
+        const SlotLayout* layout = nullptr;
+    };
+
+    // One lowered expression. The result is always left in register 0.
+    struct Chunk {
+        std::vector<Instr> code;
+        std::vector<BasicValue> constants;
+        std::vector<VarRef> variables;
+        uint32_t end_pcode = 0;     // p-code address just past the expression
+        uint8_t num_registers = 1;
+        // code[0] loads a variable into R0 and every later write to R0 is
+        // R0 = R0 + R[b]: the shape of S$ + a$ + b$ (see NeReLaBasic::assign_by_append).
+        bool appends_to_variable = false;
+        // Set at run time: 0 = not tried yet, 1 = the operands ran no user
+        // functions, 2 = they did (one of them might change S$), never append.
+        uint8_t append_state = 0;
+    };
+
+    // A null-terminated string operand of the p-code (variable, function, member
+    // or label name, string literal), decoded once. 'text' is the operand as
+    // written, so a string literal is shared from here instead of being rebuilt
+    // on every evaluation; 'name' is the upper-case form the tables are keyed by.
+    struct Symbol {
+        BasicString text;
+        BasicString name;
+        uint32_t length = 0;        // p-code bytes including the null terminator
+    };
+
+    // Interns operand texts for one interpreter. Ids start at 1 so that 0 can
+    // mean "not decoded yet"; a deque keeps symbols in place while callers hold
+    // references to them.
+    // A pool can be layered on a read-only base (a THREAD worker on the program
+    // snapshot's pool): the base's ids stay valid and new symbols are numbered
+    // after them, so the copied CodeUnits keep working without copying the base.
+    class SymbolPool {
+    public:
+        SymbolPool() = default;
+        explicit SymbolPool(std::shared_ptr<const SymbolPool> base_pool);
+
+        uint32_t intern(std::string_view text);
+        const Symbol& operator[](uint32_t id) const {
+            return id <= base_size ? (*base)[id] : symbols[id - base_size - 1];
+        }
+
+        // A read-only pool with the same ids, for copies of the interpreter to layer on.
+        std::shared_ptr<const SymbolPool> share() const;
+
+    private:
+        uint32_t find(std::string_view text) const; // 0 if not interned
+
+        struct Hash {
+            using is_transparent = void;
+            size_t operator()(std::string_view s) const { return std::hash<std::string_view>{}(s); }
+        };
+        std::shared_ptr<const SymbolPool> base;
+        uint32_t base_size = 0;
+        std::deque<Symbol> symbols;
+        std::unordered_map<std::string, uint32_t, Hash, std::equal_to<>> ids;
+    };
+
+    // The lowered expressions of one p-code buffer (main program or module).
+    // 'entry' is indexed by p-code address: 0 = not looked at yet,
+    // -1 = cannot be lowered (use the parser), n > 0 = chunks[n - 1].
+    // A deque keeps chunks in place while nested evaluations append new ones.
+    // 'symbol' is indexed by the address of a string operand: 0 = not decoded
+    // yet, otherwise its SymbolPool id.
+    struct CodeUnit {
+        std::vector<int32_t> entry;
+        std::deque<Chunk> chunks;
+        std::vector<uint32_t> symbol;
+
+        void reset(size_t p_code_size) {
+            entry.assign(p_code_size, 0);
+            chunks.clear();
+            symbol.assign(p_code_size, 0);
+        }
+    };
+
+    // Lowers the expression that starts at p_code[start] into 'out'.
+    // Returns false if the expression uses a construct the bytecode does not model
+    // (AWAIT, pipes, bitwise or custom operators); the caller then keeps using the parser.
+    bool compile_expression(const std::vector<uint8_t>& p_code, uint32_t start, Chunk& out);
+
+    // Returns the size in bytes of the token at p_code[pc] including its inline operand.
+    size_t token_length(const std::vector<uint8_t>& p_code, size_t pc);
+}
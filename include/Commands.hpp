@@ -4,6 +4,7 @@
 #include <string>
 
 class NeReLaBasic; // Forward declaration to avoid circular dependencies
+namespace Bytecode { struct Symbol; }
 
 namespace Commands {
     void do_dim(NeReLaBasic& vm);
@@ -53,6 +54,9 @@ void set_variable(NeReLaBasic& vm, const std::string& name, const BasicValue& va
 std::string to_string(const BasicValue& val);
 std::string to_upper(std::string s);
 std::string read_string(NeReLaBasic& vm);
+// Reads the string operand at vm.pcode like read_string, but decodes each p-code
+// address only once; later reads are a table lookup and allocate nothing.
+const Bytecode::Symbol& read_symbol(NeReLaBasic& vm);
 
 void dump_p_code(const std::vector<uint8_t>& p_code_to_dump, const std::string& name);
 
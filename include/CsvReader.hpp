@@ -0,0 +1,84 @@
+// CsvReader.hpp
+#pragma once
+#include "Types.hpp"
+#include <fstream>
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstdint>
+
+// Reads delimited text files (CSV and the like) into [rows, columns] arrays,
+// either all at once (CSVREADER) or a given number of rows at a time (CSV.READ).
+//
+// The file is read in large blocks that are cut at line boundaries; the lines of
+// a block are split over several threads and numbers are parsed with
+// std::from_chars. Only one block is held in memory at a time.
+//
+// Column types are inferred block by block: a column whose non-empty cells are
+// all numbers is numeric, any other column keeps its text. A numeric column that
+// has text in a later block becomes a text column from that block on; rows that
+// were already read keep their numbers. An all-numeric file gives an unboxed
+// double array.
+//
+// Fields may be quoted ("a, b", with "" for a quote) but cannot span lines.
+// Blank lines are skipped.
+class CsvReader {
+public:
+    CsvReader(char delimiter, bool has_header);
+
+    // False if the file cannot be opened.
+    bool open(const std::string& filename);
+
+    // Returns the next 'max_rows' rows (0 = all remaining); the array has 0 rows
+    // once the file is exhausted. Returns nullptr and fills 'error' when a row has
+    // a different number of fields than the first one.
+    std::shared_ptr<Array> read(size_t max_rows, std::string& error);
+
+    // True once every row has been returned.
+    bool at_end() const;
+
+private:
+    struct Cell {
+        double number;
+        uint32_t offset;      // into Block::text
+        uint32_t length : 30;
+        uint32_t numeric : 1;
+        uint32_t blank : 1;
+    };
+
+    // The rows of one thread's share of a block.
+    struct Piece {
+        std::vector<Cell> cells;
+        size_t rows = 0;
+        size_t width = 0;     // fields in the first row
+        size_t bad_row = SIZE_MAX;
+        size_t bad_width = 0;
+    };
+
+    struct Block {
+        std::string text;
+        std::vector<Piece> pieces;
+    };
+
+    bool load_block(std::string& error);
+    void parse_piece(size_t begin, size_t end, Piece& piece);
+    void infer_column_types();
+
+    std::ifstream file;
+    char delimiter;
+    bool skip_header;
+    bool at_file_start = true;
+    bool file_done = false;
+    std::string carry;          // an incomplete last line, completed by the next block
+
+    Block block;
+    size_t next_piece = 0;      // read position within 'block'
+    size_t next_row = 0;
+
+    bool types_known = false;
+    size_t width = 0;
+    std::vector<uint8_t> text_column;
+    bool any_text = false;
+    bool all_text = false;
+    size_t rows_parsed = 0;     // for error messages
+};
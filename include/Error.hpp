@@ -7,7 +7,7 @@ class NeReLaBasic;
 
 namespace Error {
     // Sets the current error code.
-    void set(uint8_t errorCode, uint16_t lineNumber, const std::string& customMessage = "");
+    void set(uint8_t errorCode, uint32_t lineNumber, const std::string& customMessage = "");
 
     // Gets the current error code.
     uint8_t get();
@@ -0,0 +1,90 @@
+// EventQueue.hpp
+#pragma once
+#include "Types.hpp"
+#include <deque>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+#include <cstddef>
+
+// The queue behind RAISEEVENT and the window/keyboard events that ON "..." CALL
+// handlers receive.
+//
+// Event names are interned into small ids, so raising and dispatching never
+// compare strings. Each event type has a priority (QUIT first, MOUSEMOVE last,
+// everything else in between, FIFO within a priority) and may be coalesced: a
+// new MOUSEMOVE replaces the payload of one that is still waiting instead of
+// queueing behind it.
+//
+// The queue holds at most 'capacity' events (0 = unbounded). When it is full,
+// DROP_OLDEST discards the oldest event of the lowest waiting priority (or the
+// new event, if that ranks lower still), DROP_NEWEST discards the new event.
+// WAIT is handled by the VM: RAISEEVENT first runs queued handlers until there
+// is room, and falls back to DROP_OLDEST where it cannot (inside a handler, or
+// for window events).
+class EventQueue {
+public:
+    using EventId = uint32_t;
+
+    // Built-in events, interned first so native code can raise them by id.
+    enum : EventId { QUIT, KEYDOWN, KEYUP, KEYPRESS, MOUSEMOVE, MOUSEDOWN, MOUSEUP };
+
+    enum class Priority : uint8_t { HIGH, NORMAL, LOW };
+    enum class Overflow { DROP_OLDEST, DROP_NEWEST, WAIT };
+
+    struct Event {
+        EventId id;
+        BasicValue data;
+        uint64_t seq;       // raise order, for coalescing
+    };
+
+    struct Stats {
+        uint64_t raised = 0;
+        uint64_t dispatched = 0;
+        uint64_t coalesced = 0;
+        uint64_t dropped = 0;
+        size_t high_water = 0;
+    };
+
+    EventQueue();
+
+    // 'name' must already be upper case.
+    EventId intern(const std::string& name);
+    const std::string& name_of(EventId id) const { return types[id].name; }
+    size_t type_count() const { return types.size(); }
+
+    void set_priority(EventId id, Priority priority) { types[id].priority = priority; }
+    void set_coalesce(EventId id, bool coalesce) { types[id].coalesce = coalesce; }
+
+    // Returns false if the new event was dropped.
+    bool push(EventId id, BasicValue data);
+    bool pop(Event& out);
+    void clear();
+
+    bool empty() const { return count == 0; }
+    size_t size() const { return count; }
+    bool full() const { return capacity != 0 && count >= capacity; }
+
+    size_t capacity = 1024;
+    Overflow overflow = Overflow::DROP_OLDEST;
+    Stats stats;
+
+private:
+    static constexpr size_t LEVELS = 3;
+
+    struct Type {
+        std::string name;
+        Priority priority = Priority::NORMAL;
+        bool coalesce = false;
+        uint64_t pending_seq = 0;   // seq of the waiting event of a coalesced type, 0 = none
+    };
+
+    void drop_front(size_t level);
+
+    std::vector<Type> types;
+    std::unordered_map<std::string, EventId> ids;
+    std::deque<Event> levels[LEVELS];
+    size_t count = 0;
+    uint64_t next_seq = 1;
+};
@@ -0,0 +1,51 @@
+// Kernels.hpp
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// Element-wise loops over contiguous double arrays, used by the array operators
+// and the math built-ins once their operands are unboxed (see ArrayData).
+// The widest instruction set the CPU supports is picked at runtime (AVX2, then
+// SSE2); everything else, and the tail of every loop, runs as plain scalar code.
+// All variants produce bit-identical results.
+namespace Kernels {
+
+    enum class Binary { ADD, SUB, MUL, DIV, MOD, POW };
+    enum class Compare { EQ, NE, LT, GT, LE, GE };
+    enum class Unary { SQRT, ABS, FLOOR, CEIL, TRUNC, SIN, COS, TAN };
+
+    // out[i] = a[i * a_step] op b[i * b_step]. A step is 1 for an array operand
+    // and 0 for a scalar that is broadcast over the whole loop.
+    // DIV and MOD do not check for zero divisors; the caller reports those.
+    void binary(Binary op, const double* a, size_t a_step, const double* b, size_t b_step, double* out, size_t n);
+
+    // out[i] = a[i * a_step] op b[i * b_step] ? 1 : 0
+    void compare(Compare op, const double* a, size_t a_step, const double* b, size_t b_step, uint8_t* out, size_t n);
+
+    // out[i] = op(in[i]); 'in' and 'out' may be the same buffer.
+    void unary(Unary op, const double* in, double* out, size_t n);
+
+    // The scalar form of the above, for non-array arguments.
+    double binary(Binary op, double a, double b);
+    double unary(Unary op, double x);
+
+    // Matrix multiply, row-major: C (m x n) = A (m x k) * B (k x n), or C += A * B
+    // with 'accumulate'. ld* are the row strides. With trans_a, 'a' holds A
+    // transposed (k x m) and is read in place, likewise trans_b for 'b'; this is
+    // how the autodiff backward pass avoids materialising transposes.
+    // The work is cache-blocked and spread over the OpenMP threads. Unlike the
+    // element-wise loops, the AVX2 path uses fused multiply-add, so results may
+    // differ from a naive loop in the last bit.
+    void gemm(bool trans_a, bool trans_b, size_t m, size_t n, size_t k,
+        const double* a, size_t lda, const double* b, size_t ldb,
+        double* c, size_t ldc, bool accumulate = false);
+
+    // The same product in single precision, for FLOAT32 tensors. Accumulation is
+    // in float as well; a vector holds twice as many elements.
+    void gemm(bool trans_a, bool trans_b, size_t m, size_t n, size_t k,
+        const float* a, size_t lda, const float* b, size_t ldb,
+        float* c, size_t ldc, bool accumulate = false);
+
+    // "AVX2", "SSE2" or "scalar". AVX2 implies FMA here.
+    const char* instruction_set();
+}
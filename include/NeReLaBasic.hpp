@@ -8,9 +8,16 @@
 #include <deque>
 #include "Types.hpp"
 #include "Tokens.hpp"
+#include "Bytecode.hpp"
+#include "Variables.hpp"
+#include "PCode.hpp"
+#include "ThreadPool.hpp"
+#include "EventQueue.hpp"
 #include "NetworkManager.hpp"
+#include "Profiler.hpp"
 #include <functional> 
 #include <future>
+#include <chrono>
 
 // --- Platform-specific includes for dynamic library loading ---
 #ifdef _WIN32
@@ -51,9 +58,9 @@ public:
     std::string lineinput;
     std::string filename;
 
-    uint16_t prgptr = 0;
-    uint16_t pcode = 0;
-    uint16_t linenr = 0;
+    uint32_t prgptr = 0;
+    uint32_t pcode = 0;
+    uint32_t linenr = 0;
     std::string prompt = "> ";
 
     uint8_t graphmode = 0;
@@ -63,10 +70,33 @@ public:
     bool is_stopped = false;
     bool program_ended = false;
     bool nopause_active = false; // Set to true by OPTION "NOPAUSE", disables ESC/Spacebar break/pause
-
-    uint16_t runtime_current_line = 0;
-    uint16_t current_source_line = 0;
-    uint16_t current_statement_start_pcode = 0; // Tracks the start of the current statement
+    // How long a task may run before the scheduler moves on, set by OPTION "TIMESLICE=...".
+    // A task always finishes the line it is on; with both limits at 0 it runs exactly one line.
+    uint32_t time_slice_statements = 0;
+    uint32_t time_slice_us = 0;
+
+    // The sampling profiler, started by OPTION "PROFILE" or, for every RUN, by the
+    // --profile flag (which sets profile_output). Its reports are written when the
+    // program ends.
+    std::unique_ptr<Profiler> profiler;
+    std::string profile_output;
+
+    // Cleared by TENSOR.NO_GRAD TRUE: the tensor ops then only compute values and
+    // record no autodiff graph, which is what inference wants.
+    bool tensor_grad_enabled = true;
+
+    // Keyboard and window polling is amortised: process_system_events() runs before
+    // every statement, but only reads the clock every INPUT_CHECK_STATEMENTS calls
+    // and only polls once INPUT_POLL_INTERVAL has passed since the last poll.
+    static constexpr uint32_t INPUT_CHECK_STATEMENTS = 16;
+    static constexpr std::chrono::microseconds INPUT_POLL_INTERVAL{ 1000 };
+    uint32_t statements_since_input_check = INPUT_CHECK_STATEMENTS; // poll on the first statement
+    std::chrono::steady_clock::time_point last_input_poll{};
+
+    uint32_t runtime_current_line = 0;
+    uint32_t current_source_line = 0;
+    uint32_t current_statement_start_pcode = 0; // Tracks the start of the current statement
+    uint64_t user_function_calls = 0; // Counts execute_synchronous_function() calls
 
     using FunctionTable = std::unordered_map<std::string, NeReLaBasic::FunctionInfo>;
 
@@ -74,8 +104,16 @@ public:
         std::string variable_name; // Name of the loop counter (e.g., "i")
         double end_value = 0;
         double step_value = 0;
-        uint16_t loop_start_pcode = 0; // Address to jump back to on NEXT
-        std::vector<uint16_t> exit_patch_locations; // To patch EXIT FOR jumps
+        uint32_t loop_start_pcode = 0; // Address to jump back to on NEXT
+        std::vector<uint32_t> exit_patch_locations; // To patch EXIT FOR jumps
+
+        // The counter's slot, resolved once by FOR: a local slot of call_stack[frame],
+        // or a global slot. Counters that only have a name (a frame's overflow map)
+        // are looked up by name on every NEXT.
+        static constexpr uint32_t GLOBAL = UINT32_MAX;
+        static constexpr uint32_t BY_NAME = UINT32_MAX - 1;
+        uint32_t frame = BY_NAME;
+        uint32_t slot = 0;
     };
 
     // A type alias for our native C++ function pointers.
@@ -94,19 +132,18 @@ public:
         bool is_exported = false;
         bool is_async = false;
         std::string module_name;
-        uint16_t start_pcode = 0;
+        uint32_t start_pcode = 0;
         std::vector<std::string> parameter_names;
+        std::shared_ptr<SlotLayout> locals; // Local slot layout; parameters occupy the first slots
         NativeFunction native_impl = nullptr; // A pointer to a C++ function
         NativeDLLFunction native_dll_impl = nullptr; // A pointer to a C++ function in an DLL
     };
 
-    using FunctionTable = std::unordered_map<std::string, NeReLaBasic::FunctionInfo>;
-
     struct StackFrame {
         std::string function_name;
-        uint16_t linenr;
-        std::unordered_map<std::string, BasicValue> local_variables;
-        uint16_t return_pcode = 0; // Where to jump back to after the function ends
+        uint32_t linenr;
+        LocalVariables local_variables;
+        uint32_t return_pcode = 0; // Where to jump back to after the function ends
         const std::vector<uint8_t>* return_p_code_ptr;
         FunctionTable* previous_function_table_ptr;
         size_t for_stack_size_on_entry = 0;
@@ -133,17 +170,21 @@ public:
         BasicValue result = false;
         std::shared_ptr<Task> awaiting_task = nullptr;
         const std::vector<uint8_t>* p_code_ptr = nullptr;
-        uint16_t p_code_counter = 0;
+        uint32_t p_code_counter = 0;
+        // The task's stacks. While the task runs they are swapped into the VM's
+        // call_stack/for_stack and swapped back out when it yields its turn.
         std::vector<StackFrame> call_stack;
         std::vector<ForLoopInfo> for_stack;
         bool yielded_execution = false; // Flag to signal a yield from AWAIT
+        bool resume_mid_line = false;   // p_code_counter points at a statement, not at a line prefix
+        bool waiting_in_await = false;  // parked inside AWAIT until the awaited task is done (see finish_awaited_task)
         // --- Per-Task Error Handling State ---
         bool error_handler_active = false;
         std::string error_handler_function_name = "";
         bool jump_to_error_handler = false;
-        uint16_t resume_pcode_next_statement = 0;
-        uint16_t resume_pcode = 0;
-        uint16_t resume_runtime_line = 0;
+        uint32_t resume_pcode_next_statement = 0;
+        uint32_t resume_pcode = 0;
+        uint32_t resume_runtime_line = 0;
         const std::vector<uint8_t>* resume_p_code_ptr = nullptr;
         FunctionTable* resume_function_table_ptr = nullptr;
         std::vector<StackFrame> resume_call_stack_snapshot;
@@ -155,6 +196,7 @@ public:
         std::string name;
         std::vector<uint8_t> p_code;
         FunctionTable function_table;
+        uint64_t source_hash = 0; // see ProgramCache::Unit::import_hashes
     };
 
     // --- Structures for User-Defined Types ---
@@ -168,12 +210,15 @@ public:
         // Using a map for members allows for quick lookup
         std::map<std::string, MemberInfo> members;
         FunctionTable methods;
+        // Member names in 'members' order, shared by every instance of the type.
+        // Built on first use by create_default_instance, so member N is in slot N.
+        std::shared_ptr<MapKeys> layout;
     };
 
     // --- For TRY/CATCH Runtime ---
     struct ExceptionHandler {
-        uint16_t catch_address;    // p-code address of the CATCH block
-        uint16_t finally_address;  // p-code address of the FINALLY block
+        uint32_t catch_address;    // p-code address of the CATCH block
+        uint32_t finally_address;  // p-code address of the FINALLY block
         size_t call_stack_depth;   // Stack depth at the moment TRY was entered
         size_t for_stack_depth;    // FOR loop stack depth at the moment TRY was entered
     };
@@ -181,7 +226,7 @@ public:
 
     // --- Flags for pending jumps from Error::set ---
     bool jump_to_catch_pending = false;
-    uint16_t pending_catch_address = 0;
+    uint32_t pending_catch_address = 0;
 
     std::promise<bool> dap_launch_promise; // Used to signal that launch has occurred
     std::string program_to_debug; // Will hold the path from the launch request
@@ -194,7 +239,7 @@ public:
     bool dap_command_received = false;
 
     // Breakpoints: line number -> BreakpointInfo (can be just bool for now)
-    std::map<uint16_t, bool> breakpoints;
+    std::map<uint32_t, bool> breakpoints;
 
     void pause_for_debugger();
     void resume_from_debugger();
@@ -211,10 +256,23 @@ public:
     std::vector<uint8_t> program_p_code;    // Stores the compiled bytecode for RUN/DUMP
     std::vector<uint8_t> direct_p_code;     // Temporary buffer for direct-mode commands
     const std::vector<uint8_t>* active_p_code = nullptr;    //Active P-Code Pointer
+
+    // --- Register bytecode for expressions (see Bytecode.hpp) ---
+    // One CodeUnit per compiled p-code buffer, registered by Compiler::tokenize_program.
+    std::unordered_map<const std::vector<uint8_t>*, Bytecode::CodeUnit> code_units;
+    const std::vector<uint8_t>* cached_unit_p_code = nullptr;
+    Bytecode::CodeUnit* cached_unit = nullptr;
+    Bytecode::SymbolPool symbols;          // Names and string literals read by read_symbol()
+    // REPL lines and EXECUTE snippets have no CodeUnit. Their symbols are kept per
+    // p-code buffer only while it runs (see SnippetSymbols), so a loop of distinct
+    // EXECUTE strings does not grow 'symbols'. The count is the nesting depth.
+    std::unordered_map<const std::vector<uint8_t>*, std::pair<Bytecode::SymbolPool, int>> snippet_symbols;
+    std::vector<BasicValue> register_file; // Shared by nested expression evaluations
+    size_t register_top = 0;
     std::vector<ForLoopInfo> for_stack;
 
     std::vector<StackFrame> call_stack;
-    std::vector<uint16_t> func_stack;
+    std::vector<uint32_t> func_stack;
     std::vector<std::shared_ptr<Map>> this_stack;
 
     // The main program has its own function table
@@ -228,18 +286,27 @@ public:
     FunctionTable* active_function_table = nullptr;
 
     // -- - Symbol Tables for Variables-- -
-    std::unordered_map<std::string, BasicValue> variables;
+    GlobalVariables variables;
     std::map<std::string, TypeInfo> user_defined_types; // Storage for UDTs
 
-    //std::unordered_map<std::string, uint16_t> label_addresses;
+    //std::unordered_map<std::string, uint32_t> label_addresses;
 
     // --- C++ Modules ---
     std::map<std::string, BasicModule> compiled_modules;
 
     // --- Event Handling System ---
-    std::map<std::string, std::string> event_handlers; // Maps event name to function name
-    std::deque<std::pair<std::string, BasicValue>> event_queue; // Queue of raised events
+    // ON "name" CALL resolves the handler SUB once; it is looked up again by name
+    // only after the program has been recompiled.
+    struct EventHandler {
+        std::string function_name; // empty = no handler
+        std::shared_ptr<const FunctionInfo> function;
+        uint64_t program_generation = 0;
+    };
+    EventQueue events; // capacity and overflow policy are set by OPTION "EVENTQUEUE=..." / "EVENTOVERFLOW=..."
+    std::vector<EventHandler> event_handlers; // indexed by EventQueue::EventId
     bool is_processing_event = false; // Prevents event recursion
+    // How long one call of process_event_queue() may keep dispatching a burst.
+    static constexpr std::chrono::microseconds EVENT_BATCH_BUDGET{ 2000 };
 
 #ifdef _WIN32
     std::vector<HMODULE> loaded_libraries;
@@ -263,9 +330,9 @@ public:
 
     //// Context to return to after RESUME
     //// These will store the state *before* the error handler is invoked.
-    //uint16_t resume_pcode_next_statement = 0; // Where RESUME NEXT should jump
-    //uint16_t resume_pcode = 0;
-    //uint16_t resume_runtime_line = 0;
+    //uint32_t resume_pcode_next_statement = 0; // Where RESUME NEXT should jump
+    //uint32_t resume_pcode = 0;
+    //uint32_t resume_runtime_line = 0;
     //const std::vector<uint8_t>* resume_p_code_ptr = nullptr; // Raw pointer, assuming it points to active_p_code
     //NeReLaBasic::FunctionTable* resume_function_table_ptr = nullptr; // Raw pointer
     //std::vector<StackFrame> resume_call_stack_snapshot; // Snapshot of call stack for RESUME NEXT/0
@@ -286,7 +353,16 @@ public:
     Task* current_task = nullptr;
 
     std::mutex background_tasks_mutex;
-    std::map<std::thread::id, std::future<BasicValue>> background_tasks;
+    std::map<uint64_t, std::future<BasicValue>> background_tasks;
+    uint64_t next_thread_job_id = 1;
+
+    // THREAD runs its calls on a fixed pool of workers. Each worker keeps its own
+    // interpreter, copied from 'thread_program' (a read-only snapshot of this
+    // program) only when the program has changed since the worker's last job.
+    std::unique_ptr<ThreadPool> thread_pool;
+    std::shared_ptr<const NeReLaBasic> thread_program;
+    uint64_t thread_program_generation = 0;
+    uint64_t program_generation = 0; // bumped by the compiler whenever the program changes
 
     bool is_in_pipe_call = false;
     BasicValue piped_value_for_call;
@@ -309,6 +385,7 @@ public:
     // --- Declarations for Expression Parsing ---
     std::vector<BasicValue> parse_argument_list();
     BasicValue evaluate_expression();
+    BasicValue parse_expression();
     BasicValue parse_comparison();
     BasicValue parse_term();
     BasicValue parse_primary();
@@ -338,20 +415,46 @@ public:
     void skip_unary();
     void skip_binary_op_chain(std::function<void()> skip_higher_precedence, const std::vector<Tokens::ID>& operators);
 
+    // --- Operators shared by the parser and the bytecode dispatch loop ---
+    BasicValue apply_power_op(const BasicValue& left, const BasicValue& right);
+    BasicValue apply_factor_op(Tokens::ID op, const BasicValue& left, const BasicValue& right);
+    BasicValue apply_term_op(Tokens::ID op, const BasicValue& left, const BasicValue& right);
+    BasicValue apply_comparison_op(Tokens::ID op, const BasicValue& left, const BasicValue& right);
+
+    // --- Register bytecode ---
+    Bytecode::CodeUnit* find_code_unit();
+    void resolve_chunk_variables(Bytecode::Chunk& chunk);
+    BasicValue& resolve_variable(const Bytecode::VarRef& ref);
+    Bytecode::Chunk* lowered_expression();
+    BasicValue execute_chunk(const Bytecode::Chunk& chunk, std::vector<BasicValue>* appended = nullptr);
+    bool assign_by_append(const std::string& name);
+
 
     // --- Main execution ---
     BasicValue get_stacktrace();
     void statement();
     void process_system_events();
+    void poll_input();
     BasicValue execute_function_for_value(const FunctionInfo& func_info, const std::vector<BasicValue>& args);
     void execute_repl_command(const std::vector<uint8_t>& repl_p_code);
     void execute_synchronous_block(const std::vector<uint8_t>& code_to_run, int multiline = false);
     BasicValue execute_synchronous_function(const FunctionInfo& func_info, const std::vector<BasicValue>& args);
     void execute_main_program(const std::vector<uint8_t>& code_to_run, bool resume_mode);
+    void run_scheduler_round();
+    void run_task_slice();
+    bool finish_awaited_task(Task* task);
+    bool time_slice_used_up(uint32_t statements_run, std::chrono::steady_clock::time_point slice_start) const;
+    void start_profiler(const std::string& output_base);
+    void finish_profiler();
     void raise_event(const std::string& event_name, BasicValue data);
+    void raise_event(EventQueue::EventId id, BasicValue data);
+    bool has_event_handler(EventQueue::EventId id) const;
+    void set_event_handler(const std::string& event_name, const std::string& func_name, const FunctionInfo& func_info);
+    std::shared_ptr<const FunctionInfo> event_handler(EventQueue::EventId id);
     void process_event_queue();
     //BasicValue execute_function_for_value_t(const FunctionInfo& func_info, const std::vector<BasicValue>& args);
     BasicValue launch_bsync_function(const FunctionInfo& func_info, const std::vector<BasicValue>& args);
+    void reset_for_thread_job();
     void init_basic();
     void init_system();
     void init_screen();
@@ -0,0 +1,52 @@
+// PCode.hpp
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// Layout helpers for the token p-code. Every line starts with its source line
+// number, and jump targets (FUNC/SUB end, IF/ELSE/DO/LOOP/TRY patches, ...) are
+// absolute byte offsets into the buffer. Both are stored as 32-bit little-endian
+// values, so programs and modules are not limited to 64 KB or 65,535 lines.
+namespace PCode {
+    using Address = uint32_t;
+
+    constexpr size_t ADDRESS_SIZE = sizeof(Address);
+    constexpr size_t LINE_PREFIX_SIZE = sizeof(uint32_t);
+
+    // Marks a FunctionInfo whose body has not been placed yet (lambdas in pass 1).
+    constexpr Address UNPATCHED = 0xFFFFFFFF;
+
+    inline void write_u32(std::vector<uint8_t>& p_code, size_t at, uint32_t value) {
+        p_code[at] = value & 0xFF;
+        p_code[at + 1] = (value >> 8) & 0xFF;
+        p_code[at + 2] = (value >> 16) & 0xFF;
+        p_code[at + 3] = (value >> 24) & 0xFF;
+    }
+
+    inline void emit_u32(std::vector<uint8_t>& p_code, uint32_t value) {
+        p_code.resize(p_code.size() + sizeof(uint32_t));
+        write_u32(p_code, p_code.size() - sizeof(uint32_t), value);
+    }
+
+    inline uint32_t read_u32(const std::vector<uint8_t>& p_code, size_t at) {
+        return static_cast<uint32_t>(p_code[at]) |
+            (static_cast<uint32_t>(p_code[at + 1]) << 8) |
+            (static_cast<uint32_t>(p_code[at + 2]) << 16) |
+            (static_cast<uint32_t>(p_code[at + 3]) << 24);
+    }
+
+    // Writes a zeroed jump target and returns its position for patch_address().
+    inline Address emit_placeholder(std::vector<uint8_t>& p_code) {
+        Address at = static_cast<Address>(p_code.size());
+        emit_u32(p_code, 0);
+        return at;
+    }
+
+    inline void emit_address(std::vector<uint8_t>& p_code, Address target) { emit_u32(p_code, target); }
+    inline void patch_address(std::vector<uint8_t>& p_code, Address at, Address target) { write_u32(p_code, at, target); }
+    inline Address read_address(const std::vector<uint8_t>& p_code, size_t at) { return read_u32(p_code, at); }
+
+    inline void emit_line(std::vector<uint8_t>& p_code, uint32_t line) { emit_u32(p_code, line); }
+    inline uint32_t read_line(const std::vector<uint8_t>& p_code, size_t at) { return read_u32(p_code, at); }
+}
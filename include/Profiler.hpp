@@ -0,0 +1,96 @@
+// Profiler.hpp
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+
+class NeReLaBasic;
+
+// A sampling profiler for OPTION "PROFILE" and the --profile flag.
+// A timer thread only counts ticks; it never touches interpreter state. The
+// interpreter charges the ticks that arrived while a statement or a native
+// built-in ran to the line, the BASIC call stack and the built-in at the end
+// of that statement or call, so a tick costs one relaxed load when nothing is due.
+// Threads started with THREAD run on copies of the interpreter and are not sampled.
+class Profiler {
+public:
+    explicit Profiler(std::string output_base, std::chrono::microseconds interval = std::chrono::milliseconds(1));
+    ~Profiler();
+
+    Profiler(const Profiler&) = delete;
+    Profiler& operator=(const Profiler&) = delete;
+
+    // Stops the timer and writes <base>.profile.txt (flat profile and call tree)
+    // and <base>.folded (collapsed stacks for flamegraph.pl, speedscope, ...).
+    // Returns false if a file could not be written.
+    bool write_reports();
+
+    const std::string& output_base() const { return base; }
+
+    bool sample_due() const { return ticks.load(std::memory_order_relaxed) != charged; }
+    void charge(const NeReLaBasic& vm);
+
+    // Charges the ticks that arrived while a statement ran, once it has finished.
+    class StatementScope {
+    public:
+        StatementScope(Profiler* p, const NeReLaBasic& vm) : profiler(p), vm(vm) {}
+        ~StatementScope() { if (profiler && profiler->sample_due()) profiler->charge(vm); }
+        StatementScope(const StatementScope&) = delete;
+        StatementScope& operator=(const StatementScope&) = delete;
+    private:
+        Profiler* profiler;
+        const NeReLaBasic& vm;
+    };
+
+    // Charges what is due to the enclosing statement when a built-in starts, and
+    // the ticks that arrive during the call to the built-in when it returns.
+    class NativeScope {
+    public:
+        NativeScope(Profiler* p, const NeReLaBasic& vm, const std::string& name) : profiler(p), vm(vm) {
+            if (profiler) {
+                if (profiler->sample_due()) profiler->charge(vm);
+                outer = profiler->native;
+                profiler->native = &name;
+            }
+        }
+        ~NativeScope() {
+            if (profiler) {
+                if (profiler->sample_due()) profiler->charge(vm);
+                profiler->native = outer;
+            }
+        }
+        NativeScope(const NativeScope&) = delete;
+        NativeScope& operator=(const NativeScope&) = delete;
+    private:
+        Profiler* profiler;
+        const NeReLaBasic& vm;
+        const std::string* outer = nullptr;
+    };
+
+private:
+    void stop();
+
+    std::string base;
+    std::chrono::microseconds interval;
+    std::chrono::steady_clock::time_point started;
+    std::chrono::steady_clock::duration sampled{};
+
+    std::atomic<uint32_t> ticks{ 0 };
+    uint32_t charged = 0;                 // ticks already attributed (interpreter thread only)
+    const std::string* native = nullptr;  // built-in running right now, if any
+
+    std::map<std::pair<std::string, uint32_t>, uint64_t> line_samples; // (function, line) -> samples
+    std::map<std::string, uint64_t> stack_samples;                    // "<main>;F;G;BUILTIN" -> samples
+    uint64_t total_samples = 0;
+
+    std::thread timer;
+    std::mutex timer_mutex;
+    std::condition_variable timer_wakeup;
+    bool stopping = false;
+};
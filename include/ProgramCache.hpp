@@ -0,0 +1,51 @@
+// ProgramCache.hpp
+#pragma once
+#include "NeReLaBasic.hpp"
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <map>
+#include <unordered_map>
+
+// Compiled programs and modules are kept on disk next to their source file
+// ("prog.jdb" -> "prog.jdbc"), so a run whose source has not changed skips
+// tokenizing and all of the compiler's pre-scans.
+//
+// A cache file holds one compilation unit: its p-code, the FUNC/SUBs, methods
+// and lambdas it defines (with their local slot layouts), its TYPE definitions,
+// labels and the names of the modules it imports. Imported modules have cache
+// files of their own. A file is only used when the source hash, the interpreter
+// version and the format version all match; anything else is recompiled and
+// rewritten. The main program's p-code also depends on what its modules export
+// (a SUB is called differently from a FUNC, an ASYNC FUNC starts a task), so it
+// records the source hash of every import and is recompiled when one changed.
+// Bump FORMAT_VERSION whenever the p-code encoding changes.
+namespace ProgramCache {
+
+    constexpr uint32_t FORMAT_VERSION = 2;
+
+    struct Unit {
+        bool is_module = false;
+        std::string module_name;
+        std::vector<std::string> imports;
+        std::vector<uint64_t> import_hashes; // source hash of each import when this unit was compiled
+        std::vector<uint8_t> p_code;
+        NeReLaBasic::FunctionTable functions; // user-defined entries only, no built-ins or linked imports
+        std::map<std::string, NeReLaBasic::TypeInfo> types;
+        std::unordered_map<std::string, uint32_t> labels;
+    };
+
+    // The cache file that belongs to a source file.
+    std::string path_for(const std::string& source_path);
+
+    // 64-bit FNV-1a of the source text.
+    uint64_t hash_source(const std::string& source);
+
+    // False if the file is missing, unreadable or stale.
+    bool load(const std::string& cache_path, uint64_t source_hash, Unit& unit);
+
+    // Writes through a temporary file that is then renamed, so concurrent runs
+    // never see a half-written cache. Failures (e.g. a read-only directory) are
+    // ignored; the program then simply compiles every time.
+    void save(const std::string& cache_path, uint64_t source_hash, const Unit& unit);
+}
@@ -0,0 +1,19 @@
+// RegexCache.hpp
+#pragma once
+#include <regex>
+#include <string>
+#include <memory>
+
+// Compiled patterns for REGEX.MATCH, REGEX.FINDALL and REGEX.REPLACE, so a call
+// in a loop does not rebuild its std::regex every time. The most recently used
+// patterns are kept (keyed by pattern text and flags); the cache is shared by
+// all threads, and the pattern used last on each thread is found without taking
+// the lock.
+namespace RegexCache {
+
+    constexpr size_t CAPACITY = 64;
+
+    // Throws std::regex_error for an invalid pattern, like the std::regex constructor.
+    std::shared_ptr<const std::regex> get(const std::string& pattern,
+        std::regex::flag_type flags = std::regex::ECMAScript);
+}
@@ -5,7 +5,7 @@
 #include <string>
 #include <sstream>
 #include <streambuf>
-#include <cstdint> // For uint16_t, uint8_t
+#include <cstdint> // For uint32_t, uint8_t
 #ifndef _WIN32
 #include <ncurses.h>
 #endif  
@@ -34,8 +34,8 @@ namespace TextIO {
     int kbhit();
     #endif
     void print(const std::string& message);
-    void print_uw(uint16_t value);
-    void print_uwhex(uint16_t value);
+    void print_uw(uint32_t value);
+    void print_uwhex(uint32_t value);
     void nl(); // Newline
     void clearScreen();
     void setColor(uint8_t foreground, uint8_t background);
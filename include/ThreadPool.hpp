@@ -0,0 +1,44 @@
+// ThreadPool.hpp
+#pragma once
+#include <vector>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+// A fixed set of worker threads that run queued jobs in FIFO order.
+// THREAD hands its calls to the pool instead of starting a new OS thread per call.
+class ThreadPool {
+public:
+    using Job = std::function<void()>;
+
+    // 'size' = 0 uses one worker per hardware thread.
+    explicit ThreadPool(size_t size = 0);
+
+    // Drops the jobs that have not started yet. Workers that are still busy are
+    // detached and exit after their current job, so a BASIC thread that never
+    // returns does not block the interpreter from shutting down.
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    void submit(Job job);
+    size_t size() const { return workers.size(); }
+
+private:
+    // Shared with the workers, so it outlives the pool while a detached worker finishes.
+    struct Queue {
+        std::deque<Job> jobs;
+        std::mutex mutex;
+        std::condition_variable available;
+        bool stopping = false;
+    };
+
+    static void worker_loop(std::shared_ptr<Queue> queue);
+
+    std::shared_ptr<Queue> queue;
+    std::vector<std::thread> workers;
+};
@@ -9,12 +9,18 @@
 
 #include <variant>
 #include <string>
+#include <string_view>
 #include <chrono>
 #include <vector>     
 #include <numeric>    // for std::accumulate
 #include <stdexcept>  // for exceptions
 #include <future>
+#include <thread>
 #include <map>
+#include <mutex>
+#include <atomic>
+#include <initializer_list>
+#include <type_traits>
 #include "json.hpp" 
 
 // Forward-declare the Array struct so BasicValue can know it exists.
@@ -143,10 +149,115 @@ struct OpaqueHandle {
     }
 };
 
+// The string of a BasicValue: immutable and reference counted, so copying a
+// string value (into a variable, an array element, a map, a function argument)
+// only bumps a count instead of copying its characters. The empty string needs
+// no allocation and the 256 one-character strings are preallocated and shared.
+// It converts to const std::string& for reading; edit() returns a writable
+// string, copying the text first if another value still shares it.
+class BasicString {
+public:
+    BasicString() noexcept = default;
+    BasicString(const std::string& text) : rep(make(text.data(), text.size())) {}
+    BasicString(std::string&& text) : rep(make(std::move(text))) {}
+    BasicString(const char* text) : BasicString(std::string_view(text)) {}
+    explicit BasicString(std::string_view text) : rep(make(text.data(), text.size())) {}
+
+    BasicString(const BasicString& other) noexcept : rep(other.rep) { retain(); }
+    BasicString(BasicString&& other) noexcept : rep(other.rep) { other.rep = nullptr; }
+    BasicString& operator=(const BasicString& other) noexcept {
+        if (rep != other.rep) { other.retain(); release(); rep = other.rep; }
+        return *this;
+    }
+    BasicString& operator=(BasicString&& other) noexcept {
+        if (this != &other) { release(); rep = other.rep; other.rep = nullptr; }
+        return *this;
+    }
+    ~BasicString() { release(); }
+
+    const std::string& str() const noexcept { return rep ? rep->text : empty_text(); }
+    operator const std::string& () const noexcept { return str(); }
+
+    size_t size() const noexcept { return str().size(); }
+    size_t length() const noexcept { return str().size(); }
+    bool empty() const noexcept { return !rep || rep->text.empty(); }
+    const char* c_str() const noexcept { return str().c_str(); }
+    const char* data() const noexcept { return str().data(); }
+    char operator[](size_t i) const { return str()[i]; }
+    std::string::const_iterator begin() const noexcept { return str().begin(); }
+    std::string::const_iterator end() const noexcept { return str().end(); }
+
+    std::string& edit() {
+        if (!rep) rep = new Rep;
+        else if (rep->refs.load(std::memory_order_acquire) != 1) {
+            Rep* copy = new Rep;
+            copy->text = rep->text;
+            release();
+            rep = copy;
+        }
+        return rep->text;
+    }
+    // Appends in place; appending nothing leaves the string (and its sharing) alone.
+    void append(std::string_view text) {
+        if (!text.empty()) edit().append(text);
+    }
+
+    friend bool operator==(const BasicString& a, const BasicString& b) { return a.rep == b.rep || a.str() == b.str(); }
+    friend bool operator<(const BasicString& a, const BasicString& b) { return a.str() < b.str(); }
+    friend std::string operator+(const BasicString& a, const BasicString& b) { return a.str() + b.str(); }
+    friend std::string operator+(const BasicString& a, const std::string& b) { return a.str() + b; }
+    friend std::string operator+(const std::string& a, const BasicString& b) { return a + b.str(); }
+    friend std::string operator+(const BasicString& a, const char* b) { return a.str() + b; }
+    friend std::string operator+(const char* a, const BasicString& b) { return a + b.str(); }
+
+private:
+    struct Rep {
+        std::atomic<uint32_t> refs{ 1 };
+        std::string text;
+    };
+
+    static const std::string& empty_text() noexcept {
+        static const std::string empty;
+        return empty;
+    }
+    // The shared one-character strings. The table keeps a reference to each of
+    // them, so they are never freed and never edited in place.
+    static Rep* single(unsigned char c) {
+        static Rep* const table = [] {
+            Rep* t = new Rep[256];
+            for (int i = 0; i < 256; ++i) t[i].text.assign(1, static_cast<char>(i));
+            return t;
+        }();
+        table[c].refs.fetch_add(1, std::memory_order_relaxed);
+        return &table[c];
+    }
+    static Rep* make(const char* text, size_t length) {
+        if (length == 0) return nullptr;
+        if (length == 1) return single(static_cast<unsigned char>(text[0]));
+        Rep* r = new Rep;
+        r->text.assign(text, length);
+        return r;
+    }
+    static Rep* make(std::string&& text) {
+        if (text.size() <= 1) return make(text.data(), text.size());
+        Rep* r = new Rep;
+        r->text = std::move(text);
+        return r;
+    }
+
+    void retain() const noexcept { if (rep) rep->refs.fetch_add(1, std::memory_order_relaxed); }
+    void release() noexcept {
+        if (rep && rep->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) delete rep;
+        rep = nullptr;
+    }
+
+    Rep* rep = nullptr;
+};
+
 // This struct represents a "pointer" or "reference" to a function.
 // We just store the function's name.
 struct FunctionRef {
-    std::string name;
+    BasicString name;
     // This lets std::variant compare it if needed.
 #ifdef _WIN32    
     bool operator==(const FunctionRef&) const = default;
@@ -157,8 +268,20 @@ struct FunctionRef {
 #endif
 };
 
+// A parsed JSON document, or a view of one object or array inside it. Views
+// share the document, so member and index access copy nothing: only the scalars
+// that are actually read are converted to BasicValues (see json_view).
 struct JsonObject {
-    nlohmann::json data;
+    std::shared_ptr<const nlohmann::json> document;
+    const nlohmann::json* node = nullptr;
+
+    JsonObject() = default;
+    explicit JsonObject(nlohmann::json value)
+        : document(std::make_shared<const nlohmann::json>(std::move(value))), node(document.get()) {}
+    JsonObject(std::shared_ptr<const nlohmann::json> doc, const nlohmann::json* value)
+        : document(std::move(doc)), node(value) {}
+
+    const nlohmann::json& value() const { return *node; }
 };
 
 struct TaskRef {
@@ -173,7 +296,7 @@ struct TaskRef {
 };
 
 struct ThreadHandle {
-    std::thread::id id; // Use the thread's ID as a unique identifier
+    uint64_t id; // Job number, unique per interpreter (see NeReLaBasic::launch_bsync_function)
 #ifdef _WIN32    
     bool operator==(const ThreadHandle&) const = default;
 #else
@@ -185,15 +308,237 @@ struct ThreadHandle {
 
 // --- Use a std::shared_ptr to break the circular dependency ---
 #ifdef JDCOM
-using BasicValue = std::variant<bool, double, std::string, FunctionRef, int, DateTime, std::shared_ptr<Array>, std::shared_ptr<Map>, std::shared_ptr<JsonObject>, ComObject, std::shared_ptr<Tensor>, TaskRef, ThreadHandle, std::shared_ptr<OpaqueHandle> >;
+using BasicValue = std::variant<bool, double, BasicString, FunctionRef, int, DateTime, std::shared_ptr<Array>, std::shared_ptr<Map>, std::shared_ptr<JsonObject>, ComObject, std::shared_ptr<Tensor>, TaskRef, ThreadHandle, std::shared_ptr<OpaqueHandle> >;
 #else
-using BasicValue = std::variant<bool, double, std::string, FunctionRef, int, DateTime, std::shared_ptr<Array>, std::shared_ptr<Map>, std::shared_ptr<JsonObject>, std::shared_ptr<Tensor>, TaskRef, ThreadHandle, std::shared_ptr<OpaqueHandle> >;
+using BasicValue = std::variant<bool, double, BasicString, FunctionRef, int, DateTime, std::shared_ptr<Array>, std::shared_ptr<Map>, std::shared_ptr<JsonObject>, std::shared_ptr<Tensor>, TaskRef, ThreadHandle, std::shared_ptr<OpaqueHandle> >;
 #endif
 
+// The largest alternatives are the shared_ptrs, so a BasicValue is 24 bytes.
+static_assert(sizeof(BasicString) == sizeof(void*), "BasicString must stay a single pointer");
+
+// The position of T among the alternatives of BasicValue, for switching on index().
+template <typename T, typename Variant> struct ValueIndex;
+template <typename T, typename... Ts>
+struct ValueIndex<T, std::variant<Ts...>> {
+    static constexpr size_t value = [] {
+        constexpr bool matches[] = { std::is_same_v<T, Ts>... };
+        size_t i = 0;
+        while (!matches[i]) ++i;
+        return i;
+    }();
+};
+template <typename T>
+inline constexpr size_t value_index = ValueIndex<T, BasicValue>::value;
+
+
+// --- The element storage of an Array ---
+// Homogeneous arrays of numbers, booleans or strings are kept unboxed in a
+// plain contiguous vector (8 bytes per double instead of a 24-byte BasicValue).
+// Reading never changes the storage: operator[], at(), the iterators and the
+// vector conversion return elements by value, and the typed accessors (kind(),
+// doubles(), number(), get()) work on the store directly. Only a write of an
+// element of another type (through set(), push_back(), insert() or resize())
+// converts the array to boxed storage for good (integers written to a double
+// array are stored as doubles), as does boxed_values(), which hands out the
+// elements by reference for in-place edits.
+class ArrayData {
+public:
+    enum class Kind : uint8_t { BOXED, DOUBLE, INT, BOOL, STRING };
+
+    // Walks the elements by value (see get()).
+    class const_iterator {
+    public:
+        using iterator_category = std::random_access_iterator_tag;
+        using value_type = BasicValue;
+        using difference_type = std::ptrdiff_t;
+        using pointer = void;
+        using reference = BasicValue;
+
+        const_iterator() = default;
+        const_iterator(const ArrayData* data, size_t index) : data(data), index(index) {}
+
+        BasicValue operator*() const { return data->get(index); }
+        BasicValue operator[](difference_type n) const { return data->get(index + n); }
+        const_iterator& operator++() { ++index; return *this; }
+        const_iterator operator++(int) { const_iterator old = *this; ++index; return old; }
+        const_iterator& operator--() { --index; return *this; }
+        const_iterator operator--(int) { const_iterator old = *this; --index; return old; }
+        const_iterator& operator+=(difference_type n) { index += n; return *this; }
+        const_iterator& operator-=(difference_type n) { index -= n; return *this; }
+        const_iterator operator+(difference_type n) const { return { data, index + n }; }
+        const_iterator operator-(difference_type n) const { return { data, index - n }; }
+        difference_type operator-(const const_iterator& other) const { return static_cast<difference_type>(index) - static_cast<difference_type>(other.index); }
+        bool operator==(const const_iterator& other) const { return index == other.index; }
+        bool operator!=(const const_iterator& other) const { return index != other.index; }
+        bool operator<(const const_iterator& other) const { return index < other.index; }
+        size_t position() const { return index; }
+
+    private:
+        const ArrayData* data = nullptr;
+        size_t index = 0;
+    };
+
+    using value_type = BasicValue;
+    using iterator = const_iterator;
+
+    ArrayData() = default;
+    ArrayData(std::vector<BasicValue> values) : boxed(std::move(values)) {}
+    ArrayData(std::initializer_list<BasicValue> values) : boxed(values) {}
+    ArrayData(size_t count, const BasicValue& value) : boxed(count, value) {}
+
+    ArrayData(const ArrayData& other) { copy_from(other); }
+    ArrayData(ArrayData&& other) noexcept { move_from(std::move(other)); }
+    ArrayData& operator=(const ArrayData& other) { if (this != &other) copy_from(other); return *this; }
+    ArrayData& operator=(ArrayData&& other) noexcept { if (this != &other) move_from(std::move(other)); return *this; }
+
+    // --- Typed construction ---
+    static ArrayData of_doubles(std::vector<double> values) { ArrayData d; d.doubles_ = std::move(values); d.store_kind = Kind::DOUBLE; return d; }
+    static ArrayData of_ints(std::vector<int> values) { ArrayData d; d.ints_ = std::move(values); d.store_kind = Kind::INT; return d; }
+    static ArrayData of_bools(std::vector<uint8_t> values) { ArrayData d; d.bools_ = std::move(values); d.store_kind = Kind::BOOL; return d; }
+    static ArrayData of_strings(std::vector<BasicString> values) { ArrayData d; d.strings_ = std::move(values); d.store_kind = Kind::STRING; return d; }
+    static ArrayData of_strings(std::vector<std::string> values) {
+        std::vector<BasicString> texts;
+        texts.reserve(values.size());
+        for (std::string& value : values) texts.emplace_back(std::move(value));
+        return of_strings(std::move(texts));
+    }
+
+    Kind kind() const { return store_kind.load(std::memory_order_acquire); }
+    bool is_numeric() const { Kind k = kind(); return k == Kind::DOUBLE || k == Kind::INT || k == Kind::BOOL; }
+
+    // The typed stores. Only valid while kind() says so.
+    std::vector<double>& doubles() { return doubles_; }
+    const std::vector<double>& doubles() const { return doubles_; }
+    std::vector<int>& ints() { return ints_; }
+    const std::vector<int>& ints() const { return ints_; }
+    std::vector<uint8_t>& bools() { return bools_; }
+    const std::vector<uint8_t>& bools() const { return bools_; }
+    std::vector<BasicString>& strings() { return strings_; }
+    const std::vector<BasicString>& strings() const { return strings_; }
+
+    // --- Element access that never boxes ---
+    double number(size_t i) const;         // like to_double(get(i))
+    BasicValue get(size_t i) const;
+    void set(size_t i, const BasicValue& value);
+    std::vector<double> to_doubles() const;
+    // The elements as contiguous doubles: the store itself for a DOUBLE array,
+    // otherwise a converted copy placed in 'scratch'.
+    const double* numbers(std::vector<double>& scratch) const;
+
+    size_t size() const {
+        switch (kind()) {
+        case Kind::DOUBLE: return doubles_.size();
+        case Kind::INT: return ints_.size();
+        case Kind::BOOL: return bools_.size();
+        case Kind::STRING: return strings_.size();
+        default: return boxed.size();
+        }
+    }
+    bool empty() const { return size() == 0; }
+
+    void reserve(size_t n) {
+        switch (kind()) {
+        case Kind::DOUBLE: doubles_.reserve(n); break;
+        case Kind::INT: ints_.reserve(n); break;
+        case Kind::BOOL: bools_.reserve(n); break;
+        case Kind::STRING: strings_.reserve(n); break;
+        default: boxed.reserve(n); break;
+        }
+    }
+    void clear() {
+        release_typed();
+        boxed.clear();
+        store_kind.store(Kind::BOXED, std::memory_order_release);
+    }
+
+    void push_back(const BasicValue& value);
+    void push_back(BasicValue&& value);
+
+    // --- vector<BasicValue> interface ---
+    // Reads return copies and never box.
+    const BasicValue operator[](size_t i) const { return get(i); }
+    const BasicValue at(size_t i) const {
+        if (i >= size()) throw std::out_of_range("Array index out of bounds.");
+        return get(i);
+    }
+    const BasicValue front() const { return get(0); }
+    const BasicValue back() const { return get(size() - 1); }
+    const_iterator begin() const { return { this, 0 }; }
+    const_iterator end() const { return { this, size() }; }
+    const_iterator cbegin() const { return begin(); }
+    const_iterator cend() const { return end(); }
+    operator std::vector<BasicValue>() const;
+
+    template <typename... Args>
+    void emplace_back(Args&&... args) { push_back(BasicValue(std::forward<Args>(args)...)); }
+    void resize(size_t n) { resize(n, BasicValue{}); }
+    void resize(size_t n, const BasicValue& value);
+    void pop_back();
+    void insert(const_iterator pos, const BasicValue& value);
+    void insert(const_iterator pos, const_iterator first, const_iterator last);
+    void erase(const_iterator pos) { erase(pos, pos + 1); }
+    void erase(const_iterator first, const_iterator last);
+    template <typename... Args>
+    void assign(Args&&... args) { clear(); boxed.assign(std::forward<Args>(args)...); }
+
+    // The elements as boxed values that can be edited in place (sorting, writing
+    // through a reference). Converts the array to boxed storage for good.
+    std::vector<BasicValue>& boxed_values() { box(); return boxed; }
+
+    bool operator==(const ArrayData& other) const;
+
+private:
+    // Copies a typed store into 'boxed'. Arrays are shared by reference (e.g. with
+    // THREAD workers), so another thread may still be reading the typed store it
+    // saw before the switch: the store is kept until the array is cleared or
+    // assigned, and the mutex keeps two writers from boxing at once.
+    void box() {
+        if (kind() != Kind::BOXED) box_slow();
+    }
+    void box_slow();
+    // Whether a write of 'value' fits the typed store, as set() and push_back() decide.
+    bool fits(const BasicValue& value) const;
+    void release_typed() {
+        std::vector<double>().swap(doubles_);
+        std::vector<int>().swap(ints_);
+        std::vector<uint8_t>().swap(bools_);
+        std::vector<BasicString>().swap(strings_);
+    }
+    void copy_from(const ArrayData& other) {
+        Kind k = other.kind();
+        release_typed();
+        boxed.clear();
+        switch (k) {
+        case Kind::DOUBLE: doubles_ = other.doubles_; break;
+        case Kind::INT: ints_ = other.ints_; break;
+        case Kind::BOOL: bools_ = other.bools_; break;
+        case Kind::STRING: strings_ = other.strings_; break;
+        default: boxed = other.boxed; break;
+        }
+        store_kind.store(k, std::memory_order_release);
+    }
+    void move_from(ArrayData&& other) {
+        Kind k = other.kind();
+        boxed = std::move(other.boxed);
+        doubles_ = std::move(other.doubles_);
+        ints_ = std::move(other.ints_);
+        bools_ = std::move(other.bools_);
+        strings_ = std::move(other.strings_);
+        store_kind.store(k, std::memory_order_release);
+        other.clear();
+    }
+
+    std::vector<BasicValue> boxed;
+    std::vector<double> doubles_;
+    std::vector<int> ints_;
+    std::vector<uint8_t> bools_;
+    std::vector<BasicString> strings_;
+    std::atomic<Kind> store_kind{ Kind::BOXED };
+};
 
 // --- A structure to represent N-dimensional arrays ---
 struct Array {
-    std::vector<BasicValue> data; // The raw data, stored in a flat "raveled" format.
+    ArrayData data;               // The raw data, stored in a flat "raveled" format.
     std::vector<size_t> shape;    // The dimensions of the array. e.g., {5} for a vector, {2, 3} for a 2x3 matrix.
 
     // Default constructor for an empty array
@@ -235,22 +580,190 @@ struct Array {
 #endif     
 };
 
+// The keys of a MapData in insertion order, each key's position being its slot,
+// with an open-addressing hash index over them. All instances of one TYPE share
+// a single MapKeys (see NeReLaBasic::TypeInfo::layout), so an instance is little
+// more than its vector of member values.
+struct MapKeys {
+    static constexpr uint32_t NONE = UINT32_MAX;
+
+    std::vector<std::string> names;
+    std::vector<size_t> hashes;
+    std::vector<uint32_t> index;    // slots, NONE for a free bucket; 0 or a power of two buckets
+
+    static size_t hash(std::string_view key) { return std::hash<std::string_view>{}(key); }
+    size_t size() const { return names.size(); }
+
+    uint32_t find(std::string_view key, size_t h) const {
+        if (index.empty()) return NONE;
+        const size_t mask = index.size() - 1;
+        for (size_t i = h & mask;; i = (i + 1) & mask) {
+            uint32_t slot = index[i];
+            if (slot == NONE) return NONE;
+            if (hashes[slot] == h && names[slot] == key) return slot;
+        }
+    }
+    uint32_t find(std::string_view key) const { return find(key, hash(key)); }
+
+    uint32_t add(std::string key, size_t h) {
+        uint32_t slot = static_cast<uint32_t>(names.size());
+        names.push_back(std::move(key));
+        hashes.push_back(h);
+        if (names.size() * 4 > index.size() * 3) {
+            index.assign(index.empty() ? 8 : index.size() * 2, NONE);   // keep the load under 3/4
+            for (uint32_t s = 0; s < names.size(); ++s) place(s);
+        }
+        else {
+            place(slot);
+        }
+        return slot;
+    }
+
+private:
+    void place(uint32_t slot) {
+        const size_t mask = index.size() - 1;
+        size_t i = hashes[slot] & mask;
+        while (index[i] != NONE) i = (i + 1) & mask;
+        index[i] = slot;
+    }
+};
+
+// The contents of a Map: a hash map that iterates in insertion order. It keeps
+// the parts of the std::map interface the interpreter uses (find, at, count,
+// operator[], iteration over entries with .first/.second). The keys are shared
+// copy-on-write, so copying a Map or creating a TYPE instance copies only values.
+class MapData {
+public:
+    template <bool Const>
+    struct EntryRef {
+        const std::string& first;
+        std::conditional_t<Const, const BasicValue&, BasicValue&> second;
+        const EntryRef* operator->() const { return this; }
+    };
+
+    template <bool Const>
+    class Iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = EntryRef<Const>;
+        using difference_type = std::ptrdiff_t;
+        using pointer = EntryRef<Const>;
+        using reference = EntryRef<Const>;
+        using Owner = std::conditional_t<Const, const MapData, MapData>;
+
+        Iterator() = default;
+        Iterator(Owner* owner, size_t slot) : owner(owner), slot(slot) {}
+        operator Iterator<true>() const { return { owner, slot }; }
+
+        reference operator*() const { return { owner->keys->names[slot], owner->values[slot] }; }
+        pointer operator->() const { return **this; }
+        Iterator& operator++() { ++slot; return *this; }
+        Iterator operator++(int) { Iterator old = *this; ++slot; return old; }
+        bool operator==(const Iterator& other) const { return slot == other.slot; }
+        bool operator!=(const Iterator& other) const { return slot != other.slot; }
+
+    private:
+        Owner* owner = nullptr;
+        size_t slot = 0;
+    };
+
+    using iterator = Iterator<false>;
+    using const_iterator = Iterator<true>;
+
+    MapData() = default;
+    // An instance with one slot per key of 'layout', all holding 'init'.
+    MapData(std::shared_ptr<MapKeys> layout, std::vector<BasicValue> init)
+        : keys(std::move(layout)), values(std::move(init)) {}
+
+    size_t size() const { return values.size(); }
+    bool empty() const { return values.empty(); }
+    void clear() { keys.reset(); values.clear(); }
+
+    iterator begin() { return { this, 0 }; }
+    iterator end() { return { this, values.size() }; }
+    const_iterator begin() const { return { this, 0 }; }
+    const_iterator end() const { return { this, values.size() }; }
+
+    // The slot holding 'key', or MapKeys::NONE. Slots stay valid until the Map is cleared.
+    uint32_t slot_of(std::string_view key) const { return keys ? keys->find(key) : MapKeys::NONE; }
+    BasicValue& slot(uint32_t s) { return values[s]; }
+    const BasicValue& slot(uint32_t s) const { return values[s]; }
+
+    iterator find(std::string_view key) {
+        uint32_t s = slot_of(key);
+        return { this, s == MapKeys::NONE ? values.size() : s };
+    }
+    const_iterator find(std::string_view key) const {
+        uint32_t s = slot_of(key);
+        return { this, s == MapKeys::NONE ? values.size() : s };
+    }
+    size_t count(std::string_view key) const { return slot_of(key) == MapKeys::NONE ? 0 : 1; }
+    bool contains(std::string_view key) const { return count(key) != 0; }
+
+    BasicValue& at(std::string_view key) {
+        uint32_t s = slot_of(key);
+        if (s == MapKeys::NONE) throw std::out_of_range("Map key not found: " + std::string(key));
+        return values[s];
+    }
+    const BasicValue& at(std::string_view key) const {
+        uint32_t s = slot_of(key);
+        if (s == MapKeys::NONE) throw std::out_of_range("Map key not found: " + std::string(key));
+        return values[s];
+    }
+
+    // Inserts a default-constructed value for a new key, like std::map.
+    BasicValue& operator[](const std::string& key) {
+        size_t h = MapKeys::hash(key);
+        uint32_t s = keys ? keys->find(key, h) : MapKeys::NONE;
+        if (s != MapKeys::NONE) return values[s];
+        if (!keys) keys = std::make_shared<MapKeys>();
+        else if (keys.use_count() > 1) keys = std::make_shared<MapKeys>(*keys);
+        keys->add(key, h);
+        return values.emplace_back();
+    }
+
+private:
+    std::shared_ptr<MapKeys> keys;
+    std::vector<BasicValue> values;
+};
+
 // --- A structure to represent a Map (associative array) ---
 struct Map {
-    std::map<std::string, BasicValue> data;
+    MapData data;
     std::string type_name_if_udt; // Stores the name of the UDT, e.g., "T_SPRITE"
 };
 
 using GradFunc = std::function<std::vector<std::shared_ptr<Tensor>>(std::shared_ptr<Tensor>)>;
 
+ // Element type of a FloatArray / Tensor. FLOAT64 values live in 'data' and
+ // FLOAT32 values in 'data32'; the vector of the other type stays empty.
+ enum class DType {
+     FLOAT64,
+     FLOAT32
+ };
+
  struct FloatArray {
      std::vector<double> data;
+     std::vector<float> data32;
      std::vector<size_t> shape;
+     DType dtype = DType::FLOAT64;
 
      size_t size() const {
          if (shape.empty()) return 0;
          return std::accumulate(shape.begin(), shape.end(), 1, std::multiplies<size_t>());
      }
+
+     // The storage for element type T (double or float), for code templated on it.
+     template <typename T> std::vector<T>& values() {
+         if constexpr (std::is_same_v<T, float>) return data32; else return data;
+     }
+     template <typename T> const std::vector<T>& values() const {
+         if constexpr (std::is_same_v<T, float>) return data32; else return data;
+     }
+
+     // Number of stored elements and element i as a double, whatever the dtype.
+     size_t count() const { return dtype == DType::FLOAT32 ? data32.size() : data.size(); }
+     double at(size_t i) const { return dtype == DType::FLOAT32 ? data32[i] : data[i]; }
  };
 
 
@@ -261,9 +774,35 @@ struct Tensor {
     // --- For Autodiff ---
     std::vector<std::shared_ptr<Tensor>> parents; // Tensors this one was created from
     GradFunc backward_fn = nullptr; // The function to compute the gradient
+    bool released = false; // A backward pass already ran through this node and freed its inputs
+
+    // Position on the tape: tensors are numbered in creation order, and a node is
+    // always created after its parents, so a graph sorted by descending id lists
+    // every node before its inputs.
+    uint64_t id = next_id();
+
+    static uint64_t next_id() {
+        static std::atomic<uint64_t> counter{ 0 };
+        return counter.fetch_add(1, std::memory_order_relaxed) + 1;
+    }
 
-    // A flag to prevent re-computing gradients in complex graphs
-    bool has_been_processed = false;
+    // A graph can be hundreds of thousands of nodes deep. Letting each node release
+    // its parents from its own destructor would recurse once per node, so the
+    // inputs of nodes that are about to die are collected on a heap stack instead.
+    ~Tensor() {
+        if (parents.empty()) return;
+        std::vector<std::shared_ptr<Tensor>> dying = std::move(parents);
+        backward_fn = nullptr;
+        while (!dying.empty()) {
+            std::shared_ptr<Tensor> node = std::move(dying.back());
+            dying.pop_back();
+            if (node && node.use_count() == 1 && !node->parents.empty()) {
+                for (auto& parent : node->parents) dying.push_back(std::move(parent));
+                node->parents.clear();
+                node->backward_fn = nullptr;
+            }
+        }
+    }
 };
 
 //==============================================================================
@@ -272,69 +811,223 @@ struct Tensor {
 // multiple .cpp files without causing linker errors.
 //==============================================================================
 
-// Helper to convert a BasicValue to a int for math operations.
+// Helpers to convert a BasicValue to a number or a boolean. Each is a single
+// switch on the alternative. Booleans count as 1 or 0, a single-element array
+// is coerced to its element, everything else is 0 / false.
+
+// Truncates a double, as BASIC's INT function does.
 inline int to_int(const BasicValue& val) {
-    if (std::holds_alternative<int>(val)) {
-        return std::get<int>(val);
+    switch (val.index()) {
+    case value_index<int>: return *std::get_if<int>(&val);
+    case value_index<double>: return static_cast<int>(*std::get_if<double>(&val));
+    case value_index<bool>: return *std::get_if<bool>(&val) ? 1 : 0;
+    case value_index<std::shared_ptr<Array>>: {
+        const auto& arr_ptr = *std::get_if<std::shared_ptr<Array>>(&val);
+        return arr_ptr && arr_ptr->data.size() == 1 ? to_int(arr_ptr->data.get(0)) : 0;
+    }
+    default: return 0;
     }
-    if (std::holds_alternative<double>(val)) {
-        // Truncate the double, as BASIC's INT function does.
-        return static_cast<int>(std::get<double>(val));
+}
+
+inline double to_double(const BasicValue& val) {
+    switch (val.index()) {
+    case value_index<double>: return *std::get_if<double>(&val);
+    case value_index<int>: return static_cast<double>(*std::get_if<int>(&val));
+    case value_index<bool>: return *std::get_if<bool>(&val) ? 1.0 : 0.0;
+    case value_index<std::shared_ptr<Array>>: {
+        const auto& arr_ptr = *std::get_if<std::shared_ptr<Array>>(&val);
+        return arr_ptr && arr_ptr->data.size() == 1 ? arr_ptr->data.number(0) : 0.0;
     }
-    if (std::holds_alternative<bool>(val)) {
-        return std::get<bool>(val) ? 1 : 0;
+    default: return 0.0;
     }
-    if (std::holds_alternative<std::shared_ptr<Array>>(val)) {
-        const auto& arr_ptr = std::get<std::shared_ptr<Array>>(val);
-        if (arr_ptr && arr_ptr->data.size() == 1) {
-            // Coerce single-element array to a number
-            return to_int(arr_ptr->data[0]);
-        }
+}
+
+// Any non-zero number is true.
+inline bool to_bool(const BasicValue& val) {
+    switch (val.index()) {
+    case value_index<bool>: return *std::get_if<bool>(&val);
+    case value_index<double>: return *std::get_if<double>(&val) != 0.0;
+    case value_index<std::shared_ptr<Array>>: {
+        const auto& arr_ptr = *std::get_if<std::shared_ptr<Array>>(&val);
+        return arr_ptr && arr_ptr->data.size() == 1 ? to_bool(arr_ptr->data.get(0)) : false;
+    }
+    default: return false;
     }
-    return 0;
 }
 
-// Helper to convert a BasicValue to a double for math operations.
-// This is called "coercion". It treats booleans as 1.0 or 0.0.
 
-inline double to_double(const BasicValue& val) {
-    if (std::holds_alternative<double>(val)) {
-        return std::get<double>(val);
+//==============================================================================
+// ArrayData members that need the conversion helpers above.
+//==============================================================================
+
+inline double ArrayData::number(size_t i) const {
+    switch (kind()) {
+    case Kind::DOUBLE: return doubles_[i];
+    case Kind::INT: return static_cast<double>(ints_[i]);
+    case Kind::BOOL: return bools_[i] ? 1.0 : 0.0;
+    case Kind::STRING: return 0.0;
+    default: return to_double(boxed[i]);
     }
-    if (std::holds_alternative<int>(val)) { 
-        return static_cast<double>(std::get<int>(val));
+}
+
+inline BasicValue ArrayData::get(size_t i) const {
+    switch (kind()) {
+    case Kind::DOUBLE: return doubles_[i];
+    case Kind::INT: return ints_[i];
+    case Kind::BOOL: return bools_[i] != 0;
+    case Kind::STRING: return strings_[i];
+    default: return boxed[i];
     }
-    if (std::holds_alternative<bool>(val)) {
-        return std::get<bool>(val) ? 1.0 : 0.0;
+}
+
+inline void ArrayData::set(size_t i, const BasicValue& value) {
+    switch (kind()) {
+    case Kind::DOUBLE:
+        if (auto* d = std::get_if<double>(&value)) { doubles_[i] = *d; return; }
+        if (auto* n = std::get_if<int>(&value)) { doubles_[i] = *n; return; } // a double array stays numeric
+        break;
+    case Kind::INT: if (auto* n = std::get_if<int>(&value)) { ints_[i] = *n; return; } break;
+    case Kind::BOOL: if (auto* b = std::get_if<bool>(&value)) { bools_[i] = *b; return; } break;
+    case Kind::STRING: if (auto* s = std::get_if<BasicString>(&value)) { strings_[i] = *s; return; } break;
+    default: break;
     }
-    // Check if it holds a pointer to an array
-    if (std::holds_alternative<std::shared_ptr<Array>>(val)) {
-        const auto& arr_ptr = std::get<std::shared_ptr<Array>>(val);
-        if (arr_ptr && arr_ptr->data.size() == 1) {
-            // Coerce single-element array to a number
-            return to_double(arr_ptr->data[0]);
-        }
+    box();
+    boxed[i] = value;
+}
+
+inline std::vector<double> ArrayData::to_doubles() const {
+    if (kind() == Kind::DOUBLE) return doubles_;
+    std::vector<double> out(size());
+    for (size_t i = 0; i < out.size(); ++i) out[i] = number(i);
+    return out;
+}
+
+inline const double* ArrayData::numbers(std::vector<double>& scratch) const {
+    if (kind() == Kind::DOUBLE) return doubles_.data();
+    scratch = to_doubles();
+    return scratch.data();
+}
+
+inline void ArrayData::push_back(const BasicValue& value) {
+    switch (kind()) {
+    case Kind::DOUBLE:
+        if (auto* d = std::get_if<double>(&value)) { doubles_.push_back(*d); return; }
+        if (auto* n = std::get_if<int>(&value)) { doubles_.push_back(*n); return; }
+        break;
+    case Kind::INT: if (auto* n = std::get_if<int>(&value)) { ints_.push_back(*n); return; } break;
+    case Kind::BOOL: if (auto* b = std::get_if<bool>(&value)) { bools_.push_back(*b); return; } break;
+    case Kind::STRING: if (auto* s = std::get_if<BasicString>(&value)) { strings_.push_back(*s); return; } break;
+    default: break;
     }
-    return 0.0;
+    box();
+    boxed.push_back(value);
 }
 
-// Helper to convert a BasicValue to a boolean for logic operations.
-// It treats any non-zero number as true.
-inline bool to_bool(const BasicValue& val) {
-    if (std::holds_alternative<bool>(val)) {
-        return std::get<bool>(val);
-    }
-    if (std::holds_alternative<double>(val)) {
-        return std::get<double>(val) != 0.0;
-    }
-    // Check if it holds a pointer to an array
-    if (std::holds_alternative<std::shared_ptr<Array>>(val)) {
-        const auto& arr_ptr = std::get<std::shared_ptr<Array>>(val);
-        if (arr_ptr && arr_ptr->data.size() == 1) {
-            // Coerce single-element array to a bool
-            return to_bool(arr_ptr->data[0]);
+inline void ArrayData::push_back(BasicValue&& value) {
+    if (kind() == Kind::STRING) {
+        if (auto* s = std::get_if<BasicString>(&value)) { strings_.push_back(std::move(*s)); return; }
+    }
+    else if (kind() == Kind::BOXED) {
+        boxed.push_back(std::move(value));
+        return;
+    }
+    push_back(static_cast<const BasicValue&>(value));
+}
+
+inline bool ArrayData::operator==(const ArrayData& other) const {
+    Kind k = kind();
+    if (k == other.kind()) {
+        switch (k) {
+        case Kind::DOUBLE: return doubles_ == other.doubles_;
+        case Kind::INT: return ints_ == other.ints_;
+        case Kind::BOOL: return bools_ == other.bools_;
+        case Kind::STRING: return strings_ == other.strings_;
+        default: return boxed == other.boxed;
         }
     }
-    return false;
+    if (size() != other.size()) return false;
+    for (size_t i = 0; i < size(); ++i) {
+        if (!(get(i) == other.get(i))) return false;
+    }
+    return true;
 }
 
+inline void ArrayData::box_slow() {
+    static std::mutex box_mutex;
+    std::lock_guard<std::mutex> lock(box_mutex);
+    Kind k = kind();
+    if (k == Kind::BOXED) return;
+    std::vector<BasicValue> values;
+    values.reserve(size());
+    for (size_t i = 0; i < size(); ++i) values.push_back(get(i));
+    boxed = std::move(values);
+    store_kind.store(Kind::BOXED, std::memory_order_release);
+}
+
+inline bool ArrayData::fits(const BasicValue& value) const {
+    switch (kind()) {
+    case Kind::DOUBLE: return std::holds_alternative<double>(value) || std::holds_alternative<int>(value);
+    case Kind::INT: return std::holds_alternative<int>(value);
+    case Kind::BOOL: return std::holds_alternative<bool>(value);
+    case Kind::STRING: return std::holds_alternative<BasicString>(value);
+    default: return true;
+    }
+}
+
+inline ArrayData::operator std::vector<BasicValue>() const {
+    if (kind() == Kind::BOXED) return boxed;
+    std::vector<BasicValue> values;
+    values.reserve(size());
+    for (size_t i = 0; i < size(); ++i) values.push_back(get(i));
+    return values;
+}
+
+inline void ArrayData::resize(size_t n, const BasicValue& value) {
+    if (!fits(value)) box();
+    switch (kind()) {
+    case Kind::DOUBLE: doubles_.resize(n, to_double(value)); break;
+    case Kind::INT: ints_.resize(n, *std::get_if<int>(&value)); break;
+    case Kind::BOOL: bools_.resize(n, *std::get_if<bool>(&value)); break;
+    case Kind::STRING: strings_.resize(n, *std::get_if<BasicString>(&value)); break;
+    default: boxed.resize(n, value); break;
+    }
+}
+
+inline void ArrayData::pop_back() {
+    switch (kind()) {
+    case Kind::DOUBLE: doubles_.pop_back(); break;
+    case Kind::INT: ints_.pop_back(); break;
+    case Kind::BOOL: bools_.pop_back(); break;
+    case Kind::STRING: strings_.pop_back(); break;
+    default: boxed.pop_back(); break;
+    }
+}
+
+inline void ArrayData::insert(const_iterator pos, const BasicValue& value) {
+    if (!fits(value)) box();
+    const auto at = static_cast<std::ptrdiff_t>(pos.position());
+    switch (kind()) {
+    case Kind::DOUBLE: doubles_.insert(doubles_.begin() + at, to_double(value)); break;
+    case Kind::INT: ints_.insert(ints_.begin() + at, *std::get_if<int>(&value)); break;
+    case Kind::BOOL: bools_.insert(bools_.begin() + at, *std::get_if<bool>(&value)); break;
+    case Kind::STRING: strings_.insert(strings_.begin() + at, *std::get_if<BasicString>(&value)); break;
+    default: boxed.insert(boxed.begin() + at, value); break;
+    }
+}
+
+inline void ArrayData::insert(const_iterator pos, const_iterator first, const_iterator last) {
+    std::vector<BasicValue> values(first, last); // 'first' may point into this array
+    for (size_t i = 0; i < values.size(); ++i) insert(pos + i, values[i]);
+}
+
+inline void ArrayData::erase(const_iterator first, const_iterator last) {
+    const auto from = static_cast<std::ptrdiff_t>(first.position());
+    const auto to = static_cast<std::ptrdiff_t>(last.position());
+    switch (kind()) {
+    case Kind::DOUBLE: doubles_.erase(doubles_.begin() + from, doubles_.begin() + to); break;
+    case Kind::INT: ints_.erase(ints_.begin() + from, ints_.begin() + to); break;
+    case Kind::BOOL: bools_.erase(bools_.begin() + from, bools_.begin() + to); break;
+    case Kind::STRING: strings_.erase(strings_.begin() + from, strings_.begin() + to); break;
+    default: boxed.erase(boxed.begin() + from, boxed.begin() + to); break;
+    }
+}
@@ -0,0 +1,225 @@
+// Variables.hpp
+#pragma once
+#include "Types.hpp"
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <utility>
+#include <unordered_map>
+#include <stdexcept>
+#include <algorithm>
+
+// Maps variable names to slot numbers. The compiler interns every identifier it
+// sees, so at runtime a name can be resolved to a slot once and the slot index
+// used from then on. Slot numbers are never reused or moved.
+class SlotLayout {
+public:
+    uint32_t intern(const std::string& name) {
+        auto it = index.find(name);
+        if (it != index.end()) return it->second;
+        uint32_t slot = static_cast<uint32_t>(names.size());
+        index.emplace(name, slot);
+        names.push_back(name);
+        return slot;
+    }
+
+    int32_t find(const std::string& name) const {
+        auto it = index.find(name);
+        return it == index.end() ? -1 : static_cast<int32_t>(it->second);
+    }
+
+    const std::string& name_of(uint32_t slot) const { return names[slot]; }
+    size_t size() const { return names.size(); }
+
+private:
+    std::unordered_map<std::string, uint32_t> index;
+    std::vector<std::string> names;
+};
+
+namespace VariableDetail {
+    // Iterates over the defined slots (and then the overflow map) of a variable
+    // table, yielding (name, value) pairs like the unordered_map it replaces.
+    template <typename Table>
+    class Iterator {
+    public:
+        using value_type = std::pair<const std::string&, const BasicValue&>;
+
+        Iterator(const Table* t, size_t s, typename Table::ExtraMap::const_iterator e) : table(t), slot(s), extra(e) { skip(); }
+
+        value_type operator*() const {
+            if (slot < table->defined.size()) return { table->layout->name_of(static_cast<uint32_t>(slot)), table->values[slot] };
+            return { extra->first, extra->second };
+        }
+        Iterator& operator++() {
+            if (slot < table->defined.size()) { ++slot; skip(); }
+            else ++extra;
+            return *this;
+        }
+        bool operator!=(const Iterator& other) const { return slot != other.slot || extra != other.extra; }
+
+    private:
+        const Table* table;
+        size_t slot;
+        typename Table::ExtraMap::const_iterator extra;
+
+        void skip() { while (slot < table->defined.size() && !table->defined[slot]) ++slot; }
+    };
+}
+
+// The global variables. Names are interned into the table's own layout, which
+// keeps growing as new names appear. A deque keeps references to values stable
+// while new slots are added.
+class GlobalVariables {
+public:
+    using ExtraMap = std::unordered_map<std::string, BasicValue>;
+    using const_iterator = VariableDetail::Iterator<GlobalVariables>;
+
+    GlobalVariables() : layout(std::make_shared<SlotLayout>()) {}
+
+    // An empty table that uses a copy of an existing slot numbering.
+    explicit GlobalVariables(const SlotLayout& numbering)
+        : layout(std::make_shared<SlotLayout>(numbering)), values(numbering.size()), defined(numbering.size(), 0) {
+    }
+
+    // Copies get their own layout: the layout keeps growing at runtime and
+    // must not be shared with a VM running on another thread.
+    GlobalVariables(const GlobalVariables& other)
+        : layout(std::make_shared<SlotLayout>(*other.layout)), values(other.values), defined(other.defined) {
+    }
+    GlobalVariables& operator=(const GlobalVariables& other) {
+        if (this != &other) {
+            layout = std::make_shared<SlotLayout>(*other.layout);
+            values = other.values;
+            defined = other.defined;
+        }
+        return *this;
+    }
+
+    // Returns the slot for 'name', creating an (undefined) slot if necessary.
+    uint32_t intern(const std::string& name) {
+        uint32_t slot = layout->intern(name);
+        if (slot >= values.size()) {
+            values.resize(slot + 1);
+            defined.resize(slot + 1, 0);
+        }
+        return slot;
+    }
+
+    const SlotLayout& get_layout() const { return *layout; }
+    bool is_defined(uint32_t slot) const { return slot < defined.size() && defined[slot]; }
+
+    // Like operator[]: returns the value in 'slot' and marks it as defined.
+    BasicValue& slot(uint32_t slot) {
+        defined[slot] = 1;
+        return values[slot];
+    }
+
+    // --- map-style access by name ---
+    BasicValue& operator[](const std::string& name) { return slot(intern(name)); }
+
+    size_t count(const std::string& name) const {
+        int32_t s = layout->find(name);
+        return (s >= 0 && is_defined(s)) ? 1 : 0;
+    }
+    bool contains(const std::string& name) const { return count(name) != 0; }
+
+    BasicValue& at(const std::string& name) {
+        int32_t s = layout->find(name);
+        if (s < 0 || !is_defined(s)) throw std::out_of_range("variable not found: " + name);
+        return values[s];
+    }
+    const BasicValue& at(const std::string& name) const {
+        return const_cast<GlobalVariables*>(this)->at(name);
+    }
+
+    // Removes all values but keeps the slot numbering, so names resolved by the
+    // compiler stay valid across RUNs.
+    void clear() {
+        for (auto& v : values) v = false;
+        std::fill(defined.begin(), defined.end(), 0);
+    }
+
+    bool empty() const { return !(begin() != end()); }
+
+    const_iterator begin() const { return const_iterator(this, 0, extra.end()); }
+    const_iterator end() const { return const_iterator(this, defined.size(), extra.end()); }
+
+private:
+    friend class VariableDetail::Iterator<GlobalVariables>;
+    std::shared_ptr<SlotLayout> layout;
+    std::deque<BasicValue> values;
+    std::vector<uint8_t> defined;
+    ExtraMap extra; // always empty; lets globals share the iterator with locals
+};
+
+// The local variables of one stack frame. The slots come from the layout the
+// compiler built for the function (parameters first, then every name used in
+// its body); the layout is frozen after compilation, so it can be shared by all
+// frames and threads. Names the layout does not know (e.g. from EXECUTE) go into
+// a small overflow map.
+class LocalVariables {
+public:
+    using ExtraMap = std::unordered_map<std::string, BasicValue>;
+    using const_iterator = VariableDetail::Iterator<LocalVariables>;
+
+    LocalVariables() = default;
+    explicit LocalVariables(std::shared_ptr<const SlotLayout> function_layout)
+        : layout(std::move(function_layout)) {
+        if (layout) {
+            values.resize(layout->size());
+            defined.resize(layout->size(), 0);
+        }
+    }
+
+    const SlotLayout* get_layout() const { return layout.get(); }
+
+    bool is_defined(uint32_t slot) const { return slot < defined.size() && defined[slot]; }
+    BasicValue& slot(uint32_t slot) {
+        defined[slot] = 1;
+        return values[slot];
+    }
+
+    // Returns a pointer to the variable, or nullptr if it is not defined in this frame.
+    BasicValue* find(const std::string& name) {
+        if (layout) {
+            int32_t s = layout->find(name);
+            if (s >= 0) return defined[s] ? &values[s] : nullptr;
+        }
+        if (extra.empty()) return nullptr;
+        auto it = extra.find(name);
+        return it == extra.end() ? nullptr : &it->second;
+    }
+
+    bool has_extra() const { return !extra.empty(); }
+
+    // --- map-style access by name ---
+    BasicValue& operator[](const std::string& name) {
+        if (layout) {
+            int32_t s = layout->find(name);
+            if (s >= 0) return slot(s);
+        }
+        return extra[name];
+    }
+
+    size_t count(const std::string& name) const { return const_cast<LocalVariables*>(this)->find(name) ? 1 : 0; }
+    bool contains(const std::string& name) const { return count(name) != 0; }
+
+    BasicValue& at(const std::string& name) {
+        BasicValue* v = find(name);
+        if (!v) throw std::out_of_range("variable not found: " + name);
+        return *v;
+    }
+
+    bool empty() const { return !(begin() != end()); }
+
+    const_iterator begin() const { return const_iterator(this, 0, extra.begin()); }
+    const_iterator end() const { return const_iterator(this, defined.size(), extra.end()); }
+
+private:
+    friend class VariableDetail::Iterator<LocalVariables>;
+    std::shared_ptr<const SlotLayout> layout;
+    std::vector<BasicValue> values;
+    std::vector<uint8_t> defined;
+    ExtraMap extra;
+};
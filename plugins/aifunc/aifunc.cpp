@@ -80,12 +80,23 @@ BasicValue builtin_adam_update(NeReLaBasic& vm, const std::vector<BasicValue>& a
                     continue;
                 }
 
+                // The moments are kept in the parameter's dtype (float32 or float64);
+                // the gradient always has the dtype of its tensor.
+                const DType dtype = param_tensor->data->dtype;
+                auto moments_match = [&]() {
+                    const auto& m_val = m_layer_state->data[param_name];
+                    return std::holds_alternative<std::shared_ptr<Tensor>>(m_val) && std::get<std::shared_ptr<Tensor>>(m_val)->data->dtype == dtype;
+                    };
+
                 // Initialize optimizer state for this tensor if it's the first time
-                if (m_layer_state->data.find(param_name) == m_layer_state->data.end()) {
+                // (or the parameter was replaced by one of another dtype)
+                if (m_layer_state->data.find(param_name) == m_layer_state->data.end() || !moments_match()) {
                     // --- FIX: Create two SEPARATE zero-filled arrays for m and v ---
                     auto m_zero_data = std::make_shared<FloatArray>();
                     m_zero_data->shape = param_tensor->data->shape;
-                    m_zero_data->data.assign(param_tensor->data->size(), 0.0);
+                    m_zero_data->dtype = dtype;
+                    if (dtype == DType::FLOAT32) m_zero_data->data32.assign(param_tensor->data->size(), 0.0f);
+                    else m_zero_data->data.assign(param_tensor->data->size(), 0.0);
 
                     auto m_tensor_init = std::make_shared<Tensor>();
                     m_tensor_init->data = m_zero_data;
@@ -93,7 +104,9 @@ BasicValue builtin_adam_update(NeReLaBasic& vm, const std::vector<BasicValue>& a
 
                     auto v_zero_data = std::make_shared<FloatArray>();
                     v_zero_data->shape = param_tensor->data->shape;
-                    v_zero_data->data.assign(param_tensor->data->size(), 0.0);
+                    v_zero_data->dtype = dtype;
+                    if (dtype == DType::FLOAT32) v_zero_data->data32.assign(param_tensor->data->size(), 0.0f);
+                    else v_zero_data->data.assign(param_tensor->data->size(), 0.0);
 
                     auto v_tensor_init = std::make_shared<Tensor>();
                     v_tensor_init->data = v_zero_data;
@@ -108,18 +121,27 @@ BasicValue builtin_adam_update(NeReLaBasic& vm, const std::vector<BasicValue>& a
                 auto& grad = param_tensor->grad->data;
 
                 // Apply Adam update rule to each element of the tensor
-                for (size_t i = 0; i < param_tensor->data->size(); ++i) {
-                    // Update biased first moment estimate
-                    m->data[i] = beta1 * m->data[i] + (1.0 - beta1) * grad->data[i];
-                    // Update biased second raw moment estimate
-                    v->data[i] = beta2 * v->data[i] + (1.0 - beta2) * std::pow(grad->data[i], 2);
-                    // Compute bias-corrected first moment estimate
-                    double m_hat = m->data[i] / (1.0 - std::pow(beta1, t));
-                    // Compute bias-corrected second raw moment estimate
-                    double v_hat = v->data[i] / (1.0 - std::pow(beta2, t));
-                    // Update parameters
-                    param_tensor->data->data[i] -= lr * m_hat / (std::sqrt(v_hat) + epsilon);
-                }
+                auto adam_step = [&](auto zero) {
+                    using T = decltype(zero);
+                    auto& m_values = m->values<T>();
+                    auto& v_values = v->values<T>();
+                    const auto& g = grad->values<T>();
+                    auto& w = param_tensor->data->values<T>();
+                    for (size_t i = 0; i < param_tensor->data->size(); ++i) {
+                        // Update biased first moment estimate
+                        m_values[i] = static_cast<T>(beta1 * m_values[i] + (1.0 - beta1) * g[i]);
+                        // Update biased second raw moment estimate
+                        v_values[i] = static_cast<T>(beta2 * v_values[i] + (1.0 - beta2) * std::pow(g[i], 2));
+                        // Compute bias-corrected first moment estimate
+                        double m_hat = m_values[i] / (1.0 - std::pow(beta1, t));
+                        // Compute bias-corrected second raw moment estimate
+                        double v_hat = v_values[i] / (1.0 - std::pow(beta2, t));
+                        // Update parameters
+                        w[i] -= static_cast<T>(lr * m_hat / (std::sqrt(v_hat) + epsilon));
+                    }
+                    };
+                if (dtype == DType::FLOAT32) adam_step(float{});
+                else adam_step(double{});
                 // Clear the gradient after updating
                 param_tensor->grad = nullptr;
             }
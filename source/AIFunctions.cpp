@@ -3,14 +3,18 @@
 #include "Types.hpp"
 #include "BuiltinFunctions.hpp" // For functions like builtin_transpose
 #include "Commands.hpp"       // For utility functions like to_double, to_string
+#include "Kernels.hpp"
 #include <random>
 #include <functional>
-#include <unordered_set>
+#include <unordered_map>
 #include <cmath>
 #include <fstream>
 #include <limits>
 #include <algorithm>
 #include <memory>
+#include <atomic>
+#include <bit>
+#include <numeric>
 #include <omp.h>
 
 // Forward declarations for functions defined in this file
@@ -31,17 +35,152 @@ std::shared_ptr<Array> array_subtract(const std::shared_ptr<Array>& a, const std
 // --- Helper Namespace for AI-specific utilities ---
 namespace {
 
+    // Storage for the FloatArrays produced by the tensor ops and their gradients.
+    // Freed arrays are kept in buckets by dtype and capacity (2^k elements,
+    // requests round up) and handed out again, so a training loop that rebuilds
+    // the same graph every step stops allocating after the first one. Each thread
+    // keeps its own pool; an array freed on another thread simply joins that
+    // thread's pool.
+    struct PoolStats {
+        std::atomic<uint64_t> requests{ 0 };
+        std::atomic<uint64_t> allocations{ 0 };
+    };
+    PoolStats pool_stats;
+
+    size_t capacity_bytes(const FloatArray& arr) {
+        return arr.data.capacity() * sizeof(double) + arr.data32.capacity() * sizeof(float);
+    }
+
+    class FloatArrayPool {
+    public:
+        static constexpr size_t MAX_POOLED_BYTES = size_t(64) << 20; // per thread
+
+        ~FloatArrayPool() { destroyed = true; }
+
+        std::shared_ptr<FloatArray> acquire(std::vector<size_t> shape, size_t n, DType dtype) {
+            pool_stats.requests.fetch_add(1, std::memory_order_relaxed);
+            const unsigned k = static_cast<unsigned>(std::bit_width(n > 0 ? n - 1 : 0));
+            auto& bucket = buckets[static_cast<size_t>(dtype)][k];
+            std::unique_ptr<FloatArray> arr;
+            if (!bucket.empty()) {
+                arr = std::move(bucket.back());
+                bucket.pop_back();
+                pooled_bytes -= capacity_bytes(*arr);
+            }
+            else {
+                pool_stats.allocations.fetch_add(1, std::memory_order_relaxed);
+                arr = std::make_unique<FloatArray>();
+                arr->dtype = dtype;
+                if (dtype == DType::FLOAT32) arr->data32.reserve(size_t(1) << k);
+                else arr->data.reserve(size_t(1) << k);
+            }
+            arr->shape = std::move(shape);
+            if (dtype == DType::FLOAT32) arr->data32.resize(n);
+            else arr->data.resize(n);
+            return std::shared_ptr<FloatArray>(arr.release(), [](FloatArray* p) { release(p); });
+        }
+
+        size_t bytes() const { return pooled_bytes; }
+
+        static FloatArrayPool& local() {
+            thread_local FloatArrayPool pool;
+            return pool;
+        }
+
+    private:
+        static void release(FloatArray* p) {
+            // Arrays that outlive the thread's pool (at exit) are freed directly.
+            if (destroyed) { delete p; return; }
+            FloatArrayPool& pool = local();
+            const size_t capacity = p->dtype == DType::FLOAT32 ? p->data32.capacity() : p->data.capacity();
+            const size_t bytes = capacity_bytes(*p);
+            if (capacity == 0 || pool.pooled_bytes + bytes > MAX_POOLED_BYTES) { delete p; return; }
+            pool.pooled_bytes += bytes;
+            pool.buckets[static_cast<size_t>(p->dtype)][std::bit_width(capacity) - 1].emplace_back(p);
+        }
+
+        static thread_local bool destroyed;
+        std::vector<std::unique_ptr<FloatArray>> buckets[2][64];
+        size_t pooled_bytes = 0;
+    };
+    thread_local bool FloatArrayPool::destroyed = false;
+
+    // --- Element types ---
+    // The tensor ops are written once as generic lambdas over the element type T
+    // and instantiated for double and float through dispatch(). Sums over a row
+    // or a whole tensor are accumulated in double for both.
+    template <typename T> constexpr DType dtype_of = std::is_same_v<T, float> ? DType::FLOAT32 : DType::FLOAT64;
+
+    template <typename F> decltype(auto) dispatch(DType dtype, F&& f) {
+        if (dtype == DType::FLOAT32) return f(float{});
+        return f(double{});
+    }
+
+    // An op on tensors of different dtypes runs in float32: float64 data (from
+    // TENSOR.FROM, say) is converted as it enters a float32 model.
+    DType common_dtype(std::initializer_list<const std::shared_ptr<FloatArray>*> arrays) {
+        for (const auto* arr : arrays) {
+            if (*arr && (*arr)->dtype == DType::FLOAT32) return DType::FLOAT32;
+        }
+        return DType::FLOAT64;
+    }
+
+    const char* dtype_name(DType dtype) {
+        return dtype == DType::FLOAT32 ? "float32" : "float64";
+    }
+
+    // "float32" / "float64" (any case) to a DType; false for anything else.
+    bool parse_dtype(const std::string& name, DType& dtype) {
+        std::string lower = name;
+        std::transform(lower.begin(), lower.end(), lower.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+        if (lower == "float32") { dtype = DType::FLOAT32; return true; }
+        if (lower == "float64") { dtype = DType::FLOAT64; return true; }
+        return false;
+    }
+
+    // A pooled array of the given shape. The contents are unspecified unless 'fill' is given.
+    std::shared_ptr<FloatArray> new_float_array(std::vector<size_t> shape, DType dtype = DType::FLOAT64) {
+        size_t n = shape.empty() ? 0 : std::accumulate(shape.begin(), shape.end(), size_t(1), std::multiplies<size_t>());
+        return FloatArrayPool::local().acquire(std::move(shape), n, dtype);
+    }
+
+    std::shared_ptr<FloatArray> new_float_array(std::vector<size_t> shape, double fill, DType dtype = DType::FLOAT64) {
+        auto arr = new_float_array(std::move(shape), dtype);
+        dispatch(dtype, [&](auto zero) {
+            using T = decltype(zero);
+            std::fill(arr->values<T>().begin(), arr->values<T>().end(), static_cast<T>(fill));
+            });
+        return arr;
+    }
+
+    // 'arr' itself if it already has the given dtype, else a converted copy.
+    std::shared_ptr<FloatArray> as_dtype(const std::shared_ptr<FloatArray>& arr, DType dtype) {
+        if (!arr || arr->dtype == dtype) return arr;
+        auto result = new_float_array(arr->shape, dtype);
+        if (dtype == DType::FLOAT32) std::copy(arr->data.begin(), arr->data.end(), result->data32.begin());
+        else std::copy(arr->data32.begin(), arr->data32.end(), result->data.begin());
+        return result;
+    }
+
+    std::shared_ptr<Tensor> tensor_of(std::shared_ptr<FloatArray> data) {
+        auto t = std::make_shared<Tensor>();
+        t->data = std::move(data);
+        return t;
+    }
+
     // A numerically stable implementation of the sigmoid function.
-    double sigmoid(double x) {
-        return 1.0 / (1.0 + std::exp(-x));
+    template <typename T>
+    T sigmoid(T x) {
+        return T(1) / (T(1) + std::exp(-x));
     }
 
     /**
          * @brief Creates a FloatArray with a given shape, initialized with random values.
          */
-    std::shared_ptr<FloatArray> create_randomized_float_array(const std::vector<size_t>& shape, size_t fan_in, size_t fan_out) {
+    std::shared_ptr<FloatArray> create_randomized_float_array(const std::vector<size_t>& shape, size_t fan_in, size_t fan_out, DType dtype) {
         auto array_ptr = std::make_shared<FloatArray>();
         array_ptr->shape = shape;
+        array_ptr->dtype = dtype;
 
         double limit = std::sqrt(6.0 / (fan_in + fan_out));
         std::random_device rd;
@@ -49,69 +188,75 @@ namespace {
         std::uniform_real_distribution<> distr(-limit, limit);
 
         size_t total_elements = array_ptr->size();
-        array_ptr->data.reserve(total_elements);
-
-        for (size_t i = 0; i < total_elements; ++i) {
-            array_ptr->data.push_back(distr(gen));
-        }
+        dispatch(dtype, [&](auto zero) {
+            using T = decltype(zero);
+            auto& values = array_ptr->values<T>();
+            values.reserve(total_elements);
+            for (size_t i = 0; i < total_elements; ++i) {
+                values.push_back(static_cast<T>(distr(gen)));
+            }
+            });
         return array_ptr;
     }
 
-    std::shared_ptr<FloatArray> transpose_float_array(const std::shared_ptr<FloatArray>& arr) {
-        if (!arr || arr->shape.size() != 2) return nullptr;
-        size_t rows = arr->shape[0];
-        size_t cols = arr->shape[1];
-        auto result = std::make_shared<FloatArray>();
-        result->shape = { cols, rows };
-        result->data.resize(rows * cols);
-        for (size_t r = 0; r < rows; ++r) {
-            for (size_t c = 0; c < cols; ++c) {
-                result->data[c * rows + r] = arr->data[r * cols + c];
-            }
-        }
-        return result;
+    // An unpooled array filled with one value, for parameters that live as long as the model.
+    std::shared_ptr<FloatArray> create_filled_float_array(const std::vector<size_t>& shape, double fill, DType dtype) {
+        auto array_ptr = std::make_shared<FloatArray>();
+        array_ptr->shape = shape;
+        array_ptr->dtype = dtype;
+        dispatch(dtype, [&](auto zero) {
+            using T = decltype(zero);
+            array_ptr->values<T>().assign(array_ptr->size(), static_cast<T>(fill));
+            });
+        return array_ptr;
     }
 
-    std::shared_ptr<FloatArray> float_array_matmul(const std::shared_ptr<FloatArray>& a, const std::shared_ptr<FloatArray>& b) {
+    /**
+     * @brief Matrix product through Kernels::gemm. With trans_a / trans_b the
+     * operand is used transposed without building the transposed copy.
+     * Both operands must have the same dtype.
+     */
+    std::shared_ptr<FloatArray> float_array_matmul(const std::shared_ptr<FloatArray>& a, const std::shared_ptr<FloatArray>& b, bool trans_a = false, bool trans_b = false) {
         if (!a || !b || a->shape.size() != 2 || b->shape.size() != 2) return nullptr;
-        size_t rA = a->shape[0], cA = a->shape[1], rB = b->shape[0], cB = b->shape[1];
+        size_t rA = trans_a ? a->shape[1] : a->shape[0], cA = trans_a ? a->shape[0] : a->shape[1];
+        size_t rB = trans_b ? b->shape[1] : b->shape[0], cB = trans_b ? b->shape[0] : b->shape[1];
         if (cA != rB) return nullptr;
 
-        auto result_ptr = std::make_shared<FloatArray>();
-        result_ptr->shape = { rA, cB };
-        result_ptr->data.assign(rA * cB, 0.0);
-#pragma omp parallel for collapse(2)
-        for (auto r = 0; r < rA; ++r) {
-            for (auto c = 0; c < cB; ++c) {
-                for (auto i = 0; i < cA; ++i) {
-                    result_ptr->data[r * cB + c] += a->data[r * cA + i] * b->data[i * cB + c];
-                }
-            }
-        }
+        auto result_ptr = new_float_array({ rA, cB }, a->dtype);
+        dispatch(a->dtype, [&](auto zero) {
+            using T = decltype(zero);
+            Kernels::gemm(trans_a, trans_b, rA, cB, cA, a->values<T>().data(), a->shape[1], b->values<T>().data(), b->shape[1], result_ptr->values<T>().data(), cB);
+            });
         return result_ptr;
     }
 
-    // --- All helper functions now operate on FloatArray and std::vector<double> ---
+    // --- The element-wise helpers expect operands of the same dtype and return that dtype ---
 
     std::shared_ptr<FloatArray> float_array_elementwise_multiply(const std::shared_ptr<FloatArray>& a, const std::shared_ptr<FloatArray>& b) {
         if (!a || !b || a->shape != b->shape) return nullptr;
-        auto result_ptr = std::make_shared<FloatArray>();
-        result_ptr->shape = a->shape;
-        result_ptr->data.reserve(a->data.size());
-        for (size_t i = 0; i < a->data.size(); ++i) {
-            result_ptr->data.push_back(a->data[i] * b->data[i]);
-        }
+        auto result_ptr = new_float_array(a->shape, a->dtype);
+        dispatch(a->dtype, [&](auto zero) {
+            using T = decltype(zero);
+            const T* x = a->values<T>().data();
+            const T* y = b->values<T>().data();
+            T* out = result_ptr->values<T>().data();
+            const size_t n = result_ptr->count();
+            for (size_t i = 0; i < n; ++i) out[i] = x[i] * y[i];
+            });
         return result_ptr;
     }
 
     std::shared_ptr<FloatArray> float_array_scalar_multiply(double scalar, const std::shared_ptr<FloatArray>& arr) {
         if (!arr) return nullptr;
-        auto result_ptr = std::make_shared<FloatArray>();
-        result_ptr->shape = arr->shape;
-        result_ptr->data.reserve(arr->data.size());
-        for (const auto& elem : arr->data) {
-            result_ptr->data.push_back(elem * scalar);
-        }
+        auto result_ptr = new_float_array(arr->shape, arr->dtype);
+        dispatch(arr->dtype, [&](auto zero) {
+            using T = decltype(zero);
+            const T* x = arr->values<T>().data();
+            T* out = result_ptr->values<T>().data();
+            const T s = static_cast<T>(scalar);
+            const size_t n = result_ptr->count();
+            for (size_t i = 0; i < n; ++i) out[i] = x[i] * s;
+            });
         return result_ptr;
     }
 
@@ -119,176 +264,175 @@ namespace {
         if (!arr || arr->shape.size() != 2) return nullptr;
         size_t rows = arr->shape[0];
         size_t cols = arr->shape[1];
-        auto result_ptr = std::make_shared<FloatArray>();
-
-        if (axis == 0) {
-            result_ptr->shape = { 1, cols };
-            result_ptr->data.assign(cols, 0.0);
-            for (size_t c = 0; c < cols; ++c) {
-                for (size_t r = 0; r < rows; ++r) {
-                    result_ptr->data[c] += arr->data[r * cols + c];
+        if (axis != 0 && axis != 1) return nullptr;
+
+        auto result_ptr = axis == 0 ? new_float_array({ 1, cols }, arr->dtype) : new_float_array({ rows, 1 }, arr->dtype);
+        dispatch(arr->dtype, [&](auto zero) {
+            using T = decltype(zero);
+            const T* x = arr->values<T>().data();
+            T* out = result_ptr->values<T>().data();
+            if (axis == 0) {
+                for (size_t c = 0; c < cols; ++c) {
+                    double col_sum = 0.0;
+                    for (size_t r = 0; r < rows; ++r) {
+                        col_sum += x[r * cols + c];
+                    }
+                    out[c] = static_cast<T>(col_sum);
                 }
             }
-        }
-        else if (axis == 1) {
-            result_ptr->shape = { rows, 1 };
-            result_ptr->data.reserve(rows);
-            for (size_t r = 0; r < rows; ++r) {
-                double row_sum = 0.0;
-                for (size_t c = 0; c < cols; ++c) {
-                    row_sum += arr->data[r * cols + c];
+            else {
+                for (size_t r = 0; r < rows; ++r) {
+                    double row_sum = 0.0;
+                    for (size_t c = 0; c < cols; ++c) {
+                        row_sum += x[r * cols + c];
+                    }
+                    out[r] = static_cast<T>(row_sum);
                 }
-                result_ptr->data.push_back(row_sum);
             }
-        }
-        else {
-            return nullptr;
-        }
+            });
         return result_ptr;
     }
 
     std::shared_ptr<FloatArray> float_array_add(const std::shared_ptr<FloatArray>& a, const std::shared_ptr<FloatArray>& b) {
         if (!a || !b) return nullptr;
 
-        if (b->size() == 1 && a->size() > 1) {
-            double scalar = b->data[0];
-            auto result_ptr = std::make_shared<FloatArray>();
-            result_ptr->shape = a->shape;
-            result_ptr->data.reserve(a->size());
-            for (double elem : a->data) {
-                result_ptr->data.push_back(elem + scalar);
+        return dispatch(a->dtype, [&](auto zero) -> std::shared_ptr<FloatArray> {
+            using T = decltype(zero);
+            const T* x = a->values<T>().data();
+            const T* y = b->values<T>().data();
+
+            if (b->size() == 1 && a->size() > 1) {
+                const T scalar = y[0];
+                auto result_ptr = new_float_array(a->shape, a->dtype);
+                T* out = result_ptr->values<T>().data();
+                const size_t n = a->count();
+                for (size_t i = 0; i < n; ++i) {
+                    out[i] = x[i] + scalar;
+                }
+                return result_ptr;
             }
-            return result_ptr;
-        }
-        if (a->size() == 1 && b->size() > 1) {
-            double scalar = a->data[0];
-            auto result_ptr = std::make_shared<FloatArray>();
-            result_ptr->shape = b->shape;
-            result_ptr->data.reserve(b->size());
-            for (double elem : b->data) {
-                result_ptr->data.push_back(scalar + elem);
+            if (a->size() == 1 && b->size() > 1) {
+                const T scalar = x[0];
+                auto result_ptr = new_float_array(b->shape, b->dtype);
+                T* out = result_ptr->values<T>().data();
+                const size_t n = b->count();
+                for (size_t i = 0; i < n; ++i) {
+                    out[i] = scalar + y[i];
+                }
+                return result_ptr;
             }
-            return result_ptr;
-        }
 
-        if (a->shape.size() == 2 && b->shape.size() == 2 && a->shape[0] > b->shape[0] && b->shape[0] == 1 && a->shape[1] == b->shape[1]) {
-            auto result_ptr = std::make_shared<FloatArray>(*a);
-            for (size_t r = 0; r < a->shape[0]; ++r) {
-                for (size_t c = 0; c < a->shape[1]; ++c) {
-                    result_ptr->data[r * a->shape[1] + c] += b->data[c];
+            if (a->shape.size() == 2 && b->shape.size() == 2 && a->shape[0] > b->shape[0] && b->shape[0] == 1 && a->shape[1] == b->shape[1]) {
+                auto result_ptr = new_float_array(a->shape, a->dtype);
+                T* out = result_ptr->values<T>().data();
+                for (size_t r = 0; r < a->shape[0]; ++r) {
+                    for (size_t c = 0; c < a->shape[1]; ++c) {
+                        out[r * a->shape[1] + c] = x[r * a->shape[1] + c] + y[c];
+                    }
                 }
+                return result_ptr;
             }
-            return result_ptr;
-        }
 
-        if (a->shape == b->shape) {
-            auto result_ptr = std::make_shared<FloatArray>();
-            result_ptr->shape = a->shape;
-            result_ptr->data.reserve(a->size());
-            for (size_t i = 0; i < a->size(); ++i) {
-                result_ptr->data.push_back(a->data[i] + b->data[i]);
+            if (a->shape == b->shape) {
+                auto result_ptr = new_float_array(a->shape, a->dtype);
+                T* out = result_ptr->values<T>().data();
+                const size_t n = a->size();
+                for (size_t i = 0; i < n; ++i) {
+                    out[i] = x[i] + y[i];
+                }
+                return result_ptr;
             }
-            return result_ptr;
-        }
-        return nullptr;
+            return nullptr;
+            });
     }
 
     std::shared_ptr<FloatArray> float_array_subtract(const std::shared_ptr<FloatArray>& a, const std::shared_ptr<FloatArray>& b) {
-        if (!a || !b) return nullptr;
+        if (!a || !b || a->shape != b->shape) return nullptr;
 
-        if (a->shape == b->shape) {
-            auto result_ptr = std::make_shared<FloatArray>();
-            result_ptr->shape = a->shape;
-            result_ptr->data.reserve(a->size());
-            for (size_t i = 0; i < a->size(); ++i) {
-                result_ptr->data.push_back(a->data[i] - b->data[i]);
+        auto result_ptr = new_float_array(a->shape, a->dtype);
+        dispatch(a->dtype, [&](auto zero) {
+            using T = decltype(zero);
+            const T* x = a->values<T>().data();
+            const T* y = b->values<T>().data();
+            T* out = result_ptr->values<T>().data();
+            const size_t n = a->size();
+            for (size_t i = 0; i < n; ++i) {
+                out[i] = x[i] - y[i];
             }
-            return result_ptr;
-        }
-        return nullptr;
-    }
-
-    std::shared_ptr<FloatArray> rotate180(const std::shared_ptr<FloatArray>& kernel) {
-        if (!kernel || kernel->shape.size() != 4) return nullptr;
-        auto rotated_kernel = std::make_shared<FloatArray>(*kernel);
-        size_t h = kernel->shape[2];
-        size_t w = kernel->shape[3];
-        size_t plane_size = h * w;
-
-        for (size_t i = 0; i < kernel->data.size() / plane_size; ++i) {
-            size_t plane_start = i * plane_size;
-            std::reverse(rotated_kernel->data.begin() + plane_start, rotated_kernel->data.begin() + plane_start + plane_size);
-        }
-        return rotated_kernel;
+            });
+        return result_ptr;
     }
 
 } // end anonymous namespace
 
 // --- Core Tensor Operations ---
 
-/**
-  * @brief Helper to add two arrays together, element-wise, with broadcasting.
-  */
-std::shared_ptr<Array> array_add(const std::shared_ptr<Array>& a, const std::shared_ptr<Array>& b) {
-    if (!a || !b) return nullptr;
+namespace {
+    // Shared by array_add and array_subtract. The operands are read without boxing,
+    // the loops run through Kernels::binary and the result is an unboxed double array.
+    std::shared_ptr<Array> array_elementwise(const std::shared_ptr<Array>& a, const std::shared_ptr<Array>& b, Kernels::Binary op, bool allow_left_row_broadcast) {
+        auto make_result = [](const std::vector<size_t>& shape, std::vector<double> values) {
+            auto result_ptr = std::make_shared<Array>();
+            result_ptr->shape = shape;
+            result_ptr->data = ArrayData::of_doubles(std::move(values));
+            return result_ptr;
+            };
+        std::vector<double> a_scratch, b_scratch;
 
-    // --- Broadcasting a scalar ---
-    if (b->size() == 1 && a->size() > 1) {
-        double scalar = to_double(b->data[0]);
-        auto result_ptr = std::make_shared<Array>();
-        result_ptr->shape = a->shape;
-        result_ptr->data.reserve(a->size());
-        for (const auto& elem : a->data) {
-            result_ptr->data.push_back(to_double(elem) + scalar);
+        // --- Broadcasting a scalar ---
+        if (b->size() == 1 && a->size() > 1) {
+            double scalar = b->data.number(0);
+            std::vector<double> out(a->data.size());
+            Kernels::binary(op, a->data.numbers(a_scratch), 1, &scalar, 0, out.data(), out.size());
+            return make_result(a->shape, std::move(out));
         }
-        return result_ptr;
-    }
-    if (a->size() == 1 && b->size() > 1) {
-        double scalar = to_double(a->data[0]);
-        auto result_ptr = std::make_shared<Array>();
-        result_ptr->shape = b->shape;
-        result_ptr->data.reserve(b->size());
-        for (const auto& elem : b->data) {
-            result_ptr->data.push_back(scalar + to_double(elem));
+        if (a->size() == 1 && b->size() > 1) {
+            double scalar = a->data.number(0);
+            std::vector<double> out(b->data.size());
+            Kernels::binary(op, &scalar, 0, b->data.numbers(b_scratch), 1, out.data(), out.size());
+            return make_result(b->shape, std::move(out));
         }
-        return result_ptr;
-    }
 
-    // --- Broadcasting a row vector [1, C] to a matrix [R, C] ---
-    if (a->shape.size() == 2 && b->shape.size() == 2 && b->shape[0] == 1 && a->shape[1] == b->shape[1]) {
-        // This handles Matrix + Vector
-        auto result_ptr = std::make_shared<Array>(*a); // Copy the larger matrix
-        for (size_t r = 0; r < a->shape[0]; ++r) {
-            for (size_t c = 0; c < a->shape[1]; ++c) {
-                result_ptr->data[r * a->shape[1] + c] = to_double(a->data[r * a->shape[1] + c]) + to_double(b->data[c]);
+        // --- Broadcasting a row vector [1, C] to a matrix [R, C] ---
+        if (a->shape.size() == 2 && b->shape.size() == 2 && b->shape[0] == 1 && a->shape[1] == b->shape[1] && (allow_left_row_broadcast || a->shape[0] > 1)) {
+            size_t cols = a->shape[1];
+            const double* pa = a->data.numbers(a_scratch);
+            const double* pb = b->data.numbers(b_scratch);
+            std::vector<double> out(a->data.size());
+            for (size_t row = 0; row < a->shape[0]; ++row) {
+                Kernels::binary(op, pa + row * cols, 1, pb, 1, out.data() + row * cols, cols);
             }
+            return make_result(a->shape, std::move(out));
         }
-        return result_ptr;
-    }
-    if (b->shape.size() == 2 && a->shape.size() == 2 && a->shape[0] == 1 && b->shape[1] == a->shape[1]) {
-        // This handles Vector + Matrix
-        auto result_ptr = std::make_shared<Array>(*b); // Copy the larger matrix
-        for (size_t r = 0; r < b->shape[0]; ++r) {
-            for (size_t c = 0; c < b->shape[1]; ++c) {
-                result_ptr->data[r * b->shape[1] + c] = to_double(a->data[c]) + to_double(b->data[r * b->shape[1] + c]);
+        if (allow_left_row_broadcast && b->shape.size() == 2 && a->shape.size() == 2 && a->shape[0] == 1 && b->shape[1] == a->shape[1]) {
+            size_t cols = b->shape[1];
+            const double* pa = a->data.numbers(a_scratch);
+            const double* pb = b->data.numbers(b_scratch);
+            std::vector<double> out(b->data.size());
+            for (size_t row = 0; row < b->shape[0]; ++row) {
+                Kernels::binary(op, pa, 1, pb + row * cols, 1, out.data() + row * cols, cols);
             }
+            return make_result(b->shape, std::move(out));
         }
-        return result_ptr;
-    }
 
-    // --- Standard element-wise addition for arrays of the exact same shape ---
-    if (a->shape == b->shape) {
-        auto result_ptr = std::make_shared<Array>();
-        result_ptr->shape = a->shape;
-        result_ptr->data.reserve(a->size());
-        for (size_t i = 0; i < a->size(); ++i) {
-            result_ptr->data.push_back(to_double(a->data[i]) + to_double(b->data[i]));
+        // --- Standard element-wise operation for arrays of the exact same shape ---
+        if (a->shape == b->shape) {
+            std::vector<double> out(a->size());
+            Kernels::binary(op, a->data.numbers(a_scratch), 1, b->data.numbers(b_scratch), 1, out.data(), out.size());
+            return make_result(a->shape, std::move(out));
         }
-        return result_ptr;
+
+        // If no broadcasting rule applies and shapes are different, it's an error.
+        return nullptr;
     }
+}
 
-    // If no broadcasting rule applies and shapes are different, it's an error.
-    return nullptr;
+/**
+  * @brief Helper to add two arrays together, element-wise, with broadcasting.
+  */
+std::shared_ptr<Array> array_add(const std::shared_ptr<Array>& a, const std::shared_ptr<Array>& b) {
+    if (!a || !b) return nullptr;
+    return array_elementwise(a, b, Kernels::Binary::ADD, true);
 }
 
 
@@ -297,53 +441,8 @@ std::shared_ptr<Array> array_add(const std::shared_ptr<Array>& a, const std::sha
  */
 std::shared_ptr<Array> array_subtract(const std::shared_ptr<Array>& a, const std::shared_ptr<Array>& b) {
     if (!a || !b) return nullptr;
-
-    // Broadcasting a scalar from the right
-    if (b->size() == 1 && a->size() > 1) {
-        double scalar = to_double(b->data[0]);
-        auto result_ptr = std::make_shared<Array>();
-        result_ptr->shape = a->shape;
-        result_ptr->data.reserve(a->size());
-        for (const auto& elem : a->data) {
-            result_ptr->data.push_back(to_double(elem) - scalar);
-        }
-        return result_ptr;
-    }
-    // Broadcasting a scalar from the left
-    if (a->size() == 1 && b->size() > 1) {
-        double scalar = to_double(a->data[0]);
-        auto result_ptr = std::make_shared<Array>();
-        result_ptr->shape = b->shape;
-        result_ptr->data.reserve(b->size());
-        for (const auto& elem : b->data) {
-            result_ptr->data.push_back(scalar - to_double(elem));
-        }
-        return result_ptr;
-    }
-
-    // Broadcasting a row vector from the right
-    if (a->shape.size() == 2 && b->shape.size() == 2 && a->shape[0] > 1 && b->shape[0] == 1 && a->shape[1] == b->shape[1]) {
-        auto result_ptr = std::make_shared<Array>(*a); // Copy matrix
-        for (size_t r = 0; r < a->shape[0]; ++r) {
-            for (size_t c = 0; c < a->shape[1]; ++c) {
-                result_ptr->data[r * a->shape[1] + c] = to_double(a->data[r * a->shape[1] + c]) - to_double(b->data[c]);
-            }
-        }
-        return result_ptr;
-    }
-
-    // Standard element-wise subtraction
-    if (a->shape != b->shape) {
-        return nullptr; // Error: shapes not compatible
-    }
-
-    auto result_ptr = std::make_shared<Array>();
-    result_ptr->shape = a->shape;
-    result_ptr->data.reserve(a->size());
-    for (size_t i = 0; i < a->size(); ++i) {
-        result_ptr->data.push_back(to_double(a->data[i]) - to_double(b->data[i]));
-    }
-    return result_ptr;
+    // Only a row vector on the right is broadcast, and only onto a matrix of several rows.
+    return array_elementwise(a, b, Kernels::Binary::SUB, false);
 }
 
 /**
@@ -352,8 +451,9 @@ std::shared_ptr<Array> array_subtract(const std::shared_ptr<Array>& a, const std
 BasicValue tensor_add(NeReLaBasic& vm, const BasicValue& a, const BasicValue& b) {
     const auto& a_tensor = std::get<std::shared_ptr<Tensor>>(a);
     const auto& b_tensor = std::get<std::shared_ptr<Tensor>>(b);
+    const DType dtype = common_dtype({ &a_tensor->data, &b_tensor->data });
 
-    auto result_data = float_array_add(a_tensor->data, b_tensor->data);
+    auto result_data = float_array_add(as_dtype(a_tensor->data, dtype), as_dtype(b_tensor->data, dtype));
     if (!result_data) {
         Error::set(15, vm.runtime_current_line, "Tensor shapes not compatible for addition.");
         return {};
@@ -361,6 +461,7 @@ BasicValue tensor_add(NeReLaBasic& vm, const BasicValue& a, const BasicValue& b)
 
     auto result_tensor = std::make_shared<Tensor>();
     result_tensor->data = result_data;
+    if (!vm.tensor_grad_enabled) return result_tensor;
     result_tensor->parents = { a_tensor, b_tensor };
 
     result_tensor->backward_fn = [a_tensor, b_tensor](std::shared_ptr<Tensor> output_grad) -> std::vector<std::shared_ptr<Tensor>> {
@@ -388,8 +489,9 @@ BasicValue tensor_add(NeReLaBasic& vm, const BasicValue& a, const BasicValue& b)
 BasicValue tensor_subtract(NeReLaBasic& vm, const BasicValue& a, const BasicValue& b) {
     const auto& a_tensor = std::get<std::shared_ptr<Tensor>>(a);
     const auto& b_tensor = std::get<std::shared_ptr<Tensor>>(b);
+    const DType dtype = common_dtype({ &a_tensor->data, &b_tensor->data });
 
-    auto result_data = float_array_subtract(a_tensor->data, b_tensor->data);
+    auto result_data = float_array_subtract(as_dtype(a_tensor->data, dtype), as_dtype(b_tensor->data, dtype));
     if (!result_data) {
         Error::set(15, vm.runtime_current_line, "Tensor shapes not compatible for subtraction.");
         return {};
@@ -397,6 +499,7 @@ BasicValue tensor_subtract(NeReLaBasic& vm, const BasicValue& a, const BasicValu
 
     auto result_tensor = std::make_shared<Tensor>();
     result_tensor->data = result_data;
+    if (!vm.tensor_grad_enabled) return result_tensor;
     result_tensor->parents = { a_tensor, b_tensor };
 
     result_tensor->backward_fn = [](std::shared_ptr<Tensor> output_grad) -> std::vector<std::shared_ptr<Tensor>> {
@@ -414,21 +517,25 @@ BasicValue tensor_subtract(NeReLaBasic& vm, const BasicValue& a, const BasicValu
 BasicValue tensor_elementwise_multiply(NeReLaBasic& vm, const BasicValue& a, const BasicValue& b) {
     const auto& a_tensor = std::get<std::shared_ptr<Tensor>>(a);
     const auto& b_tensor = std::get<std::shared_ptr<Tensor>>(b);
+    const DType dtype = common_dtype({ &a_tensor->data, &b_tensor->data });
+    auto a_data = as_dtype(a_tensor->data, dtype);
+    auto b_data = as_dtype(b_tensor->data, dtype);
 
     auto result_tensor = std::make_shared<Tensor>();
-    result_tensor->data = float_array_elementwise_multiply(a_tensor->data, b_tensor->data);
+    result_tensor->data = float_array_elementwise_multiply(a_data, b_data);
     if (!result_tensor->data) {
         Error::set(15, vm.runtime_current_line, "Tensor shapes not compatible for element-wise multiplication.");
         return {};
     }
 
+    if (!vm.tensor_grad_enabled) return result_tensor;
     result_tensor->parents = { a_tensor, b_tensor };
-    result_tensor->backward_fn = [a_tensor, b_tensor](std::shared_ptr<Tensor> output_grad) -> std::vector<std::shared_ptr<Tensor>> {
+    result_tensor->backward_fn = [a_data, b_data](std::shared_ptr<Tensor> output_grad) -> std::vector<std::shared_ptr<Tensor>> {
         auto grad_a_tensor = std::make_shared<Tensor>();
-        grad_a_tensor->data = float_array_elementwise_multiply(output_grad->data, b_tensor->data);
+        grad_a_tensor->data = float_array_elementwise_multiply(output_grad->data, b_data);
 
         auto grad_b_tensor = std::make_shared<Tensor>();
-        grad_b_tensor->data = float_array_elementwise_multiply(output_grad->data, a_tensor->data);
+        grad_b_tensor->data = float_array_elementwise_multiply(output_grad->data, a_data);
 
         return { grad_a_tensor, grad_b_tensor };
         };
@@ -441,31 +548,38 @@ BasicValue tensor_elementwise_multiply(NeReLaBasic& vm, const BasicValue& a, con
 BasicValue tensor_power(NeReLaBasic& vm, const BasicValue& base, const BasicValue& exponent) {
     const auto& base_tensor = std::get<std::shared_ptr<Tensor>>(base);
     const double exp_val = to_double(exponent);
+    const DType dtype = base_tensor->data->dtype;
 
     auto result_tensor = std::make_shared<Tensor>();
-    auto result_data = std::make_shared<FloatArray>();
-    result_data->shape = base_tensor->data->shape;
-    result_data->data.reserve(base_tensor->data->size());
-    for (const auto& val : base_tensor->data->data) {
-        result_data->data.push_back(std::pow(val, exp_val));
-    }
+    auto result_data = new_float_array(base_tensor->data->shape, dtype);
+    dispatch(dtype, [&](auto zero) {
+        using T = decltype(zero);
+        const T* x = base_tensor->data->values<T>().data();
+        T* out = result_data->values<T>().data();
+        const size_t n = result_data->count();
+        for (size_t i = 0; i < n; ++i) {
+            out[i] = static_cast<T>(std::pow(x[i], exp_val));
+        }
+        });
     result_tensor->data = result_data;
+    if (!vm.tensor_grad_enabled) return result_tensor;
     result_tensor->parents = { base_tensor };
 
     result_tensor->backward_fn = [base_tensor, exp_val](std::shared_ptr<Tensor> output_grad) -> std::vector<std::shared_ptr<Tensor>> {
-        auto u_pow_n_minus_1 = std::make_shared<FloatArray>();
-        u_pow_n_minus_1->shape = base_tensor->data->shape;
-        u_pow_n_minus_1->data.reserve(base_tensor->data->size());
-        for (const auto& val : base_tensor->data->data) {
-            u_pow_n_minus_1->data.push_back(std::pow(val, exp_val - 1.0));
-        }
-
-        auto n_times_u = float_array_scalar_multiply(exp_val, u_pow_n_minus_1);
-        auto final_grad_data = float_array_elementwise_multiply(output_grad->data, n_times_u);
-
-        auto final_grad_tensor = std::make_shared<Tensor>();
-        final_grad_tensor->data = final_grad_data;
-        return { final_grad_tensor };
+        // dy * n * u^(n-1), in one pass
+        const DType dtype = base_tensor->data->dtype;
+        auto final_grad_data = new_float_array(base_tensor->data->shape, dtype);
+        dispatch(dtype, [&](auto zero) {
+            using T = decltype(zero);
+            const T* x = base_tensor->data->values<T>().data();
+            const T* dy = output_grad->data->values<T>().data();
+            T* dx = final_grad_data->values<T>().data();
+            const size_t n = final_grad_data->count();
+            for (size_t i = 0; i < n; ++i) {
+                dx[i] = static_cast<T>(dy[i] * (std::pow(x[i], exp_val - 1.0) * exp_val));
+            }
+            });
+        return { tensor_of(final_grad_data) };
         };
 
     return result_tensor;
@@ -485,6 +599,7 @@ BasicValue tensor_scalar_divide(NeReLaBasic& vm, const BasicValue& a, const Basi
 
     auto result_tensor = std::make_shared<Tensor>();
     result_tensor->data = float_array_scalar_multiply(1.0 / scalar_b, tensor_a->data);
+    if (!vm.tensor_grad_enabled) return result_tensor;
     result_tensor->parents = { tensor_a };
 
     result_tensor->backward_fn = [scalar_b](std::shared_ptr<Tensor> output_grad) -> std::vector<std::shared_ptr<Tensor>> {
@@ -502,24 +617,26 @@ BasicValue builtin_matmul(NeReLaBasic& vm, const std::vector<BasicValue>& args)
     if (std::holds_alternative<std::shared_ptr<Tensor>>(args[0])) {
         const auto& a_tensor = std::get<std::shared_ptr<Tensor>>(args[0]);
         const auto& b_tensor = std::get<std::shared_ptr<Tensor>>(args[1]);
+        const DType dtype = common_dtype({ &a_tensor->data, &b_tensor->data });
+        auto a_data = as_dtype(a_tensor->data, dtype);
+        auto b_data = as_dtype(b_tensor->data, dtype);
 
-        auto result_ptr = float_array_matmul(a_tensor->data, b_tensor->data);
+        auto result_ptr = float_array_matmul(a_data, b_data);
         if (!result_ptr) {
             Error::set(15, vm.runtime_current_line, "Inner dimensions must match for MATMUL."); return {};
         }
 
         auto result_tensor = std::make_shared<Tensor>();
         result_tensor->data = result_ptr;
+        if (!vm.tensor_grad_enabled) return result_tensor;
         result_tensor->parents = { a_tensor, b_tensor };
 
-        result_tensor->backward_fn = [a_tensor, b_tensor](std::shared_ptr<Tensor> output_grad) -> std::vector<std::shared_ptr<Tensor>> {
+        result_tensor->backward_fn = [a_data, b_data](std::shared_ptr<Tensor> output_grad) -> std::vector<std::shared_ptr<Tensor>> {
             // grad(A) = grad_C @ B.T
-            auto b_transposed = transpose_float_array(b_tensor->data);
-            auto grad_a_data = float_array_matmul(output_grad->data, b_transposed);
+            auto grad_a_data = float_array_matmul(output_grad->data, b_data, false, true);
 
             // grad(B) = A.T @ grad_C
-            auto a_transposed = transpose_float_array(a_tensor->data);
-            auto grad_b_data = float_array_matmul(a_transposed, output_grad->data);
+            auto grad_b_data = float_array_matmul(a_data, output_grad->data, true, false);
 
             auto grad_a_tensor = std::make_shared<Tensor>();
             grad_a_tensor->data = grad_a_data;
@@ -541,11 +658,13 @@ BasicValue builtin_matmul(NeReLaBasic& vm, const std::vector<BasicValue>& args)
         }
         size_t rA = a_ptr->shape[0], cA = a_ptr->shape[1], rB = b_ptr->shape[0], cB = b_ptr->shape[1];
         if (cA != rB) { Error::set(15, vm.runtime_current_line, "Inner dimensions must match."); return {}; }
+        // The operands are read as unboxed doubles (converted once if needed).
+        std::vector<double> a_scratch, b_scratch;
+        std::vector<double> out(rA * cB);
+        Kernels::gemm(false, false, rA, cB, cA, a_ptr->data.numbers(a_scratch), cA, b_ptr->data.numbers(b_scratch), cB, out.data(), cB);
         auto result_ptr = std::make_shared<Array>();
         result_ptr->shape = { rA, cB };
-        result_ptr->data.resize(rA * cB, 0.0);
-        for (size_t r = 0; r < rA; ++r) for (size_t c = 0; c < cB; ++c) for (size_t i = 0; i < cA; ++i)
-            result_ptr->data[r * cB + c] = to_double(result_ptr->data[r * cB + c]) + to_double(a_ptr->data[r * cA + i]) * to_double(b_ptr->data[i * cB + c]);
+        result_ptr->data = ArrayData::of_doubles(std::move(out));
         return result_ptr;
 
     }
@@ -558,22 +677,77 @@ BasicValue builtin_matmul(NeReLaBasic& vm, const std::vector<BasicValue>& args)
 // --- CNN and Utility Functions ---
 
 namespace {
-    // Helper to rotate a 4D kernel by 180 degrees, needed for convolution backprop.
-    std::shared_ptr<Array> rotate180(const std::shared_ptr<Array>& kernel) {
-        if (!kernel || kernel->shape.size() != 4) return nullptr;
-        auto rotated_kernel = std::make_shared<Array>(*kernel); // Make a copy
-        size_t h = kernel->shape[2];
-        size_t w = kernel->shape[3];
-        size_t plane_size = h * w;
-
-        for (size_t i = 0; i < kernel->data.size() / plane_size; ++i) {
-            size_t plane_start = i * plane_size;
-            std::reverse(rotated_kernel->data.begin() + plane_start, rotated_kernel->data.begin() + plane_start + plane_size);
+    // Shape of one convolution, shared by the forward and the backward pass.
+    // Images are laid out [batch, channels, height, width] and kernels
+    // [out_channels, in_channels, kernel_h, kernel_w], both row-major.
+    struct ConvGeometry {
+        size_t batch, in_channels, in_height, in_width;
+        size_t out_channels, kernel_h, kernel_w;
+        size_t out_height, out_width;
+        size_t stride, padding;
+
+        size_t in_plane() const { return in_height * in_width; }
+        size_t out_plane() const { return out_height * out_width; }
+        size_t patch() const { return in_channels * kernel_h * kernel_w; }
+    };
+
+    // Unfolds one image into a (patch x out_plane) matrix: row (c, ky, kx) holds
+    // the input pixel each output position sees through that kernel tap, or 0 in
+    // the padding. The convolution is then a single matrix product.
+    template <typename T>
+    void im2col(const ConvGeometry& g, const T* image, T* col) {
+        for (size_t c = 0; c < g.in_channels; ++c) {
+            const T* plane = image + c * g.in_plane();
+            for (size_t ky = 0; ky < g.kernel_h; ++ky) {
+                for (size_t kx = 0; kx < g.kernel_w; ++kx) {
+                    T* row = col + ((c * g.kernel_h + ky) * g.kernel_w + kx) * g.out_plane();
+                    for (size_t oy = 0; oy < g.out_height; ++oy) {
+                        T* out = row + oy * g.out_width;
+                        long long iy = static_cast<long long>(oy * g.stride + ky) - static_cast<long long>(g.padding);
+                        if (iy < 0 || iy >= static_cast<long long>(g.in_height)) {
+                            std::fill(out, out + g.out_width, T(0));
+                            continue;
+                        }
+                        const T* in_row = plane + iy * g.in_width;
+                        for (size_t ox = 0; ox < g.out_width; ++ox) {
+                            long long ix = static_cast<long long>(ox * g.stride + kx) - static_cast<long long>(g.padding);
+                            out[ox] = (ix >= 0 && ix < static_cast<long long>(g.in_width)) ? in_row[ix] : T(0);
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    // The adjoint of im2col: adds every entry of 'col' back onto the input pixel it
+    // was copied from. 'image' must be zeroed (or hold a gradient to add to).
+    template <typename T>
+    void col2im(const ConvGeometry& g, const T* col, T* image) {
+        for (size_t c = 0; c < g.in_channels; ++c) {
+            T* plane = image + c * g.in_plane();
+            for (size_t ky = 0; ky < g.kernel_h; ++ky) {
+                for (size_t kx = 0; kx < g.kernel_w; ++kx) {
+                    const T* row = col + ((c * g.kernel_h + ky) * g.kernel_w + kx) * g.out_plane();
+                    for (size_t oy = 0; oy < g.out_height; ++oy) {
+                        long long iy = static_cast<long long>(oy * g.stride + ky) - static_cast<long long>(g.padding);
+                        if (iy < 0 || iy >= static_cast<long long>(g.in_height)) continue;
+                        const T* in = row + oy * g.out_width;
+                        T* in_row = plane + iy * g.in_width;
+                        for (size_t ox = 0; ox < g.out_width; ++ox) {
+                            long long ix = static_cast<long long>(ox * g.stride + kx) - static_cast<long long>(g.padding);
+                            if (ix >= 0 && ix < static_cast<long long>(g.in_width)) in_row[ix] += in[ox];
+                        }
+                    }
+                }
+            }
         }
-        return rotated_kernel;
     }
 } // end anonymous namespace
 
+// Convolution as im2col + GEMM: for every image of the batch, the output
+// (out_channels x out_plane) is kernel (out_channels x patch) times the unfolded
+// image (patch x out_plane). Batches are split over the OpenMP threads; a single
+// image leaves the parallelism to the matrix product itself.
 BasicValue builtin_conv2d(NeReLaBasic& vm, const std::vector<BasicValue>& args) {
     if (args.size() != 5) { Error::set(8, vm.runtime_current_line, "CONV2D requires 5 arguments."); return {}; }
     if (!std::holds_alternative<std::shared_ptr<Tensor>>(args[0]) ||
@@ -587,91 +761,118 @@ BasicValue builtin_conv2d(NeReLaBasic& vm, const std::vector<BasicValue>& args)
     int stride = static_cast<int>(to_double(args[3]));
     int padding = static_cast<int>(to_double(args[4]));
 
-    size_t in_channels = input_tensor->data->shape[1];
-    size_t in_height = input_tensor->data->shape[2];
-    size_t in_width = input_tensor->data->shape[3];
-    size_t out_channels = kernel_tensor->data->shape[0];
-    size_t kernel_h = kernel_tensor->data->shape[2];
-    size_t kernel_w = kernel_tensor->data->shape[3];
-    size_t out_height = static_cast<size_t>(std::floor((in_height + 2 * padding - kernel_h) / stride)) + 1;
-    size_t out_width = static_cast<size_t>(std::floor((in_width + 2 * padding - kernel_w) / stride)) + 1;
-
-    auto result_array = std::make_shared<FloatArray>();
-    result_array->shape = { 1, out_channels, out_height, out_width };
-    result_array->data.assign(out_channels * out_height * out_width, 0.0);
-
-    for (size_t oc = 0; oc < out_channels; ++oc) {
-        for (size_t y = 0; y < out_height; ++y) {
-            for (size_t x = 0; x < out_width; ++x) {
-                double sum = 0.0;
-                for (size_t ic = 0; ic < in_channels; ++ic) {
-                    for (size_t ky = 0; ky < kernel_h; ++ky) {
-                        for (size_t kx = 0; kx < kernel_w; ++kx) {
-                            int input_y = y * stride + ky - padding;
-                            int input_x = x * stride + kx - padding;
-                            if (input_y >= 0 && input_y < in_height && input_x >= 0 && input_x < in_width) {
-                                double input_val = input_tensor->data->data[ic * (in_height * in_width) + input_y * in_width + input_x];
-                                double kernel_val = kernel_tensor->data->data[oc * (in_channels * kernel_h * kernel_w) + ic * (kernel_h * kernel_w) + ky * kernel_w + kx];
-                                sum += input_val * kernel_val;
-                            }
-                        }
-                    }
+    const auto& in_shape = input_tensor->data->shape;
+    const auto& k_shape = kernel_tensor->data->shape;
+    if (in_shape.size() != 4 || k_shape.size() != 4) {
+        Error::set(15, vm.runtime_current_line, "CONV2D expects a [batch, channels, height, width] input and an [out, in, height, width] kernel."); return {};
+    }
+    if (k_shape[1] != in_shape[1]) {
+        Error::set(15, vm.runtime_current_line, "CONV2D kernel and input channel counts do not match."); return {};
+    }
+    if (bias_tensor->data->size() != k_shape[0]) {
+        Error::set(15, vm.runtime_current_line, "CONV2D needs one bias per output channel."); return {};
+    }
+    if (stride < 1 || padding < 0) {
+        Error::set(15, vm.runtime_current_line, "CONV2D stride must be at least 1 and padding must not be negative."); return {};
+    }
+    if (in_shape[2] + 2 * padding < k_shape[2] || in_shape[3] + 2 * padding < k_shape[3]) {
+        Error::set(15, vm.runtime_current_line, "CONV2D kernel is larger than the padded input."); return {};
+    }
+
+    ConvGeometry g;
+    g.batch = in_shape[0];
+    g.in_channels = in_shape[1];
+    g.in_height = in_shape[2];
+    g.in_width = in_shape[3];
+    g.out_channels = k_shape[0];
+    g.kernel_h = k_shape[2];
+    g.kernel_w = k_shape[3];
+    g.stride = static_cast<size_t>(stride);
+    g.padding = static_cast<size_t>(padding);
+    g.out_height = (g.in_height + 2 * g.padding - g.kernel_h) / g.stride + 1;
+    g.out_width = (g.in_width + 2 * g.padding - g.kernel_w) / g.stride + 1;
+
+    const DType dtype = common_dtype({ &input_tensor->data, &kernel_tensor->data, &bias_tensor->data });
+    auto input_data = as_dtype(input_tensor->data, dtype);
+    auto kernel_data = as_dtype(kernel_tensor->data, dtype);
+    auto bias_data = as_dtype(bias_tensor->data, dtype);
+    auto result_array = new_float_array({ g.batch, g.out_channels, g.out_height, g.out_width }, dtype);
+
+    dispatch(dtype, [&](auto zero) {
+        using T = decltype(zero);
+        const T* input = input_data->values<T>().data();
+        const T* kernel = kernel_data->values<T>().data();
+        const T* bias = bias_data->values<T>().data();
+        T* output = result_array->values<T>().data();
+
+#pragma omp parallel if(g.batch > 1)
+        {
+            std::vector<T> col(g.patch() * g.out_plane());
+#pragma omp for schedule(dynamic)
+            for (long long b = 0; b < static_cast<long long>(g.batch); ++b) {
+                im2col(g, input + b * g.in_channels * g.in_plane(), col.data());
+                T* out = output + b * g.out_channels * g.out_plane();
+                Kernels::gemm(false, false, g.out_channels, g.out_plane(), g.patch(), kernel, g.patch(), col.data(), g.out_plane(), out, g.out_plane());
+                for (size_t oc = 0; oc < g.out_channels; ++oc) {
+                    T* plane = out + oc * g.out_plane();
+                    for (size_t i = 0; i < g.out_plane(); ++i) plane[i] += bias[oc];
                 }
-                sum += bias_tensor->data->data[oc];
-                result_array->data[oc * (out_height * out_width) + y * out_width + x] = sum;
             }
         }
-    }
+        });
 
     auto result_tensor = std::make_shared<Tensor>();
     result_tensor->data = result_array;
+    if (!vm.tensor_grad_enabled) return result_tensor;
     result_tensor->parents = { input_tensor, kernel_tensor, bias_tensor };
 
     result_tensor->backward_fn = [=](std::shared_ptr<Tensor> output_grad) -> std::vector<std::shared_ptr<Tensor>> {
-        auto d_input_arr = std::make_shared<FloatArray>();
-        d_input_arr->shape = input_tensor->data->shape;
-        d_input_arr->data.assign(input_tensor->data->size(), 0.0);
-
-        auto d_kernel_arr = std::make_shared<FloatArray>();
-        d_kernel_arr->shape = kernel_tensor->data->shape;
-        d_kernel_arr->data.assign(kernel_tensor->data->size(), 0.0);
-
-        auto d_bias_arr = std::make_shared<FloatArray>();
-        d_bias_arr->shape = bias_tensor->data->shape;
-        d_bias_arr->data.assign(bias_tensor->data->size(), 0.0);
-
-        auto rotated_kernel = rotate180(kernel_tensor->data);
-
-        for (size_t oc = 0; oc < out_channels; ++oc) {
-            for (size_t y = 0; y < out_height; ++y) {
-                for (size_t x = 0; x < out_width; ++x) {
-                    double grad_out_val = output_grad->data->data[oc * (out_height * out_width) + y * out_width + x];
-                    d_bias_arr->data[oc] += grad_out_val;
-
-                    for (size_t ic = 0; ic < in_channels; ++ic) {
-                        for (size_t ky = 0; ky < kernel_h; ++ky) {
-                            for (size_t kx = 0; kx < kernel_w; ++kx) {
-                                int input_y = y * stride + ky - padding;
-                                int input_x = x * stride + kx - padding;
-
-                                if (input_y >= 0 && input_y < in_height && input_x >= 0 && input_x < in_width) {
-                                    // Gradient for the kernel
-                                    d_kernel_arr->data[oc * (in_channels * kernel_h * kernel_w) + ic * (kernel_h * kernel_w) + ky * kernel_w + kx] += input_tensor->data->data[ic * (in_height * in_width) + input_y * in_width + input_x] * grad_out_val;
-
-                                    // Gradient for the input
-                                    d_input_arr->data[ic * (in_height * in_width) + input_y * in_width + input_x] += rotated_kernel->data[oc * (in_channels * kernel_h * kernel_w) + ic * (kernel_h * kernel_w) + ky * kernel_w + kx] * grad_out_val;
-                                }
-                            }
-                        }
+        auto d_input_arr = new_float_array(input_data->shape, 0.0, dtype);
+        auto d_kernel_arr = new_float_array(kernel_data->shape, 0.0, dtype);
+        auto d_bias_arr = new_float_array(bias_data->shape, 0.0, dtype);
+
+        dispatch(dtype, [&](auto zero) {
+            using T = decltype(zero);
+            const T* x = input_data->values<T>().data();
+            const T* w = kernel_data->values<T>().data();
+            const T* dy = output_grad->data->values<T>().data();
+            T* dx = d_input_arr->values<T>().data();
+            T* dk = d_kernel_arr->values<T>().data();
+            T* dbias = d_bias_arr->values<T>().data();
+            const size_t weights = d_kernel_arr->count();
+
+            // Each thread sums the kernel and bias gradients of its images into
+            // private buffers; they are added up once the batch is done.
+            // The input gradient of each image is written by one thread only.
+#pragma omp parallel if(g.batch > 1)
+            {
+                std::vector<T> col(g.patch() * g.out_plane());
+                std::vector<T> dcol(col.size());
+                std::vector<T> dw(weights, T(0));
+                std::vector<T> db(g.out_channels, T(0));
+#pragma omp for schedule(dynamic)
+                for (long long b = 0; b < static_cast<long long>(g.batch); ++b) {
+                    const T* dy_b = dy + b * g.out_channels * g.out_plane();
+                    for (size_t oc = 0; oc < g.out_channels; ++oc) {
+                        const T* plane = dy_b + oc * g.out_plane();
+                        for (size_t i = 0; i < g.out_plane(); ++i) db[oc] += plane[i];
                     }
+                    // dW += dY_b * col_b^T
+                    im2col(g, x + b * g.in_channels * g.in_plane(), col.data());
+                    Kernels::gemm(false, true, g.out_channels, g.patch(), g.out_plane(), dy_b, g.out_plane(), col.data(), g.out_plane(), dw.data(), g.patch(), true);
+                    // dX_b = col2im(W^T * dY_b)
+                    Kernels::gemm(true, false, g.patch(), g.out_plane(), g.out_channels, w, g.patch(), dy_b, g.out_plane(), dcol.data(), g.out_plane());
+                    col2im(g, dcol.data(), dx + b * g.in_channels * g.in_plane());
+                }
+#pragma omp critical
+                {
+                    for (size_t i = 0; i < weights; ++i) dk[i] += dw[i];
+                    for (size_t oc = 0; oc < g.out_channels; ++oc) dbias[oc] += db[oc];
                 }
             }
-        }
+            });
 
-        auto d_input = std::make_shared<Tensor>(); d_input->data = d_input_arr;
-        auto d_kernel = std::make_shared<Tensor>(); d_kernel->data = d_kernel_arr;
-        auto d_bias = std::make_shared<Tensor>(); d_bias->data = d_bias_arr;
-        return { d_input, d_kernel, d_bias };
+        return { tensor_of(d_input_arr), tensor_of(d_kernel_arr), tensor_of(d_bias_arr) };
         };
     return result_tensor;
 }
@@ -685,65 +886,125 @@ BasicValue builtin_maxpool2d(NeReLaBasic& vm, const std::vector<BasicValue>& arg
     int pool_size = static_cast<int>(to_double(args[1]));
     int stride = static_cast<int>(to_double(args[2]));
 
-    size_t channels = input->data->shape[1];
-    size_t in_height = input->data->shape[2];
-    size_t in_width = input->data->shape[3];
-    size_t out_height = static_cast<size_t>(std::floor((in_height - pool_size) / stride)) + 1;
-    size_t out_width = static_cast<size_t>(std::floor((in_width - pool_size) / stride)) + 1;
-
-    auto result_array = std::make_shared<FloatArray>();
-    result_array->shape = { 1, channels, out_height, out_width };
-    result_array->data.resize(channels * out_height * out_width);
-
-    auto indices_array = std::make_shared<FloatArray>();
-    indices_array->shape = result_array->shape;
-    indices_array->data.resize(result_array->size());
-
-    for (size_t c = 0; c < channels; ++c) {
-        for (size_t y = 0; y < out_height; ++y) {
-            for (size_t x = 0; x < out_width; ++x) {
-                double max_val = -std::numeric_limits<double>::infinity();
-                size_t max_index = 0;
-                for (int py = 0; py < pool_size; ++py) {
-                    for (int px = 0; px < pool_size; ++px) {
-                        int input_y = y * stride + py;
-                        int input_x = x * stride + px;
-                        size_t current_index = c * (in_height * in_width) + input_y * in_width + input_x;
-                        double current_val = input->data->data[current_index];
-                        if (current_val > max_val) {
-                            max_val = current_val;
-                            max_index = current_index;
+    const auto& in_shape = input->data->shape;
+    if (in_shape.size() != 4) {
+        Error::set(15, vm.runtime_current_line, "MAXPOOL2D expects a [batch, channels, height, width] input."); return {};
+    }
+    if (pool_size < 1 || stride < 1 || static_cast<size_t>(pool_size) > in_shape[2] || static_cast<size_t>(pool_size) > in_shape[3]) {
+        Error::set(15, vm.runtime_current_line, "MAXPOOL2D pool size and stride must be at least 1 and the pool must fit the input."); return {};
+    }
+
+    size_t batch = in_shape[0];
+    size_t channels = in_shape[1];
+    size_t in_height = in_shape[2];
+    size_t in_width = in_shape[3];
+    size_t out_height = (in_height - pool_size) / stride + 1;
+    size_t out_width = (in_width - pool_size) / stride + 1;
+    size_t in_plane = in_height * in_width;
+    size_t out_plane = out_height * out_width;
+    size_t planes = batch * channels;
+
+    const DType dtype = input->data->dtype;
+    auto result_array = new_float_array({ batch, channels, out_height, out_width }, dtype);
+
+    // Flat input index of the maximum each output was taken from, for the backward pass.
+    auto indices = std::make_shared<std::vector<size_t>>(result_array->size());
+
+    dispatch(dtype, [&](auto zero) {
+        using T = decltype(zero);
+        const T* in = input->data->values<T>().data();
+        T* out = result_array->values<T>().data();
+#pragma omp parallel for if(planes * out_plane >= 4096)
+        for (long long p = 0; p < static_cast<long long>(planes); ++p) {
+            for (size_t y = 0; y < out_height; ++y) {
+                for (size_t x = 0; x < out_width; ++x) {
+                    T max_val = -std::numeric_limits<T>::infinity();
+                    size_t max_index = p * in_plane + y * stride * in_width + x * stride;
+                    for (int py = 0; py < pool_size; ++py) {
+                        for (int px = 0; px < pool_size; ++px) {
+                            size_t current_index = p * in_plane + (y * stride + py) * in_width + x * stride + px;
+                            if (in[current_index] > max_val) {
+                                max_val = in[current_index];
+                                max_index = current_index;
+                            }
                         }
                     }
+                    size_t o = p * out_plane + y * out_width + x;
+                    out[o] = max_val;
+                    (*indices)[o] = max_index;
                 }
-                result_array->data[c * (out_height * out_width) + y * out_width + x] = max_val;
-                indices_array->data[c * (out_height * out_width) + y * out_width + x] = static_cast<double>(max_index);
             }
         }
-    }
+        });
 
     auto result_tensor = std::make_shared<Tensor>();
     result_tensor->data = result_array;
+    if (!vm.tensor_grad_enabled) return result_tensor;
     result_tensor->parents = { input };
 
-    result_tensor->backward_fn = [input_shape = input->data->shape, indices_array](std::shared_ptr<Tensor> output_grad) -> std::vector<std::shared_ptr<Tensor>> {
-        auto input_grad_array = std::make_shared<FloatArray>();
-        input_grad_array->shape = input_shape;
-        input_grad_array->data.assign(input_grad_array->size(), 0.0);
-        for (size_t i = 0; i < output_grad->data->data.size(); ++i) {
-            size_t max_idx = static_cast<size_t>(output_grad->data->data[i]);
-            double current_grad = input_grad_array->data[max_idx];
-            double new_grad = output_grad->data->data[i];
-            input_grad_array->data[max_idx] = current_grad + new_grad;
-        }
-        auto final_grad = std::make_shared<Tensor>();
-        final_grad->data = input_grad_array;
-        return { final_grad };
+    result_tensor->backward_fn = [input_shape = in_shape, dtype, indices, planes, out_plane](std::shared_ptr<Tensor> output_grad) -> std::vector<std::shared_ptr<Tensor>> {
+        auto input_grad_array = new_float_array(input_shape, 0.0, dtype);
+        dispatch(dtype, [&](auto zero) {
+            using T = decltype(zero);
+            const T* dy = output_grad->data->values<T>().data();
+            T* dx = input_grad_array->values<T>().data();
+            // Every plane routes its gradient into its own input plane, so planes can run in parallel.
+#pragma omp parallel for if(planes * out_plane >= 4096)
+            for (long long p = 0; p < static_cast<long long>(planes); ++p) {
+                for (size_t o = p * out_plane; o < (p + 1) * out_plane; ++o) dx[(*indices)[o]] += dy[o];
+            }
+            });
+        return { tensor_of(input_grad_array) };
         };
     return result_tensor;
 }
 
 
+namespace {
+    // Row-wise kernels for the normalising layers. Rows are independent, so large
+    // inputs are split over the OpenMP threads one row at a time; each row is
+    // small enough to stay in L1 across the passes that touch it.
+    constexpr size_t ROW_PARALLEL_MIN = 1 << 14; // elements
+
+    // y = softmax(x) over the first 'end' entries of the row; the rest is masked to 0.
+    template <typename T>
+    void softmax_row(const T* x, T* y, size_t end, size_t cols) {
+        T max_val = -std::numeric_limits<T>::infinity();
+        for (size_t j = 0; j < end; ++j) max_val = std::max(max_val, x[j]);
+        double sum = 0.0;
+        for (size_t j = 0; j < end; ++j) {
+            T e = std::exp(x[j] - max_val);
+            y[j] = e;
+            sum += e;
+        }
+        if (sum > 0) {
+            const T total = static_cast<T>(sum);
+            for (size_t j = 0; j < end; ++j) y[j] /= total;
+        }
+        std::fill(y + end, y + cols, T(0));
+    }
+
+    // Softmax of every row of a [rows, cols] buffer. With 'causal', row i only
+    // sees columns 0..i.
+    template <typename T>
+    void softmax_rows(const T* x, T* y, size_t rows, size_t cols, bool causal) {
+#pragma omp parallel for if(rows > 1 && rows * cols >= ROW_PARALLEL_MIN)
+        for (long long i = 0; i < static_cast<long long>(rows); ++i) {
+            size_t end = causal ? std::min(static_cast<size_t>(i) + 1, cols) : cols;
+            softmax_row(x + i * cols, y + i * cols, end, cols);
+        }
+    }
+
+    // A 1D tensor is treated as a single row.
+    void row_shape(const std::vector<size_t>& shape, size_t& rows, size_t& cols) {
+        rows = shape.size() > 1 ? shape[0] : 1;
+        cols = shape.size() > 1 ? shape[1] : (shape.empty() ? 0 : shape[0]);
+    }
+} // end anonymous namespace
+
+// Layer normalisation over the last axis of a 2D tensor. The forward pass keeps
+// only the mean and 1/stddev of each row; the backward pass rebuilds the
+// normalised values from them instead of holding a second copy of the input.
 BasicValue builtin_layer_norm(NeReLaBasic& vm, const std::vector<BasicValue>& args) {
     if (args.size() != 3) {
         Error::set(8, vm.runtime_current_line, "LAYER_NORM requires 3 arguments: input_tensor, gain_tensor, bias_tensor.");
@@ -765,84 +1026,103 @@ BasicValue builtin_layer_norm(NeReLaBasic& vm, const std::vector<BasicValue>& ar
 
     size_t rows = x->data->shape[0];
     size_t cols = x->data->shape[1];
+    if (gain->data->size() != cols || bias->data->size() != cols) {
+        Error::set(15, vm.runtime_current_line, "LAYER_NORM gain and bias must have one entry per column."); return {};
+    }
+
+    const DType dtype = common_dtype({ &x->data, &gain->data, &bias->data });
+    auto x_data = as_dtype(x->data, dtype);
+    auto gain_data = as_dtype(gain->data, dtype);
+    auto bias_data = as_dtype(bias->data, dtype);
+    auto native_result_data = new_float_array(x_data->shape, dtype);
+
+    // mean and 1/sqrt(variance + epsilon) of every row, for the backward pass
+    auto row_stats = new_float_array({ rows, 2 });
+
+    dispatch(dtype, [&](auto zero) {
+        using T = decltype(zero);
+        const T* in = x_data->values<T>().data();
+        const T* g = gain_data->values<T>().data();
+        const T* b = bias_data->values<T>().data();
+        T* out = native_result_data->values<T>().data();
+#pragma omp parallel for if(rows > 1 && rows * cols >= ROW_PARALLEL_MIN)
+        for (long long r = 0; r < static_cast<long long>(rows); ++r) {
+            const T* row = in + r * cols;
+            double sum = 0.0;
+            for (size_t c = 0; c < cols; ++c) sum += row[c];
+            double mean = sum / cols;
+
+            double var_sum = 0.0;
+            for (size_t c = 0; c < cols; ++c) {
+                double d = row[c] - mean;
+                var_sum += d * d;
+            }
+            double inv_std = 1.0 / std::sqrt(var_sum / cols + epsilon);
+            row_stats->data[2 * r] = mean;
+            row_stats->data[2 * r + 1] = inv_std;
 
-    auto native_result_data = std::make_shared<FloatArray>();
-    native_result_data->shape = x->data->shape;
-    native_result_data->data.resize(x->data->size());
-
-    auto var_array = std::make_shared<FloatArray>();
-    auto x_norm_array = std::make_shared<FloatArray>();
-    var_array->shape = { rows, 1 };
-    var_array->data.reserve(rows);
-    x_norm_array->shape = x->data->shape;
-    x_norm_array->data.resize(x->data->size());
-
-    for (size_t r = 0; r < rows; ++r) {
-        size_t row_start = r * cols;
-        double sum = 0.0;
-        for (size_t c = 0; c < cols; ++c) sum += x->data->data[row_start + c];
-        double mean = sum / cols;
-
-        double var_sum = 0.0;
-        for (size_t c = 0; c < cols; ++c) var_sum += std::pow(x->data->data[row_start + c] - mean, 2);
-        double variance = var_sum / cols;
-        var_array->data.push_back(variance);
-
-        double inv_std = 1.0 / std::sqrt(variance + epsilon);
-
-        for (size_t c = 0; c < cols; ++c) {
-            double x_norm_val = (x->data->data[row_start + c] - mean) * inv_std;
-            x_norm_array->data[row_start + c] = x_norm_val;
-            native_result_data->data[row_start + c] = gain->data->data[c] * x_norm_val + bias->data->data[c];
+            T* out_row = out + r * cols;
+            for (size_t c = 0; c < cols; ++c) out_row[c] = static_cast<T>(g[c] * ((row[c] - mean) * inv_std) + b[c]);
         }
-    }
+        });
 
     auto result_tensor = std::make_shared<Tensor>();
     result_tensor->data = native_result_data;
+    if (!vm.tensor_grad_enabled) return result_tensor;
     result_tensor->parents = { x, gain, bias };
 
     result_tensor->backward_fn = [=](std::shared_ptr<Tensor> output_grad) -> std::vector<std::shared_ptr<Tensor>> {
-        auto dx = std::make_shared<FloatArray>();
-        auto dgain = std::make_shared<FloatArray>();
-        auto dbias = std::make_shared<FloatArray>();
-        dx->shape = x->data->shape;
-        dgain->shape = gain->data->shape;
-        dbias->shape = bias->data->shape;
-        dx->data.assign(x->data->size(), 0.0);
-        dgain->data.assign(gain->data->size(), 0.0);
-        dbias->data.assign(bias->data->size(), 0.0);
-
-        for (size_t r = 0; r < rows; ++r) {
-            size_t row_start = r * cols;
-            double inv_std = 1.0 / std::sqrt(var_array->data[r] + epsilon);
-
-            double d_x_norm_mean = 0.0;
-            double d_x_norm_x_norm_mean = 0.0;
-
-            for (size_t c = 0; c < cols; ++c) {
-                double dout = output_grad->data->data[row_start + c];
-                double x_norm_val = x_norm_array->data[row_start + c];
-
-                dbias->data[c] += dout;
-                dgain->data[c] += dout * x_norm_val;
+        auto dx = new_float_array(x_data->shape, dtype);
+        auto dgain = new_float_array(gain_data->shape, dtype);
+        auto dbias = new_float_array(bias_data->shape, dtype);
+
+        dispatch(dtype, [&](auto zero) {
+            using T = decltype(zero);
+            const T* in = x_data->values<T>().data();
+            const T* g = gain_data->values<T>().data();
+            const T* dout = output_grad->data->values<T>().data();
+            T* dxp = dx->values<T>().data();
+
+            // dx only depends on its own row.
+#pragma omp parallel for if(rows > 1 && rows * cols >= ROW_PARALLEL_MIN)
+            for (long long r = 0; r < static_cast<long long>(rows); ++r) {
+                const double mean = row_stats->data[2 * r], inv_std = row_stats->data[2 * r + 1];
+                const T* row = in + r * cols;
+                const T* dout_row = dout + r * cols;
+                double d_x_norm_mean = 0.0;
+                double d_x_norm_x_norm_mean = 0.0;
+                for (size_t c = 0; c < cols; ++c) {
+                    double d_x_norm_i = dout_row[c] * g[c];
+                    d_x_norm_mean += d_x_norm_i;
+                    d_x_norm_x_norm_mean += d_x_norm_i * ((row[c] - mean) * inv_std);
+                }
+                d_x_norm_mean /= cols;
+                d_x_norm_x_norm_mean /= cols;
 
-                double d_x_norm_i = dout * gain->data->data[c];
-                d_x_norm_mean += d_x_norm_i;
-                d_x_norm_x_norm_mean += d_x_norm_i * x_norm_val;
+                T* dx_row = dxp + r * cols;
+                for (size_t c = 0; c < cols; ++c) {
+                    double x_norm_i = (row[c] - mean) * inv_std;
+                    dx_row[c] = static_cast<T>(((dout_row[c] * g[c] - d_x_norm_mean) - x_norm_i * d_x_norm_x_norm_mean) * inv_std);
+                }
             }
-            d_x_norm_mean /= cols;
-            d_x_norm_x_norm_mean /= cols;
 
-            for (size_t c = 0; c < cols; ++c) {
-                double d_x_norm_i = output_grad->data->data[row_start + c] * gain->data->data[c];
-                double x_norm_i = x_norm_array->data[row_start + c];
-                dx->data[row_start + c] += ((d_x_norm_i - d_x_norm_mean) - x_norm_i * d_x_norm_x_norm_mean) * inv_std;
+            // The gain and bias gradients sum over the rows; this stays serial so the
+            // result does not depend on the thread count.
+            std::vector<double> dg(cols, 0.0), db(cols, 0.0);
+            for (size_t r = 0; r < rows; ++r) {
+                const double mean = row_stats->data[2 * r], inv_std = row_stats->data[2 * r + 1];
+                const T* row = in + r * cols;
+                const T* dout_row = dout + r * cols;
+                for (size_t c = 0; c < cols; ++c) {
+                    db[c] += dout_row[c];
+                    dg[c] += dout_row[c] * ((row[c] - mean) * inv_std);
+                }
             }
-        }
-        auto dx_tensor = std::make_shared<Tensor>(); dx_tensor->data = dx;
-        auto dgain_tensor = std::make_shared<Tensor>(); dgain_tensor->data = dgain;
-        auto dbias_tensor = std::make_shared<Tensor>(); dbias_tensor->data = dbias;
-        return { dx_tensor, dgain_tensor, dbias_tensor };
+            std::copy(dg.begin(), dg.end(), dgain->values<T>().begin());
+            std::copy(db.begin(), db.end(), dbias->values<T>().begin());
+            });
+
+        return { tensor_of(dx), tensor_of(dgain), tensor_of(dbias) };
         };
 
     return result_tensor;
@@ -856,14 +1136,20 @@ BasicValue builtin_sigmoid(NeReLaBasic& vm, const std::vector<BasicValue>& args)
     
     const auto& input_tensor = std::get<std::shared_ptr<Tensor>>(args[0]);
 
-    auto result_array = std::make_shared<FloatArray>();
-    result_array->shape = input_tensor->data->shape;
-    result_array->data.reserve(input_tensor->data->size());
-    for (const auto& val : input_tensor->data->data) {
-        result_array->data.push_back(1.0 / (1.0 + std::exp(-val)));
-    }
+    const DType dtype = input_tensor->data->dtype;
+    auto result_array = new_float_array(input_tensor->data->shape, dtype);
+    dispatch(dtype, [&](auto zero) {
+        using T = decltype(zero);
+        const T* in = input_tensor->data->values<T>().data();
+        T* out = result_array->values<T>().data();
+        const size_t n = result_array->count();
+#pragma omp parallel for simd if(n >= ROW_PARALLEL_MIN)
+        for (long long i = 0; i < static_cast<long long>(n); ++i) out[i] = sigmoid(in[i]);
+        });
+
     auto result_tensor = std::make_shared<Tensor>();
     result_tensor->data = result_array;
+    if (!vm.tensor_grad_enabled) return result_tensor;
     result_tensor->parents = { input_tensor };
 
     std::weak_ptr<Tensor> result_tensor_weak(result_tensor);
@@ -871,15 +1157,20 @@ BasicValue builtin_sigmoid(NeReLaBasic& vm, const std::vector<BasicValue>& args)
         auto result_tensor = result_tensor_weak.lock();
         if (!result_tensor) return { nullptr };
 
-        auto ones_array = std::make_shared<FloatArray>();
-        ones_array->shape = result_tensor->data->shape;
-        ones_array->data.assign(result_tensor->data->size(), 1.0);
-        auto one_minus_sigmoid = float_array_subtract(ones_array, result_tensor->data);
-        auto derivative = float_array_elementwise_multiply(result_tensor->data, one_minus_sigmoid);
-        auto final_grad_data = float_array_elementwise_multiply(output_grad->data, derivative);
-        auto final_grad_tensor = std::make_shared<Tensor>();
-        final_grad_tensor->data = final_grad_data;
-        return { final_grad_tensor };
+        // dx = dy * s * (1 - s), in one pass
+        const DType dtype = result_tensor->data->dtype;
+        auto final_grad_data = new_float_array(result_tensor->data->shape, dtype);
+        dispatch(dtype, [&](auto zero) {
+            using T = decltype(zero);
+            const T* s = result_tensor->data->values<T>().data();
+            const T* dy = output_grad->data->values<T>().data();
+            T* dx = final_grad_data->values<T>().data();
+            const size_t n = final_grad_data->count();
+#pragma omp parallel for simd if(n >= ROW_PARALLEL_MIN)
+            for (long long i = 0; i < static_cast<long long>(n); ++i) dx[i] = dy[i] * (s[i] * (T(1) - s[i]));
+            });
+
+        return { tensor_of(final_grad_data) };
         };
     return result_tensor;
 }
@@ -888,24 +1179,18 @@ BasicValue tensor_sum(NeReLaBasic& vm, const std::vector<BasicValue>& args) {
     if (args.empty()) { Error::set(8, vm.runtime_current_line); return {}; }
     const auto& input_tensor = std::get<std::shared_ptr<Tensor>>(args[0]);
 
+    const DType dtype = input_tensor->data->dtype;
     double total = 0.0;
-    for (const auto& val : input_tensor->data->data) {
-        total += val;
+    for (size_t i = 0; i < input_tensor->data->count(); ++i) {
+        total += input_tensor->data->at(i);
     }
     auto result_tensor = std::make_shared<Tensor>();
-    result_tensor->data = std::make_shared<FloatArray>();
-    result_tensor->data->shape = { 1 };
-    result_tensor->data->data = { total };
+    result_tensor->data = new_float_array({ 1 }, total, dtype);
+    if (!vm.tensor_grad_enabled) return result_tensor;
     result_tensor->parents = { input_tensor };
 
     result_tensor->backward_fn = [input_tensor](std::shared_ptr<Tensor> output_grad) -> std::vector<std::shared_ptr<Tensor>> {
-        double grad_val = output_grad->data->data[0];
-        auto grad_array = std::make_shared<FloatArray>();
-        grad_array->shape = input_tensor->data->shape;
-        grad_array->data.assign(input_tensor->data->size(), grad_val);
-        auto final_grad_tensor = std::make_shared<Tensor>();
-        final_grad_tensor->data = grad_array;
-        return { final_grad_tensor };
+        return { tensor_of(new_float_array(input_tensor->data->shape, output_grad->data->at(0), input_tensor->data->dtype)) };
         };
     return result_tensor;
 }
@@ -965,7 +1250,9 @@ namespace {
                 nlohmann::json tensor_obj;
                 tensor_obj["__type__"] = "tensor";
                 tensor_obj["shape"] = arg->data->shape;
-                tensor_obj["data"] = arg->data->data;
+                tensor_obj["dtype"] = dtype_name(arg->data->dtype);
+                if (arg->data->dtype == DType::FLOAT32) tensor_obj["data"] = arg->data->data32;
+                else tensor_obj["data"] = arg->data->data;
                 return tensor_obj;
             }
             else if constexpr (std::is_same_v<T, DateTime> || std::is_same_v<T, FunctionRef>) {
@@ -977,7 +1264,7 @@ namespace {
                 return nlohmann::json("<COM Object>");
             }
 #endif
-            else if constexpr (std::is_same_v<T, bool> || std::is_same_v<T, double> || std::is_same_v<T, int> || std::is_same_v<T, std::string>) {
+            else if constexpr (std::is_same_v<T, bool> || std::is_same_v<T, double> || std::is_same_v<T, int> || std::is_same_v<T, BasicString>) {
                 return nlohmann::json(arg);
             }
             else {
@@ -1007,7 +1294,12 @@ namespace {
                 auto tensor = std::make_shared<Tensor>();
                 tensor->data = std::make_shared<FloatArray>();
                 tensor->data->shape = j["shape"].get<std::vector<size_t>>();
-                tensor->data->data = j["data"].get<std::vector<double>>();
+                // Models saved before tensors had a dtype are float64.
+                DType dtype = DType::FLOAT64;
+                if (j.contains("dtype") && j["dtype"].is_string()) parse_dtype(j["dtype"].get<std::string>(), dtype);
+                tensor->data->dtype = dtype;
+                if (dtype == DType::FLOAT32) tensor->data->data32 = j["data"].get<std::vector<float>>();
+                else tensor->data->data = j["data"].get<std::vector<double>>();
                 return tensor;
             }
             else {
@@ -1025,7 +1317,7 @@ namespace {
 BasicValue builtin_save_model(NeReLaBasic& vm, const std::vector<BasicValue>& args) {
     if (args.size() != 2) { Error::set(8, vm.runtime_current_line); return false; }
     const auto& model_map_ptr = std::get<std::shared_ptr<Map>>(args[0]);
-    const std::string filename = std::get<std::string>(args[1]);
+    const std::string filename = std::get<BasicString>(args[1]);
 
     nlohmann::json j_model = tensor_basic_value_to_json(model_map_ptr);
 
@@ -1037,7 +1329,7 @@ BasicValue builtin_save_model(NeReLaBasic& vm, const std::vector<BasicValue>& ar
 
 BasicValue builtin_load_model(NeReLaBasic& vm, const std::vector<BasicValue>& args) {
     if (args.size() != 1) { Error::set(8, vm.runtime_current_line); return {}; }
-    const std::string filename = std::get<std::string>(args[0]);
+    const std::string filename = std::get<BasicString>(args[0]);
     std::ifstream infile(filename);
     if (!infile) { Error::set(6, vm.runtime_current_line); return {}; }
 
@@ -1054,19 +1346,26 @@ BasicValue builtin_load_model(NeReLaBasic& vm, const std::vector<BasicValue>& ar
 // --- Factory and Utility Functions ---
 // --- Bridge and Factory Functions ---
 
+// TENSOR.FROM(array [, dtype$]): dtype$ is "float64" (the default) or "float32".
 BasicValue builtin_to_tensor(NeReLaBasic& vm, const std::vector<BasicValue>& args) {
-    if (args.size() != 1) { Error::set(8, vm.runtime_current_line); return {}; }
+    if (args.empty() || args.size() > 2) { Error::set(8, vm.runtime_current_line, "TENSOR.FROM requires 1 or 2 arguments."); return {}; }
     if (!std::holds_alternative<std::shared_ptr<Array>>(args[0])) {
         Error::set(15, vm.runtime_current_line, "Argument to TENSOR.FROM must be an Array."); return {};
     }
+    DType dtype = DType::FLOAT64;
+    if (args.size() > 1 && !parse_dtype(to_string(args[1]), dtype)) {
+        Error::set(1, vm.runtime_current_line, "Unknown tensor dtype: " + to_string(args[1]) + ". Use \"float32\" or \"float64\".");
+        return {};
+    }
     const auto& generic_array_ptr = std::get<std::shared_ptr<Array>>(args[0]);
 
-    auto float_array_ptr = std::make_shared<FloatArray>();
-    float_array_ptr->shape = generic_array_ptr->shape;
-    float_array_ptr->data.reserve(generic_array_ptr->size());
-    for (const auto& val : generic_array_ptr->data) {
-        float_array_ptr->data.push_back(to_double(val));
-    }
+    auto float_array_ptr = new_float_array(generic_array_ptr->shape, dtype);
+    std::vector<double> scratch;
+    const double* values = generic_array_ptr->data.numbers(scratch);
+    dispatch(dtype, [&](auto zero) {
+        using T = decltype(zero);
+        std::copy(values, values + float_array_ptr->count(), float_array_ptr->values<T>().begin());
+        });
 
     auto tensor_ptr = std::make_shared<Tensor>();
     tensor_ptr->data = float_array_ptr;
@@ -1083,36 +1382,52 @@ BasicValue builtin_toarray(NeReLaBasic& vm, const std::vector<BasicValue>& args)
     auto generic_array_ptr = std::make_shared<Array>();
     generic_array_ptr->shape = tensor_ptr->data->shape;
     generic_array_ptr->data.reserve(tensor_ptr->data->size());
-    for (double val : tensor_ptr->data->data) {
-        generic_array_ptr->data.push_back(val);
+    for (size_t i = 0; i < tensor_ptr->data->count(); ++i) {
+        generic_array_ptr->data.push_back(tensor_ptr->data->at(i));
     }
     return generic_array_ptr;
 }
 
+// TENSOR.DTYPE(tensor) -> "float32" or "float64"
+BasicValue builtin_tensor_dtype(NeReLaBasic& vm, const std::vector<BasicValue>& args) {
+    if (args.size() != 1) { Error::set(8, vm.runtime_current_line); return {}; }
+    if (!std::holds_alternative<std::shared_ptr<Tensor>>(args[0])) {
+        Error::set(15, vm.runtime_current_line, "Argument to TENSOR.DTYPE must be a Tensor."); return {};
+    }
+    const auto& tensor_ptr = std::get<std::shared_ptr<Tensor>>(args[0]);
+    if (!tensor_ptr || !tensor_ptr->data) { Error::set(3, vm.runtime_current_line); return {}; }
+    return std::string(dtype_name(tensor_ptr->data->dtype));
+}
+
 BasicValue builtin_create_layer(NeReLaBasic& vm, const std::vector<BasicValue>& args) {
     if (args.size() != 2) { Error::set(8, vm.runtime_current_line); return {}; }
-    if (!std::holds_alternative<std::string>(args[0])) {
+    if (!std::holds_alternative<BasicString>(args[0])) {
         Error::set(15, vm.runtime_current_line, "Argument 1 to TENSOR.CREATE_LAYER must be a String."); return {};
     }
     if (!std::holds_alternative<std::shared_ptr<Map>>(args[1])) {
         Error::set(15, vm.runtime_current_line, "Argument 1 to TENSOR.CREATE_LAYER must be a Map."); return {};
     }
-    std::string layer_type = to_upper(std::get<std::string>(args[0]));
+    std::string layer_type = to_upper(std::get<BasicString>(args[0]));
     const auto& options_map_ptr = std::get<std::shared_ptr<Map>>(args[1]);
     auto layer_result_ptr = std::make_shared<Map>();
     layer_result_ptr->data["type"] = layer_type;
     auto& options = options_map_ptr->data;
 
+    // New layers are float32 unless the options ask for "dtype": "float64".
+    DType dtype = DType::FLOAT32;
+    if (options.count("dtype") && !parse_dtype(to_string(options.at("dtype")), dtype)) {
+        Error::set(1, vm.runtime_current_line, "Unknown tensor dtype: " + to_string(options.at("dtype")) + ". Use \"float32\" or \"float64\".");
+        return {};
+    }
+
     try {
         if (layer_type == "DENSE") {
             size_t input_size = static_cast<size_t>(to_double(options.at("input_size")));
             size_t units = static_cast<size_t>(to_double(options.at("units")));
             auto weights_tensor = std::make_shared<Tensor>();
-            weights_tensor->data = create_randomized_float_array({ input_size, units }, input_size, units);
+            weights_tensor->data = create_randomized_float_array({ input_size, units }, input_size, units, dtype);
             auto bias_tensor = std::make_shared<Tensor>();
-            bias_tensor->data = std::make_shared<FloatArray>();
-            bias_tensor->data->shape = { 1, units };
-            bias_tensor->data->data.assign(units, 0.0);
+            bias_tensor->data = create_filled_float_array({ 1, units }, 0.0, dtype);
             layer_result_ptr->data["weights"] = weights_tensor;
             layer_result_ptr->data["bias"] = bias_tensor;
         }
@@ -1120,30 +1435,26 @@ BasicValue builtin_create_layer(NeReLaBasic& vm, const std::vector<BasicValue>&
             size_t vocab_size = static_cast<size_t>(to_double(options.at("vocab_size")));
             size_t embedding_dim = static_cast<size_t>(to_double(options.at("embedding_dim")));
             auto weights_tensor = std::make_shared<Tensor>();
-            weights_tensor->data = create_randomized_float_array({ vocab_size, embedding_dim }, vocab_size, embedding_dim);
+            weights_tensor->data = create_randomized_float_array({ vocab_size, embedding_dim }, vocab_size, embedding_dim, dtype);
             layer_result_ptr->data["weights"] = weights_tensor;
         }
         else if (layer_type == "LAYER_NORM") {
             size_t dim = static_cast<size_t>(to_double(options.at("dim")));
             auto gain_tensor = std::make_shared<Tensor>();
-            gain_tensor->data = std::make_shared<FloatArray>();
-            gain_tensor->data->shape = { 1, dim };
-            gain_tensor->data->data.assign(dim, 1.0);
+            gain_tensor->data = create_filled_float_array({ 1, dim }, 1.0, dtype);
             auto bias_tensor = std::make_shared<Tensor>();
-            bias_tensor->data = std::make_shared<FloatArray>();
-            bias_tensor->data->shape = { 1, dim };
-            bias_tensor->data->data.assign(dim, 0.0);
+            bias_tensor->data = create_filled_float_array({ 1, dim }, 0.0, dtype);
             layer_result_ptr->data["gain"] = gain_tensor;
             layer_result_ptr->data["bias"] = bias_tensor;
         }
         else if (layer_type == "ATTENTION") {
             size_t embedding_dim = static_cast<size_t>(to_double(options.at("embedding_dim")));
             auto w_q = std::make_shared<Tensor>();
-            w_q->data = create_randomized_float_array({ embedding_dim, embedding_dim }, embedding_dim, embedding_dim);
+            w_q->data = create_randomized_float_array({ embedding_dim, embedding_dim }, embedding_dim, embedding_dim, dtype);
             auto w_k = std::make_shared<Tensor>();
-            w_k->data = create_randomized_float_array({ embedding_dim, embedding_dim }, embedding_dim, embedding_dim);
+            w_k->data = create_randomized_float_array({ embedding_dim, embedding_dim }, embedding_dim, embedding_dim, dtype);
             auto w_v = std::make_shared<Tensor>();
-            w_v->data = create_randomized_float_array({ embedding_dim, embedding_dim }, embedding_dim, embedding_dim);
+            w_v->data = create_randomized_float_array({ embedding_dim, embedding_dim }, embedding_dim, embedding_dim, dtype);
             layer_result_ptr->data["Wq"] = w_q;
             layer_result_ptr->data["Wk"] = w_k;
             layer_result_ptr->data["Wv"] = w_v;
@@ -1162,12 +1473,12 @@ BasicValue builtin_create_optimizer(NeReLaBasic& vm, const std::vector<BasicValu
         Error::set(8, vm.runtime_current_line, "CREATE_OPTIMIZER requires 2 arguments: type$, options_map");
         return {};
     }
-    if (!std::holds_alternative<std::string>(args[0]) || !std::holds_alternative<std::shared_ptr<Map>>(args[1])) {
+    if (!std::holds_alternative<BasicString>(args[0]) || !std::holds_alternative<std::shared_ptr<Map>>(args[1])) {
         Error::set(15, vm.runtime_current_line, "Invalid arguments for CREATE_OPTIMIZER.");
         return {};
     }
 
-    std::string optimizer_type = to_upper(std::get<std::string>(args[0]));
+    std::string optimizer_type = to_upper(std::get<BasicString>(args[0]));
     const auto& options_map_ptr = std::get<std::shared_ptr<Map>>(args[1]);
     if (!options_map_ptr) {
         Error::set(3, vm.runtime_current_line, "Optimizer options map cannot be null.");
@@ -1233,6 +1544,51 @@ BasicValue builtin_optimizer_update(NeReLaBasic& vm, const std::vector<BasicValu
 
 // --- Autodiff and Training Functions ---
 
+namespace {
+    // Below this many gradient elements in a wave of independent nodes, TENSOR.BACKWARD
+    // runs them one after the other rather than waking the thread team.
+    constexpr size_t BRANCH_PARALLEL_MIN = 1 << 14;
+
+    // Adds 'incoming' to parent.grad. The first gradient is adopted as it is; later
+    // ones are summed in place once the parent owns its gradient buffer. A gradient
+    // that is still shared (returned to several parents, or held by a BASIC
+    // variable) is copied once before it is written to. Gradients always take the
+    // dtype of the tensor they belong to; an op that ran in float32 on a float64
+    // input hands back a float32 gradient, which is converted here.
+    void accumulate_grad(Tensor& parent, const std::shared_ptr<Tensor>& incoming) {
+        const DType dtype = parent.data ? parent.data->dtype : incoming->data->dtype;
+        if (!parent.grad || !parent.grad->data) {
+            parent.grad = incoming->data->dtype == dtype ? incoming : tensor_of(as_dtype(incoming->data, dtype));
+            return;
+        }
+        auto& grad = parent.grad->data;
+        const auto add = as_dtype(incoming->data, dtype);
+        if (grad->shape != add->shape) {
+            parent.grad = tensor_of(float_array_add(grad, add));
+            return;
+        }
+        if (parent.grad.use_count() > 1 || grad.use_count() > 1) {
+            parent.grad = tensor_of(float_array_add(grad, add));
+            return;
+        }
+        dispatch(dtype, [&](auto zero) {
+            using T = decltype(zero);
+            T* g = grad->values<T>().data();
+            const T* a = add->values<T>().data();
+            const size_t n = grad->count();
+            for (size_t i = 0; i < n; ++i) g[i] += a[i];
+            });
+    }
+
+    bool has_nonzero(const FloatArray& arr) {
+        const size_t n = arr.count();
+        for (size_t i = 0; i < n; ++i) {
+            if (arr.at(i) != 0.0) return true;
+        }
+        return false;
+    }
+} // end anonymous namespace
+
 BasicValue builtin_backward(NeReLaBasic& vm, const std::vector<BasicValue>& args) {
     if (args.size() != 1) { Error::set(8, vm.runtime_current_line); return false; }
     if (!std::holds_alternative<std::shared_ptr<Tensor>>(args[0]) ) {
@@ -1242,49 +1598,98 @@ BasicValue builtin_backward(NeReLaBasic& vm, const std::vector<BasicValue>& args
     auto loss_tensor = std::get<std::shared_ptr<Tensor>>(args[0]);
     if (!loss_tensor || !loss_tensor->data) { Error::set(3, vm.runtime_current_line); return false; }
 
-    std::vector<std::shared_ptr<Tensor>> sorted_graph;
-    std::unordered_set<const Tensor*> visited;
-    std::function<void(std::shared_ptr<Tensor>)> visit =
-        [&](std::shared_ptr<Tensor> node) {
-        if (!node || visited.count(node.get())) return;
-        visited.insert(node.get());
-        for (auto& parent : node->parents) {
-            visit(parent);
+    // Collect the graph with an explicit stack (long sequences would overflow a
+    // recursive walk) and count, for every node, the edges from its consumers.
+    std::vector<std::shared_ptr<Tensor>> nodes{ loss_tensor };
+    std::unordered_map<const Tensor*, size_t> index{ { loss_tensor.get(), 0 } };
+    std::vector<size_t> pending(1, 0);
+    for (size_t stack_top = 0; stack_top < nodes.size(); ++stack_top) {
+        for (const auto& parent : nodes[stack_top]->parents) {
+            if (!parent) continue;
+            auto [it, inserted] = index.try_emplace(parent.get(), nodes.size());
+            if (inserted) {
+                nodes.push_back(parent);
+                pending.push_back(0);
+            }
+            ++pending[it->second];
         }
-        sorted_graph.push_back(node);
-        };
-    visit(loss_tensor);
+    }
 
-    loss_tensor->grad = std::make_shared<Tensor>();
-    loss_tensor->grad->data = std::make_shared<FloatArray>();
-    loss_tensor->grad->data->shape = loss_tensor->data->shape;
-    loss_tensor->grad->data->data.assign(loss_tensor->data->size(), 1.0);
+    loss_tensor->grad = tensor_of(new_float_array(loss_tensor->data->shape, 1.0, loss_tensor->data->dtype));
+
+    // Walk the tape backwards in waves. A node is ready once all of its consumers
+    // have passed their gradient on; the nodes of one wave are independent
+    // branches (e.g. the Q, K and V projections of an attention layer), so their
+    // backward functions run on the OpenMP thread team. Gradients are then added
+    // into the parents serially, in tape order, so results do not depend on the
+    // thread count.
+    std::vector<size_t> ready{ 0 }, next;
+    std::vector<std::vector<std::shared_ptr<Tensor>>> parent_grads;
+    while (!ready.empty()) {
+        std::sort(ready.begin(), ready.end(), [&](size_t a, size_t b) { return nodes[a]->id > nodes[b]->id; });
+        parent_grads.assign(ready.size(), {});
+
+        // A node released by an earlier BACKWARD has no inputs left to pass a
+        // gradient on to; dropping it would leave the shared part of the graph
+        // with silently wrong gradients.
+        for (size_t r : ready) {
+            const auto& node = nodes[r];
+            if (node->released && node->grad && has_nonzero(*node->grad->data)) {
+                node->grad = nullptr;
+                Error::set(2, vm.runtime_current_line, "Trying to backward through the graph a second time: its intermediate values were freed by an earlier TENSOR.BACKWARD.");
+                return false;
+            }
+        }
 
-    for (auto it = sorted_graph.rbegin(); it != sorted_graph.rend(); ++it) {
-        auto& node = *it;
-        if (node->backward_fn && node->grad) {
-            auto parent_grads = node->backward_fn(node->grad);
+        size_t work = 0;
+        for (size_t r : ready) work += nodes[r]->data ? nodes[r]->data->count() : 0;
+#pragma omp parallel for schedule(dynamic) if(ready.size() > 1 && work >= BRANCH_PARALLEL_MIN)
+        for (long long w = 0; w < static_cast<long long>(ready.size()); ++w) {
+            const auto& node = nodes[ready[w]];
+            if (node->backward_fn && node->grad) parent_grads[w] = node->backward_fn(node->grad);
+        }
 
+        next.clear();
+        for (size_t w = 0; w < ready.size(); ++w) {
+            const auto& node = nodes[ready[w]];
+            // Taken out of parent_grads so an adopted gradient is owned by its parent alone.
+            const auto grads = std::move(parent_grads[w]);
             for (size_t i = 0; i < node->parents.size(); ++i) {
-                auto& parent = node->parents[i];
-                if (i < parent_grads.size() && parent_grads[i] && parent_grads[i]->data) {
-                    if (parent->grad && parent->grad->data) {
-                        parent->grad->data = float_array_add(parent->grad->data, parent_grads[i]->data);
-                    }
-                    else {
-                        parent->grad = parent_grads[i];
-                    }
+                const auto& parent = node->parents[i];
+                if (!parent) continue;
+                if (i < grads.size() && grads[i] && grads[i]->data) {
+                    accumulate_grad(*parent, grads[i]);
                 }
+                size_t p = index.at(parent.get());
+                if (--pending[p] == 0) next.push_back(p);
             }
-        }
 
-        if (!node->parents.empty()) {
-            node->grad = nullptr;
+            // An intermediate node is done once its gradient has been passed on. Its
+            // gradient, the activations its backward closure holds and the links to
+            // its inputs are released now rather than when the graph goes away.
+            if (!node->parents.empty()) {
+                node->grad = nullptr;
+                node->backward_fn = nullptr;
+                node->parents.clear();
+                node->released = true;
+            }
+            else if (node->released) {
+                node->grad = nullptr;
+            }
         }
+        ready.swap(next);
     }
     return false;
 }
 
+// TENSOR.NO_GRAD TRUE stops the tensor ops from recording the autodiff graph
+// (no parents, no backward closures, nothing kept alive for a backward pass)
+// until TENSOR.NO_GRAD FALSE. Meant for inference and evaluation code.
+BasicValue builtin_tensor_no_grad(NeReLaBasic& vm, const std::vector<BasicValue>& args) {
+    if (args.size() != 1) { Error::set(8, vm.runtime_current_line); return false; }
+    vm.tensor_grad_enabled = !to_bool(args[0]);
+    return false;
+}
 
 BasicValue builtin_update(NeReLaBasic& vm, const std::vector<BasicValue>& args) {
     if (args.size() != 2) { Error::set(8, vm.runtime_current_line); return {}; }
@@ -1302,8 +1707,22 @@ BasicValue builtin_update(NeReLaBasic& vm, const std::vector<BasicValue>& args)
             if (std::holds_alternative<std::shared_ptr<Tensor>>(param_val)) {
                 const auto& param_tensor = std::get<std::shared_ptr<Tensor>>(param_val);
                 if (param_tensor && param_tensor->grad && param_tensor->grad->data) {
-                    auto delta = float_array_scalar_multiply(lr, param_tensor->grad->data);
-                    param_tensor->data = float_array_subtract(param_tensor->data, delta);
+                    const auto& grad = param_tensor->grad->data;
+                    if (param_tensor->data.use_count() == 1 && param_tensor->data->shape == grad->shape && param_tensor->data->dtype == grad->dtype) {
+                        // Nobody else sees these weights: step them in place.
+                        dispatch(grad->dtype, [&](auto zero) {
+                            using T = decltype(zero);
+                            T* w = param_tensor->data->values<T>().data();
+                            const T* g = grad->values<T>().data();
+                            const T step = static_cast<T>(lr);
+                            const size_t n = grad->count();
+                            for (size_t i = 0; i < n; ++i) w[i] -= step * g[i];
+                            });
+                    }
+                    else {
+                        auto delta = float_array_scalar_multiply(lr, as_dtype(grad, param_tensor->data->dtype));
+                        param_tensor->data = float_array_subtract(param_tensor->data, delta);
+                    }
                     param_tensor->grad = nullptr;
                 }
             }
@@ -1333,7 +1752,7 @@ BasicValue builtin_update(NeReLaBasic& vm, const std::vector<BasicValue>& args)
 
 BasicValue builtin_tensor_tokenize(NeReLaBasic& vm, const std::vector<BasicValue>& args) {
     if (args.size() != 2) { Error::set(8, vm.runtime_current_line); return {}; }
-    const auto& text = std::get<std::string>(args[0]);
+    const auto& text = std::get<BasicString>(args[0]);
     const auto& vocab_map_val = args[1];
     if (!std::holds_alternative<std::shared_ptr<Map>>(vocab_map_val)) {
         Error::set(15, vm.runtime_current_line, "Second argument to TOKENIZE must be a Map.");
@@ -1389,27 +1808,37 @@ BasicValue builtin_tensor_relu(NeReLaBasic& vm, const std::vector<BasicValue>& a
     }
     const auto& input_tensor = std::get<std::shared_ptr<Tensor>>(args[0]);
 
-    auto result_data = std::make_shared<FloatArray>();
-    result_data->shape = input_tensor->data->shape;
-    result_data->data.reserve(input_tensor->data->size());
-    for (double val : input_tensor->data->data) {
-        result_data->data.push_back(std::max(0.0, val));
-    }
+    const DType dtype = input_tensor->data->dtype;
+    auto result_data = new_float_array(input_tensor->data->shape, dtype);
+    dispatch(dtype, [&](auto zero) {
+        using T = decltype(zero);
+        const T* x = input_tensor->data->values<T>().data();
+        T* out = result_data->values<T>().data();
+        const size_t n = result_data->count();
+        for (size_t i = 0; i < n; ++i) {
+            out[i] = std::max(T(0), x[i]);
+        }
+        });
     auto result_tensor = std::make_shared<Tensor>();
     result_tensor->data = result_data;
+    if (!vm.tensor_grad_enabled) return result_tensor;
     result_tensor->parents = { input_tensor };
 
     result_tensor->backward_fn = [input_tensor](std::shared_ptr<Tensor> output_grad) -> std::vector<std::shared_ptr<Tensor>> {
-        auto grad_data = std::make_shared<FloatArray>();
-        grad_data->shape = input_tensor->data->shape;
-        grad_data->data.reserve(input_tensor->data->size());
-        for (size_t i = 0; i < input_tensor->data->size(); ++i) {
-            double derivative = input_tensor->data->data[i] > 0 ? 1.0 : 0.0;
-            grad_data->data.push_back(derivative * output_grad->data->data[i]);
-        }
-        auto final_grad = std::make_shared<Tensor>();
-        final_grad->data = grad_data;
-        return { final_grad };
+        const DType dtype = input_tensor->data->dtype;
+        auto grad_data = new_float_array(input_tensor->data->shape, dtype);
+        dispatch(dtype, [&](auto zero) {
+            using T = decltype(zero);
+            const T* x = input_tensor->data->values<T>().data();
+            const T* dy = output_grad->data->values<T>().data();
+            T* dx = grad_data->values<T>().data();
+            const size_t n = grad_data->count();
+            for (size_t i = 0; i < n; ++i) {
+                T derivative = x[i] > 0 ? T(1) : T(0);
+                dx[i] = derivative * dy[i];
+            }
+            });
+        return { tensor_of(grad_data) };
         };
     return result_tensor;
 }
@@ -1425,76 +1854,55 @@ BasicValue builtin_tensor_softmax(NeReLaBasic& vm, const std::vector<BasicValue>
         is_causal = to_bool(args[1]);
     }
 
-    auto result_data = std::make_shared<FloatArray>();
-    result_data->shape = input_tensor->data->shape;
-    size_t rows = (input_tensor->data->shape.size() > 1) ? input_tensor->data->shape[0] : 1;
-    size_t cols = (input_tensor->data->shape.size() > 1) ? input_tensor->data->shape[1] : input_tensor->data->shape[0];
-    result_data->data.resize(rows * cols);
+    size_t rows, cols;
+    row_shape(input_tensor->data->shape, rows, cols);
 
-    for (size_t i = 0; i < rows; ++i) {
-        double max_val = -std::numeric_limits<double>::infinity();
-        size_t row_start = i * cols;
-        size_t end = is_causal ? i + 1 : cols;
-
-        for (size_t j = 0; j < end; ++j) {
-            max_val = std::max(max_val, input_tensor->data->data[row_start + j]);
-        }
-
-        double sum = 0.0;
-        for (size_t j = 0; j < end; ++j) {
-            double exp_val = std::exp(input_tensor->data->data[row_start + j] - max_val);
-            result_data->data[row_start + j] = exp_val;
-            sum += exp_val;
-        }
-
-        if (sum > 0) {
-            for (size_t j = 0; j < end; ++j) {
-                result_data->data[row_start + j] /= sum;
-            }
-        }
-        // Zero out the masked part
-        for (size_t j = end; j < cols; ++j) {
-            result_data->data[row_start + j] = 0.0;
-        }
-    }
+    const DType dtype = input_tensor->data->dtype;
+    auto result_data = new_float_array(input_tensor->data->shape, dtype);
+    dispatch(dtype, [&](auto zero) {
+        using T = decltype(zero);
+        softmax_rows(input_tensor->data->values<T>().data(), result_data->values<T>().data(), rows, cols, is_causal);
+        });
 
     auto result_tensor = std::make_shared<Tensor>();
     result_tensor->data = result_data;
+    if (!vm.tensor_grad_enabled) return result_tensor;
     result_tensor->parents = { input_tensor };
 
     std::weak_ptr<Tensor> result_tensor_weak(result_tensor);
-    result_tensor->backward_fn = [result_tensor_weak, is_causal](std::shared_ptr<Tensor> output_grad) -> std::vector<std::shared_ptr<Tensor>> {
+    result_tensor->backward_fn = [result_tensor_weak, is_causal, rows, cols](std::shared_ptr<Tensor> output_grad) -> std::vector<std::shared_ptr<Tensor>> {
         auto result_tensor = result_tensor_weak.lock();
         if (!result_tensor) return { nullptr };
 
-        auto y = result_tensor->data;
-        auto g = output_grad->data;
-        auto grad_data = std::make_shared<FloatArray>();
-        grad_data->shape = y->shape;
-        grad_data->data.resize(y->size());
-
-        size_t rows = y->shape[0];
-        size_t cols = y->shape[1];
-
-        for (size_t r = 0; r < rows; ++r) {
-            size_t row_start = r * cols;
-            size_t end = is_causal ? r + 1 : cols;
-            double dot_product = 0.0;
-            for (size_t c = 0; c < end; ++c) {
-                dot_product += y->data[row_start + c] * g->data[row_start + c];
+        const DType dtype = result_tensor->data->dtype;
+        auto grad_data = new_float_array(result_tensor->data->shape, dtype);
+
+        dispatch(dtype, [&](auto zero) {
+            using T = decltype(zero);
+            const T* y = result_tensor->data->values<T>().data();
+            const T* g = output_grad->data->values<T>().data();
+            T* dx = grad_data->values<T>().data();
+            // dx = y * (g - <y, g>) per row; masked entries have y = 0.
+#pragma omp parallel for if(rows > 1 && rows * cols >= ROW_PARALLEL_MIN)
+            for (long long r = 0; r < static_cast<long long>(rows); ++r) {
+                size_t row_start = r * cols;
+                size_t end = is_causal ? std::min(static_cast<size_t>(r) + 1, cols) : cols;
+                double dot_product = 0.0;
+                for (size_t c = 0; c < end; ++c) dot_product += y[row_start + c] * g[row_start + c];
+                const T dot = static_cast<T>(dot_product);
+                for (size_t c = 0; c < end; ++c) dx[row_start + c] = y[row_start + c] * (g[row_start + c] - dot);
+                std::fill(dx + row_start + end, dx + row_start + cols, T(0));
             }
-            for (size_t c = 0; c < end; ++c) {
-                grad_data->data[row_start + c] = y->data[row_start + c] * (g->data[row_start + c] - dot_product);
-            }
-        }
-        auto final_grad = std::make_shared<Tensor>();
-        final_grad->data = grad_data;
-        return { final_grad };
+            });
+        return { tensor_of(grad_data) };
         };
     return result_tensor;
 }
 
 
+// Softmax and cross-entropy in one node. The probabilities computed for the loss
+// are kept for the backward pass, whose gradient is then (p - actual) / batch
+// in a single loop, without running softmax a second time.
 BasicValue builtin_tensor_cross_entropy_loss(NeReLaBasic& vm, const std::vector<BasicValue>& args) {
     if (args.size() != 2) { Error::set(8, vm.runtime_current_line); return {}; }
     if (!std::holds_alternative<std::shared_ptr<Tensor>>(args[0]) || !std::holds_alternative<std::shared_ptr<Tensor>>(args[1])) {
@@ -1507,47 +1915,72 @@ BasicValue builtin_tensor_cross_entropy_loss(NeReLaBasic& vm, const std::vector<
         Error::set(15, vm.runtime_current_line); return {};
     }
 
-    size_t batch_size = logits_tensor->data->shape[0];
-    size_t vocab_size = logits_tensor->data->shape[1];
-
-    auto probs_val = builtin_tensor_softmax(vm, { logits_tensor });
-    if (Error::get() != 0) { return {}; }
-    auto probs_tensor = std::get<std::shared_ptr<Tensor>>(probs_val);
-
-    double total_loss = 0.0;
-    for (size_t i = 0; i < batch_size; ++i) {
-        size_t row_start = i * vocab_size;
-        for (size_t j = 0; j < vocab_size; ++j) {
-            if (actual_tensor->data->data[row_start + j] == 1.0) {
-                double prob = std::max(1e-9, probs_tensor->data->data[row_start + j]);
-                total_loss -= std::log(prob);
-                break;
+    size_t batch_size, vocab_size;
+    row_shape(logits_tensor->data->shape, batch_size, vocab_size);
+
+    const DType dtype = common_dtype({ &logits_tensor->data, &actual_tensor->data });
+    auto logits_data = as_dtype(logits_tensor->data, dtype);
+    auto actual_data = as_dtype(actual_tensor->data, dtype);
+    auto probs = new_float_array(logits_data->shape, dtype);
+    auto row_loss = new_float_array({ batch_size }, 0.0);
+    dispatch(dtype, [&](auto zero) {
+        using T = decltype(zero);
+        const T* logits = logits_data->values<T>().data();
+        const T* actual = actual_data->values<T>().data();
+        T* p = probs->values<T>().data();
+#pragma omp parallel for if(batch_size > 1 && batch_size * vocab_size >= ROW_PARALLEL_MIN)
+        for (long long i = 0; i < static_cast<long long>(batch_size); ++i) {
+            size_t row_start = i * vocab_size;
+            softmax_row(logits + row_start, p + row_start, vocab_size, vocab_size);
+            for (size_t j = 0; j < vocab_size; ++j) {
+                if (actual[row_start + j] == T(1)) {
+                    row_loss->data[i] = -std::log(std::max(1e-9, static_cast<double>(p[row_start + j])));
+                    break;
+                }
             }
         }
-    }
+        });
+    // Rows are added in order so the loss does not depend on the thread count.
+    double total_loss = 0.0;
+    for (double l : row_loss->data) total_loss += l;
 
     auto loss_tensor = std::make_shared<Tensor>();
-    loss_tensor->data = std::make_shared<FloatArray>();
-    loss_tensor->data->shape = { 1 };
-    loss_tensor->data->data = { total_loss / batch_size };
+    loss_tensor->data = new_float_array({ 1 }, total_loss / batch_size, dtype);
+    if (!vm.tensor_grad_enabled) return loss_tensor;
     loss_tensor->parents = { logits_tensor, actual_tensor };
 
-    loss_tensor->backward_fn = [=, &vm](std::shared_ptr<Tensor> output_grad) -> std::vector<std::shared_ptr<Tensor>> {
-        auto probas_data = std::get<std::shared_ptr<Tensor>>(builtin_tensor_softmax(vm, { logits_tensor }))->data;
-        auto grad_data = float_array_subtract(probas_data, actual_tensor->data);
-
-        double incoming_grad_scalar = output_grad->data->data[0];
-        auto scaled_grad_data = float_array_scalar_multiply(incoming_grad_scalar / batch_size, grad_data);
-
-        auto grad_tensor = std::make_shared<Tensor>();
-        grad_tensor->data = scaled_grad_data;
-
-        return { grad_tensor, nullptr };
+    loss_tensor->backward_fn = [actual_data, probs, batch_size](std::shared_ptr<Tensor> output_grad) -> std::vector<std::shared_ptr<Tensor>> {
+        auto grad_data = new_float_array(probs->shape, probs->dtype);
+
+        dispatch(probs->dtype, [&](auto zero) {
+            using T = decltype(zero);
+            const T scale = static_cast<T>(output_grad->data->at(0) / batch_size);
+            const T* p = probs->values<T>().data();
+            const T* actual = actual_data->values<T>().data();
+            T* dx = grad_data->values<T>().data();
+            const size_t n = probs->count();
+#pragma omp parallel for simd if(n >= ROW_PARALLEL_MIN)
+            for (long long i = 0; i < static_cast<long long>(n); ++i) dx[i] = (p[i] - actual[i]) * scale;
+            });
+
+        return { tensor_of(grad_data), nullptr };
         };
 
     return loss_tensor;
 }
 
+// TENSOR.POOLSTATS() -> Map with the number of tensor buffers requested and freshly
+// allocated since start-up, and the bytes the calling thread keeps for reuse.
+// The difference between two calls around a training step shows its allocations.
+BasicValue builtin_tensor_poolstats(NeReLaBasic& vm, const std::vector<BasicValue>& args) {
+    if (!args.empty()) { Error::set(8, vm.runtime_current_line); return {}; }
+    auto stats = std::make_shared<Map>();
+    stats->data["requests"] = static_cast<double>(pool_stats.requests.load(std::memory_order_relaxed));
+    stats->data["allocations"] = static_cast<double>(pool_stats.allocations.load(std::memory_order_relaxed));
+    stats->data["pooled_bytes"] = static_cast<double>(FloatArrayPool::local().bytes());
+    return stats;
+}
+
 // The main registration function for this module
 void register_ai_functions(NeReLaBasic& vm, NeReLaBasic::FunctionTable& table_to_populate) {
     // Helper lambda to make registration cleaner
@@ -1569,8 +2002,9 @@ void register_ai_functions(NeReLaBasic& vm, NeReLaBasic::FunctionTable& table_to
         };
 
     // Core Tensor Ops
-    register_func("TENSOR.FROM", 1, builtin_to_tensor);
+    register_func("TENSOR.FROM", -1, builtin_to_tensor);
     register_func("TENSOR.TOARRAY", 1, builtin_toarray);
+    register_func("TENSOR.DTYPE", 1, builtin_tensor_dtype);
     register_func("TENSOR.MATMUL", 2, builtin_matmul);
     register_func("SUM", -1, builtin_sum);
 
@@ -1582,6 +2016,7 @@ void register_ai_functions(NeReLaBasic& vm, NeReLaBasic::FunctionTable& table_to
 
     // Training
     register_proc("TENSOR.BACKWARD", 1, builtin_backward);
+    register_proc("TENSOR.NO_GRAD", 1, builtin_tensor_no_grad);
     register_func("TENSOR.UPDATE", 2, builtin_update);
 
     // Activation & Layer Functions
@@ -1596,4 +2031,5 @@ void register_ai_functions(NeReLaBasic& vm, NeReLaBasic::FunctionTable& table_to
     register_func("TENSOR.CROSS_ENTROPY_LOSS", 2, builtin_tensor_cross_entropy_loss);
     register_func("TENSOR.TOKENIZE", 2, builtin_tensor_tokenize);
     register_func("TENSOR.POSITIONAL_ENCODING", 2, builtin_tensor_positional_encoding);
+    register_func("TENSOR.POOLSTATS", 0, builtin_tensor_poolstats);
 }
\ No newline at end of file
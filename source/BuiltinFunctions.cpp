@@ -7,6 +7,9 @@
 #include "Error.hpp"
 #include "Types.hpp"
 #include "LocaleManager.hpp"
+#include "Kernels.hpp"
+#include "CsvReader.hpp"
+#include "RegexCache.hpp"
 #include <thread>
 #include <chrono>
 #include <cmath> // For sin, cos, etc.
@@ -46,6 +49,25 @@
 
 #include "json.hpp"
 
+// FORMAT$ passes string values straight to the formatter.
+#ifdef _WIN32
+template <>
+struct std::formatter<BasicString> : std::formatter<std::string_view> {
+    template <typename FormatContext>
+    auto format(const BasicString& s, FormatContext& ctx) const {
+        return std::formatter<std::string_view>::format(std::string_view(s.data(), s.size()), ctx);
+    }
+};
+#else
+template <>
+struct fmt::formatter<BasicString> : fmt::formatter<fmt::string_view> {
+    template <typename FormatContext>
+    auto format(const BasicString& s, FormatContext& ctx) const {
+        return fmt::formatter<fmt::string_view>::format(fmt::string_view(s.data(), s.size()), ctx);
+    }
+};
+#endif
+
 #ifdef JDCOM
 #include <windows.h> // Basic Windows types, HRESULT
 #include <objbase.h> // CoInitializeEx, CoUninitialize, CoCreateInstance, CLSIDFromProgID
@@ -65,7 +87,7 @@ _variant_t basic_value_to_variant_t(const BasicValue& val) {
         else if constexpr (std::is_same_v<T, int>) { // If you still use int
             return _variant_t(static_cast<long>(arg)); // Convert to long for VARIANT
         }
-        else if constexpr (std::is_same_v<T, std::string>) {
+        else if constexpr (std::is_same_v<T, BasicString>) {
             // Convert std::string to BSTR (Basic string)
             return _variant_t(arg.c_str()); // BSTR is allocated internally by _variant_t
         }
@@ -440,7 +462,7 @@ nlohmann::json basic_to_json_value(const BasicValue& val) {
     return std::visit([](auto&& arg) -> nlohmann::json {
         using T = std::decay_t<decltype(arg)>;
 
-        if constexpr (std::is_same_v<T, bool> || std::is_same_v<T, double> || std::is_same_v<T, int> || std::is_same_v<T, std::string>) {
+        if constexpr (std::is_same_v<T, bool> || std::is_same_v<T, double> || std::is_same_v<T, int> || std::is_same_v<T, BasicString>) {
             return nlohmann::json(arg);
         }
         else if constexpr (std::is_same_v<T, std::shared_ptr<Array>>) {
@@ -460,8 +482,8 @@ nlohmann::json basic_to_json_value(const BasicValue& val) {
             return j_obj;
         }
         else if constexpr (std::is_same_v<T, std::shared_ptr<JsonObject>>) {
-            // If we encounter a JsonObject, just return its internal data.
-            return arg ? arg->data : nlohmann::json(nullptr);
+            // If we encounter a JsonObject, just return the value it refers to.
+            return arg ? arg->value() : nlohmann::json(nullptr);
         }
         else if constexpr (std::is_same_v<T, DateTime> || std::is_same_v<T, FunctionRef>) {
             // Convert these types to their string representation
@@ -516,6 +538,43 @@ BasicValue json_to_basic_value(const nlohmann::json& j) {
     return 0.0;
 }
 
+// The BasicValue for 'child', a value inside parent's document: objects and
+// arrays become views sharing the document, scalars are converted.
+BasicValue json_view(const JsonObject& parent, const nlohmann::json& child) {
+    if (child.is_object() || child.is_array()) {
+        return std::make_shared<JsonObject>(parent.document, &child);
+    }
+    return json_to_basic_value(child);
+}
+
+// Member and index access hand out views while an accessor chain walks the
+// document (J{"items"}[3]{"name"} copies nothing), but a JSON array that ends the
+// chain is converted to an Array, so PRINT, SUM, arithmetic and the other array
+// functions see an ordinary array.
+void json_array_to_basic(BasicValue& value) {
+    if (const auto* json_ptr = std::get_if<std::shared_ptr<JsonObject>>(&value)) {
+        if (*json_ptr && (*json_ptr)->node && (*json_ptr)->value().is_array()) {
+            value = json_to_basic_value((*json_ptr)->value());
+        }
+    }
+}
+
+// A top-level parsed value: a JsonObject for an object or array, the converted
+// value for a scalar.
+static BasicValue json_document(nlohmann::json parsed) {
+    if (parsed.is_object() || parsed.is_array()) {
+        return std::make_shared<JsonObject>(std::move(parsed));
+    }
+    return json_to_basic_value(parsed);
+}
+
+static const JsonObject* get_json_object(const BasicValue& val) {
+    if (const auto* json_ptr = std::get_if<std::shared_ptr<JsonObject>>(&val)) {
+        if (*json_ptr && (*json_ptr)->node) return json_ptr->get();
+    }
+    return nullptr;
+}
+
 
 // JSON.PARSE$(json_string$) -> JsonObject
 BasicValue builtin_json_parse(NeReLaBasic& vm, const std::vector<BasicValue>& args) {
@@ -527,14 +586,9 @@ BasicValue builtin_json_parse(NeReLaBasic& vm, const std::vector<BasicValue>& ar
     std::string json_string = to_string(args[0]);
 
     try {
-        // Create our JsonObject wrapper
-        auto json_obj_ptr = std::make_shared<JsonObject>();
-
-        // Use the nlohmann library to parse the string
-        json_obj_ptr->data = nlohmann::json::parse(json_string);
-
-        // Return the shared pointer to our JsonObject inside the BasicValue
-        return json_obj_ptr;
+        // Use the nlohmann library to parse the string. Accessing members of
+        // the returned JsonObject yields views into this one document.
+        return std::make_shared<JsonObject>(nlohmann::json::parse(json_string));
     }
     catch (const nlohmann::json::parse_error& e) {
         // If parsing fails, set a BASIC error and return.
@@ -566,6 +620,139 @@ BasicValue builtin_json_stringify(NeReLaBasic& vm, const std::vector<BasicValue>
     }
 }
 
+// JSON.LOAD(filename$) -> JsonObject
+// Parses a JSON file directly from disk, without reading it into a string first.
+BasicValue builtin_json_load(NeReLaBasic& vm, const std::vector<BasicValue>& args) {
+    if (args.size() != 1) {
+        Error::set(8, vm.runtime_current_line);
+        return {};
+    }
+    std::ifstream infile(to_string(args[0]), std::ios::binary);
+    if (!infile) {
+        Error::set(6, vm.runtime_current_line); // File not found
+        return {};
+    }
+    try {
+        return json_document(nlohmann::json::parse(infile));
+    }
+    catch (const nlohmann::json::parse_error& e) {
+        Error::set(1, vm.runtime_current_line, "JSON Parse Error: " + std::string(e.what()));
+        return {};
+    }
+}
+
+// JSON.VALUE(json) -> Map, Array or scalar
+// Converts a JsonObject, with everything below it, into ordinary Maps and Arrays.
+BasicValue builtin_json_value(NeReLaBasic& vm, const std::vector<BasicValue>& args) {
+    if (args.size() != 1) {
+        Error::set(8, vm.runtime_current_line);
+        return {};
+    }
+    const JsonObject* json = get_json_object(args[0]);
+    if (!json) return args[0];
+    return json_to_basic_value(json->value());
+}
+
+// Reads newline-delimited JSON (one value per line) for JSON.OPEN/JSON.READ.
+// The next non-blank line is read ahead so that EOF is known before READ.
+struct NdjsonReader {
+    std::ifstream in;
+    std::string pending;
+    bool has_pending = false;
+    size_t line = 0;          // line number of 'pending'
+
+    void advance() {
+        has_pending = false;
+        while (std::getline(in, pending)) {
+            line++;
+            if (!pending.empty() && pending.back() == '\r') pending.pop_back();
+            if (pending.find_first_not_of(" \t") != std::string::npos) {
+                has_pending = true;
+                return;
+            }
+        }
+    }
+};
+
+// JSON.OPEN(filename$) -> handle
+// Opens a newline-delimited JSON file to be read one record at a time.
+BasicValue builtin_json_open(NeReLaBasic& vm, const std::vector<BasicValue>& args) {
+    if (args.size() != 1) {
+        Error::set(8, vm.runtime_current_line);
+        return {};
+    }
+    auto reader = std::make_unique<NdjsonReader>();
+    reader->in.open(to_string(args[0]), std::ios::binary);
+    if (!reader->in) {
+        Error::set(6, vm.runtime_current_line); // File not found
+        return {};
+    }
+    reader->advance();
+    return std::make_shared<OpaqueHandle>(reader.release(), "NDJSONREADER", [](void* p) { delete static_cast<NdjsonReader*>(p); });
+}
+
+// Returns the reader behind a JSON.OPEN handle, or sets an error.
+static NdjsonReader* get_ndjson_reader(NeReLaBasic& vm, const BasicValue& arg, const std::string& name) {
+    if (const auto* handle = std::get_if<std::shared_ptr<OpaqueHandle>>(&arg)) {
+        if (*handle && (*handle)->ptr && (*handle)->type_name == "NDJSONREADER") {
+            return static_cast<NdjsonReader*>((*handle)->ptr);
+        }
+    }
+    Error::set(15, vm.runtime_current_line, name + " requires an open handle from JSON.OPEN.");
+    return nullptr;
+}
+
+// JSON.READ(handle) -> JsonObject
+// Returns the next record. Each record is its own small document, so memory
+// use does not grow with the size of the file.
+BasicValue builtin_json_read(NeReLaBasic& vm, const std::vector<BasicValue>& args) {
+    if (args.size() != 1) {
+        Error::set(8, vm.runtime_current_line);
+        return {};
+    }
+    NdjsonReader* reader = get_ndjson_reader(vm, args[0], "JSON.READ");
+    if (!reader) return {};
+    if (!reader->has_pending) {
+        Error::set(15, vm.runtime_current_line, "JSON.READ: no more records (check JSON.EOF).");
+        return {};
+    }
+    try {
+        BasicValue record = json_document(nlohmann::json::parse(reader->pending));
+        reader->advance();
+        return record;
+    }
+    catch (const nlohmann::json::parse_error& e) {
+        Error::set(1, vm.runtime_current_line, "JSON.READ: line " + std::to_string(reader->line) + ": " + e.what());
+        reader->advance();
+        return {};
+    }
+}
+
+// JSON.EOF(handle) -> boolean
+BasicValue builtin_json_eof(NeReLaBasic& vm, const std::vector<BasicValue>& args) {
+    if (args.size() != 1) {
+        Error::set(8, vm.runtime_current_line);
+        return true;
+    }
+    NdjsonReader* reader = get_ndjson_reader(vm, args[0], "JSON.EOF");
+    if (!reader) return true;
+    return !reader->has_pending;
+}
+
+// JSON.CLOSE handle
+// Closes the file now instead of when the last reference to the handle goes away.
+BasicValue builtin_json_close(NeReLaBasic& vm, const std::vector<BasicValue>& args) {
+    if (args.size() != 1) {
+        Error::set(8, vm.runtime_current_line);
+        return false;
+    }
+    if (!get_ndjson_reader(vm, args[0], "JSON.CLOSE")) return false;
+    auto& handle = std::get<std::shared_ptr<OpaqueHandle>>(args[0]);
+    delete static_cast<NdjsonReader*>(handle->ptr);
+    handle->ptr = nullptr;
+    return false;
+}
+
 //=========================================================
 // NEW: Map Helper Functions
 //=========================================================
@@ -576,6 +763,9 @@ BasicValue builtin_map_exists(NeReLaBasic& vm, const std::vector<BasicValue>& ar
         Error::set(8, vm.runtime_current_line); // Wrong number of arguments
         return false;
     }
+    if (const JsonObject* json = get_json_object(args[0])) {
+        return json->value().is_object() && json->value().contains(to_string(args[1]));
+    }
     if (!std::holds_alternative<std::shared_ptr<Map>>(args[0])) {
         Error::set(15, vm.runtime_current_line, "First argument to MAP.EXISTS must be a Map.");
         return false;
@@ -598,6 +788,15 @@ BasicValue builtin_map_keys(NeReLaBasic& vm, const std::vector<BasicValue>& args
         Error::set(8, vm.runtime_current_line);
         return {};
     }
+    if (const JsonObject* json = get_json_object(args[0]); json && json->value().is_object()) {
+        std::vector<std::string> keys;
+        keys.reserve(json->value().size());
+        for (const auto& item : json->value().items()) keys.push_back(item.key());
+        auto result_ptr = std::make_shared<Array>();
+        result_ptr->shape = { keys.size() };
+        result_ptr->data = ArrayData::of_strings(std::move(keys));
+        return result_ptr;
+    }
     if (!std::holds_alternative<std::shared_ptr<Map>>(args[0])) {
         Error::set(15, vm.runtime_current_line, "Argument to MAP.KEYS must be a Map.");
         return {};
@@ -626,6 +825,18 @@ BasicValue builtin_map_values(NeReLaBasic& vm, const std::vector<BasicValue>& ar
         Error::set(8, vm.runtime_current_line);
         return {};
     }
+    if (const JsonObject* json = get_json_object(args[0])) {
+        // Works for JSON arrays as well: one entry per element.
+        auto result_ptr = std::make_shared<Array>();
+        result_ptr->data.reserve(json->value().size());
+        for (const auto& item : json->value()) {
+            BasicValue element = json_view(*json, item);
+            json_array_to_basic(element);
+            result_ptr->data.push_back(std::move(element));
+        }
+        result_ptr->shape = { result_ptr->data.size() };
+        return result_ptr;
+    }
     if (!std::holds_alternative<std::shared_ptr<Map>>(args[0])) {
         Error::set(15, vm.runtime_current_line, "Argument to MAP.VALUES must be a Map.");
         return {};
@@ -693,9 +904,17 @@ BasicValue builtin_len(NeReLaBasic& vm, const std::vector<BasicValue>& args) {
         }
     }
 
+    // --- A JSON array or object: its element count, shaped like an array's LEN ---
+    if (const JsonObject* json = get_json_object(val)) {
+        auto shape_vector_ptr = std::make_shared<Array>();
+        shape_vector_ptr->shape = { 1 };
+        shape_vector_ptr->data.push_back(static_cast<double>(json->value().size()));
+        return shape_vector_ptr;
+    }
+
     // --- Case 2: The argument is a string that might be a variable name ---
-    if (std::holds_alternative<std::string>(val)) {
-        std::string name = to_upper(std::get<std::string>(val));
+    if (std::holds_alternative<BasicString>(val)) {
+        std::string name = to_upper(std::get<BasicString>(val));
         // Check if a variable with this name exists
         if (vm.variables.count(name)) {
             const BasicValue& var_val = vm.variables.at(name);
@@ -1652,8 +1871,8 @@ BasicValue apply_elementwise_op(NeReLaBasic& vm, const BasicValue& input, const
         result_ptr->shape = (*arr_ptr)->shape; // Result has the same shape
         result_ptr->data.reserve((*arr_ptr)->data.size());
 
-        for (const auto& val : (*arr_ptr)->data) {
-            BasicValue result = op(vm, val);
+        for (size_t i = 0; i < (*arr_ptr)->data.size(); ++i) {
+            BasicValue result = op(vm, (*arr_ptr)->data.get(i));
             // If the operation on an element failed, stop and return.
             if (Error::get() != 0) {
                 return {};
@@ -2159,7 +2378,7 @@ BasicValue builtin_reverse(NeReLaBasic& vm, const std::vector<BasicValue>& args)
         // Reverse it
         std::reverse(slice.begin(), slice.end());
         // Insert the reversed slice into the new data
-        new_array_ptr->data.insert(new_array_ptr->data.end(), slice.begin(), slice.end());
+        for (auto& value : slice) new_array_ptr->data.push_back(std::move(value));
     }
 
     return new_array_ptr;
@@ -2316,7 +2535,7 @@ BasicValue builtin_stack(NeReLaBasic& vm, const std::vector<BasicValue>& args) {
         // Interleave the data from the source vectors
         for (size_t r = 0; r < rows; ++r) {
             for (size_t c = 0; c < cols; ++c) {
-                result_ptr->data[r * cols + c] = source_arrays[c]->data[r];
+                result_ptr->data.set(r * cols + c, source_arrays[c]->data[r]);
             }
         }
     }
@@ -2381,7 +2600,7 @@ BasicValue builtin_mvlet(NeReLaBasic& vm, const std::vector<BasicValue>& args) {
 
         size_t start_pos = (size_t)index * cols;
         for (size_t c = 0; c < cols; ++c) {
-            result_ptr->data[start_pos + c] = vector_ptr->data[c];
+            result_ptr->data.set(start_pos + c, vector_ptr->data[c]);
         }
     }
     else { // dimension == 1, Replace a column
@@ -2395,7 +2614,7 @@ BasicValue builtin_mvlet(NeReLaBasic& vm, const std::vector<BasicValue>& args) {
         }
 
         for (size_t r = 0; r < rows; ++r) {
-            result_ptr->data[r * cols + (size_t)index] = vector_ptr->data[r];
+            result_ptr->data.set(r * cols + (size_t)index, vector_ptr->data[r]);
         }
     }
 
@@ -2433,7 +2652,7 @@ BasicValue builtin_transpose(NeReLaBasic& vm, const std::vector<BasicValue>& arg
     for (size_t r = 0; r < rows; ++r) {
         for (size_t c = 0; c < cols; ++c) {
             // New position (c, r) gets data from old position (r, c)
-            new_array_ptr->data[c * rows + r] = source_array_ptr->data[r * cols + c];
+            new_array_ptr->data.set(c * rows + r, source_array_ptr->data[r * cols + c]);
         }
     }
 
@@ -2621,7 +2840,7 @@ BasicValue builtin_format_str(NeReLaBasic& vm, const std::vector<BasicValue>& ar
 #ifdef _WIN32
                                 return std::vformat(LocaleManager::get_current_locale(), format_specifier, std::make_format_args(static_cast<long long>(value)));
 #else
-                                return fmt::format(format_specifier, value);
+                                return fmt::format(fmt::runtime(format_specifier), value);
 #endif                                
                             }
                             if (type_char == 'c') {
@@ -2629,7 +2848,7 @@ BasicValue builtin_format_str(NeReLaBasic& vm, const std::vector<BasicValue>& ar
 #ifdef _WIN32                                
                                 return std::vformat(LocaleManager::get_current_locale(), format_specifier, std::make_format_args(static_cast<char>(static_cast<long long>(value))));
 #else
-                                return fmt::format(format_specifier, value);
+                                return fmt::format(fmt::runtime(format_specifier), value);
 #endif                                
                             }
                         }
@@ -2637,15 +2856,15 @@ BasicValue builtin_format_str(NeReLaBasic& vm, const std::vector<BasicValue>& ar
 #ifdef _WIN32
                         return std::vformat(LocaleManager::get_current_locale(), format_specifier, std::make_format_args(value));
 #else
-                        return fmt::format(format_specifier, value);
+                        return fmt::format(fmt::runtime(format_specifier), value);
 #endif                                
                     }
-                    else if constexpr (std::is_same_v<T, bool> || std::is_same_v<T, int> || std::is_same_v<T, std::string>) {
+                    else if constexpr (std::is_same_v<T, bool> || std::is_same_v<T, int> || std::is_same_v<T, BasicString>) {
                         // These types are fine as they are
 #ifdef _WIN32
                         return std::vformat(LocaleManager::get_current_locale(), format_specifier, std::make_format_args(value));
 #else
-                        return fmt::format(format_specifier, value);
+                        return fmt::format(fmt::runtime(format_specifier), value);
 #endif                                
                     }
                     else {
@@ -2754,7 +2973,7 @@ BasicValue builtin_rotate(NeReLaBasic& vm, const std::vector<BasicValue>& args)
         }
 
         // Copy the value
-        result_ptr->data[dest_linear_idx] = source_ptr->data[source_linear_idx];
+        result_ptr->data.set(dest_linear_idx, source_ptr->data[source_linear_idx]);
     }
 
     return result_ptr;
@@ -2831,7 +3050,7 @@ BasicValue builtin_shift(NeReLaBasic& vm, const std::vector<BasicValue>& args) {
                 multiplier *= shape[d];
             }
             // Copy the value
-            result_ptr->data[dest_linear_idx] = source_ptr->data[source_linear_idx];
+            result_ptr->data.set(dest_linear_idx, source_ptr->data[source_linear_idx]);
         }
         // If out of bounds, the value is discarded (and the cell keeps its fill_value).
     }
@@ -2917,7 +3136,7 @@ BasicValue builtin_convolve(NeReLaBasic& vm, const std::vector<BasicValue>& args
                 }
             }
             // Store the final calculated sum in the output array
-            result_ptr->data[y * source_w + x] = sum;
+            result_ptr->data.set(y * source_w + x, sum);
         }
     }
     return result_ptr;
@@ -2981,7 +3200,7 @@ BasicValue builtin_place(NeReLaBasic& vm, const std::vector<BasicValue>& args) {
             size_t source_idx = sy * source_w + sx;
             size_t dest_idx = dy * dest_w + dx;
 
-            result_ptr->data[dest_idx] = source_ptr->data[source_idx];
+            result_ptr->data.set(dest_idx, source_ptr->data[source_idx]);
         }
     }
 
@@ -2997,7 +3216,7 @@ BasicValue builtin_product(NeReLaBasic& vm, const std::vector<BasicValue>& args)
 
     if (args.size() == 1) {
         double total = 1.0;
-        for (const auto& val : arr_ptr->data) { total *= to_double(val); }
+        for (size_t i = 0; i < arr_ptr->data.size(); ++i) { total *= arr_ptr->data.number(i); }
         return total;
     }
 
@@ -3009,21 +3228,23 @@ BasicValue builtin_product(NeReLaBasic& vm, const std::vector<BasicValue>& args)
 
     if (dimension == 0) { // Reduce along rows
         result_ptr->shape = { 1, cols };
-        result_ptr->data.assign(cols, 1.0); // Initialize with ones
+        std::vector<double> totals(cols, 1.0); // Initialize with ones
         for (size_t r = 0; r < rows; ++r) {
             for (size_t c = 0; c < cols; ++c) {
-                result_ptr->data[c] = to_double(result_ptr->data[c]) * to_double(arr_ptr->data[r * cols + c]);
+                totals[c] *= arr_ptr->data.number(r * cols + c);
             }
         }
+        result_ptr->data = ArrayData::of_doubles(std::move(totals));
     }
     else if (dimension == 1) { // Reduce along columns
         result_ptr->shape = { rows, 1 };
-        result_ptr->data.reserve(rows);
+        std::vector<double> totals(rows);
         for (size_t r = 0; r < rows; ++r) {
             double row_total = 1.0;
-            for (size_t c = 0; c < cols; ++c) { row_total *= to_double(arr_ptr->data[r * cols + c]); }
-            result_ptr->data.push_back(row_total);
+            for (size_t c = 0; c < cols; ++c) { row_total *= arr_ptr->data.number(r * cols + c); }
+            totals[r] = row_total;
         }
+        result_ptr->data = ArrayData::of_doubles(std::move(totals));
     }
     else { Error::set(1, vm.runtime_current_line, "Invalid dimension for reduction. Must be 0 or 1."); return 1.0; }
     return result_ptr;
@@ -3047,9 +3268,13 @@ BasicValue array_sum(NeReLaBasic& vm, const std::vector<BasicValue>& args) {
 
     // 2. --- Backward Compatibility: Reduce to Scalar ---
     if (args.size() == 1) {
+        const ArrayData& data = arr_ptr->data;
         double total = 0.0;
-        for (const auto& val : arr_ptr->data) {
-            total += to_double(val);
+        if (data.kind() == ArrayData::Kind::DOUBLE) {
+            for (double v : data.doubles()) total += v;
+        }
+        else {
+            for (size_t i = 0; i < data.size(); ++i) total += data.number(i);
         }
         return total;
     }
@@ -3067,23 +3292,25 @@ BasicValue array_sum(NeReLaBasic& vm, const std::vector<BasicValue>& args) {
 
     if (dimension == 0) { // Reduce along rows -> result is a row vector of size 'cols'
         result_ptr->shape = { 1, cols };
-        result_ptr->data.assign(cols, 0.0); // Initialize with zeros
+        std::vector<double> totals(cols, 0.0); // Initialize with zeros
         for (size_t r = 0; r < rows; ++r) {
             for (size_t c = 0; c < cols; ++c) {
-                result_ptr->data[c] = to_double(result_ptr->data[c]) + to_double(arr_ptr->data[r * cols + c]);
+                totals[c] += arr_ptr->data.number(r * cols + c);
             }
         }
+        result_ptr->data = ArrayData::of_doubles(std::move(totals));
     }
     else if (dimension == 1) { // Reduce along columns -> result is a column vector of size 'rows'
         result_ptr->shape = { rows, 1 };
-        result_ptr->data.reserve(rows);
+        std::vector<double> totals(rows);
         for (size_t r = 0; r < rows; ++r) {
             double row_total = 0.0;
             for (size_t c = 0; c < cols; ++c) {
-                row_total += to_double(arr_ptr->data[r * cols + c]);
+                row_total += arr_ptr->data.number(r * cols + c);
             }
-            result_ptr->data.push_back(row_total);
+            totals[r] = row_total;
         }
+        result_ptr->data = ArrayData::of_doubles(std::move(totals));
     }
     else {
         Error::set(1, vm.runtime_current_line, "Invalid dimension for reduction. Must be 0 or 1.");
@@ -3093,19 +3320,31 @@ BasicValue array_sum(NeReLaBasic& vm, const std::vector<BasicValue>& args) {
     return result_ptr;
 }
 
-// MIN(array, [dimension]) -> number or array
-BasicValue builtin_min(NeReLaBasic& vm, const std::vector<BasicValue>& args) {
+// Shared by MIN and MAX. Picks the element whose value compares best (the first
+// one on ties) and returns it unchanged, so integers stay integers.
+static BasicValue reduce_extremum(NeReLaBasic& vm, const std::vector<BasicValue>& args, bool want_max, const std::string& name) {
     if (args.size() < 1 || args.size() > 2) { Error::set(8, vm.runtime_current_line); return 0.0; }
-    if (!std::holds_alternative<std::shared_ptr<Array>>(args[0])) { Error::set(15, vm.runtime_current_line, "First argument to MIN must be an array."); return 0.0; }
+    if (!std::holds_alternative<std::shared_ptr<Array>>(args[0])) { Error::set(15, vm.runtime_current_line, "First argument to " + name + " must be an array."); return 0.0; }
     const auto& arr_ptr = std::get<std::shared_ptr<Array>>(args[0]);
     if (!arr_ptr || arr_ptr->data.empty()) { return 0.0; }
+    const ArrayData& data = arr_ptr->data;
 
-    if (args.size() == 1) {
-        BasicValue min_val = arr_ptr->data[0];
-        for (size_t i = 1; i < arr_ptr->data.size(); ++i) {
-            if (to_double(arr_ptr->data[i]) < to_double(min_val)) { min_val = arr_ptr->data[i]; }
+    auto better = [want_max](double candidate, double best) { return want_max ? candidate > best : candidate < best; };
+
+    // Index of the best element in data[first], data[first + step], ... (count elements).
+    auto best_index = [&](size_t first, size_t step, size_t count) {
+        size_t best = first;
+        double best_value = data.number(first);
+        for (size_t k = 1; k < count; ++k) {
+            size_t i = first + k * step;
+            double v = data.number(i);
+            if (better(v, best_value)) { best = i; best_value = v; }
         }
-        return min_val;
+        return best;
+        };
+
+    if (args.size() == 1) {
+        return data.get(best_index(0, 1, data.size()));
     }
 
     if (arr_ptr->shape.size() != 2) { Error::set(15, vm.runtime_current_line, "Dimensional reduction currently only supports 2D matrices."); return 0.0; }
@@ -3114,74 +3353,38 @@ BasicValue builtin_min(NeReLaBasic& vm, const std::vector<BasicValue>& args) {
     size_t cols = arr_ptr->shape[1];
     auto result_ptr = std::make_shared<Array>();
 
+    std::vector<size_t> picked;
     if (dimension == 0) { // Reduce along rows
         result_ptr->shape = { 1, cols };
-        result_ptr->data.assign(arr_ptr->data.begin(), arr_ptr->data.begin() + cols); // Initialize with first row
-        for (size_t r = 1; r < rows; ++r) { // Start from the second row
-            for (size_t c = 0; c < cols; ++c) {
-                if (to_double(arr_ptr->data[r * cols + c]) < to_double(result_ptr->data[c])) { result_ptr->data[c] = arr_ptr->data[r * cols + c]; }
-            }
-        }
+        for (size_t c = 0; c < cols; ++c) picked.push_back(best_index(c, cols, rows));
     }
     else if (dimension == 1) { // Reduce along columns
         result_ptr->shape = { rows, 1 };
-        result_ptr->data.reserve(rows);
-        for (size_t r = 0; r < rows; ++r) {
-            BasicValue row_min = arr_ptr->data[r * cols]; // Initialize with first element of the row
-            for (size_t c = 1; c < cols; ++c) { // Start from second element
-                if (to_double(arr_ptr->data[r * cols + c]) < to_double(row_min)) { row_min = arr_ptr->data[r * cols + c]; }
-            }
-            result_ptr->data.push_back(row_min);
-        }
+        for (size_t r = 0; r < rows; ++r) picked.push_back(best_index(r * cols, 1, cols));
     }
     else { Error::set(1, vm.runtime_current_line, "Invalid dimension for reduction. Must be 0 or 1."); return 0.0; }
+
+    if (data.kind() == ArrayData::Kind::DOUBLE) {
+        std::vector<double> values;
+        values.reserve(picked.size());
+        for (size_t i : picked) values.push_back(data.doubles()[i]);
+        result_ptr->data = ArrayData::of_doubles(std::move(values));
+    }
+    else {
+        result_ptr->data.reserve(picked.size());
+        for (size_t i : picked) result_ptr->data.push_back(data.get(i));
+    }
     return result_ptr;
 }
 
+// MIN(array, [dimension]) -> number or array
+BasicValue builtin_min(NeReLaBasic& vm, const std::vector<BasicValue>& args) {
+    return reduce_extremum(vm, args, false, "MIN");
+}
+
 // MAX(array, [dimension]) -> number or array
 BasicValue builtin_max(NeReLaBasic& vm, const std::vector<BasicValue>& args) {
-    // This implementation is identical to MIN, just with the > operator
-    if (args.size() < 1 || args.size() > 2) { Error::set(8, vm.runtime_current_line); return 0.0; }
-    if (!std::holds_alternative<std::shared_ptr<Array>>(args[0])) { Error::set(15, vm.runtime_current_line, "First argument to MAX must be an array."); return 0.0; }
-    const auto& arr_ptr = std::get<std::shared_ptr<Array>>(args[0]);
-    if (!arr_ptr || arr_ptr->data.empty()) { return 0.0; }
-
-    if (args.size() == 1) {
-        BasicValue max_val = arr_ptr->data[0];
-        for (size_t i = 1; i < arr_ptr->data.size(); ++i) {
-            if (to_double(arr_ptr->data[i]) > to_double(max_val)) { max_val = arr_ptr->data[i]; }
-        }
-        return max_val;
-    }
-
-    if (arr_ptr->shape.size() != 2) { Error::set(15, vm.runtime_current_line, "Dimensional reduction currently only supports 2D matrices."); return 0.0; }
-    int dimension = static_cast<int>(to_double(args[1]));
-    size_t rows = arr_ptr->shape[0];
-    size_t cols = arr_ptr->shape[1];
-    auto result_ptr = std::make_shared<Array>();
-
-    if (dimension == 0) { // Reduce along rows
-        result_ptr->shape = { 1, cols };
-        result_ptr->data.assign(arr_ptr->data.begin(), arr_ptr->data.begin() + cols); // Initialize with first row
-        for (size_t r = 1; r < rows; ++r) { // Start from the second row
-            for (size_t c = 0; c < cols; ++c) {
-                if (to_double(arr_ptr->data[r * cols + c]) > to_double(result_ptr->data[c])) { result_ptr->data[c] = arr_ptr->data[r * cols + c]; }
-            }
-        }
-    }
-    else if (dimension == 1) { // Reduce along columns
-        result_ptr->shape = { rows, 1 };
-        result_ptr->data.reserve(rows);
-        for (size_t r = 0; r < rows; ++r) {
-            BasicValue row_max = arr_ptr->data[r * cols]; // Initialize with first element of the row
-            for (size_t c = 1; c < cols; ++c) { // Start from second element
-                if (to_double(arr_ptr->data[r * cols + c]) > to_double(row_max)) { row_max = arr_ptr->data[r * cols + c]; }
-            }
-            result_ptr->data.push_back(row_max);
-        }
-    }
-    else { Error::set(1, vm.runtime_current_line, "Invalid dimension for reduction. Must be 0 or 1."); return 0.0; }
-    return result_ptr;
+    return reduce_extremum(vm, args, true, "MAX");
 }
 
 // Helper macro for boolean reduction functions
@@ -3208,7 +3411,7 @@ BasicValue builtin_any(NeReLaBasic& vm, const std::vector<BasicValue>& args) {
     if (!arr_ptr || arr_ptr->data.empty()) { return false; } // ANY of empty is false
 
     if (args.size() == 1) {
-        for (const auto& val : arr_ptr->data) { if (to_bool(val)) return true; }
+        for (size_t i = 0; i < arr_ptr->data.size(); ++i) { if (to_bool(arr_ptr->data.get(i))) return true; }
         return false;
     }
 
@@ -3222,7 +3425,7 @@ BasicValue builtin_any(NeReLaBasic& vm, const std::vector<BasicValue>& args) {
         result_ptr->shape = { 1, cols };
         result_ptr->data.assign(cols, false); // Initialize with false
         for (size_t r = 0; r < rows; ++r) {
-            for (size_t c = 0; c < cols; ++c) { result_ptr->data[c] = to_bool(result_ptr->data[c]) || to_bool(arr_ptr->data[r * cols + c]); }
+            for (size_t c = 0; c < cols; ++c) { result_ptr->data.set(c, to_bool(result_ptr->data[c]) || to_bool(arr_ptr->data.get(r * cols + c))); }
         }
     }
     else if (dimension == 1) { // Reduce along columns
@@ -3230,7 +3433,7 @@ BasicValue builtin_any(NeReLaBasic& vm, const std::vector<BasicValue>& args) {
         result_ptr->data.reserve(rows);
         for (size_t r = 0; r < rows; ++r) {
             bool row_any = false;
-            for (size_t c = 0; c < cols; ++c) { if (to_bool(arr_ptr->data[r * cols + c])) { row_any = true; break; } }
+            for (size_t c = 0; c < cols; ++c) { if (to_bool(arr_ptr->data.get(r * cols + c))) { row_any = true; break; } }
             result_ptr->data.push_back(row_any);
         }
     }
@@ -3246,7 +3449,7 @@ BasicValue builtin_all(NeReLaBasic& vm, const std::vector<BasicValue>& args) {
     if (!arr_ptr || arr_ptr->data.empty()) { return true; } // ALL of empty is true
 
     if (args.size() == 1) {
-        for (const auto& val : arr_ptr->data) { if (!to_bool(val)) return false; }
+        for (size_t i = 0; i < arr_ptr->data.size(); ++i) { if (!to_bool(arr_ptr->data.get(i))) return false; }
         return true;
     }
 
@@ -3260,7 +3463,7 @@ BasicValue builtin_all(NeReLaBasic& vm, const std::vector<BasicValue>& args) {
         result_ptr->shape = { 1, cols };
         result_ptr->data.assign(cols, true); // Initialize with true
         for (size_t r = 0; r < rows; ++r) {
-            for (size_t c = 0; c < cols; ++c) { result_ptr->data[c] = to_bool(result_ptr->data[c]) && to_bool(arr_ptr->data[r * cols + c]); }
+            for (size_t c = 0; c < cols; ++c) { result_ptr->data.set(c, to_bool(result_ptr->data[c]) && to_bool(arr_ptr->data.get(r * cols + c))); }
         }
     }
     else if (dimension == 1) { // Reduce along columns
@@ -3268,7 +3471,7 @@ BasicValue builtin_all(NeReLaBasic& vm, const std::vector<BasicValue>& args) {
         result_ptr->data.reserve(rows);
         for (size_t r = 0; r < rows; ++r) {
             bool row_all = true;
-            for (size_t c = 0; c < cols; ++c) { if (!to_bool(arr_ptr->data[r * cols + c])) { row_all = false; break; } }
+            for (size_t c = 0; c < cols; ++c) { if (!to_bool(arr_ptr->data.get(r * cols + c))) { row_all = false; break; } }
             result_ptr->data.push_back(row_all);
         }
     }
@@ -3313,16 +3516,16 @@ BasicValue builtin_scan(NeReLaBasic& vm, const std::vector<BasicValue>& args) {
         // The accumulator holds the cumulative result for the current slice.
         // Initialize it with the first element of the slice.
         BasicValue accumulator = source_ptr->data[slice_start_idx];
-        result_ptr->data[slice_start_idx] = accumulator;
+        result_ptr->data.set(slice_start_idx, accumulator);
 
         // Loop through the rest of the slice (from the second element onwards)
         for (size_t j = 1; j < last_dim_size; ++j) {
             size_t current_idx = slice_start_idx + j;
-            const BasicValue& current_val = source_ptr->data[current_idx];
+            const BasicValue current_val = source_ptr->data[current_idx];
 
             // --- Apply the operator ---
-            if (std::holds_alternative<std::string>(op_arg)) {
-                const std::string op = to_upper(std::get<std::string>(op_arg));
+            if (std::holds_alternative<BasicString>(op_arg)) {
+                const std::string op = to_upper(std::get<BasicString>(op_arg));
                 double acc_d = to_double(accumulator);
                 double cur_d = to_double(current_val);
 
@@ -3357,7 +3560,7 @@ BasicValue builtin_scan(NeReLaBasic& vm, const std::vector<BasicValue>& args) {
                 return {};
             }
 
-            result_ptr->data[current_idx] = accumulator;
+            result_ptr->data.set(current_idx, accumulator);
         }
     }
 
@@ -3427,7 +3630,7 @@ BasicValue builtin_reduce(NeReLaBasic& vm, const std::vector<BasicValue>& args)
 
     // Iterate through the array elements, applying the user's function.
     for (size_t i = start_index; i < arr_ptr->data.size(); ++i) {
-        const BasicValue& current_element = arr_ptr->data[i];
+        const BasicValue current_element = arr_ptr->data[i];
 
         // Prepare the two arguments to pass to the user's BASIC function.
         std::vector<BasicValue> func_args = { accumulator, current_element };
@@ -3579,11 +3782,11 @@ BasicValue builtin_iota(NeReLaBasic& vm, const std::vector<BasicValue>& args) {
 
     auto new_array_ptr = std::make_shared<Array>();
     new_array_ptr->shape = { (size_t)count };
-    new_array_ptr->data.reserve(count);
-
-    for (int i = 1; i <= count; ++i) {
-        new_array_ptr->data.push_back(static_cast<double>(i));
+    std::vector<double> values(count);
+    for (int i = 0; i < count; ++i) {
+        values[i] = static_cast<double>(i + 1);
     }
+    new_array_ptr->data = ArrayData::of_doubles(std::move(values));
 
     return new_array_ptr;
 }
@@ -3608,22 +3811,39 @@ BasicValue builtin_reshape(NeReLaBasic& vm, const std::vector<BasicValue>& args)
 
     // Create the new shape from the shape_vector
     std::vector<size_t> new_shape;
-    for (const auto& val : shape_vector_ptr->data) {
-        new_shape.push_back(static_cast<size_t>(to_double(val)));
+    for (size_t i = 0; i < shape_vector_ptr->data.size(); ++i) {
+        new_shape.push_back(static_cast<size_t>(shape_vector_ptr->data.number(i)));
     }
 
     auto new_array_ptr = std::make_shared<Array>();
     new_array_ptr->shape = new_shape;
     size_t new_total_size = new_array_ptr->size();
-    new_array_ptr->data.reserve(new_total_size);
 
     // APL's reshape cycles through the source data if needed.
-    if (source_array_ptr->data.empty()) {
-        new_array_ptr->data.assign(new_total_size, 0.0); // Fill with default if source is empty
+    const ArrayData& source = source_array_ptr->data;
+    if (source.empty()) {
+        new_array_ptr->data = ArrayData::of_doubles(std::vector<double>(new_total_size, 0.0)); // Fill with default if source is empty
+    }
+    else if (source.kind() != ArrayData::Kind::BOXED) {
+        // Unboxed sources are cycled as plain memory and stay unboxed.
+        auto cycle = [new_total_size](const auto& values) {
+            std::decay_t<decltype(values)> out(new_total_size);
+            for (size_t i = 0; i < new_total_size; ++i) {
+                out[i] = values[i % values.size()];
+            }
+            return out;
+            };
+        switch (source.kind()) {
+        case ArrayData::Kind::DOUBLE: new_array_ptr->data = ArrayData::of_doubles(cycle(source.doubles())); break;
+        case ArrayData::Kind::INT: new_array_ptr->data = ArrayData::of_ints(cycle(source.ints())); break;
+        case ArrayData::Kind::BOOL: new_array_ptr->data = ArrayData::of_bools(cycle(source.bools())); break;
+        default: new_array_ptr->data = ArrayData::of_strings(cycle(source.strings())); break;
+        }
     }
     else {
+        new_array_ptr->data.reserve(new_total_size);
         for (size_t i = 0; i < new_total_size; ++i) {
-            new_array_ptr->data.push_back(source_array_ptr->data[i % source_array_ptr->data.size()]);
+            new_array_ptr->data.push_back(source.get(i % source.size()));
         }
     }
 
@@ -3655,8 +3875,8 @@ BasicValue builtin_outer(NeReLaBasic& vm, const std::vector<BasicValue>& args) {
     const BasicValue& op_arg = args[2];
 
     // 3. Check if the operator is a string
-    if (std::holds_alternative<std::string>(op_arg)) {
-        const std::string op = to_upper(std::get<std::string>(op_arg));
+    if (std::holds_alternative<BasicString>(op_arg)) {
+        const std::string op = to_upper(std::get<BasicString>(op_arg));
         for (const auto& val_a : a_ptr->data) {
             for (const auto& val_b : b_ptr->data) {
                 double num_a = to_double(val_a);
@@ -4066,12 +4286,13 @@ BasicValue apply_math_op(const BasicValue& input, const std::function<double(dou
 
         auto result_ptr = std::make_shared<Array>();
         result_ptr->shape = (*arr_ptr)->shape; // Result has the same shape
-        result_ptr->data.reserve((*arr_ptr)->data.size());
 
         // Apply the operation to each element
-        for (const auto& val : (*arr_ptr)->data) {
-            result_ptr->data.push_back(op(to_double(val)));
+        std::vector<double> out((*arr_ptr)->data.size());
+        for (size_t i = 0; i < out.size(); ++i) {
+            out[i] = op((*arr_ptr)->data.number(i));
         }
+        result_ptr->data = ArrayData::of_doubles(std::move(out));
         return result_ptr;
     }
     // Case 2: Input is a scalar
@@ -4079,13 +4300,31 @@ BasicValue apply_math_op(const BasicValue& input, const std::function<double(dou
         return op(to_double(input));
     }
 }
+
+// The same for the math functions the Kernels module implements; arrays are
+// processed in one vectorised pass instead of a call per element.
+BasicValue apply_math_op(const BasicValue& input, Kernels::Unary op) {
+    if (const auto& arr_ptr = std::get_if<std::shared_ptr<Array>>(&input)) {
+        if (!*arr_ptr) return {};
+
+        auto result_ptr = std::make_shared<Array>();
+        result_ptr->shape = (*arr_ptr)->shape;
+        std::vector<double> out = (*arr_ptr)->data.to_doubles();
+        Kernels::unary(op, out.data(), out.data(), out.size());
+        result_ptr->data = ArrayData::of_doubles(std::move(out));
+        return result_ptr;
+    }
+    else {
+        return Kernels::unary(op, to_double(input));
+    }
+}
 // SIN(numeric_expression or array)
 BasicValue builtin_sin(NeReLaBasic& vm, const std::vector<BasicValue>& args) {
     if (args.size() != 1) {
         Error::set(8, vm.runtime_current_line);
         return 0.0;
     }
-    return apply_math_op(args[0], [](double d) { return std::sin(d); });
+    return apply_math_op(args[0], Kernels::Unary::SIN);
 }
 
 // COS(numeric_expression or array)
@@ -4094,7 +4333,7 @@ BasicValue builtin_cos(NeReLaBasic& vm, const std::vector<BasicValue>& args) {
         Error::set(8, vm.runtime_current_line);
         return 0.0;
     }
-    return apply_math_op(args[0], [](double d) { return std::cos(d); });
+    return apply_math_op(args[0], Kernels::Unary::COS);
 }
 
 // TAN(numeric_expression or array)
@@ -4103,7 +4342,7 @@ BasicValue builtin_tan(NeReLaBasic& vm, const std::vector<BasicValue>& args) {
         Error::set(8, vm.runtime_current_line);
         return 0.0;
     }
-    return apply_math_op(args[0], [](double d) { return std::tan(d); });
+    return apply_math_op(args[0], Kernels::Unary::TAN);
 }
 
 // SQR(numeric_expression or array) - Square Root
@@ -4113,7 +4352,7 @@ BasicValue builtin_sqr(NeReLaBasic& vm, const std::vector<BasicValue>& args) {
         return 0.0;
     }
     // Apply sqrt, returning 0 for negative inputs to avoid domain errors
-    return apply_math_op(args[0], [](double d) { return (d < 0) ? 0.0 : std::sqrt(d); });
+    return apply_math_op(args[0], Kernels::Unary::SQRT);
 }
 
 // RND(numeric_expression or array)
@@ -4196,8 +4435,7 @@ BasicValue builtin_abs(NeReLaBasic& vm, const std::vector<BasicValue>& args) {
         Error::set(8, vm.runtime_current_line);
         return 0.0;
     }
-    // Use the existing helper to apply std::abs to scalars or array elements
-    return apply_math_op(args[0], [](double d) { return std::abs(d); });
+    return apply_math_op(args[0], Kernels::Unary::ABS);
 }
 
 // INT(numeric_expression or array) - Traditional BASIC integer function (floor)
@@ -4206,7 +4444,7 @@ BasicValue builtin_int(NeReLaBasic& vm, const std::vector<BasicValue>& args) {
         Error::set(8, vm.runtime_current_line);
         return 0.0;
     }
-    return apply_math_op(args[0], [](double d) { return std::floor(d); });
+    return apply_math_op(args[0], Kernels::Unary::FLOOR);
 }
 
 // FLOOR(numeric_expression or array) - Rounds down
@@ -4215,7 +4453,7 @@ BasicValue builtin_floor(NeReLaBasic& vm, const std::vector<BasicValue>& args) {
         Error::set(8, vm.runtime_current_line);
         return 0.0;
     }
-    return apply_math_op(args[0], [](double d) { return std::floor(d); });
+    return apply_math_op(args[0], Kernels::Unary::FLOOR);
 }
 
 // CEIL(numeric_expression or array) - Rounds up
@@ -4224,7 +4462,7 @@ BasicValue builtin_ceil(NeReLaBasic& vm, const std::vector<BasicValue>& args) {
         Error::set(8, vm.runtime_current_line);
         return 0.0;
     }
-    return apply_math_op(args[0], [](double d) { return std::ceil(d); });
+    return apply_math_op(args[0], Kernels::Unary::CEIL);
 }
 
 // TRUNC(numeric_expression or array) - Truncates toward zero
@@ -4233,7 +4471,7 @@ BasicValue builtin_trunc(NeReLaBasic& vm, const std::vector<BasicValue>& args) {
         Error::set(8, vm.runtime_current_line);
         return 0.0;
     }
-    return apply_math_op(args[0], [](double d) { return std::trunc(d); });
+    return apply_math_op(args[0], Kernels::Unary::TRUNC);
 }
 
 // --- Date and Time Functions ---
@@ -4673,6 +4911,47 @@ BasicValue builtin_option(NeReLaBasic& vm, const std::vector<BasicValue>& args)
         vm.nopause_active = false;
         TextIO::print("OPTION PAUSE is active. Break/Pause enabled.\n");
     }
+    else if (option_str.rfind("TIMESLICE=", 0) == 0) {
+        // "TIMESLICE=LINE" (default), "TIMESLICE=<n>" statements or "TIMESLICE=<n>US" microseconds
+        std::string value = option_str.substr(10);
+        bool micros = value.size() > 2 && value.substr(value.size() - 2) == "US";
+        if (micros) value.resize(value.size() - 2);
+        if (value == "LINE") {
+            vm.time_slice_statements = 0;
+            vm.time_slice_us = 0;
+        }
+        else if (!value.empty() && value.size() <= 9 && value.find_first_not_of("0123456789") == std::string::npos) {
+            uint32_t amount = static_cast<uint32_t>(std::stoul(value));
+            vm.time_slice_statements = micros ? 0 : amount;
+            vm.time_slice_us = micros ? amount : 0;
+        }
+        else {
+            Error::set(1, vm.runtime_current_line, "Invalid TIMESLICE option: " + value);
+        }
+    }
+    else if (option_str == "PROFILE" || option_str.rfind("PROFILE=", 0) == 0) {
+        // "PROFILE" samples until the program ends and writes <program>.profile.txt
+        // and <program>.folded; "PROFILE=<path>" chooses the report path (without extension).
+        vm.start_profiler(option_str == "PROFILE" ? std::string() : to_string(args[0]).substr(8));
+    }
+    else if (option_str.rfind("EVENTQUEUE=", 0) == 0) {
+        // "EVENTQUEUE=<n>" pending events at most, "EVENTQUEUE=0" for no limit
+        std::string value = option_str.substr(11);
+        if (!value.empty() && value.size() <= 9 && value.find_first_not_of("0123456789") == std::string::npos) {
+            vm.events.capacity = static_cast<size_t>(std::stoul(value));
+        }
+        else {
+            Error::set(1, vm.runtime_current_line, "Invalid EVENTQUEUE option: " + value);
+        }
+    }
+    else if (option_str.rfind("EVENTOVERFLOW=", 0) == 0) {
+        // What a full event queue does with one more event, see EventQueue.hpp
+        std::string value = option_str.substr(14);
+        if (value == "DROPOLDEST") vm.events.overflow = EventQueue::Overflow::DROP_OLDEST;
+        else if (value == "DROPNEWEST") vm.events.overflow = EventQueue::Overflow::DROP_NEWEST;
+        else if (value == "WAIT") vm.events.overflow = EventQueue::Overflow::WAIT;
+        else Error::set(1, vm.runtime_current_line, "Invalid EVENTOVERFLOW option: " + value);
+    }
     // Add more else if blocks here for future options, e.g.:
     // else if (option_str == "GRAPHICSON") {
     //     // vm.graphics_enabled = true;
@@ -4687,6 +4966,26 @@ BasicValue builtin_option(NeReLaBasic& vm, const std::vector<BasicValue>& args)
     return false; // Procedures return a dummy value
 }
 
+// EVENT.STATS() -> map
+// Counters of the event queue: "pending", "highwater", "capacity", "raised",
+// "dispatched", "coalesced" and "dropped".
+BasicValue builtin_event_stats(NeReLaBasic& vm, const std::vector<BasicValue>& args) {
+    if (!args.empty()) {
+        Error::set(8, vm.runtime_current_line, "EVENT.STATS takes no arguments.");
+        return false;
+    }
+    const auto& stats = vm.events.stats;
+    auto result = std::make_shared<Map>();
+    result->data["pending"] = static_cast<double>(vm.events.size());
+    result->data["highwater"] = static_cast<double>(stats.high_water);
+    result->data["capacity"] = static_cast<double>(vm.events.capacity);
+    result->data["raised"] = static_cast<double>(stats.raised);
+    result->data["dispatched"] = static_cast<double>(stats.dispatched);
+    result->data["coalesced"] = static_cast<double>(stats.coalesced);
+    result->data["dropped"] = static_cast<double>(stats.dropped);
+    return result;
+}
+
 // GETENV$(variable_name$) -> string$
 // Reads the value of a system environment variable.
 BasicValue builtin_getenv_str(NeReLaBasic& vm, const std::vector<BasicValue>& args) {
@@ -4939,15 +5238,13 @@ BasicValue builtin_txtreader_str(NeReLaBasic& vm, const std::vector<BasicValue>&
 }
 
 
-// CSVREADER(filename$, [delimiter$], [has_header_bool]) -> array
-// Reads a delimited file (like CSV) into a 2D array of numbers.
-BasicValue builtin_csvreader(NeReLaBasic& vm, const std::vector<BasicValue>& args) {
+// Opens a CsvReader for CSVREADER and CSV.OPEN: (filename$, [delimiter$], [has_header_bool]).
+static std::unique_ptr<CsvReader> open_csv_reader(NeReLaBasic& vm, const std::vector<BasicValue>& args, const std::string& name) {
     if (args.empty() || args.size() > 3) {
-        Error::set(8, vm.runtime_current_line, "Wrong number of arguments");
-        return {};
+        Error::set(8, vm.runtime_current_line, "Wrong number of arguments to " + name);
+        return nullptr;
     }
 
-    // --- 1. Parse Arguments ---
     std::string filename = to_string(args[0]);
     char delimiter = ',';
     bool has_header = false;
@@ -4962,64 +5259,98 @@ BasicValue builtin_csvreader(NeReLaBasic& vm, const std::vector<BasicValue>& arg
         has_header = to_bool(args[2]);
     }
 
-    // --- 2. Open File ---
-    std::ifstream infile(filename);
-    if (!infile) {
+    auto reader = std::make_unique<CsvReader>(delimiter, has_header);
+    if (!reader->open(filename)) {
         Error::set(6, vm.runtime_current_line); // File not found
-        return {};
+        return nullptr;
     }
+    return reader;
+}
 
-    // --- 3. Read and Parse ---
-    std::vector<BasicValue> flat_data;
-    size_t rows = 0;
-    size_t cols = 0;
-    std::string line;
+// CSVREADER(filename$, [delimiter$], [has_header_bool]) -> array
+// Reads a delimited file (like CSV) into a 2D array. Numeric columns hold
+// numbers, columns with text keep their text (see CsvReader).
+BasicValue builtin_csvreader(NeReLaBasic& vm, const std::vector<BasicValue>& args) {
+    auto reader = open_csv_reader(vm, args, "CSVREADER");
+    if (!reader) return {};
 
-    // Handle header row if specified
-    if (has_header && std::getline(infile, line)) {
-        // Just consume the line and do nothing with it.
+    std::string error;
+    auto result_ptr = reader->read(0, error);
+    if (!result_ptr) {
+        Error::set(15, vm.runtime_current_line, "CSVREADER: " + error);
+        return {};
     }
+    return result_ptr;
+}
 
-    // Loop through the rest of the file
-    while (std::getline(infile, line)) {
-        rows++;
-        std::stringstream line_stream(line);
-        std::string cell;
-        size_t current_cols = 0;
+// CSV.OPEN(filename$, [delimiter$], [has_header_bool]) -> handle
+// Opens a delimited file for reading a number of rows at a time with CSV.READ.
+BasicValue builtin_csv_open(NeReLaBasic& vm, const std::vector<BasicValue>& args) {
+    auto reader = open_csv_reader(vm, args, "CSV.OPEN");
+    if (!reader) return {};
+    return std::make_shared<OpaqueHandle>(reader.release(), "CSVREADER", [](void* p) { delete static_cast<CsvReader*>(p); });
+}
 
-        while (std::getline(line_stream, cell, delimiter)) {
-            current_cols++;
-            try {
-                // Try to convert each cell to a number.
-                flat_data.push_back(std::stod(cell));
-            }
-            catch (const std::invalid_argument&) {
-                // If conversion fails, store 0.0, a common practice.
-                flat_data.push_back(0.0);
-            }
+// Returns the reader behind a CSV.OPEN handle, or sets an error.
+static CsvReader* get_csv_reader(NeReLaBasic& vm, const BasicValue& arg, const std::string& name) {
+    if (const auto* handle = std::get_if<std::shared_ptr<OpaqueHandle>>(&arg)) {
+        if (*handle && (*handle)->ptr && (*handle)->type_name == "CSVREADER") {
+            return static_cast<CsvReader*>((*handle)->ptr);
         }
+    }
+    Error::set(15, vm.runtime_current_line, name + " requires an open handle from CSV.OPEN.");
+    return nullptr;
+}
 
-        // --- 4. Determine Shape and Validate ---
-        if (rows == 1) {
-            // This is the first data row, so it determines the number of columns.
-            cols = current_cols;
-        }
-        else {
-            // For all subsequent rows, verify they have the correct number of columns.
-            if (current_cols != cols) {
-                Error::set(15, vm.runtime_current_line); // Type Mismatch (or a new "Invalid file format" error)
-                return {};
-            }
-        }
+// CSV.READ(handle, rows) -> array
+// Returns the next 'rows' rows as a 2D array; it has 0 rows at the end of the file.
+BasicValue builtin_csv_read(NeReLaBasic& vm, const std::vector<BasicValue>& args) {
+    if (args.size() != 2) {
+        Error::set(8, vm.runtime_current_line, "CSV.READ requires 2 arguments: handle, rows");
+        return {};
+    }
+    CsvReader* reader = get_csv_reader(vm, args[0], "CSV.READ");
+    if (!reader) return {};
+    double rows = to_double(args[1]);
+    if (rows < 1) {
+        Error::set(1, vm.runtime_current_line, "CSV.READ: the row count must be at least 1.");
+        return {};
     }
 
-    // --- 5. Create and Return the Array ---
-    auto result_ptr = std::make_shared<Array>();
-    result_ptr->shape = { rows, cols };
-    result_ptr->data = flat_data;
+    std::string error;
+    auto result_ptr = reader->read(static_cast<size_t>(rows), error);
+    if (!result_ptr) {
+        Error::set(15, vm.runtime_current_line, "CSV.READ: " + error);
+        return {};
+    }
     return result_ptr;
 }
 
+// CSV.EOF(handle) -> boolean
+BasicValue builtin_csv_eof(NeReLaBasic& vm, const std::vector<BasicValue>& args) {
+    if (args.size() != 1) {
+        Error::set(8, vm.runtime_current_line);
+        return true;
+    }
+    CsvReader* reader = get_csv_reader(vm, args[0], "CSV.EOF");
+    if (!reader) return true;
+    return reader->at_end();
+}
+
+// CSV.CLOSE handle
+// Closes the file now instead of when the last reference to the handle goes away.
+BasicValue builtin_csv_close(NeReLaBasic& vm, const std::vector<BasicValue>& args) {
+    if (args.size() != 1) {
+        Error::set(8, vm.runtime_current_line);
+        return false;
+    }
+    if (!get_csv_reader(vm, args[0], "CSV.CLOSE")) return false;
+    auto& handle = std::get<std::shared_ptr<OpaqueHandle>>(args[0]);
+    delete static_cast<CsvReader*>(handle->ptr);
+    handle->ptr = nullptr;
+    return false;
+}
+
 // TXTWRITER filename$, content$
 // Writes the content of a string variable to a text file.
 BasicValue builtin_txtwriter(NeReLaBasic& vm, const std::vector<BasicValue>& args) {
@@ -5029,7 +5360,6 @@ BasicValue builtin_txtwriter(NeReLaBasic& vm, const std::vector<BasicValue>& arg
     }
 
     std::string filename = to_string(args[0]);
-    std::string content = to_string(args[1]);
 
     std::ofstream outfile(filename);
     if (!outfile) {
@@ -5037,7 +5367,13 @@ BasicValue builtin_txtwriter(NeReLaBasic& vm, const std::vector<BasicValue>& arg
         return false;
     }
 
-    outfile << content;
+    // Write a string argument directly; only other values are converted first.
+    if (const BasicString* content = std::get_if<BasicString>(&args[1])) {
+        outfile.write(content->data(), static_cast<std::streamsize>(content->size()));
+    }
+    else {
+        outfile << to_string(args[1]);
+    }
     return false; // Procedures return a dummy value
 }
 
@@ -5087,7 +5423,7 @@ BasicValue builtin_csvwriter(NeReLaBasic& vm, const std::vector<BasicValue>& arg
         const auto& header_ptr = std::get<std::shared_ptr<Array>>(args[3]);
         if (header_ptr) {
             for (size_t i = 0; i < header_ptr->data.size(); ++i) {
-                outfile << to_string(header_ptr->data[i]);
+                outfile << to_string(header_ptr->data.get(i));
                 if (i < header_ptr->data.size() - 1) {
                     outfile << delimiter;
                 }
@@ -5102,7 +5438,7 @@ BasicValue builtin_csvwriter(NeReLaBasic& vm, const std::vector<BasicValue>& arg
 
     for (size_t r = 0; r < rows; ++r) {
         for (size_t c = 0; c < cols; ++c) {
-            const BasicValue& val = array_ptr->data[r * cols + c];
+            const BasicValue val = array_ptr->data.get(r * cols + c);
             outfile << to_string(val);
             if (c < cols - 1) {
                 outfile << delimiter;
@@ -5303,7 +5639,7 @@ BasicValue builtin_typeof(NeReLaBasic& vm, const std::vector<BasicValue>& args)
         else if constexpr (std::is_same_v<T, double>) {
             return "DOUBLE";
         }
-        else if constexpr (std::is_same_v<T, std::string>) {
+        else if constexpr (std::is_same_v<T, BasicString>) {
             return "STRING";
         }
         else if constexpr (std::is_same_v<T, DateTime>) {
@@ -5384,7 +5720,106 @@ BasicValue get_thread_result(NeReLaBasic& vm, const std::vector<BasicValue>& arg
     return result_future.get();
 }
 
-// REGEX.MATCH(pattern$, text$) -> Boolean or Array
+// --- Regex helpers ---
+// Patterns come from RegexCache, so a REGEX call in a loop compiles its pattern
+// once. Passing an array as the text applies the function to every element and
+// returns an array of the results with the same shape; large arrays are spread
+// over the OpenMP threads.
+static constexpr size_t REGEX_PARALLEL_MIN = 1024;
+
+// The elements of an array text argument as strings: the array's own store for a
+// string array, otherwise converted copies placed in 'scratch'.
+static const std::vector<BasicString>& regex_texts(const Array& texts, std::vector<BasicString>& scratch) {
+    if (texts.data.kind() == ArrayData::Kind::STRING) return texts.data.strings();
+    scratch.resize(texts.data.size());
+    for (size_t i = 0; i < scratch.size(); ++i) scratch[i] = to_string(texts.data.get(i));
+    return scratch;
+}
+
+// Runs body(i) for every i in [0, n). Returns the message of the first
+// std::regex_error thrown while matching (e.g. a pattern that is too complex for
+// an input), or an empty string.
+template <typename Body>
+static std::string regex_for_each(size_t n, Body body) {
+    std::string error;
+#pragma omp parallel for schedule(dynamic, 64) if (n >= REGEX_PARALLEL_MIN)
+    for (long long i = 0; i < static_cast<long long>(n); ++i) {
+        try {
+            body(static_cast<size_t>(i));
+        }
+        catch (const std::regex_error& e) {
+#pragma omp critical(regex_error)
+            if (error.empty()) error = e.what();
+        }
+    }
+    return error;
+}
+
+static std::shared_ptr<Array> regex_result_array(const Array& texts, ArrayData data) {
+    auto result_ptr = std::make_shared<Array>();
+    result_ptr->shape = texts.shape;
+    result_ptr->data = std::move(data);
+    return result_ptr;
+}
+
+// TRUE, FALSE or the captured groups of one whole-string match.
+static BasicValue regex_match_one(const std::regex& pattern, const std::string& text_str) {
+    std::smatch matches;
+    if (std::regex_match(text_str, matches, pattern)) {
+        // If there are capture groups (...), return them as an array.
+        if (matches.size() > 1) {
+            auto result_ptr = std::make_shared<Array>();
+            // Start at 1 to skip the full match (matches[0])
+            for (size_t i = 1; i < matches.size(); ++i) {
+                result_ptr->data.push_back(matches[i].str());
+            }
+            result_ptr->shape = { result_ptr->data.size() };
+            return result_ptr;
+        }
+        else {
+            // No capture groups, but the whole string matched.
+            return true;
+        }
+    }
+    else {
+        // The string did not match the pattern.
+        return false;
+    }
+}
+
+static std::shared_ptr<Array> regex_findall_one(const std::regex& pattern, const std::string& text_str) {
+    auto result_ptr = std::make_shared<Array>();
+    auto words_begin = std::sregex_iterator(text_str.begin(), text_str.end(), pattern);
+    auto words_end = std::sregex_iterator();
+
+    bool has_capture_groups = pattern.mark_count() > 0;
+
+    if (has_capture_groups) {
+        // Return a 2D array of captured groups
+        for (auto it = words_begin; it != words_end; ++it) {
+            const std::smatch& match = *it;
+            auto row_ptr = std::make_shared<Array>();
+            // Start at 1 to get only the captured groups
+            for (size_t i = 1; i < match.size(); ++i) {
+                row_ptr->data.push_back(match[i].str());
+            }
+            row_ptr->shape = { row_ptr->data.size() };
+            result_ptr->data.push_back(row_ptr);
+        }
+        result_ptr->shape = { result_ptr->data.size() };
+    }
+    else {
+        // No capture groups, just return all full matches as a 1D array.
+        for (auto it = words_begin; it != words_end; ++it) {
+            result_ptr->data.push_back((*it).str());
+        }
+        result_ptr->shape = { result_ptr->data.size() };
+    }
+    return result_ptr;
+}
+
+// REGEX.MATCH(pattern$, text$) -> Boolean or Array of captured groups
+// REGEX.MATCH(pattern$, texts[]) -> Array with one result per element
 BasicValue builtin_regex_match(NeReLaBasic& vm, const std::vector<BasicValue>& args) {
     if (args.size() != 2) {
         Error::set(8, vm.runtime_current_line, "REGEX.MATCH requires 2 arguments: pattern, text");
@@ -5392,32 +5827,35 @@ BasicValue builtin_regex_match(NeReLaBasic& vm, const std::vector<BasicValue>& a
     }
 
     std::string pattern_str = to_string(args[0]);
-    std::string text_str = to_string(args[1]);
-    std::smatch matches;
 
     try {
-        std::regex pattern(pattern_str);
-
-        if (std::regex_match(text_str, matches, pattern)) {
-            // If there are capture groups (...), return them as an array.
-            if (matches.size() > 1) {
-                auto result_ptr = std::make_shared<Array>();
-                // Start at 1 to skip the full match (matches[0])
-                for (size_t i = 1; i < matches.size(); ++i) {
-                    result_ptr->data.push_back(matches[i].str());
-                }
-                result_ptr->shape = { result_ptr->data.size() };
-                return result_ptr;
+        auto pattern = RegexCache::get(pattern_str);
+
+        if (const auto* texts_ptr = std::get_if<std::shared_ptr<Array>>(&args[1]); texts_ptr && *texts_ptr) {
+            const Array& texts = **texts_ptr;
+            std::vector<BasicString> scratch;
+            const auto& strings = regex_texts(texts, scratch);
+            std::string error;
+            ArrayData data;
+            if (pattern->mark_count() == 0) {
+                // Without groups every result is TRUE/FALSE: an unboxed boolean array.
+                std::vector<uint8_t> matched(strings.size());
+                error = regex_for_each(strings.size(), [&](size_t i) { matched[i] = std::regex_match(strings[i].str(), *pattern); });
+                data = ArrayData::of_bools(std::move(matched));
             }
             else {
-                // No capture groups, but the whole string matched.
-                return true;
+                std::vector<BasicValue> results(strings.size());
+                error = regex_for_each(strings.size(), [&](size_t i) { results[i] = regex_match_one(*pattern, strings[i].str()); });
+                data = ArrayData(std::move(results));
             }
+            if (!error.empty()) {
+                Error::set(1, vm.runtime_current_line, "Regex error: " + error);
+                return false;
+            }
+            return regex_result_array(texts, std::move(data));
         }
-        else {
-            // The string did not match the pattern.
-            return false;
-        }
+
+        return regex_match_one(*pattern, to_string(args[1]));
     }
     catch (const std::regex_error& e) {
         Error::set(1, vm.runtime_current_line, "Invalid regex pattern: " + std::string(e.what()));
@@ -5428,6 +5866,7 @@ BasicValue builtin_regex_match(NeReLaBasic& vm, const std::vector<BasicValue>& a
 // Regex functions
 
 // REGEX.FINDALL(pattern$, text$) -> Array
+// REGEX.FINDALL(pattern$, texts[]) -> Array with one result Array per element
 BasicValue builtin_regex_findall(NeReLaBasic& vm, const std::vector<BasicValue>& args) {
     if (args.size() != 2) {
         Error::set(8, vm.runtime_current_line, "REGEX.FINDALL requires 2 arguments: pattern, text");
@@ -5435,39 +5874,24 @@ BasicValue builtin_regex_findall(NeReLaBasic& vm, const std::vector<BasicValue>&
     }
 
     std::string pattern_str = to_string(args[0]);
-    std::string text_str = to_string(args[1]);
-    auto result_ptr = std::make_shared<Array>();
 
     try {
-        std::regex pattern(pattern_str);
-        auto words_begin = std::sregex_iterator(text_str.begin(), text_str.end(), pattern);
-        auto words_end = std::sregex_iterator();
-
-        bool has_capture_groups = pattern.mark_count() > 0;
-
-        if (has_capture_groups) {
-            // Return a 2D array of captured groups
-            for (auto it = words_begin; it != words_end; ++it) {
-                const std::smatch& match = *it;
-                auto row_ptr = std::make_shared<Array>();
-                // Start at 1 to get only the captured groups
-                for (size_t i = 1; i < match.size(); ++i) {
-                    row_ptr->data.push_back(match[i].str());
-                }
-                row_ptr->shape = { row_ptr->data.size() };
-                result_ptr->data.push_back(row_ptr);
-            }
-            result_ptr->shape = { result_ptr->data.size() };
-        }
-        else {
-            // No capture groups, just return all full matches as a 1D array.
-            for (auto it = words_begin; it != words_end; ++it) {
-                result_ptr->data.push_back((*it).str());
+        auto pattern = RegexCache::get(pattern_str);
+
+        if (const auto* texts_ptr = std::get_if<std::shared_ptr<Array>>(&args[1]); texts_ptr && *texts_ptr) {
+            const Array& texts = **texts_ptr;
+            std::vector<BasicString> scratch;
+            const auto& strings = regex_texts(texts, scratch);
+            std::vector<BasicValue> results(strings.size());
+            std::string error = regex_for_each(strings.size(), [&](size_t i) { results[i] = regex_findall_one(*pattern, strings[i].str()); });
+            if (!error.empty()) {
+                Error::set(1, vm.runtime_current_line, "Regex error: " + error);
+                return {};
             }
-            result_ptr->shape = { result_ptr->data.size() };
+            return regex_result_array(texts, ArrayData(std::move(results)));
         }
 
-        return result_ptr;
+        return regex_findall_one(*pattern, to_string(args[1]));
     }
     catch (const std::regex_error& e) {
         Error::set(1, vm.runtime_current_line, "Invalid regex pattern: " + std::string(e.what()));
@@ -5476,6 +5900,7 @@ BasicValue builtin_regex_findall(NeReLaBasic& vm, const std::vector<BasicValue>&
 }
 
 // REGEX.REPLACE(pattern$, text$, replacement$) -> String
+// REGEX.REPLACE(pattern$, texts[], replacement$) -> Array of strings
 BasicValue builtin_regex_replace(NeReLaBasic& vm, const std::vector<BasicValue>& args) {
     if (args.size() != 3) {
         Error::set(8, vm.runtime_current_line, "REGEX.REPLACE requires 3 arguments: pattern, text, replacement");
@@ -5483,13 +5908,26 @@ BasicValue builtin_regex_replace(NeReLaBasic& vm, const std::vector<BasicValue>&
     }
 
     std::string pattern_str = to_string(args[0]);
-    std::string text_str = to_string(args[1]);
     std::string replacement_str = to_string(args[2]);
 
     try {
-        std::regex pattern(pattern_str);
+        auto pattern = RegexCache::get(pattern_str);
+
+        if (const auto* texts_ptr = std::get_if<std::shared_ptr<Array>>(&args[1]); texts_ptr && *texts_ptr) {
+            const Array& texts = **texts_ptr;
+            std::vector<BasicString> scratch;
+            const auto& strings = regex_texts(texts, scratch);
+            std::vector<std::string> results(strings.size());
+            std::string error = regex_for_each(strings.size(), [&](size_t i) { results[i] = std::regex_replace(strings[i].str(), *pattern, replacement_str); });
+            if (!error.empty()) {
+                Error::set(1, vm.runtime_current_line, "Regex error: " + error);
+                return std::string("");
+            }
+            return regex_result_array(texts, ArrayData::of_strings(std::move(results)));
+        }
+
         // regex_replace finds all matches and replaces them according to the format string.
-        return std::regex_replace(text_str, pattern, replacement_str);
+        return std::regex_replace(to_string(args[1]), *pattern, replacement_str);
     }
     catch (const std::regex_error& e) {
         Error::set(1, vm.runtime_current_line, "Invalid regex pattern: " + std::string(e.what()));
@@ -5725,6 +6163,12 @@ void register_builtin_functions(NeReLaBasic& vm, NeReLaBasic::FunctionTable& tab
 
     register_func("JSON.PARSE$", 1, builtin_json_parse);
     register_func("JSON.STRINGIFY$", 1, builtin_json_stringify);
+    register_func("JSON.LOAD", 1, builtin_json_load);
+    register_func("JSON.VALUE", 1, builtin_json_value);
+    register_func("JSON.OPEN", 1, builtin_json_open);
+    register_func("JSON.READ", 1, builtin_json_read);
+    register_func("JSON.EOF", 1, builtin_json_eof);
+    register_proc("JSON.CLOSE", 1, builtin_json_close);
 
     register_func("MAP.EXISTS", 2, builtin_map_exists);
     register_func("MAP.KEYS", 1, builtin_map_keys);
@@ -5735,6 +6179,7 @@ void register_builtin_functions(NeReLaBasic& vm, NeReLaBasic::FunctionTable& tab
     register_proc("LOCATE", 2, builtin_locate);
     register_proc("SLEEP", 1, builtin_sleep);
     register_proc("OPTION", 1, builtin_option);
+    register_func("EVENT.STATS", 0, builtin_event_stats);
     register_proc("CURSOR", 1, builtin_cursor);
     register_func("GETENV$", 1, builtin_getenv_str);
 
@@ -5749,6 +6194,10 @@ void register_builtin_functions(NeReLaBasic& vm, NeReLaBasic::FunctionTable& tab
     register_proc("EXECUTE", 1, builtin_execute);
 
     register_func("CSVREADER", -1, builtin_csvreader); // -1 for optional args
+    register_func("CSV.OPEN", -1, builtin_csv_open);
+    register_func("CSV.READ", 2, builtin_csv_read);
+    register_func("CSV.EOF", 1, builtin_csv_eof);
+    register_proc("CSV.CLOSE", 1, builtin_csv_close);
     register_func("TXTREADER$", 1, builtin_txtreader_str);
     register_proc("TXTWRITER", 2, builtin_txtwriter);
     register_proc("CSVWRITER", -1, builtin_csvwriter); // -1 for optional delimiter
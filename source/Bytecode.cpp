@@ -0,0 +1,412 @@
+// Bytecode.cpp
+#include "Bytecode.hpp"
+#include "StringUtils.hpp"
+#include <cstring>
+#include <algorithm>
+
+using Tokens::ID;
+
+size_t Bytecode::token_length(const std::vector<uint8_t>& p_code, size_t pc) {
+    switch (static_cast<ID>(p_code[pc])) {
+    case ID::NUMBER:
+        return 1 + sizeof(double);
+    case ID::INTEGER_LITERAL:
+        return 1 + sizeof(int);
+    case ID::STRING:
+    case ID::VARIANT:
+    case ID::INT:
+    case ID::STRVAR:
+    case ID::CALLFUNC:
+    case ID::FUNCREF:
+    case ID::CONSTANT:
+    case ID::ARRAY_ACCESS:
+    case ID::MAP_ACCESS:
+    case ID::OP_START_TASK: {
+        size_t end = pc + 1;
+        while (end < p_code.size() && p_code[end] != 0) end++;
+        return end - pc + 1; // token + characters + null terminator
+    }
+    default:
+        return 1;
+    }
+}
+
+Bytecode::SymbolPool::SymbolPool(std::shared_ptr<const SymbolPool> base_pool)
+    : base(std::move(base_pool)),
+      base_size(base ? base->base_size + static_cast<uint32_t>(base->symbols.size()) : 0) {
+}
+
+uint32_t Bytecode::SymbolPool::find(std::string_view text) const {
+    if (base) {
+        if (uint32_t id = base->find(text)) return id;
+    }
+    auto it = ids.find(text);
+    return it != ids.end() ? it->second : 0;
+}
+
+uint32_t Bytecode::SymbolPool::intern(std::string_view text) {
+    if (uint32_t id = find(text)) return id;
+    Symbol& sym = symbols.emplace_back();
+    sym.text = BasicString(text);
+    std::string upper = StringUtils::to_upper(std::string(text));
+    sym.name = (upper == text) ? sym.text : BasicString(std::move(upper));
+    sym.length = static_cast<uint32_t>(text.size() + 1);
+    const uint32_t id = base_size + static_cast<uint32_t>(symbols.size());
+    ids.emplace(std::string(text), id);
+    return id;
+}
+
+std::shared_ptr<const Bytecode::SymbolPool> Bytecode::SymbolPool::share() const {
+    // A pool that added nothing to its base (a program snapshot) passes the base on.
+    if (symbols.empty()) return base;
+    return std::make_shared<const SymbolPool>(*this);
+}
+
+namespace {
+    // Recursive descent over the p-code that mirrors the precedence chain in
+    // NeReLaBasic::evaluate_expression(), but emits register instructions instead
+    // of computing values. Every sub-expression writes its result into the register
+    // it is given; the right operand of a binary operator uses the next register up.
+    class Lowering {
+    public:
+        Lowering(const std::vector<uint8_t>& p_code, uint32_t start, Bytecode::Chunk& out)
+            : p(p_code), pc(start), chunk(out) {
+        }
+
+        bool run() {
+            expression(0);
+            if (!ok) return false;
+            chunk.end_pcode = pc;
+            chunk.num_registers = static_cast<uint8_t>(max_register + 1);
+            return true;
+        }
+
+    private:
+        const std::vector<uint8_t>& p;
+        size_t pc;
+        Bytecode::Chunk& chunk;
+        bool ok = true;
+        int max_register = 0;
+
+        ID peek() const { return pc < p.size() ? static_cast<ID>(p[pc]) : ID::C_CR; }
+
+        uint8_t next_register(uint8_t reg) {
+            if (reg >= 250) { ok = false; return reg; }
+            max_register = std::max(max_register, reg + 1);
+            return reg + 1;
+        }
+
+        void emit(Bytecode::Op op, uint8_t dst, uint8_t a = 0, uint8_t b = 0, uint32_t operand = 0) {
+            chunk.code.push_back({ op, dst, a, b, operand });
+        }
+
+        void emit_constant(uint8_t dst, BasicValue value) {
+            chunk.constants.push_back(std::move(value));
+            emit(Bytecode::Op::LOAD_CONST, dst, 0, 0, static_cast<uint32_t>(chunk.constants.size() - 1));
+        }
+
+        std::string read_name() {
+            std::string s(reinterpret_cast<const char*>(&p[pc]));
+            pc += s.size() + 1;
+            return s;
+        }
+
+        // Level 1: XOR
+        void expression(uint8_t dst) {
+            logical_or(dst);
+            while (ok && peek() == ID::XOR) {
+                pc++;
+                uint8_t rhs = next_register(dst);
+                logical_or(rhs);
+                emit(Bytecode::Op::XOR, dst, dst, rhs);
+            }
+        }
+
+        void logical_or(uint8_t dst) {
+            logical_and(dst);
+            while (ok) {
+                ID op = peek();
+                if (op == ID::OR) {
+                    pc++;
+                    uint8_t rhs = next_register(dst);
+                    logical_and(rhs);
+                    emit(Bytecode::Op::OR, dst, dst, rhs);
+                }
+                else if (op == ID::ORELSE) {
+                    pc++;
+                    size_t jump = chunk.code.size();
+                    emit(Bytecode::Op::JUMP_IF_TRUE, dst, dst);
+                    logical_and(dst);
+                    chunk.code[jump].operand = static_cast<uint32_t>(chunk.code.size());
+                }
+                else break;
+            }
+        }
+
+        void logical_and(uint8_t dst) {
+            bitwise(dst);
+            while (ok) {
+                ID op = peek();
+                if (op == ID::AND) {
+                    pc++;
+                    uint8_t rhs = next_register(dst);
+                    bitwise(rhs);
+                    emit(Bytecode::Op::AND, dst, dst, rhs);
+                }
+                else if (op == ID::ANDALSO) {
+                    pc++;
+                    size_t jump = chunk.code.size();
+                    emit(Bytecode::Op::JUMP_IF_FALSE, dst, dst);
+                    bitwise(dst);
+                    chunk.code[jump].operand = static_cast<uint32_t>(chunk.code.size());
+                }
+                else break;
+            }
+        }
+
+        // The bitwise and pipe levels are left to the parser.
+        void bitwise(uint8_t dst) {
+            comparison(dst);
+            ID op = peek();
+            if (op == ID::BAND || op == ID::BOR || op == ID::BXOR || op == ID::C_PIPE) ok = false;
+        }
+
+        void comparison(uint8_t dst) {
+            term(dst);
+            if (!ok) return;
+            Bytecode::Op op;
+            switch (peek()) {
+            case ID::C_EQ: op = Bytecode::Op::EQ; break;
+            case ID::C_NE: op = Bytecode::Op::NE; break;
+            case ID::C_LT: op = Bytecode::Op::LT; break;
+            case ID::C_GT: op = Bytecode::Op::GT; break;
+            case ID::C_LE: op = Bytecode::Op::LE; break;
+            case ID::C_GE: op = Bytecode::Op::GE; break;
+            default: return;
+            }
+            pc++;
+            uint8_t rhs = next_register(dst);
+            term(rhs);
+            emit(op, dst, dst, rhs);
+        }
+
+        void term(uint8_t dst) {
+            factor(dst);
+            while (ok && (peek() == ID::C_PLUS || peek() == ID::C_MINUS)) {
+                Bytecode::Op op = peek() == ID::C_PLUS ? Bytecode::Op::ADD : Bytecode::Op::SUB;
+                pc++;
+                uint8_t rhs = next_register(dst);
+                factor(rhs);
+                emit(op, dst, dst, rhs);
+            }
+        }
+
+        void factor(uint8_t dst) {
+            power(dst);
+            while (ok) {
+                Bytecode::Op op;
+                switch (peek()) {
+                case ID::C_ASTR: op = Bytecode::Op::MUL; break;
+                case ID::C_SLASH: op = Bytecode::Op::DIV; break;
+                case ID::MOD: op = Bytecode::Op::MOD; break;
+                case ID::FUNCREF: ok = false; return; // user-defined operator
+                default: return;
+                }
+                pc++;
+                uint8_t rhs = next_register(dst);
+                power(rhs);
+                emit(op, dst, dst, rhs);
+            }
+        }
+
+        void power(uint8_t dst) {
+            unary(dst);
+            while (ok && peek() == ID::C_CARET) {
+                pc++;
+                uint8_t rhs = next_register(dst);
+                unary(rhs);
+                emit(Bytecode::Op::POW, dst, dst, rhs);
+            }
+        }
+
+        void unary(uint8_t dst) {
+            ID token = peek();
+            if (token == ID::AWAIT) {
+                ok = false; // AWAIT can suspend the task in the middle of the expression
+                return;
+            }
+            if (token == ID::C_MINUS) {
+                pc++;
+                size_t mark = chunk.code.size();
+                unary(dst);
+                if (!ok) return;
+                // Fold the negation of a numeric literal into the constant itself.
+                if (chunk.code.size() == mark + 1 && chunk.code[mark].op == Bytecode::Op::LOAD_CONST) {
+                    BasicValue& c = chunk.constants[chunk.code[mark].operand];
+                    if (!std::holds_alternative<BasicString>(c)) {
+                        c = -to_double(c);
+                        return;
+                    }
+                }
+                emit(Bytecode::Op::NEG, dst, dst);
+                return;
+            }
+            if (token == ID::NOT) {
+                pc++;
+                unary(dst);
+                emit(Bytecode::Op::NOT, dst, dst);
+                return;
+            }
+            primary(dst);
+        }
+
+        void primary(uint8_t dst) {
+            size_t start = pc;
+            size_t mark = chunk.code.size();
+            bool native = true;
+
+            switch (peek()) {
+            case ID::NUMBER: {
+                double value;
+                memcpy(&value, &p[pc + 1], sizeof(double));
+                pc += 1 + sizeof(double);
+                emit_constant(dst, value);
+                break;
+            }
+            case ID::INTEGER_LITERAL: {
+                int value;
+                memcpy(&value, &p[pc + 1], sizeof(int));
+                pc += 1 + sizeof(int);
+                emit_constant(dst, value);
+                break;
+            }
+            case ID::STRING:
+                pc++;
+                emit_constant(dst, read_name());
+                break;
+            case ID::JD_TRUE:
+                pc++;
+                emit_constant(dst, true);
+                break;
+            case ID::JD_FALSE:
+                pc++;
+                emit_constant(dst, false);
+                break;
+            case ID::VARIANT:
+            case ID::INT:
+            case ID::STRVAR: {
+                pc++;
+                std::string name = StringUtils::to_upper(read_name());
+                if (name.find('.') != std::string::npos) { native = false; break; }
+                chunk.variables.push_back({ name });
+                emit(Bytecode::Op::LOAD_VAR, dst, 0, 0, static_cast<uint32_t>(chunk.variables.size() - 1));
+                break;
+            }
+            case ID::C_LEFTPAREN:
+                pc++;
+                expression(dst);
+                if (!ok) return;
+                if (peek() != ID::C_RIGHTPAREN) { ok = false; return; }
+                pc++;
+                break;
+            default:
+                native = false;
+                break;
+            }
+
+            // Accessors ([..], {..}, .member) on the value are handled by parse_primary.
+            ID next = peek();
+            if (native && next != ID::C_LEFTBRACKET && next != ID::C_LEFTBRACE && next != ID::C_DOT) return;
+
+            chunk.code.resize(mark);
+            pc = start;
+            if (!skip_primary()) { ok = false; return; }
+            emit(Bytecode::Op::EVAL_PRIMARY, dst, 0, 0, static_cast<uint32_t>(start));
+        }
+
+        // Skips a balanced (..), [..] or {..} group, including nested groups.
+        bool skip_group() {
+            int depth = 0;
+            while (pc < p.size()) {
+                ID token = peek();
+                if (token == ID::C_CR) return false;
+                if (token == ID::C_LEFTPAREN || token == ID::C_LEFTBRACKET || token == ID::C_LEFTBRACE) depth++;
+                else if (token == ID::C_RIGHTPAREN || token == ID::C_RIGHTBRACKET || token == ID::C_RIGHTBRACE) depth--;
+                pc += Bytecode::token_length(p, pc);
+                if (depth == 0) return true;
+                if (depth < 0) return false;
+            }
+            return false;
+        }
+
+        // Finds the end of a primary that is delegated to parse_primary().
+        bool skip_primary() {
+            switch (peek()) {
+            case ID::NUMBER:
+            case ID::INTEGER_LITERAL:
+            case ID::STRING:
+            case ID::VARIANT:
+            case ID::INT:
+            case ID::STRVAR:
+            case ID::CONSTANT:
+            case ID::FUNCREF:
+            case ID::THIS_KEYWORD:
+            case ID::JD_TRUE:
+            case ID::JD_FALSE:
+                pc += Bytecode::token_length(p, pc);
+                break;
+            case ID::THREAD:
+                pc++;
+                if (peek() != ID::CALLFUNC) return false;
+                [[fallthrough]];
+            case ID::CALLFUNC:
+            case ID::OP_START_TASK:
+                pc += Bytecode::token_length(p, pc);
+                if (peek() == ID::C_LEFTPAREN && !skip_group()) return false;
+                break;
+            case ID::C_LEFTPAREN:
+            case ID::C_LEFTBRACKET:
+            case ID::C_LEFTBRACE:
+                if (!skip_group()) return false;
+                break;
+            default:
+                return false;
+            }
+
+            while (true) {
+                ID accessor = peek();
+                if (accessor == ID::C_LEFTBRACKET || accessor == ID::C_LEFTBRACE) {
+                    if (!skip_group()) return false;
+                }
+                else if (accessor == ID::C_DOT) {
+                    pc++;
+                    ID member = peek();
+                    if (member != ID::VARIANT && member != ID::INT && member != ID::STRVAR && member != ID::CALLFUNC) return false;
+                    pc += Bytecode::token_length(p, pc);
+                    if (peek() == ID::C_LEFTPAREN && !skip_group()) return false;
+                }
+                else break;
+            }
+            return pc < p.size();
+        }
+    };
+}
+
+bool Bytecode::compile_expression(const std::vector<uint8_t>& p_code, uint32_t start, Chunk& out) {
+    if (start >= p_code.size()) return false;
+    Lowering lowering(p_code, start, out);
+    if (!lowering.run()) return false;
+
+    // Operands are evaluated into registers above R0 and never read R0, so in this
+    // shape the additions to R0 can be replayed once all operands are known.
+    out.appends_to_variable = out.code.size() > 1 && out.code[0].op == Op::LOAD_VAR && out.code[0].dst == 0;
+    bool any_add = false;
+    for (size_t i = 1; i < out.code.size() && out.appends_to_variable; ++i) {
+        const Instr& in = out.code[i];
+        if (in.dst != 0) continue;
+        if (in.op == Op::ADD && in.a == 0) any_add = true;
+        else out.appends_to_variable = false;
+    }
+    out.appends_to_variable = out.appends_to_variable && any_add;
+    return true;
+}
@@ -59,7 +59,7 @@ namespace { // Use an anonymous namespace to keep this helper local to this file
         for (size_t i = 0; i < arr.shape[current_dimension]; ++i) {
             if (is_innermost_vector) {
                 if (data_index < arr.data.size()) {
-                    ss << value_to_string_for_array(arr.data[data_index++]);
+                    ss << value_to_string_for_array(arr.data.get(data_index++));
                 }
             }
             else {
@@ -82,9 +82,9 @@ namespace { // Use an anonymous namespace to keep this helper local to this file
 
         for (size_t i = 0; i < arr.shape[current_dimension]; ++i) {
             if (is_innermost_vector) {
-                if (data_index < arr.data.size()) {
-                    // Directly convert the double to string using the main to_string
-                    ss << to_string(arr.data[data_index++]);
+                if (data_index < arr.count()) {
+                    // Directly convert the value (double or float) to string using the main to_string
+                    ss << to_string(arr.at(data_index++));
                 }
             }
             else {
@@ -101,7 +101,7 @@ namespace { // Use an anonymous namespace to keep this helper local to this file
 
     // Wrapper for FloatArray to_string conversion
     std::string float_array_to_string(const FloatArray& arr) {
-        if (arr.shape.empty() || arr.data.empty()) {
+        if (arr.shape.empty() || arr.count() == 0) {
             return "[]";
         }
         size_t data_idx = 0;
@@ -125,15 +125,37 @@ std::string read_string(NeReLaBasic& vm) {
     return s;
 }
 
+const Bytecode::Symbol& read_symbol(NeReLaBasic& vm) {
+    const uint32_t at = vm.pcode;
+    const auto& p_code = *vm.active_p_code;
+    auto operand = [&] {
+        auto end = std::find(p_code.begin() + at, p_code.end(), uint8_t{ 0 });
+        return std::string_view(reinterpret_cast<const char*>(p_code.data()) + at, end - (p_code.begin() + at));
+    };
+    const Bytecode::Symbol* sym;
+    if (Bytecode::CodeUnit* unit = vm.find_code_unit()) {
+        uint32_t& id = unit->symbol[at];
+        if (id == 0) id = vm.symbols.intern(operand());
+        sym = &vm.symbols[id];
+    }
+    else {
+        // REPL lines and EXECUTE snippets have no unit; their symbols live only
+        // as long as the snippet runs.
+        auto& pool = vm.snippet_symbols[&p_code].first;
+        sym = &pool[pool.intern(operand())];
+    }
+    vm.pcode = at + sym->length;
+    return *sym;
+}
+
 
 // Finds a variable by walking the call stack backwards, then checking globals.
 BasicValue& get_variable(NeReLaBasic& vm, const std::string& name) {
     // 1. Search backwards through the call stack for the variable.
-    if (!vm.call_stack.empty()) {
-        for (auto it = vm.call_stack.rbegin(); it != vm.call_stack.rend(); ++it) {
-            if (it->local_variables.count(name)) {
-                return it->local_variables.at(name);
-            }
+    // Each frame resolves the name to a slot of its function's layout.
+    for (auto it = vm.call_stack.rbegin(); it != vm.call_stack.rend(); ++it) {
+        if (BasicValue* local = it->local_variables.find(name)) {
+            return *local;
         }
     }
 
@@ -151,8 +173,8 @@ void set_variable(NeReLaBasic& vm, const std::string& name, const BasicValue& va
     if (!vm.call_stack.empty()) {
         // First, check if a LOCAL variable with this name already exists in the current scope.
         // This is important for loops or multiple assignments to the same local variable.
-        if (vm.call_stack.back().local_variables.count(name)) {
-            vm.call_stack.back().local_variables[name] = value;
+        if (BasicValue* local = vm.call_stack.back().local_variables.find(name)) {
+            *local = value;
             return;
         }
 
@@ -203,7 +225,7 @@ std::string to_string(const BasicValue& val) {
             ss << arg;
             return ss.str();
         }
-        else if constexpr (std::is_same_v<T, std::string>) {
+        else if constexpr (std::is_same_v<T, BasicString>) {
             return arg;
         }
         else if constexpr (std::is_same_v<T, FunctionRef>) {
@@ -268,7 +290,7 @@ std::string to_string(const BasicValue& val) {
                 return "<Null JSON>";
             }
             // Use the nlohmann::json pretty-printer (dump)
-            return arg->data.dump(2); // dump with an indent of 2 spaces
+            return arg->value().dump(2); // dump with an indent of 2 spaces
         }
         else if constexpr (std::is_same_v<T, std::shared_ptr<Map>>) {
             // --- CASE for handling std::shared_ptr<Map> ---
@@ -421,13 +443,19 @@ BasicValue create_default_instance(NeReLaBasic& vm, const std::string& type_name
     }
 
     // Check if it's a User-Defined Type
-    if (vm.user_defined_types.count(type_name_str_upper)) {
-        const auto& type_info = vm.user_defined_types.at(type_name_str_upper);
-        auto udt_instance = std::make_shared<Map>();
-
-        udt_instance->type_name_if_udt = type_name_str_upper;
+    auto type_it = vm.user_defined_types.find(type_name_str_upper);
+    if (type_it != vm.user_defined_types.end()) {
+        auto& type_info = type_it->second;
+        if (!type_info.layout) {
+            type_info.layout = std::make_shared<MapKeys>();
+            for (const auto& member_pair : type_info.members) {
+                type_info.layout->add(member_pair.second.name, MapKeys::hash(member_pair.second.name));
+            }
+        }
 
-        // Initialize all members to their default values
+        // Initialize all members to their default values, in layout order.
+        std::vector<BasicValue> member_values;
+        member_values.reserve(type_info.members.size());
         for (const auto& member_pair : type_info.members) {
             const auto& member_info = member_pair.second;
             BasicValue member_default_val;
@@ -439,8 +467,12 @@ BasicValue create_default_instance(NeReLaBasic& vm, const std::string& type_name
             case DataType::MAP:      member_default_val = std::make_shared<Map>(); break;
             default:                 member_default_val = 0.0; break;
             }
-            udt_instance->data[member_info.name] = member_default_val;
+            member_values.push_back(std::move(member_default_val));
         }
+
+        auto udt_instance = std::make_shared<Map>();
+        udt_instance->type_name_if_udt = type_name_str_upper;
+        udt_instance->data = MapData(type_info.layout, std::move(member_values));
         return udt_instance;
     }
 
@@ -452,7 +484,7 @@ BasicValue create_default_instance(NeReLaBasic& vm, const std::string& type_name
 void Commands::do_dim(NeReLaBasic& vm) {
     // Read the variable name first.
     Tokens::ID var_token = static_cast<Tokens::ID>((*vm.active_p_code)[vm.pcode++]);
-    std::string var_name = to_upper(read_string(vm));
+    const std::string& var_name = read_symbol(vm).name;
 
     bool is_array = false;
     std::vector<size_t> dimensions;
@@ -496,7 +528,7 @@ void Commands::do_dim(NeReLaBasic& vm) {
             // This case handles user-defined types, like T_Character.
         case Tokens::ID::VARIANT:
             // Only if the token is VARIANT do we read a string name.
-            type_name = to_upper(read_string(vm));
+            type_name = read_symbol(vm).name.str();
             break;
 
         default:
@@ -517,6 +549,28 @@ void Commands::do_dim(NeReLaBasic& vm) {
             type_name = "STRING";
         }
 
+        // Arrays of plain numbers, booleans or strings are stored unboxed.
+        if (type_name == "DOUBLE") {
+            new_array_ptr->data = ArrayData::of_doubles(std::vector<double>(total_size, 0.0));
+            set_variable(vm, var_name, new_array_ptr);
+            return;
+        }
+        if (type_name == "INTEGER") {
+            new_array_ptr->data = ArrayData::of_ints(std::vector<int>(total_size, 0));
+            set_variable(vm, var_name, new_array_ptr);
+            return;
+        }
+        if (type_name == "BOOLEAN" || type_name == "BOOL") {
+            new_array_ptr->data = ArrayData::of_bools(std::vector<uint8_t>(total_size, 0));
+            set_variable(vm, var_name, new_array_ptr);
+            return;
+        }
+        if (type_name == "STRING") {
+            new_array_ptr->data = ArrayData::of_strings(std::vector<std::string>(total_size));
+            set_variable(vm, var_name, new_array_ptr);
+            return;
+        }
+
         // Reserve memory for efficiency
         new_array_ptr->data.reserve(total_size);
 
@@ -714,7 +768,7 @@ void Commands::do_input(NeReLaBasic& vm) {
         return;
     }
     vm.pcode++;
-    std::string var_name = to_upper(read_string(vm));
+    const std::string& var_name = read_symbol(vm).name;
 
     // Read a full line of input from the user.
     std::string user_input_line;
@@ -782,7 +836,6 @@ void Commands::do_print(NeReLaBasic& vm) {
 
 void Commands::do_let(NeReLaBasic& vm) {
     static bool is_this = false;
-    std::string name = "";
     std::string member_var = "";
 
     Tokens::ID var_type_token = static_cast<Tokens::ID>((*vm.active_p_code)[vm.pcode]);
@@ -790,13 +843,12 @@ void Commands::do_let(NeReLaBasic& vm) {
     if (var_type_token == Tokens::ID::THIS_KEYWORD) {
         is_this = true;
         vm.pcode += 3;
-        name = to_upper(read_string(vm));
     }
     else {
         is_this = false;
         vm.pcode++;
-        name = to_upper(read_string(vm));
     }
+    const std::string& name = read_symbol(vm).name;
 
     //size_t dot_pos = name.find('.');
 
@@ -822,7 +874,7 @@ void Commands::do_let(NeReLaBasic& vm) {
         if (static_cast<Tokens::ID>((*vm.active_p_code)[vm.pcode]) == Tokens::ID::C_DOT) {
             vm.pcode++;
             vm.pcode++;
-            member_var = to_upper(read_string(vm));
+            member_var = read_symbol(vm).name.str();
         }
 
         if (static_cast<Tokens::ID>((*vm.active_p_code)[vm.pcode++]) != Tokens::ID::C_EQ) {
@@ -846,8 +898,9 @@ void Commands::do_let(NeReLaBasic& vm) {
         else if (std::holds_alternative<std::shared_ptr<Map>>(parent_obj)) {
             // Dot-chain case: The array is a member of a Map/UDT (e.g., Aliens.Visible[i] = 0)
             auto& map_ptr = std::get<std::shared_ptr<Map>>(parent_obj);
-            if (map_ptr && map_ptr->data.count(member_name)) {
-                array_val_ptr = &map_ptr->data.at(member_name);
+            uint32_t slot = map_ptr ? map_ptr->data.slot_of(member_name) : MapKeys::NONE;
+            if (slot != MapKeys::NONE) {
+                array_val_ptr = &map_ptr->data.slot(slot);
             }
         }
 
@@ -887,12 +940,12 @@ void Commands::do_let(NeReLaBasic& vm) {
             try {
                 size_t flat_index = arr_ptr->get_flat_index(scalar_indices);
                 if (member_var.length() > 0) {
-                    auto& map_ptr = std::get<std::shared_ptr<Map>>(arr_ptr->data[flat_index]);
+                    auto map_ptr = std::get<std::shared_ptr<Map>>(arr_ptr->data[flat_index]);
                     auto dataparent = arr_ptr->data[flat_index];
                     map_ptr->data[member_var] = value_to_assign;
                 }
                 else {
-                    arr_ptr->data[flat_index] = value_to_assign;
+                    arr_ptr->data.set(flat_index, value_to_assign);
                 }
             }
             catch (const std::exception&) {
@@ -925,7 +978,7 @@ void Commands::do_let(NeReLaBasic& vm) {
             // a. Stelle die Koordinaten fr diese Iteration zusammen
             for (size_t dim = 0; dim < index_expressions.size(); ++dim) {
                 if (std::holds_alternative<std::shared_ptr<Array>>(index_expressions[dim])) {
-                    current_coords[dim] = static_cast<size_t>(to_double(std::get<std::shared_ptr<Array>>(index_expressions[dim])->data[i]));
+                    current_coords[dim] = static_cast<size_t>(std::get<std::shared_ptr<Array>>(index_expressions[dim])->data.number(i));
                 }
                 else {
                     current_coords[dim] = static_cast<size_t>(to_double(index_expressions[dim]));
@@ -933,18 +986,18 @@ void Commands::do_let(NeReLaBasic& vm) {
             }
 
             // b. Hole den zuzuweisenden Wert
-            const BasicValue& value_to_set = rhs_is_array ? rhs_arr_ptr->data[i] : value_to_assign;
+            const BasicValue value_to_set = rhs_is_array ? rhs_arr_ptr->data.get(i) : value_to_assign;
 
             // c. Fhre die Zuweisung durch
             try {
                 size_t flat_index = arr_ptr->get_flat_index(current_coords);
                 if (member_var.length() > 0) {
-                    auto& map_ptr = std::get<std::shared_ptr<Map>>(arr_ptr->data[flat_index]);
+                    auto map_ptr = std::get<std::shared_ptr<Map>>(arr_ptr->data[flat_index]);
                     auto dataparent = arr_ptr->data[flat_index];
                     map_ptr->data[member_var] = value_to_set;
                 }
                 else {
-                    arr_ptr->data[flat_index] = value_to_set;
+                    arr_ptr->data.set(flat_index, value_to_set);
                 }
             }
             catch (const std::exception&) {
@@ -1038,6 +1091,7 @@ void Commands::do_let(NeReLaBasic& vm) {
             if (static_cast<Tokens::ID>((*vm.active_p_code)[vm.pcode++]) != Tokens::ID::C_EQ) {
                 Error::set(1, vm.runtime_current_line); return;
             }
+            if (vm.assign_by_append(name)) return; // S$ = S$ + ...
             BasicValue value_to_assign = vm.evaluate_expression();
             if (Error::get() != 0) return;
             set_variable(vm, name, value_to_assign);
@@ -1048,12 +1102,12 @@ void Commands::do_let(NeReLaBasic& vm) {
 
 void Commands::do_goto(NeReLaBasic& vm) {
     // The label name was stored as a string in the bytecode after the GOTO token.
-    std::string label_name = read_string(vm);
+    const std::string& label_name = read_symbol(vm).text;
 
     // Look up the label in the address map
     if (vm.compiler->label_addresses.count(label_name)) {
         // Found it! Set the program counter to the stored address.
-        uint16_t target_address = vm.compiler->label_addresses[label_name];
+        uint32_t target_address = vm.compiler->label_addresses[label_name];
         vm.pcode = target_address;
     }
     else {
@@ -1063,18 +1117,16 @@ void Commands::do_goto(NeReLaBasic& vm) {
 }
 
 void Commands::do_if(NeReLaBasic& vm) {
-    // The IF token has already been consumed by `statement`. `pcode` points to the 2-byte placeholder.
-    uint16_t jump_placeholder_addr = vm.pcode;
-    vm.pcode += 2; // Skip the placeholder to get to the expression.
+    // The IF token has already been consumed by `statement`. `pcode` points to the jump placeholder.
+    uint32_t jump_placeholder_addr = vm.pcode;
+    vm.pcode += PCode::ADDRESS_SIZE; // Skip the placeholder to get to the expression.
 
     BasicValue result = vm.evaluate_expression();
     if (Error::get() != 0) return;
 
     if (!to_bool(result)) {
         // Condition is false, so jump. Read the address from the placeholder.
-        uint8_t lsb = (*vm.active_p_code)[jump_placeholder_addr];
-        uint8_t msb = (*vm.active_p_code)[jump_placeholder_addr + 1];
-        vm.pcode = (msb << 8) | lsb;
+        vm.pcode = PCode::read_address(*vm.active_p_code, jump_placeholder_addr);
     }
     // If true, we do nothing and just continue execution from the current pcode.
 }
@@ -1082,10 +1134,7 @@ void Commands::do_if(NeReLaBasic& vm) {
 // Correct do_else implementation
 void Commands::do_else(NeReLaBasic& vm) {
     // ELSE is an unconditional jump. The placeholder is right after the token.
-    uint16_t jump_placeholder_addr = vm.pcode;
-    uint8_t lsb = (*vm.active_p_code)[jump_placeholder_addr];
-    uint8_t msb = (*vm.active_p_code)[jump_placeholder_addr + 1];
-    vm.pcode = (msb << 8) | lsb;
+    vm.pcode = PCode::read_address(*vm.active_p_code, vm.pcode);
 }
 
 void Commands::do_for(NeReLaBasic& vm) {
@@ -1098,7 +1147,7 @@ void Commands::do_for(NeReLaBasic& vm) {
         return;
     }
     vm.pcode++;
-    std::string var_name = read_string(vm);
+    const std::string& var_name = read_symbol(vm).text;
 
     // 2. Expect an equals sign.
     if (static_cast<Tokens::ID>((*vm.active_p_code)[vm.pcode++]) != Tokens::ID::C_EQ) {
@@ -1143,7 +1192,21 @@ void Commands::do_for(NeReLaBasic& vm) {
     loop_info.step_value = step_val;
     loop_info.loop_start_pcode = vm.pcode;
 
-    vm.for_stack.push_back(loop_info);
+    // 7. Resolve the counter to the slot set_variable just wrote, so NEXT can
+    //    step it in place. Inside a function FOR always writes a local.
+    if (vm.call_stack.empty()) {
+        loop_info.frame = NeReLaBasic::ForLoopInfo::GLOBAL;
+        loop_info.slot = vm.variables.intern(var_name);
+    }
+    else if (const SlotLayout* layout = vm.call_stack.back().local_variables.get_layout()) {
+        int32_t slot = layout->find(var_name);
+        if (slot >= 0) {
+            loop_info.frame = static_cast<uint32_t>(vm.call_stack.size() - 1);
+            loop_info.slot = static_cast<uint32_t>(slot);
+        }
+    }
+
+    vm.for_stack.push_back(std::move(loop_info));
 }
 void Commands::do_next(NeReLaBasic& vm) {
     // 1. Check if there is anything on the FOR stack.
@@ -1156,10 +1219,30 @@ void Commands::do_next(NeReLaBasic& vm) {
     NeReLaBasic::ForLoopInfo& current_loop = vm.for_stack.back();
 
     // 3. Get the loop variable's current value and increment it by the step.
-    double current_val = to_double(get_variable(vm, current_loop.variable_name));
-    current_val += current_loop.step_value;
-    set_variable(vm, current_loop.variable_name, current_val);
-    //vm.variables[current_loop.variable_name] = current_val;
+    //    A resolved counter is stepped in its slot without a lookup or a copy.
+    BasicValue* counter = nullptr;
+    if (current_loop.frame == NeReLaBasic::ForLoopInfo::GLOBAL) {
+        counter = &vm.variables.slot(current_loop.slot);
+    }
+    else if (current_loop.frame < vm.call_stack.size()) {
+        counter = &vm.call_stack[current_loop.frame].local_variables.slot(current_loop.slot);
+    }
+
+    double current_val;
+    if (!counter) {
+        current_val = to_double(get_variable(vm, current_loop.variable_name));
+        current_val += current_loop.step_value;
+        set_variable(vm, current_loop.variable_name, current_val);
+    }
+    else if (double* d = std::get_if<double>(counter)) {
+        *d += current_loop.step_value;
+        current_val = *d;
+    }
+    else {
+        // The first NEXT turns an int start value into a double, as it always has.
+        current_val = to_double(*counter) + current_loop.step_value;
+        *counter = current_val;
+    }
 
     // 4. Check if the loop is finished.
     bool loop_finished = false;
@@ -1187,10 +1270,8 @@ void Commands::do_next(NeReLaBasic& vm) {
 
 void Commands::do_func(NeReLaBasic& vm) {
     // The FUNC token was consumed by statement(). pcode points to its arguments.
-    // In our bytecode, the argument is the 2-byte address to jump to.
-    uint8_t lsb = (*vm.active_p_code)[vm.pcode++];
-    uint8_t msb = (*vm.active_p_code)[vm.pcode++];
-    uint16_t jump_over_address = (msb << 8) | lsb;
+    // In our bytecode, the argument is the address to jump to.
+    uint32_t jump_over_address = PCode::read_address(*vm.active_p_code, vm.pcode);
 
     // Set pcode to the target, skipping the entire function body.
     vm.pcode = jump_over_address;
@@ -1203,7 +1284,7 @@ void Commands::do_callfunc(NeReLaBasic& vm) {
     bool is_array_access = false;
 
     // The first string is either a function name or an object/array name.
-    std::string identifier_being_called = to_upper(read_string(vm));
+    const std::string& identifier_being_called = read_symbol(vm).name;
 
     // --- 1. Initial Parsing for Array Access ---
     // Check if this is an array element method call, e.g., NPCS[0].GetName()
@@ -1231,7 +1312,7 @@ void Commands::do_callfunc(NeReLaBasic& vm) {
         }
 
         // The next string is the method name
-        method_name = to_upper(read_string(vm));
+        method_name = read_symbol(vm).name.str();
     }
 
     // --- 2. Main Logic for Method Calls vs. Standard Function Calls ---
@@ -1264,7 +1345,7 @@ void Commands::do_callfunc(NeReLaBasic& vm) {
                 size_t flat_index = arr_ptr->get_flat_index(indices);
                 if (flat_index >= arr_ptr->data.size()) { Error::set(10, vm.runtime_current_line, "Array index out of bounds."); return; }
 
-                BasicValue& element_val = arr_ptr->data[flat_index];
+                const BasicValue element_val = arr_ptr->data[flat_index];
                 if (!std::holds_alternative<std::shared_ptr<Map>>(element_val)) {
                     Error::set(15, vm.runtime_current_line, "Array element is not an object that can have methods."); return;
                 }
@@ -1364,8 +1445,10 @@ void Commands::do_callfunc(NeReLaBasic& vm) {
             }
         }
 #else
-        // If COM is not defined, this is an error because dot notation is not supported.
-        Error::set(22, vm.runtime_current_line, "Unknown function: " + identifier_being_called);
+        } else {
+            // If COM is not defined, this is an error because dot notation is not supported.
+            Error::set(22, vm.runtime_current_line, "Unknown function: " + identifier_being_called);
+        }
 #endif
     }
     else {
@@ -1409,6 +1492,7 @@ void Commands::do_callfunc(NeReLaBasic& vm) {
         }
 
         // Unified Execution Logic
+        Profiler::NativeScope profile_scope(func_info.native_impl || func_info.native_dll_impl ? vm.profiler.get() : nullptr, vm, func_info.name);
         if (func_info.native_impl != nullptr) {
             // Call native C++ function
             func_info.native_impl(vm, args);
@@ -1497,7 +1581,7 @@ void Commands::do_callsub(NeReLaBasic& vm) {
     std::vector<size_t> indices;
     std::string object_name = "";
     std::string method_name = "";
-    std::string proc_name = to_upper(read_string(vm));
+    const std::string& proc_name = read_symbol(vm).name;
     bool func_not_found = !vm.active_function_table->count(proc_name);
     bool is_array_access = false;
 
@@ -1526,7 +1610,7 @@ void Commands::do_callsub(NeReLaBasic& vm) {
         }
         vm.pcode++; // consume '.'
         // The next string is the method name
-        method_name = to_upper(read_string(vm));
+        method_name = read_symbol(vm).name.str();
     }
 
     // --- Main Logic for Method Calls vs. Standard Procedure Calls ---
@@ -1566,7 +1650,7 @@ void Commands::do_callsub(NeReLaBasic& vm) {
                     Error::set(10, vm.runtime_current_line, "Array index out of bounds."); // Bad subscript
                     return;
                 }
-                BasicValue& element_val = arr_ptr->data[flat_index];
+                const BasicValue element_val = arr_ptr->data[flat_index];
 
                 // 3. Verify the element is an object (a Map) and get its pointer.
                 if (!std::holds_alternative<std::shared_ptr<Map>>(element_val)) {
@@ -1745,15 +1829,13 @@ void Commands::do_endsub(NeReLaBasic& vm) {
 
 // ---  Commands for TRY/CATCH ---
 void Commands::do_push_handler(NeReLaBasic& vm) {
-    // Read the two 2-byte addresses from p-code.
+    // Read the two addresses from p-code.
     // These were written by the compiler.
-    uint8_t catch_lsb = (*vm.active_p_code)[vm.pcode++];
-    uint8_t catch_msb = (*vm.active_p_code)[vm.pcode++];
-    uint16_t catch_addr = (catch_msb << 8) | catch_lsb;
+    uint32_t catch_addr = PCode::read_address(*vm.active_p_code, vm.pcode);
+    vm.pcode += PCode::ADDRESS_SIZE;
 
-    uint8_t finally_lsb = (*vm.active_p_code)[vm.pcode++];
-    uint8_t finally_msb = (*vm.active_p_code)[vm.pcode++];
-    uint16_t finally_addr = (finally_msb << 8) | finally_lsb;
+    uint32_t finally_addr = PCode::read_address(*vm.active_p_code, vm.pcode);
+    vm.pcode += PCode::ADDRESS_SIZE;
 
     // Push the handler information onto the runtime stack.
     vm.handler_stack.push_back({
@@ -1829,8 +1911,8 @@ void Commands::do_pop_handler(NeReLaBasic& vm) {
 //}
 
 void Commands::do_on(NeReLaBasic& vm) {
-    std::string event_name = to_upper(read_string(vm));
-    std::string func_name = to_upper(read_string(vm));
+    const std::string& event_name = read_symbol(vm).name;
+    const std::string& func_name = read_symbol(vm).name;
 
     if (vm.active_function_table->count(func_name)) {
         const auto& func_info = vm.active_function_table->at(func_name);
@@ -1849,7 +1931,7 @@ void Commands::do_on(NeReLaBasic& vm) {
             }
         }
         else {
-            vm.event_handlers[event_name] = func_name;
+            vm.set_event_handler(event_name, func_name, func_info);
         }
     }
     else {
@@ -1858,7 +1940,7 @@ void Commands::do_on(NeReLaBasic& vm) {
 }
 
 void Commands::do_raiseevent(NeReLaBasic& vm) {
-    std::string event_name = to_upper(read_string(vm));
+    const std::string& event_name = read_symbol(vm).name;
 
     // Evaluate the expression for the event data
     BasicValue event_data = false;
@@ -1881,9 +1963,9 @@ void Commands::do_do(NeReLaBasic& vm) {
         // This is a pre-test loop.
         Tokens::ID condition_type = static_cast<Tokens::ID>((*vm.active_p_code)[vm.pcode++]); 
 
-        // Read the 2-byte jump-past-loop address (this was the placeholder the compiler reserved)
-        uint16_t jump_target_if_false = (*vm.active_p_code)[vm.pcode] | ((*vm.active_p_code)[vm.pcode + 1] << 8);
-        vm.pcode += 2; // Consume the 2 bytes of the target address
+        // Read the jump-past-loop address (this was the placeholder the compiler reserved)
+        uint32_t jump_target_if_false = PCode::read_address(*vm.active_p_code, vm.pcode);
+        vm.pcode += PCode::ADDRESS_SIZE; // Consume the target address
 
         BasicValue condition_result = vm.evaluate_expression();
         if (Error::get() != 0) return;
@@ -1915,11 +1997,11 @@ void Commands::do_loop(NeReLaBasic& vm) {
     // Read the loop metadata written by the tokenizer
     bool is_pre_test = static_cast<bool>((*vm.active_p_code)[vm.pcode++]);
     Tokens::ID condition_type = static_cast<Tokens::ID>((*vm.active_p_code)[vm.pcode++]);
-    uint16_t loop_start_pcode_addr = (*vm.active_p_code)[vm.pcode] | ((*vm.active_p_code)[vm.pcode + 1] << 8);
-    vm.pcode += 2;
+    uint32_t loop_start_pcode_addr = PCode::read_address(*vm.active_p_code, vm.pcode);
+    vm.pcode += PCode::ADDRESS_SIZE;
 
     // For pre-test loops, the patching was done at compile time.
-    // So if it's a pre-test loop, we don't need to read an extra 2 bytes here.
+    // So if it's a pre-test loop, we don't need to read an extra address here.
     // The previous 'do_do' already handled the conditional jump.
     // This 'do_loop' for a pre-test only needs to jump back unconditionally.
 
@@ -1951,10 +2033,9 @@ void Commands::do_loop(NeReLaBasic& vm) {
 
 // Jumps execution to the address immediately following the corresponding NEXT statement.
 void Commands::do_exit_for(NeReLaBasic& vm) {
-    // Read the 2-byte jump address that was patched by the tokenizer.
-    uint8_t lsb = (*vm.active_p_code)[vm.pcode++];
-    uint8_t msb = (*vm.active_p_code)[vm.pcode++];
-    uint16_t jump_target = (msb << 8) | lsb;
+    // Read the jump address that was patched by the tokenizer.
+    uint32_t jump_target = PCode::read_address(*vm.active_p_code, vm.pcode);
+    vm.pcode += PCode::ADDRESS_SIZE;
 
     // The FOR stack for this loop is still active. We must pop it
     // to correctly clean up the loop state before jumping out.
@@ -1972,10 +2053,9 @@ void Commands::do_exit_for(NeReLaBasic& vm) {
 
 // Jumps execution to the address immediately following the corresponding LOOP statement.
 void Commands::do_exit_do(NeReLaBasic& vm) {
-    // Read the 2-byte jump address that was patched by the tokenizer.
-    uint8_t lsb = (*vm.active_p_code)[vm.pcode++];
-    uint8_t msb = (*vm.active_p_code)[vm.pcode++];
-    uint16_t jump_target = (msb << 8) | lsb;
+    // Read the jump address that was patched by the tokenizer.
+    uint32_t jump_target = PCode::read_address(*vm.active_p_code, vm.pcode);
+    vm.pcode += PCode::ADDRESS_SIZE;
 
     // The DO stack for this loop is still active. Pop it for cleanup.
     //if (!vm.do_loop_stack.empty()) {
@@ -2083,12 +2163,16 @@ void Commands::do_compile(NeReLaBasic& vm) {
 
     // Compile into the main program buffer
     TextIO::print("Compiling...\n");
-    if (vm.compiler->tokenize_program(vm,vm.program_p_code, source_to_compile) == 0) {
+    // A program loaded from a file is compiled through its cache file (see ProgramCache.hpp).
+    if (vm.compiler->tokenize_program(vm,vm.program_p_code, source_to_compile, vm.program_to_debug) == 0) {
         if (!vm.compiler->if_stack.empty()) {
             // There are unclosed IF blocks. Get the line number of the last one.
-            uint16_t error_line = vm.compiler->if_stack.back().source_line;
+            uint32_t error_line = vm.compiler->if_stack.back().source_line;
             Error::set(4, error_line); // New Error: Missing ENDIF
         }
+        else if (vm.compiler->loaded_from_cache) {
+            TextIO::print("OK. Program loaded from cache, " + std::to_string(vm.program_p_code.size()) + " bytes.\n");
+        }
         else {
             TextIO::print("OK. Program compiled to " + std::to_string(vm.program_p_code.size()) + " bytes.\n");
         }
@@ -2162,12 +2246,12 @@ void Commands::do_run(NeReLaBasic& vm) {
     do_compile(vm);
     if (!vm.compiler->do_loop_stack.empty()) {
         // There are unclosed DO loops. Get the line number of the last one.
-        uint16_t error_line = vm.compiler->do_loop_stack.back().source_line;
+        uint32_t error_line = vm.compiler->do_loop_stack.back().source_line;
         Error::set(14, error_line); // Unclosed loop
     }
     if (!vm.compiler->if_stack.empty()) {
         // There are unclosed Ifs. Get the line number of the last one.
-        uint16_t error_line = vm.compiler->if_stack.back().source_line;
+        uint32_t error_line = vm.compiler->if_stack.back().source_line;
         Error::set(4, error_line); // Unclosed for
     }
 
@@ -6,8 +6,10 @@
 #include "Statements.hpp"
 #include "StringUtils.hpp"
 #include "TextIO.hpp"
+#include "ProgramCache.hpp"
 #include <sstream>
 #include <fstream>
+#include <algorithm>
 
 static int lambda_counter = 0;
 
@@ -339,15 +341,14 @@ Tokens::ID Compiler::parse(NeReLaBasic& vm, bool is_start_of_statement) {
 
 
 
-uint8_t Compiler::tokenize(NeReLaBasic& vm, const std::string& line, uint16_t lineNumber, std::vector<uint8_t>& out_p_code, NeReLaBasic::FunctionTable& compilation_func_table, bool multiline, bool fromrepl) {
+uint8_t Compiler::tokenize(NeReLaBasic& vm, const std::string& line, uint32_t lineNumber, std::vector<uint8_t>& out_p_code, NeReLaBasic::FunctionTable& compilation_func_table, bool multiline, bool fromrepl) {
 
     vm.lineinput = line;
     vm.prgptr = 0;
 
     // Write the line number prefix for this line's bytecode.
     if (!multiline) {
-        out_p_code.push_back(lineNumber & 0xFF);
-        out_p_code.push_back((lineNumber >> 8) & 0xFF);
+        PCode::emit_line(out_p_code, lineNumber);
     }
 
     bool is_start_of_statement = true;
@@ -482,7 +483,8 @@ uint8_t Compiler::tokenize(NeReLaBasic& vm, const std::string& line, uint16_t li
                 }
 
                 info.arity = info.parameter_names.size();
-                info.start_pcode = out_p_code.size() + 3; // +3 for FUNC token and 2-byte address
+                info.start_pcode = out_p_code.size() + 1 + PCode::ADDRESS_SIZE; // skip the FUNC token and its address
+                begin_function_locals(info);
 
                 std::string final_function_name = info.name;
                 if (!this->current_type_context.empty()) {
@@ -493,9 +495,7 @@ uint8_t Compiler::tokenize(NeReLaBasic& vm, const std::string& line, uint16_t li
                 compilation_func_table[final_function_name] = info;
 
                 out_p_code.push_back(static_cast<uint8_t>(token));
-                func_stack.push_back(out_p_code.size()); // Store address of the placeholder
-                out_p_code.push_back(0); // Placeholder byte 1
-                out_p_code.push_back(0); // Placeholder byte 2
+                func_stack.push_back(PCode::emit_placeholder(out_p_code)); // Store address of the placeholder
                 vm.prgptr = vm.lineinput.length(); // The rest of the line is params, so we consume it.
                 continue;
             }
@@ -503,12 +503,12 @@ uint8_t Compiler::tokenize(NeReLaBasic& vm, const std::string& line, uint16_t li
                                  // Handle ENDFUNC: pop the stored address and patch the jump offset.
             case Tokens::ID::ENDFUNC: {
                 out_p_code.push_back(static_cast<uint8_t>(token));
+                current_locals.reset();
                 if (!func_stack.empty()) {
-                    uint16_t func_jump_addr = func_stack.back();
+                    uint32_t func_jump_addr = func_stack.back();
                     func_stack.pop_back();
-                    uint16_t jump_target = out_p_code.size();
-                    out_p_code[func_jump_addr] = jump_target & 0xFF;
-                    out_p_code[func_jump_addr + 1] = (jump_target >> 8) & 0xFF;
+                    uint32_t jump_target = out_p_code.size();
+                    PCode::patch_address(out_p_code, func_jump_addr, jump_target);
                 }
                 continue;
             }
@@ -545,7 +545,8 @@ uint8_t Compiler::tokenize(NeReLaBasic& vm, const std::string& line, uint16_t li
                 }
 
                 info.arity = info.parameter_names.size();
-                info.start_pcode = out_p_code.size() + 3; // +3 for SUB token and 2-byte address
+                info.start_pcode = out_p_code.size() + 1 + PCode::ADDRESS_SIZE; // skip the SUB token and its address
+                begin_function_locals(info);
 
                 std::string final_function_name = info.name;
                 if (!this->current_type_context.empty()) {
@@ -556,9 +557,7 @@ uint8_t Compiler::tokenize(NeReLaBasic& vm, const std::string& line, uint16_t li
 
                 // Write the SUB token and its placeholder jump address
                 out_p_code.push_back(static_cast<uint8_t>(token));
-                func_stack.push_back(out_p_code.size());
-                out_p_code.push_back(0); // Placeholder byte 1
-                out_p_code.push_back(0); // Placeholder byte 2
+                func_stack.push_back(PCode::emit_placeholder(out_p_code));
 
                 // We have processed the entire line.
                 vm.prgptr = vm.lineinput.length();
@@ -566,12 +565,12 @@ uint8_t Compiler::tokenize(NeReLaBasic& vm, const std::string& line, uint16_t li
             }
             case Tokens::ID::ENDSUB: {
                 out_p_code.push_back(static_cast<uint8_t>(token));
+                current_locals.reset();
                 if (!func_stack.empty()) {
-                    uint16_t func_jump_addr = func_stack.back();
+                    uint32_t func_jump_addr = func_stack.back();
                     func_stack.pop_back();
-                    uint16_t jump_target = out_p_code.size();
-                    out_p_code[func_jump_addr] = jump_target & 0xFF;
-                    out_p_code[func_jump_addr + 1] = (jump_target >> 8) & 0xFF;
+                    uint32_t jump_target = out_p_code.size();
+                    PCode::patch_address(out_p_code, func_jump_addr, jump_target);
                 }
                 continue;
             }
@@ -605,13 +604,11 @@ uint8_t Compiler::tokenize(NeReLaBasic& vm, const std::string& line, uint16_t li
                 continue;
             }
             case Tokens::ID::IF: {
-                // Write the IF token, then leave a 2-byte placeholder for the jump address.
+                // Write the IF token, then leave a placeholder for the jump address.
                 out_p_code.push_back(static_cast<uint8_t>(token));
                 if_stack.push_back({ 0, vm.current_source_line });
 
-                if_stack.push_back({ (uint16_t)out_p_code.size(), vm.current_source_line }); // Save address of the placeholder
-                out_p_code.push_back(0); // Placeholder byte 1
-                out_p_code.push_back(0); // Placeholder byte 2
+                if_stack.push_back({ PCode::emit_placeholder(out_p_code), vm.current_source_line }); // Save address of the placeholder
                 break; // The expression after IF will be tokenized next
             }
             case Tokens::ID::THEN: {
@@ -639,20 +636,15 @@ uint8_t Compiler::tokenize(NeReLaBasic& vm, const std::string& line, uint16_t li
 
                 // 2. Emit an unconditional jump (like ELSE) to skip to ENDIF.
                 out_p_code.push_back(static_cast<uint8_t>(Tokens::ID::ELSE));
-                if_stack.push_back({ (uint16_t)out_p_code.size(), vm.current_source_line });
-                out_p_code.push_back(0);
-                out_p_code.push_back(0);
+                if_stack.push_back({ PCode::emit_placeholder(out_p_code), vm.current_source_line });
 
                 // 3. Patch the previous IF/ELSEIF's conditional jump to land here.
-                uint16_t jump_target_for_previous_if = out_p_code.size();
-                out_p_code[previous_if_jump_info.patch_address] = jump_target_for_previous_if & 0xFF;
-                out_p_code[previous_if_jump_info.patch_address + 1] = (jump_target_for_previous_if >> 8) & 0xFF;
+                uint32_t jump_target_for_previous_if = out_p_code.size();
+                PCode::patch_address(out_p_code, previous_if_jump_info.patch_address, jump_target_for_previous_if);
 
                 // 4. Emit a conditional jump (like IF) for this ELSEIF's own condition.
                 out_p_code.push_back(static_cast<uint8_t>(Tokens::ID::IF));
-                if_stack.push_back({ (uint16_t)out_p_code.size(), vm.current_source_line });
-                out_p_code.push_back(0);
-                out_p_code.push_back(0);
+                if_stack.push_back({ PCode::emit_placeholder(out_p_code), vm.current_source_line });
 
                 break; // Continue to tokenize the condition expression.
             }
@@ -673,14 +665,11 @@ uint8_t Compiler::tokenize(NeReLaBasic& vm, const std::string& line, uint16_t li
 
                 // Now, write the ELSE token and its own placeholder for jumping past the ELSE block.
                 out_p_code.push_back(static_cast<uint8_t>(token));
-                if_stack.push_back({ (uint16_t)out_p_code.size(), vm.current_source_line }); // Push address of ELSE's placeholder
-                out_p_code.push_back(0); // Placeholder byte 1
-                out_p_code.push_back(0); // Placeholder byte 2
+                if_stack.push_back({ PCode::emit_placeholder(out_p_code), vm.current_source_line }); // Push address of ELSE's placeholder
 
                 // Go back and patch the original IF/ELSEIF's jump to point to the instruction AFTER the ELSE's placeholder.
-                uint16_t jump_target = out_p_code.size();
-                out_p_code[if_info.patch_address] = jump_target & 0xFF;
-                out_p_code[if_info.patch_address + 1] = (jump_target >> 8) & 0xFF;
+                uint32_t jump_target = out_p_code.size();
+                PCode::patch_address(out_p_code, if_info.patch_address, jump_target);
                 continue;
             }
             case Tokens::ID::ENDIF: {
@@ -688,7 +677,7 @@ uint8_t Compiler::tokenize(NeReLaBasic& vm, const std::string& line, uint16_t li
                     Error::set(1, vm.current_source_line, "A single-line IF does not use an explicit ENDIF");
                     continue;
                 }
-                uint16_t jump_target = out_p_code.size();
+                uint32_t jump_target = out_p_code.size();
                 bool marker_found = false;
 
                 while (!if_stack.empty()) {
@@ -701,8 +690,7 @@ uint8_t Compiler::tokenize(NeReLaBasic& vm, const std::string& line, uint16_t li
                     }
 
                     // Patch the placeholder to jump to the current location (after ENDIF).
-                    out_p_code[info.patch_address] = jump_target & 0xFF;
-                    out_p_code[info.patch_address + 1] = (jump_target >> 8) & 0xFF;
+                    PCode::patch_address(out_p_code, info.patch_address, jump_target);
                 }
 
                 if (!marker_found) {
@@ -760,13 +748,11 @@ uint8_t Compiler::tokenize(NeReLaBasic& vm, const std::string& line, uint16_t li
                 TryBlockInfo info;
                 info.source_line = lineNumber;
 
-                // Reserve 2 bytes for the CATCH address, store the placeholder's location.
-                info.catch_addr_placeholder = out_p_code.size();
-                out_p_code.push_back(0); out_p_code.push_back(0);
+                // Reserve the CATCH address, store the placeholder's location.
+                info.catch_addr_placeholder = PCode::emit_placeholder(out_p_code);
 
-                // Reserve 2 bytes for the FINALLY address.
-                info.finally_addr_placeholder = out_p_code.size();
-                out_p_code.push_back(0); out_p_code.push_back(0);
+                // Reserve the FINALLY address.
+                info.finally_addr_placeholder = PCode::emit_placeholder(out_p_code);
 
                 try_stack.push_back(info);
                 continue; // Continue tokenizing the contents of the TRY block.
@@ -785,13 +771,11 @@ uint8_t Compiler::tokenize(NeReLaBasic& vm, const std::string& line, uint16_t li
                 // 1. Emit an unconditional jump to skip over this CATCH block if the TRY block succeeded.
                 //    We'll patch this jump later to point to the FINALLY or ENDTRY.
                 out_p_code.push_back(static_cast<uint8_t>(Tokens::ID::ELSE)); // Re-using ELSE as a generic JUMP opcode
-                current_try.jump_to_finally_patches.push_back(out_p_code.size());
-                out_p_code.push_back(0); out_p_code.push_back(0);
+                current_try.jump_to_finally_patches.push_back(PCode::emit_placeholder(out_p_code));
 
                 // 2. The current location is the start of the CATCH block. Patch the placeholder in OP_PUSH_HANDLER.
-                uint16_t catch_addr = out_p_code.size();
-                out_p_code[current_try.catch_addr_placeholder] = catch_addr & 0xFF;
-                out_p_code[current_try.catch_addr_placeholder + 1] = (catch_addr >> 8) & 0xFF;
+                uint32_t catch_addr = out_p_code.size();
+                PCode::patch_address(out_p_code, current_try.catch_addr_placeholder, catch_addr);
 
                 continue;
             }
@@ -810,21 +794,18 @@ uint8_t Compiler::tokenize(NeReLaBasic& vm, const std::string& line, uint16_t li
                 //    Emit a jump and store its location to be patched later.
                 if (current_try.has_catch) {
                     out_p_code.push_back(static_cast<uint8_t>(Tokens::ID::ELSE));
-                    current_try.jump_to_finally_patches.push_back(out_p_code.size());
-                    out_p_code.push_back(0); out_p_code.push_back(0);
+                    current_try.jump_to_finally_patches.push_back(PCode::emit_placeholder(out_p_code));
                 }
 
                 // 2. The current location is the start of the FINALLY block.
-                uint16_t finally_addr = out_p_code.size();
+                uint32_t finally_addr = out_p_code.size();
 
                 // 3. Patch the main placeholder in OP_PUSH_HANDLER.
-                out_p_code[current_try.finally_addr_placeholder] = finally_addr & 0xFF;
-                out_p_code[current_try.finally_addr_placeholder + 1] = (finally_addr >> 8) & 0xFF;
+                PCode::patch_address(out_p_code, current_try.finally_addr_placeholder, finally_addr);
 
                 // 4. Patch all pending jumps (from the end of TRY and CATCH) to point here.
-                for (uint16_t patch_addr : current_try.jump_to_finally_patches) {
-                    out_p_code[patch_addr] = finally_addr & 0xFF;
-                    out_p_code[patch_addr + 1] = (finally_addr >> 8) & 0xFF;
+                for (uint32_t patch_addr : current_try.jump_to_finally_patches) {
+                    PCode::patch_address(out_p_code, patch_addr, finally_addr);
                 }
                 current_try.jump_to_finally_patches.clear(); // Clear them as they are now patched.
 
@@ -838,18 +819,16 @@ uint8_t Compiler::tokenize(NeReLaBasic& vm, const std::string& line, uint16_t li
                 TryBlockInfo current_try = try_stack.back();
                 try_stack.pop_back();
 
-                uint16_t end_addr = out_p_code.size();
+                uint32_t end_addr = out_p_code.size();
 
                 // If there was no FINALLY block, all pending jumps must go to the ENDTRY location.
                 if (!current_try.has_finally) {
                     // Patch the main finally_addr placeholder to point here.
-                    out_p_code[current_try.finally_addr_placeholder] = end_addr & 0xFF;
-                    out_p_code[current_try.finally_addr_placeholder + 1] = (end_addr >> 8) & 0xFF;
+                    PCode::patch_address(out_p_code, current_try.finally_addr_placeholder, end_addr);
 
                     // Patch any jumps from TRY or CATCH blocks.
-                    for (uint16_t patch_addr : current_try.jump_to_finally_patches) {
-                        out_p_code[patch_addr] = end_addr & 0xFF;
-                        out_p_code[patch_addr + 1] = (end_addr >> 8) & 0xFF;
+                    for (uint32_t patch_addr : current_try.jump_to_finally_patches) {
+                        PCode::patch_address(out_p_code, patch_addr, end_addr);
                     }
                 }
                 else {
@@ -882,11 +861,9 @@ uint8_t Compiler::tokenize(NeReLaBasic& vm, const std::string& line, uint16_t li
                     out_p_code.push_back(static_cast<uint8_t>(next_token_peek));
                     parse(vm, false); // Consume WHILE/UNTIL keyword
 
-                    // Write 2-byte placeholder for jump-past-loop.
+                    // Write a placeholder for jump-past-loop.
                     // This will be patched by the corresponding LOOP.
-                    info.condition_pcode_addr = out_p_code.size(); // Address of this placeholder 
-                    out_p_code.push_back(0); // Placeholder byte 1 (LSB)
-                    out_p_code.push_back(0); // Placeholder byte 2 (MSB)
+                    info.condition_pcode_addr = PCode::emit_placeholder(out_p_code); // Address of this placeholder
 
                     do_loop_stack.push_back(info);
                 }
@@ -938,16 +915,14 @@ uint8_t Compiler::tokenize(NeReLaBasic& vm, const std::string& line, uint16_t li
                 // Write the loop metadata for runtime (is_pre_test, condition_type, loop_start_pcode_addr)
                 out_p_code.push_back(static_cast<uint8_t>(current_do_loop_info.is_pre_test));
                 out_p_code.push_back(static_cast<uint8_t>(current_do_loop_info.condition_type)); // This will be NOCMD if no explicit condition
-                out_p_code.push_back(current_do_loop_info.loop_start_pcode_addr & 0xFF);
-                out_p_code.push_back((current_do_loop_info.loop_start_pcode_addr >> 8) & 0xFF);
+                PCode::emit_address(out_p_code, current_do_loop_info.loop_start_pcode_addr);
 
-                uint16_t jump_target = out_p_code.size(); // The address immediately after this LOOP
+                uint32_t jump_target = out_p_code.size(); // The address immediately after this LOOP
                 // *** CRITICAL PATCHING STEP ***
                 // If this was a pre-test loop (DO WHILE/UNTIL), its placeholder for jumping *past* the loop
                 // needs to be patched *now* to point to the instruction *after* the LOOP statement.
                 if (current_do_loop_info.is_pre_test && current_do_loop_info.condition_pcode_addr != 0) {
-                    out_p_code[current_do_loop_info.condition_pcode_addr] = jump_target & 0xFF;
-                    out_p_code[current_do_loop_info.condition_pcode_addr + 1] = (jump_target >> 8) & 0xFF;
+                    PCode::patch_address(out_p_code, current_do_loop_info.condition_pcode_addr, jump_target);
                 }
 
                 continue;
@@ -959,9 +934,7 @@ uint8_t Compiler::tokenize(NeReLaBasic& vm, const std::string& line, uint16_t li
                     return 1;
                 }
                 out_p_code.push_back(static_cast<uint8_t>(token));
-                compiler_for_stack.back().exit_patch_locations.push_back(out_p_code.size());
-                out_p_code.push_back(0);
-                out_p_code.push_back(0);
+                compiler_for_stack.back().exit_patch_locations.push_back(PCode::emit_placeholder(out_p_code));
                 continue;
             }
             case Tokens::ID::EXIT_DO: {
@@ -970,11 +943,8 @@ uint8_t Compiler::tokenize(NeReLaBasic& vm, const std::string& line, uint16_t li
                     return 1;
                 }
                 out_p_code.push_back(static_cast<uint8_t>(token));
-                // Add current location to the patch list for the current DO loop
-                do_loop_stack.back().exit_patch_locations.push_back(out_p_code.size());
-                // Write a 2-byte placeholder
-                out_p_code.push_back(0);
-                out_p_code.push_back(0);
+                // Write a placeholder and add it to the patch list for the current DO loop
+                do_loop_stack.back().exit_patch_locations.push_back(PCode::emit_placeholder(out_p_code));
                 continue;
             }
             case Tokens::ID::FOR: {
@@ -1011,12 +981,11 @@ uint8_t Compiler::tokenize(NeReLaBasic& vm, const std::string& line, uint16_t li
                 out_p_code.push_back(static_cast<uint8_t>(token));
 
                 // Now, get the address AFTER the NEXT token. This is the correct jump target for EXITFOR.
-                uint16_t exit_jump_target = out_p_code.size();
+                uint32_t exit_jump_target = out_p_code.size();
 
                 // Patch all pending EXIT FOR locations for this loop to jump past the NEXT command.
-                for (uint16_t patch_addr : loop_info.exit_patch_locations) {
-                    out_p_code[patch_addr] = exit_jump_target & 0xFF;
-                    out_p_code[patch_addr + 1] = (exit_jump_target >> 8) & 0xFF;
+                for (uint32_t patch_addr : loop_info.exit_patch_locations) {
+                    PCode::patch_address(out_p_code, patch_addr, exit_jump_target);
                 }
 
                 compiler_for_stack.pop_back();
@@ -1095,7 +1064,7 @@ uint8_t Compiler::tokenize(NeReLaBasic& vm, const std::string& line, uint16_t li
                     }
                 }
                 info.arity = info.parameter_names.size();
-                info.start_pcode = 0xFFFF; // Mark as unpatched for Pass 2
+                info.start_pcode = PCode::UNPATCHED; // Mark as unpatched for Pass 2
                 compilation_func_table[hidden_name] = info;
 
                 // 6. Add this lambda to the "pending work" list for Pass 2.
@@ -1121,6 +1090,10 @@ uint8_t Compiler::tokenize(NeReLaBasic& vm, const std::string& line, uint16_t li
                     token == Tokens::ID::FUNCREF || token == Tokens::ID::ARRAY_ACCESS || token == Tokens::ID::MAP_ACCESS ||
                     token == Tokens::ID::CALLFUNC || token == Tokens::ID::CONSTANT || token == Tokens::ID::STRVAR)
                 {
+                    if (token == Tokens::ID::VARIANT || token == Tokens::ID::STRVAR ||
+                        token == Tokens::ID::ARRAY_ACCESS || token == Tokens::ID::MAP_ACCESS) {
+                        intern_identifier(vm, vm.buffer);
+                    }
                     out_p_code.push_back(static_cast<uint8_t>(token));
                     for (char c : vm.buffer) out_p_code.push_back(c);
                     out_p_code.push_back(0);
@@ -1164,18 +1137,16 @@ uint8_t Compiler::tokenize(NeReLaBasic& vm, const std::string& line, uint16_t li
     if (loop_to_patch_ptr) {
         // Now, out_p_code contains the fully tokenized line, including the LOOP's condition.
         // The current size is the correct address for jumping past the loop.
-        uint16_t after_loop_addr = out_p_code.size();
+        uint32_t after_loop_addr = out_p_code.size();
 
         // Patch any EXITDO jumps that were found inside this loop.
-        for (uint16_t patch_addr : loop_to_patch_ptr->exit_patch_locations) {
-            out_p_code[patch_addr] = after_loop_addr & 0xFF;
-            out_p_code[patch_addr + 1] = (after_loop_addr >> 8) & 0xFF;
+        for (uint32_t patch_addr : loop_to_patch_ptr->exit_patch_locations) {
+            PCode::patch_address(out_p_code, patch_addr, after_loop_addr);
         }
 
         // Patch the pre-test jump for a DO WHILE/UNTIL ... LOOP
         if (loop_to_patch_ptr->is_pre_test && loop_to_patch_ptr->condition_pcode_addr != 0) {
-            out_p_code[loop_to_patch_ptr->condition_pcode_addr] = after_loop_addr & 0xFF;
-            out_p_code[loop_to_patch_ptr->condition_pcode_addr + 1] = (after_loop_addr >> 8) & 0xFF;
+            PCode::patch_address(out_p_code, loop_to_patch_ptr->condition_pcode_addr, after_loop_addr);
         }
 
         // Now that patching is complete, pop the loop info from the stack.
@@ -1188,9 +1159,8 @@ uint8_t Compiler::tokenize(NeReLaBasic& vm, const std::string& line, uint16_t li
             IfStackInfo placeholder_info = if_stack.back();
             if_stack.pop_back();
 
-            uint16_t jump_target = out_p_code.size();
-            out_p_code[placeholder_info.patch_address] = jump_target & 0xFF;
-            out_p_code[placeholder_info.patch_address + 1] = (jump_target >> 8) & 0xFF;
+            uint32_t jump_target = out_p_code.size();
+            PCode::patch_address(out_p_code, placeholder_info.patch_address, jump_target);
 
             if (!if_stack.empty() && if_stack.back().patch_address == 0) {
                 if_stack.pop_back();
@@ -1206,12 +1176,12 @@ uint8_t Compiler::tokenize(NeReLaBasic& vm, const std::string& line, uint16_t li
         if (!pending_lambdas.empty()) {
             for (const auto& lambda_to_compile : pending_lambdas) {
                 // The start address is the current end of the p-code vector.
-                uint16_t lambda_start_address = out_p_code.size();
+                uint32_t lambda_start_address = out_p_code.size();
 
                 // Update the FunctionInfo with the correct start address.
                 if (compilation_func_table.count(lambda_to_compile.name)) {
-                    // Point it to just after the FUNC token and its 2-byte placeholder.
-                    compilation_func_table.at(lambda_to_compile.name).start_pcode = lambda_start_address + 5;
+                    // Point it to just after the line number, the FUNC token and its placeholder.
+                    compilation_func_table.at(lambda_to_compile.name).start_pcode = lambda_start_address + PCode::LINE_PREFIX_SIZE + 1 + PCode::ADDRESS_SIZE;
                 }
 
                 // Compile the lambda's source and append its bytecode directly.
@@ -1231,7 +1201,7 @@ _dreckig:
 
 }
 
-bool Compiler::compile_module(NeReLaBasic& vm, const std::string& module_name, const std::string& module_source_code) {
+bool Compiler::compile_module(NeReLaBasic& vm, const std::string& module_name, const std::string& module_source_code, const std::string& module_path) {
     // The entire body of the original compile_module function goes here.
     // Replace member access with 'vm.' or direct member access as appropriate.
     // e.g., 'this->tokenize_program(...)'
@@ -1247,13 +1217,17 @@ bool Compiler::compile_module(NeReLaBasic& vm, const std::string& module_name, c
 
     // 1. Create the entry for the new module to hold its data.
     vm.compiled_modules[module_name] = NeReLaBasic::BasicModule{ module_name };
+    vm.compiled_modules[module_name].source_hash = ProgramCache::hash_source(module_source_code);
 
     // 2. Tokenize the module's source, telling the function where to put the results.
     // We pass the module's own p_code vector and function_table by reference.
-    if (this->tokenize_program(vm, vm.compiled_modules[module_name].p_code, module_source_code) != 0) {
+    if (this->tokenize_program(vm, vm.compiled_modules[module_name].p_code, module_source_code, module_path) != 0) {
         Error::set(1, 0); // General compilation error
         return false;
     }
+    else if (loaded_from_cache) {
+        TextIO::print("OK. Modul loaded from cache, " + std::to_string(vm.compiled_modules[module_name].p_code.size()) + " bytes.\n");
+    }
     else {
         TextIO::print("OK. Modul compiled to " + std::to_string(vm.compiled_modules[module_name].p_code.size()) + " bytes.\n");
     }
@@ -1353,11 +1327,11 @@ void Compiler::pre_scan_and_parse_types(NeReLaBasic& vm) {
     }
 }
 
-uint8_t Compiler::tokenize_lambda(NeReLaBasic& vm, std::vector<uint8_t>& out_p_code, const std::string& source, NeReLaBasic::FunctionTable& compilation_func_table, uint16_t start_line) {
+uint8_t Compiler::tokenize_lambda(NeReLaBasic& vm, std::vector<uint8_t>& out_p_code, const std::string& source, NeReLaBasic::FunctionTable& compilation_func_table, uint32_t start_line) {
     std::string line;
     std::stringstream source_stream(source);
 
-    uint16_t current_lambda_line = start_line; // Use a local line counter for this compilation
+    uint32_t current_lambda_line = start_line; // Use a local line counter for this compilation
     bool multiline = false;
 
     while (std::getline(source_stream, line)) {
@@ -1371,12 +1345,37 @@ uint8_t Compiler::tokenize_lambda(NeReLaBasic& vm, std::vector<uint8_t>& out_p_c
     return 0;
 }
 
+// Gives a variable name its global slot and, inside a FUNC/SUB, its local slot.
+// Member paths ("P.X") are resolved through their base variable.
+void Compiler::intern_identifier(NeReLaBasic& vm, const std::string& name) {
+    std::string base = StringUtils::to_upper(name.substr(0, name.find('.')));
+    if (base.empty()) return;
+    vm.variables.intern(base);
+    if (current_locals) current_locals->intern(base);
+}
+
+// Starts the local layout of a FUNC/SUB. The parameters are interned first so
+// that they occupy slots 0..arity-1, which is how calls bind their arguments.
+// A function that repeats a parameter name keeps binding by name.
+void Compiler::begin_function_locals(NeReLaBasic::FunctionInfo& info) {
+    current_locals = std::make_shared<SlotLayout>();
+    for (const auto& param : info.parameter_names) {
+        if (current_locals->intern(param) != current_locals->size() - 1) {
+            current_locals.reset();
+            break;
+        }
+    }
+    info.locals = current_locals;
+}
+
 uint8_t Compiler::tokenize_snippet(NeReLaBasic& vm, std::vector<uint8_t>& out_p_code, const std::string& source_snippet) {
     // --- 1. Save the current state of the compiler's stacks ---
     auto saved_if_stack = if_stack;
     auto saved_func_stack = func_stack;
     auto saved_do_loop_stack = do_loop_stack;
     auto saved_compiler_for_stack = compiler_for_stack;
+    auto saved_current_locals = current_locals;
+    vm.program_generation++; // the snippet may add functions; THREAD workers must re-copy
     // Note: We don't save/restore label_addresses or pending_lambdas,
     // as they should be scoped to this snippet only.
 
@@ -1385,6 +1384,7 @@ uint8_t Compiler::tokenize_snippet(NeReLaBasic& vm, std::vector<uint8_t>& out_p_
     func_stack.clear();
     do_loop_stack.clear();
     compiler_for_stack.clear();
+    current_locals.reset();
     // Clear any temporary structures from previous compilations
     label_addresses.clear();
     pending_lambdas.clear();
@@ -1392,11 +1392,11 @@ uint8_t Compiler::tokenize_snippet(NeReLaBasic& vm, std::vector<uint8_t>& out_p_
     // --- 3. Compile the snippet line by line ---
     std::stringstream source_stream(source_snippet);
     std::string line;
-    uint16_t line_num = 1;
+    uint32_t line_num = 1;
     bool is_multiline = false;
     uint8_t error_code = 0;
 
-    //out_p_code.push_back(0); out_p_code.push_back(0);
+    //PCode::emit_line(out_p_code, 0);
 
     while (std::getline(source_stream, line)) {
         is_multiline = tokenize(vm, line, line_num++, out_p_code, *vm.active_function_table, is_multiline, false);
@@ -1413,7 +1413,7 @@ uint8_t Compiler::tokenize_snippet(NeReLaBasic& vm, std::vector<uint8_t>& out_p_
     }
 
     // Finalize the snippet's p-code
-    out_p_code.push_back(0); out_p_code.push_back(0);
+    PCode::emit_line(out_p_code, 0);
     out_p_code.push_back(static_cast<uint8_t>(Tokens::ID::NOCMD));
 
 
@@ -1422,43 +1422,65 @@ uint8_t Compiler::tokenize_snippet(NeReLaBasic& vm, std::vector<uint8_t>& out_p_
     func_stack = saved_func_stack;
     do_loop_stack = saved_do_loop_stack;
     compiler_for_stack = saved_compiler_for_stack;
+    current_locals = saved_current_locals;
 
     return error_code;
 }
 
-uint8_t Compiler::tokenize_program(NeReLaBasic& vm, std::vector<uint8_t>& out_p_code, const std::string& source) {
+uint8_t Compiler::tokenize_program(NeReLaBasic& vm, std::vector<uint8_t>& out_p_code, const std::string& source, const std::string& source_path) {
+    vm.program_generation++; // THREAD workers must re-copy the program
     out_p_code.clear();
     if_stack.clear();
     func_stack.clear();
+    current_locals.reset();
     label_addresses.clear();
     do_loop_stack.clear();
     pending_lambdas.clear();
 
     vm.source_code = source; // Store source for pre-scanning
 
+    // 1. A fresh cache file stands in for the pre-scans and the compilation (steps 7-9).
+    std::string cache_path;
+    uint64_t source_hash = 0;
+    ProgramCache::Unit cached;
+    bool from_cache = false;
+    if (!source_path.empty()) {
+        cache_path = ProgramCache::path_for(source_path);
+        source_hash = ProgramCache::hash_source(source);
+        from_cache = ProgramCache::load(cache_path, source_hash, cached);
+    }
+
     //  Pre-scan for TYPE definitions
     vm.user_defined_types.clear();
-    this->pre_scan_and_parse_types(vm);
+    if (from_cache) vm.user_defined_types = std::move(cached.types);
+    else this->pre_scan_and_parse_types(vm);
 
     // 2. Pre-scan to find imports and determine if we are a module
     is_compiling_module = false;
     current_module_name = "";
     std::vector<std::string> modules_to_import;
-    std::stringstream pre_scan_stream(source);
     std::string line;
-    while (std::getline(pre_scan_stream, line)) {
-        StringUtils::trim(line);
-        std::string line_upper = StringUtils::to_upper(line);
-        if (line_upper.rfind("EXPORT MODULE", 0) == 0) {
-            is_compiling_module = true;
-            std::string temp = line_upper.substr(13);
-            StringUtils::trim(temp);
-            current_module_name = temp;
-        }
-        else if (line_upper.rfind("IMPORT", 0) == 0) {
-            std::string temp = line_upper.substr(6);
-            StringUtils::trim(temp);
-            modules_to_import.push_back(temp);
+    if (from_cache) {
+        is_compiling_module = cached.is_module;
+        current_module_name = cached.module_name;
+        modules_to_import = cached.imports;
+    }
+    else {
+        std::stringstream pre_scan_stream(source);
+        while (std::getline(pre_scan_stream, line)) {
+            StringUtils::trim(line);
+            std::string line_upper = StringUtils::to_upper(line);
+            if (line_upper.rfind("EXPORT MODULE", 0) == 0) {
+                is_compiling_module = true;
+                std::string temp = line_upper.substr(13);
+                StringUtils::trim(temp);
+                current_module_name = temp;
+            }
+            else if (line_upper.rfind("IMPORT", 0) == 0) {
+                std::string temp = line_upper.substr(6);
+                StringUtils::trim(temp);
+                modules_to_import.push_back(temp);
+            }
         }
     }
 
@@ -1485,12 +1507,14 @@ uint8_t Compiler::tokenize_program(NeReLaBasic& vm, std::vector<uint8_t>& out_p_
         for (const auto& mod_name : modules_to_import) {
             if (vm.compiled_modules.count(mod_name)) continue;
             std::string filename = mod_name + ".jdb";
+            std::string mod_path = filename;
             std::ifstream mod_file(filename);
             if (!mod_file) { 
                 std::filesystem::path program_path(vm.program_to_debug);
                 std::filesystem::path module_path = program_path.parent_path() / filename;
 
                 mod_file.open(module_path); // Attempt to open the file at the new path
+                mod_path = module_path.string();
 
                 if (!mod_file) {
                     Error::set(6, 0);
@@ -1500,13 +1524,25 @@ uint8_t Compiler::tokenize_program(NeReLaBasic& vm, std::vector<uint8_t>& out_p_
             }
             std::stringstream buffer;
             buffer << mod_file.rdbuf();
-            if (!compile_module(vm, mod_name, buffer.str())) {
+            if (!compile_module(vm, mod_name, buffer.str(), mod_path)) {
                 TextIO::print("? Error: Failed to compile module: " + mod_name + "\n");
                 return 1;
             }
         }
         is_compiling_module = false;
         current_module_name = "";
+
+        // The cached p-code was compiled against the modules as they were then.
+        if (from_cache) {
+            for (size_t i = 0; i < modules_to_import.size(); ++i) {
+                auto mod = vm.compiled_modules.find(modules_to_import[i]);
+                if (i >= cached.import_hashes.size() || mod == vm.compiled_modules.end() ||
+                    mod->second.source_hash != cached.import_hashes[i]) {
+                    from_cache = false;
+                    break;
+                }
+            }
+        }
     }
 
     // 6. LINK FIRST, if this is the main program
@@ -1522,90 +1558,128 @@ uint8_t Compiler::tokenize_program(NeReLaBasic& vm, std::vector<uint8_t>& out_p_
             }
         }
     }
-    // 7. Main compilation loop
-    std::stringstream source_stream(source);
-    vm.current_source_line = 1;
-    bool skipping_type_block = false;
-
-    int multiline = false;
-    bool in_type_definition_block = false;
-    this->in_method_block = false;
-
-    while (std::getline(source_stream, line)) {
-        // Prepare to inspect the line
-        std::string trimmed_line = line;
-        StringUtils::trim(trimmed_line);
-        if (trimmed_line.empty() || trimmed_line[0] == '\'') {
-            vm.current_source_line++;
-            continue;
-        }
-        std::string first_word = trimmed_line.substr(0, trimmed_line.find(' '));
-        first_word = StringUtils::to_upper(first_word);
+    if (from_cache) {
+        // Steps 7-9 from the cache file.
+        out_p_code = std::move(cached.p_code);
+        for (auto& [name, info] : cached.functions) (*target_func_table)[name] = std::move(info);
+        label_addresses = std::move(cached.labels);
+    }
+    else {
+        // 7. Main compilation loop
+        std::stringstream source_stream(source);
+        vm.current_source_line = 1;
+        bool skipping_type_block = false;
+
+        int multiline = false;
+        bool in_type_definition_block = false;
+        this->in_method_block = false;
+
+        while (std::getline(source_stream, line)) {
+            // Prepare to inspect the line
+            std::string trimmed_line = line;
+            StringUtils::trim(trimmed_line);
+            if (trimmed_line.empty() || trimmed_line[0] == '\'') {
+                vm.current_source_line++;
+                continue;
+            }
+            std::string first_word = trimmed_line.substr(0, trimmed_line.find(' '));
+            first_word = StringUtils::to_upper(first_word);
 
-        bool line_should_be_tokenized = false;
+            bool line_should_be_tokenized = false;
 
-        if (in_type_definition_block) {
-            // --- We are INSIDE a TYPE...ENDTYPE block ---
-            if (first_word == "SUB" || first_word == "FUNC") {
-                this->in_method_block = true;
-                line_should_be_tokenized = true; // Tokenize the start of the method
-            }
-            else if (first_word == "ENDSUB" || first_word == "ENDFUNC") {
-                this->in_method_block = false;
-                line_should_be_tokenized = true; // Tokenize the end of the method
-            }
-            else if (this->in_method_block) {
-                line_should_be_tokenized = true; // This is the method's body, tokenize it!
-            }
-            else if (first_word == "ENDTYPE") {
-                in_type_definition_block = false;
-                this->current_type_context = "";
-                //line_should_be_tokenized = true; // Tokenize ENDTYPE to patch jumps
-            }
-            // If none of the above, it's a data member line (e.g., "Name AS STRING"), so we SKIP it.
-            // line_should_be_tokenized remains false.
-        }
-        else {
-            // --- We are OUTSIDE a TYPE...ENDTYPE block ---
-            if (first_word == "TYPE") {
-                in_type_definition_block = true;
-                std::stringstream ss(trimmed_line);
-                std::string keyword, type_name;
-                ss >> keyword >> type_name;
-                this->current_type_context = StringUtils::to_upper(type_name);
-                //line_should_be_tokenized = true; // Tokenize TYPE to create the skippable block
+            if (in_type_definition_block) {
+                // --- We are INSIDE a TYPE...ENDTYPE block ---
+                if (first_word == "SUB" || first_word == "FUNC") {
+                    this->in_method_block = true;
+                    line_should_be_tokenized = true; // Tokenize the start of the method
+                }
+                else if (first_word == "ENDSUB" || first_word == "ENDFUNC") {
+                    this->in_method_block = false;
+                    line_should_be_tokenized = true; // Tokenize the end of the method
+                }
+                else if (this->in_method_block) {
+                    line_should_be_tokenized = true; // This is the method's body, tokenize it!
+                }
+                else if (first_word == "ENDTYPE") {
+                    in_type_definition_block = false;
+                    this->current_type_context = "";
+                    //line_should_be_tokenized = true; // Tokenize ENDTYPE to patch jumps
+                }
+                // If none of the above, it's a data member line (e.g., "Name AS STRING"), so we SKIP it.
+                // line_should_be_tokenized remains false.
             }
             else {
-                // This is regular global code.
-                line_should_be_tokenized = true;
+                // --- We are OUTSIDE a TYPE...ENDTYPE block ---
+                if (first_word == "TYPE") {
+                    in_type_definition_block = true;
+                    std::stringstream ss(trimmed_line);
+                    std::string keyword, type_name;
+                    ss >> keyword >> type_name;
+                    this->current_type_context = StringUtils::to_upper(type_name);
+                    //line_should_be_tokenized = true; // Tokenize TYPE to create the skippable block
+                }
+                else {
+                    // This is regular global code.
+                    line_should_be_tokenized = true;
+                }
+            }
+
+            if (line_should_be_tokenized) {
+                multiline = tokenize(vm, line, vm.current_source_line, out_p_code, *target_func_table, multiline);
+                if (multiline > 1) { /* error handling */ }
             }
-        }
 
-        if (line_should_be_tokenized) {
-            multiline = tokenize(vm, line, vm.current_source_line, out_p_code, *target_func_table, multiline);
-            if (multiline > 1) { /* error handling */ }
+            vm.current_source_line++;
         }
 
-        vm.current_source_line++;
-    }
+        // 8. *** COMPILE PENDING LAMBDAS (PASS 2) ***
+        for (const auto& lambda_to_compile : pending_lambdas) {
+            // The start address for this lambda's code is the current size of the main p-code buffer.
+            uint32_t lambda_start_address = out_p_code.size();
 
-    // 8. *** COMPILE PENDING LAMBDAS (PASS 2) ***
-    for (const auto& lambda_to_compile : pending_lambdas) {
-        // The start address for this lambda's code is the current size of the main p-code buffer.
-        uint16_t lambda_start_address = out_p_code.size();
+            // Update the FunctionInfo that was created during Pass 1.
+            if (target_func_table->count(lambda_to_compile.name)) {
+                target_func_table->at(lambda_to_compile.name).start_pcode = lambda_start_address + PCode::LINE_PREFIX_SIZE + 1 + PCode::ADDRESS_SIZE; //skip the line number and the func tocen and the jump address!
+            }
 
-        // Update the FunctionInfo that was created during Pass 1.
-        if (target_func_table->count(lambda_to_compile.name)) {
-            target_func_table->at(lambda_to_compile.name).start_pcode = lambda_start_address+5; //skip the line number and the func tocen and the jump address!
+            // Now, compile the lambda's source and append its bytecode to the end of the main buffer.
+            tokenize_lambda(vm, out_p_code, lambda_to_compile.source_code, *target_func_table, lambda_to_compile.source_line);
         }
 
-        // Now, compile the lambda's source and append its bytecode to the end of the main buffer.
-        tokenize_lambda(vm, out_p_code, lambda_to_compile.source_code, *target_func_table, lambda_to_compile.source_line);
+        // 9. Finalize p_code and linking
+        PCode::emit_line(out_p_code, 0);
+        out_p_code.push_back(static_cast<uint8_t>(Tokens::ID::NOCMD));
+
+        // Cache the unit unless it failed to compile. Built-ins are registered
+        // fresh on every run and imported functions come from the modules' own
+        // cache files, so only this unit's own functions are written.
+        if (!cache_path.empty() && Error::get() == 0 && if_stack.empty() && func_stack.empty() &&
+            do_loop_stack.empty() && compiler_for_stack.empty() && try_stack.empty()) {
+            ProgramCache::Unit unit;
+            unit.is_module = is_compiling_module;
+            unit.module_name = current_module_name;
+            unit.imports = modules_to_import;
+            for (const auto& mod_name : modules_to_import) {
+                auto mod = vm.compiled_modules.find(mod_name);
+                unit.import_hashes.push_back(mod != vm.compiled_modules.end() ? mod->second.source_hash : 0);
+            }
+            unit.p_code = out_p_code;
+            for (const auto& [name, info] : *target_func_table) {
+                if (info.native_impl || info.native_dll_impl) continue;
+                bool linked = std::any_of(modules_to_import.begin(), modules_to_import.end(),
+                    [&](const std::string& mod_name) { return name.rfind(mod_name + ".", 0) == 0; });
+                if (!linked) unit.functions[name] = info;
+            }
+            unit.types = vm.user_defined_types;
+            unit.labels = label_addresses;
+            ProgramCache::save(cache_path, source_hash, unit);
+        }
     }
 
-    // 9. Finalize p_code and linking
-    out_p_code.push_back(0); out_p_code.push_back(0);
-    out_p_code.push_back(static_cast<uint8_t>(Tokens::ID::NOCMD));
+    // 10. Register the buffer for the bytecode stage. Expressions are lowered to
+    // register code the first time they are evaluated (see Bytecode.hpp).
+    vm.code_units[&out_p_code].reset(out_p_code.size());
+    vm.cached_unit_p_code = nullptr;
 
     if (!is_compiling_module) {
         // If we just compiled the main program, link the imported functions.
@@ -1623,5 +1697,6 @@ uint8_t Compiler::tokenize_program(NeReLaBasic& vm, std::vector<uint8_t>& out_p_
     }
 
     vm.active_function_table = previous_active_table;
+    loaded_from_cache = from_cache;
     return 0;
 }
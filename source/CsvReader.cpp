@@ -0,0 +1,275 @@
+// CsvReader.cpp
+#include "CsvReader.hpp"
+#include <charconv>
+#include <cstring>
+#include <algorithm>
+#include <thread>
+
+namespace {
+    constexpr size_t BLOCK_SIZE = 16 * 1024 * 1024;
+    constexpr size_t MIN_PIECE_SIZE = 1024 * 1024; // below this a block is not worth splitting further
+
+    bool is_space(char c) { return c == ' ' || c == '\t'; }
+
+    // Parses the whole field (surrounding blanks allowed) as a number.
+    bool parse_number(const char* begin, const char* end, double& out) {
+        while (begin < end && is_space(*begin)) ++begin;
+        while (end > begin && is_space(end[-1])) --end;
+        if (begin < end && *begin == '+') {
+            ++begin;
+            if (begin < end && *begin == '-') return false; // "+-5"
+        }
+        if (begin == end) return false;
+        auto [ptr, ec] = std::from_chars(begin, end, out);
+        return ec == std::errc() && ptr == end;
+    }
+
+    bool is_blank(const char* begin, const char* end) {
+        while (begin < end && is_space(*begin)) ++begin;
+        return begin == end;
+    }
+}
+
+CsvReader::CsvReader(char delimiter, bool has_header)
+    : delimiter(delimiter), skip_header(has_header) {}
+
+bool CsvReader::open(const std::string& filename) {
+    file.open(filename, std::ios::binary);
+    return static_cast<bool>(file);
+}
+
+bool CsvReader::at_end() const {
+    if (!file_done || !carry.empty()) return false;
+    for (size_t i = next_piece; i < block.pieces.size(); ++i) {
+        if (block.pieces[i].rows > (i == next_piece ? next_row : 0)) return false;
+    }
+    return true;
+}
+
+// Splits the lines in block.text[begin, end) into cells. Quoted fields are
+// unescaped in place, which never makes them longer.
+void CsvReader::parse_piece(size_t begin, size_t end, Piece& piece) {
+    char* base = block.text.data();
+    char* p = base + begin;
+    char* const stop = base + end;
+
+    while (p < stop) {
+        char* line_end = static_cast<char*>(std::memchr(p, '\n', stop - p));
+        if (!line_end) line_end = stop;
+        char* le = line_end;
+        if (le > p && le[-1] == '\r') --le;
+
+        if (!is_blank(p, le)) {
+            size_t fields = 0;
+            char* q = p;
+            while (true) {
+                char* field = q;
+                char* field_end;
+                if (q < le && *q == '"') {
+                    char* w = q;
+                    char* r = q + 1;
+                    while (r < le) {
+                        if (*r == '"') {
+                            if (r + 1 < le && r[1] == '"') { *w++ = '"'; r += 2; continue; }
+                            ++r;
+                            break;
+                        }
+                        *w++ = *r++;
+                    }
+                    field_end = w;
+                    while (r < le && *r != delimiter) ++r; // anything after the closing quote is dropped
+                    q = r;
+                }
+                else {
+                    while (q < le && *q != delimiter) ++q;
+                    field_end = q;
+                }
+
+                Cell cell{};
+                cell.offset = static_cast<uint32_t>(field - base);
+                cell.length = static_cast<uint32_t>(field_end - field);
+                cell.blank = is_blank(field, field_end);
+                cell.numeric = !cell.blank && parse_number(field, field_end, cell.number);
+                if (!cell.numeric) cell.number = 0.0;
+                piece.cells.push_back(cell);
+                ++fields;
+
+                if (q < le && *q == delimiter) { ++q; continue; }
+                break;
+            }
+
+            if (piece.rows == 0) piece.width = fields;
+            else if (fields != piece.width && piece.bad_row == SIZE_MAX) {
+                piece.bad_row = piece.rows;
+                piece.bad_width = fields;
+            }
+            piece.rows++;
+        }
+        p = line_end + 1;
+    }
+}
+
+// Reads and parses the next block. Returns false at the end of the file or on a
+// malformed row (with 'error' set).
+bool CsvReader::load_block(std::string& error) {
+    block.pieces.clear();
+    next_piece = 0;
+    next_row = 0;
+
+    while (!(file_done && carry.empty())) {
+        std::string text = std::move(carry);
+        carry.clear();
+        if (!file_done) {
+            size_t old_size = text.size();
+            text.resize(old_size + BLOCK_SIZE);
+            file.read(text.data() + old_size, BLOCK_SIZE);
+            size_t got = static_cast<size_t>(file.gcount());
+            text.resize(old_size + got);
+            if (got < BLOCK_SIZE) file_done = true;
+
+            if (!file_done) {
+                size_t last_newline = text.rfind('\n');
+                if (last_newline == std::string::npos) { carry = std::move(text); continue; } // a very long line
+                carry.assign(text, last_newline + 1, std::string::npos);
+                text.resize(last_newline + 1);
+            }
+        }
+
+        size_t start = 0;
+        if (at_file_start) {
+            at_file_start = false;
+            if (text.compare(0, 3, "\xEF\xBB\xBF") == 0) start = 3; // UTF-8 byte order mark
+            if (skip_header) {
+                size_t header_end = text.find('\n', start);
+                start = header_end == std::string::npos ? text.size() : header_end + 1;
+            }
+        }
+
+        // Cut the block into one piece per thread, each ending on a line boundary.
+        block.text = std::move(text);
+        size_t size = block.text.size() - start;
+        size_t threads = std::max<size_t>(1, std::thread::hardware_concurrency());
+        size_t piece_count = std::max<size_t>(1, std::min(threads, size / MIN_PIECE_SIZE));
+        std::vector<size_t> bounds{ start };
+        for (size_t i = 1; i < piece_count; ++i) {
+            size_t cut = std::max(bounds.back(), start + size * i / piece_count);
+            size_t newline = block.text.find('\n', cut);
+            bounds.push_back(newline == std::string::npos ? block.text.size() : newline + 1);
+        }
+        bounds.push_back(block.text.size());
+
+        block.pieces.assign(piece_count, Piece{});
+#pragma omp parallel for schedule(dynamic)
+        for (long long i = 0; i < static_cast<long long>(piece_count); ++i) {
+            parse_piece(bounds[i], bounds[i + 1], block.pieces[i]);
+        }
+
+        // Every row must have as many fields as the first row of the file.
+        for (const auto& piece : block.pieces) {
+            if (piece.rows == 0) continue;
+            if (!types_known && width == 0) width = piece.width;
+            if (piece.width != width || piece.bad_row != SIZE_MAX) {
+                size_t row = piece.width != width ? 0 : piece.bad_row;
+                size_t fields = piece.width != width ? piece.width : piece.bad_width;
+                error = "Row " + std::to_string(rows_parsed + row + 1) + " has " + std::to_string(fields) +
+                    " fields, expected " + std::to_string(width) + ".";
+                block.pieces.clear();
+                return false;
+            }
+            rows_parsed += piece.rows;
+        }
+
+        if (width > 0) infer_column_types();
+        for (const auto& piece : block.pieces) {
+            if (piece.rows > 0) return true;
+        }
+    }
+    block.pieces.clear();
+    return false;
+}
+
+// Marks every column with a non-numeric cell in the current block as text. Runs
+// for every block: a column that was numeric so far widens to text when a later
+// block has text in it.
+void CsvReader::infer_column_types() {
+    if (!types_known) text_column.assign(width, 0);
+    for (const auto& piece : block.pieces) {
+        for (size_t i = 0; i < piece.cells.size(); ++i) {
+            const Cell& cell = piece.cells[i];
+            if (!cell.numeric && !cell.blank) text_column[i % width] = 1;
+        }
+    }
+    any_text = std::find(text_column.begin(), text_column.end(), 1) != text_column.end();
+    all_text = std::find(text_column.begin(), text_column.end(), 0) == text_column.end();
+    types_known = true;
+}
+
+std::shared_ptr<Array> CsvReader::read(size_t max_rows, std::string& error) {
+    std::vector<double> numbers;
+    std::vector<std::string> texts;
+    std::vector<BasicValue> mixed;
+    size_t rows = 0;
+
+    // How the rows are collected. If a column widens to text after rows of an
+    // all-numeric file were read, those rows move to boxed values and keep their numbers.
+    enum class Store { NUMBERS, TEXTS, MIXED };
+    auto wanted_store = [this] { return !any_text ? Store::NUMBERS : all_text ? Store::TEXTS : Store::MIXED; };
+    Store store = Store::NUMBERS;
+
+    while (max_rows == 0 || rows < max_rows) {
+        while (next_piece < block.pieces.size() && next_row >= block.pieces[next_piece].rows) {
+            next_piece++;
+            next_row = 0;
+        }
+        if (next_piece >= block.pieces.size()) {
+            if (!load_block(error)) {
+                if (!error.empty()) return nullptr;
+                break;
+            }
+            continue;
+        }
+
+        const Piece& piece = block.pieces[next_piece];
+        size_t take = piece.rows - next_row;
+        if (max_rows != 0) take = std::min(take, max_rows - rows);
+
+        const Cell* cells = piece.cells.data() + next_row * width;
+        size_t count = take * width;
+        auto cell_text = [this](const Cell& cell) { return std::string(block.text.data() + cell.offset, cell.length); };
+
+        if (rows == 0) store = wanted_store();
+        else if (store == Store::NUMBERS && wanted_store() != Store::NUMBERS) {
+            mixed.reserve(numbers.size() + count);
+            for (double number : numbers) mixed.push_back(number);
+            std::vector<double>().swap(numbers);
+            store = Store::MIXED;
+        }
+
+        if (store == Store::NUMBERS) {
+            size_t old_size = numbers.size();
+            numbers.resize(old_size + count);
+            for (size_t i = 0; i < count; ++i) numbers[old_size + i] = cells[i].number;
+        }
+        else if (store == Store::TEXTS) {
+            texts.reserve(texts.size() + count);
+            for (size_t i = 0; i < count; ++i) texts.push_back(cell_text(cells[i]));
+        }
+        else {
+            mixed.reserve(mixed.size() + count);
+            for (size_t i = 0; i < count; ++i) {
+                if (text_column[i % width]) mixed.push_back(cell_text(cells[i]));
+                else mixed.push_back(cells[i].number);
+            }
+        }
+        rows += take;
+        next_row += take;
+    }
+
+    auto result_ptr = std::make_shared<Array>();
+    result_ptr->shape = { rows, width };
+    if (rows == 0) store = wanted_store();
+    if (store == Store::NUMBERS) result_ptr->data = ArrayData::of_doubles(std::move(numbers));
+    else if (store == Store::TEXTS) result_ptr->data = ArrayData::of_strings(std::move(texts));
+    else result_ptr->data = std::move(mixed);
+    return result_ptr;
+}
@@ -11,7 +11,7 @@ namespace {
     // These variables hold the current error state.
     // They are in an anonymous namespace, making them accessible only within this file.
     uint8_t current_error_code = 0;
-    uint16_t error_line_number = 0;
+    uint32_t error_line_number = 0;
     std::string custom_error_message = ""; // NEW: For custom error messages.
 
     // A table of error messages. We can expand this as we go.
@@ -47,7 +47,7 @@ namespace {
     };
 }
 
-void Error::set(uint8_t errorCode, uint16_t lineNumber, const std::string& customMessage) {
+void Error::set(uint8_t errorCode, uint32_t lineNumber, const std::string& customMessage) {
     if (g_vm_instance_ptr == nullptr) {
         current_error_code = errorCode;
         error_line_number = lineNumber;
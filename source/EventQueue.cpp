@@ -0,0 +1,90 @@
+// EventQueue.cpp
+#include "EventQueue.hpp"
+#include <algorithm>
+
+EventQueue::EventQueue() {
+    // Same order as the enum in the header.
+    for (const char* name : { "QUIT", "KEYDOWN", "KEYUP", "KEYPRESS", "MOUSEMOVE", "MOUSEDOWN", "MOUSEUP" }) {
+        intern(name);
+    }
+    set_priority(QUIT, Priority::HIGH);
+    set_priority(MOUSEMOVE, Priority::LOW);
+    set_coalesce(MOUSEMOVE, true);
+}
+
+EventQueue::EventId EventQueue::intern(const std::string& name) {
+    auto it = ids.find(name);
+    if (it != ids.end()) return it->second;
+    EventId id = static_cast<EventId>(types.size());
+    ids.emplace(name, id);
+    types.push_back({ name });
+    return id;
+}
+
+void EventQueue::drop_front(size_t level) {
+    Event& victim = levels[level].front();
+    Type& type = types[victim.id];
+    if (type.pending_seq == victim.seq) type.pending_seq = 0;
+    levels[level].pop_front();
+    count--;
+    stats.dropped++;
+}
+
+bool EventQueue::push(EventId id, BasicValue data) {
+    Type& type = types[id];
+    size_t level = static_cast<size_t>(type.priority);
+    stats.raised++;
+
+    // A coalesced type keeps at most one event waiting; the newest payload wins.
+    if (type.coalesce && type.pending_seq != 0) {
+        auto& queue = levels[level];
+        auto it = std::lower_bound(queue.begin(), queue.end(), type.pending_seq,
+            [](const Event& e, uint64_t seq) { return e.seq < seq; });
+        if (it != queue.end() && it->seq == type.pending_seq) {
+            it->data = std::move(data);
+            stats.coalesced++;
+            return true;
+        }
+        type.pending_seq = 0;
+    }
+
+    if (full()) {
+        if (overflow == Overflow::DROP_NEWEST) {
+            stats.dropped++;
+            return false;
+        }
+        size_t victim_level = LEVELS;
+        while (victim_level > 0 && levels[victim_level - 1].empty()) victim_level--;
+        if (victim_level == 0 || level > victim_level - 1) {
+            stats.dropped++; // everything waiting outranks the new event
+            return false;
+        }
+        drop_front(victim_level - 1);
+    }
+
+    uint64_t seq = next_seq++;
+    levels[level].push_back({ id, std::move(data), seq });
+    if (type.coalesce) type.pending_seq = seq;
+    count++;
+    stats.high_water = std::max(stats.high_water, count);
+    return true;
+}
+
+bool EventQueue::pop(Event& out) {
+    for (auto& queue : levels) {
+        if (queue.empty()) continue;
+        out = std::move(queue.front());
+        queue.pop_front();
+        count--;
+        Type& type = types[out.id];
+        if (type.pending_seq == out.seq) type.pending_seq = 0;
+        return true;
+    }
+    return false;
+}
+
+void EventQueue::clear() {
+    for (auto& queue : levels) queue.clear();
+    for (auto& type : types) type.pending_seq = 0;
+    count = 0;
+}
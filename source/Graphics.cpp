@@ -122,7 +122,7 @@ bool Graphics::handle_events(NeReLaBasic& vm) {
         switch (event.type) {
             case SDL_EVENT_QUIT:
                 quit_event_received = true;
-                vm.raise_event("QUIT", true);
+                vm.raise_event(EventQueue::QUIT, true);
                 break;
 
             case SDL_EVENT_TEXT_INPUT: {
@@ -135,7 +135,7 @@ bool Graphics::handle_events(NeReLaBasic& vm) {
                 }
                 auto text_data = std::make_shared<Map>();
                 text_data->data["text"] = std::string(event.text.text);
-                vm.raise_event("KEYPRESS", text_data);
+                vm.raise_event(EventQueue::KEYPRESS, text_data);
                 break;
             }
                 // --- Capture keydown for non-text keys like ESC ---
@@ -148,7 +148,7 @@ bool Graphics::handle_events(NeReLaBasic& vm) {
                 key_data->data["scancode"] = static_cast<double>(event.key.scancode);
                 key_data->data["keycode"] = static_cast<double>(event.key.key);
                 key_data->data["repeat"] = static_cast<bool>(event.key.repeat);
-                vm.raise_event("KEYDOWN", key_data);
+                vm.raise_event(EventQueue::KEYDOWN, key_data);
                 break;
             }
             case SDL_EVENT_KEY_UP: {
@@ -156,17 +156,20 @@ bool Graphics::handle_events(NeReLaBasic& vm) {
                 key_data->data["scancode"] = static_cast<double>(event.key.scancode);
                 key_data->data["keycode"] = static_cast<double>(event.key.key);
                 key_data->data["repeat"] = static_cast<bool>(event.key.repeat);
-                vm.raise_event("KEYUP", key_data);
+                vm.raise_event(EventQueue::KEYUP, key_data);
                 break;
             }
                 // --- Handle mouse events ---
             case SDL_EVENT_MOUSE_MOTION: {
-                auto mouse_data = std::make_shared<Map>();
-                mouse_data->data["x"] = static_cast<double>(event.motion.x);
-                mouse_data->data["y"] = static_cast<double>(event.motion.y);
-                mouse_data->data["xrel"] = static_cast<double>(event.motion.xrel);
-                mouse_data->data["yrel"] = static_cast<double>(event.motion.yrel);
-                vm.raise_event("MOUSEMOVE", mouse_data);
+                // Motion arrives in floods; skip building the payload if nobody listens.
+                if (vm.has_event_handler(EventQueue::MOUSEMOVE)) {
+                    auto mouse_data = std::make_shared<Map>();
+                    mouse_data->data["x"] = static_cast<double>(event.motion.x);
+                    mouse_data->data["y"] = static_cast<double>(event.motion.y);
+                    mouse_data->data["xrel"] = static_cast<double>(event.motion.xrel);
+                    mouse_data->data["yrel"] = static_cast<double>(event.motion.yrel);
+                    vm.raise_event(EventQueue::MOUSEMOVE, mouse_data);
+                }
                 mouse_x = event.motion.x;
                 mouse_y = event.motion.y;
                 break;
@@ -179,7 +182,7 @@ bool Graphics::handle_events(NeReLaBasic& vm) {
                 mouse_data->data["x"] = static_cast<double>(event.button.x);
                 mouse_data->data["y"] = static_cast<double>(event.button.y);
                 mouse_data->data["clicks"] = static_cast<double>(event.button.clicks);
-                vm.raise_event("MOUSEDOWN", mouse_data);
+                vm.raise_event(EventQueue::MOUSEDOWN, mouse_data);
                 mouse_button_state = SDL_GetMouseState(NULL, NULL);
                 break;
             }
@@ -190,7 +193,7 @@ bool Graphics::handle_events(NeReLaBasic& vm) {
                 mouse_data->data["button"] = static_cast<double>(event.button.button);
                 mouse_data->data["x"] = static_cast<double>(event.button.x);
                 mouse_data->data["y"] = static_cast<double>(event.button.y);
-                vm.raise_event("MOUSEUP", mouse_data);
+                vm.raise_event(EventQueue::MOUSEUP, mouse_data);
                 mouse_button_state = SDL_GetMouseState(NULL, NULL);
                 break;
             }
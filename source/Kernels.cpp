@@ -0,0 +1,479 @@
+// Kernels.cpp
+#include "Kernels.hpp"
+#include <cmath>
+#include <vector>
+#include <algorithm>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define KERNELS_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#else
+#define KERNELS_X86 0
+#endif
+
+// GCC and Clang only emit AVX instructions inside functions that ask for them,
+// which keeps the rest of the binary runnable on older CPUs. MSVC needs nothing.
+#if KERNELS_X86 && (defined(__GNUC__) || defined(__clang__))
+#define KERNELS_AVX2 __attribute__((target("avx2,fma")))
+#define KERNELS_SSE2 __attribute__((target("sse2")))
+#else
+#define KERNELS_AVX2
+#define KERNELS_SSE2
+#endif
+
+namespace {
+    enum class Level { SCALAR, SSE2, AVX2 };
+
+    Level detect_level() {
+#if KERNELS_X86
+#ifdef _MSC_VER
+        int info[4];
+        __cpuid(info, 0);
+        if (info[0] >= 7) {
+            __cpuid(info, 1);
+            bool fma = (info[2] & (1 << 12)) != 0;
+            bool osxsave = (info[2] & (1 << 27)) != 0;
+            bool avx = (info[2] & (1 << 28)) != 0;
+            // The OS must also save the YMM registers on a context switch.
+            if (fma && osxsave && avx && (_xgetbv(0) & 6) == 6) {
+                __cpuidex(info, 7, 0);
+                if (info[1] & (1 << 5)) return Level::AVX2;
+            }
+        }
+        return Level::SSE2;
+#else
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) return Level::AVX2;
+        if (__builtin_cpu_supports("sse2")) return Level::SSE2;
+        return Level::SCALAR;
+#endif
+#else
+        return Level::SCALAR;
+#endif
+    }
+
+    Level level() {
+        static const Level detected = detect_level();
+        return detected;
+    }
+
+    // --- Scalar code: the reference results and the loop tails ---
+
+    bool compare_scalar(Kernels::Compare op, double a, double b) {
+        switch (op) {
+        case Kernels::Compare::EQ: return a == b;
+        case Kernels::Compare::NE: return a != b;
+        case Kernels::Compare::LT: return a < b;
+        case Kernels::Compare::GT: return a > b;
+        case Kernels::Compare::LE: return a <= b;
+        default: return a >= b;
+        }
+    }
+
+    void binary_scalar(Kernels::Binary op, const double* a, size_t as, const double* b, size_t bs, double* out, size_t from, size_t n) {
+        for (size_t i = from; i < n; ++i) out[i] = Kernels::binary(op, a[i * as], b[i * bs]);
+    }
+
+    void compare_scalar(Kernels::Compare op, const double* a, size_t as, const double* b, size_t bs, uint8_t* out, size_t from, size_t n) {
+        for (size_t i = from; i < n; ++i) out[i] = compare_scalar(op, a[i * as], b[i * bs]) ? 1 : 0;
+    }
+
+    void unary_scalar(Kernels::Unary op, const double* in, double* out, size_t from, size_t n) {
+        for (size_t i = from; i < n; ++i) out[i] = Kernels::unary(op, in[i]);
+    }
+
+#if KERNELS_X86
+    // --- AVX2: four doubles per step. Each returns how far it got. ---
+
+    KERNELS_AVX2 size_t binary_avx2(Kernels::Binary op, const double* a, size_t as, const double* b, size_t bs, double* out, size_t n) {
+        size_t i = 0;
+        for (; i + 4 <= n; i += 4) {
+            __m256d x = as ? _mm256_loadu_pd(a + i) : _mm256_broadcast_sd(a);
+            __m256d y = bs ? _mm256_loadu_pd(b + i) : _mm256_broadcast_sd(b);
+            __m256d r;
+            switch (op) {
+            case Kernels::Binary::ADD: r = _mm256_add_pd(x, y); break;
+            case Kernels::Binary::SUB: r = _mm256_sub_pd(x, y); break;
+            case Kernels::Binary::MUL: r = _mm256_mul_pd(x, y); break;
+            default: r = _mm256_div_pd(x, y); break;
+            }
+            _mm256_storeu_pd(out + i, r);
+        }
+        return i;
+    }
+
+    KERNELS_AVX2 size_t compare_avx2(Kernels::Compare op, const double* a, size_t as, const double* b, size_t bs, uint8_t* out, size_t n) {
+        size_t i = 0;
+        for (; i + 4 <= n; i += 4) {
+            __m256d x = as ? _mm256_loadu_pd(a + i) : _mm256_broadcast_sd(a);
+            __m256d y = bs ? _mm256_loadu_pd(b + i) : _mm256_broadcast_sd(b);
+            __m256d r;
+            switch (op) {
+            case Kernels::Compare::EQ: r = _mm256_cmp_pd(x, y, _CMP_EQ_OQ); break;
+            case Kernels::Compare::NE: r = _mm256_cmp_pd(x, y, _CMP_NEQ_UQ); break;
+            case Kernels::Compare::LT: r = _mm256_cmp_pd(x, y, _CMP_LT_OQ); break;
+            case Kernels::Compare::GT: r = _mm256_cmp_pd(x, y, _CMP_GT_OQ); break;
+            case Kernels::Compare::LE: r = _mm256_cmp_pd(x, y, _CMP_LE_OQ); break;
+            default: r = _mm256_cmp_pd(x, y, _CMP_GE_OQ); break;
+            }
+            int mask = _mm256_movemask_pd(r);
+            out[i] = mask & 1;
+            out[i + 1] = (mask >> 1) & 1;
+            out[i + 2] = (mask >> 2) & 1;
+            out[i + 3] = (mask >> 3) & 1;
+        }
+        return i;
+    }
+
+    KERNELS_AVX2 size_t unary_avx2(Kernels::Unary op, const double* in, double* out, size_t n) {
+        const __m256d zero = _mm256_setzero_pd();
+        const __m256d sign = _mm256_set1_pd(-0.0);
+        size_t i = 0;
+        for (; i + 4 <= n; i += 4) {
+            __m256d x = _mm256_loadu_pd(in + i);
+            __m256d r;
+            switch (op) {
+            // max(0, x) keeps NaN and -0.0, exactly like (x < 0) ? 0 : sqrt(x).
+            case Kernels::Unary::SQRT: r = _mm256_sqrt_pd(_mm256_max_pd(zero, x)); break;
+            case Kernels::Unary::ABS: r = _mm256_andnot_pd(sign, x); break;
+            case Kernels::Unary::FLOOR: r = _mm256_round_pd(x, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC); break;
+            case Kernels::Unary::CEIL: r = _mm256_round_pd(x, _MM_FROUND_TO_POS_INF | _MM_FROUND_NO_EXC); break;
+            default: r = _mm256_round_pd(x, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC); break;
+            }
+            _mm256_storeu_pd(out + i, r);
+        }
+        return i;
+    }
+
+    // --- SSE2: two doubles per step. ---
+
+    KERNELS_SSE2 size_t binary_sse2(Kernels::Binary op, const double* a, size_t as, const double* b, size_t bs, double* out, size_t n) {
+        size_t i = 0;
+        for (; i + 2 <= n; i += 2) {
+            __m128d x = as ? _mm_loadu_pd(a + i) : _mm_set1_pd(*a);
+            __m128d y = bs ? _mm_loadu_pd(b + i) : _mm_set1_pd(*b);
+            __m128d r;
+            switch (op) {
+            case Kernels::Binary::ADD: r = _mm_add_pd(x, y); break;
+            case Kernels::Binary::SUB: r = _mm_sub_pd(x, y); break;
+            case Kernels::Binary::MUL: r = _mm_mul_pd(x, y); break;
+            default: r = _mm_div_pd(x, y); break;
+            }
+            _mm_storeu_pd(out + i, r);
+        }
+        return i;
+    }
+
+    KERNELS_SSE2 size_t compare_sse2(Kernels::Compare op, const double* a, size_t as, const double* b, size_t bs, uint8_t* out, size_t n) {
+        size_t i = 0;
+        for (; i + 2 <= n; i += 2) {
+            __m128d x = as ? _mm_loadu_pd(a + i) : _mm_set1_pd(*a);
+            __m128d y = bs ? _mm_loadu_pd(b + i) : _mm_set1_pd(*b);
+            __m128d r;
+            switch (op) {
+            case Kernels::Compare::EQ: r = _mm_cmpeq_pd(x, y); break;
+            case Kernels::Compare::NE: r = _mm_cmpneq_pd(x, y); break;
+            case Kernels::Compare::LT: r = _mm_cmplt_pd(x, y); break;
+            case Kernels::Compare::GT: r = _mm_cmpgt_pd(x, y); break;
+            case Kernels::Compare::LE: r = _mm_cmple_pd(x, y); break;
+            default: r = _mm_cmpge_pd(x, y); break;
+            }
+            int mask = _mm_movemask_pd(r);
+            out[i] = mask & 1;
+            out[i + 1] = (mask >> 1) & 1;
+        }
+        return i;
+    }
+
+    KERNELS_SSE2 size_t unary_sse2(Kernels::Unary op, const double* in, double* out, size_t n) {
+        const __m128d zero = _mm_setzero_pd();
+        const __m128d sign = _mm_set1_pd(-0.0);
+        size_t i = 0;
+        for (; i + 2 <= n; i += 2) {
+            __m128d x = _mm_loadu_pd(in + i);
+            __m128d r = op == Kernels::Unary::SQRT ? _mm_sqrt_pd(_mm_max_pd(zero, x)) : _mm_andnot_pd(sign, x);
+            _mm_storeu_pd(out + i, r);
+        }
+        return i;
+    }
+#endif
+
+    // --- GEMM ---
+    // The classic packed layout: a KC-deep slice of A is copied into MR-row
+    // micro-panels and the matching slice of B into NR-column micro-panels, both
+    // zero-padded, so the micro-kernel streams through contiguous memory. A
+    // micro-panel of B (KC x NR) stays in L1 while it meets an MC-row block of A
+    // (MC x KC) that stays in L2. Everything is templated on the element type;
+    // a micro-panel row of B is two vectors wide, 8 doubles or 16 floats.
+    constexpr size_t GEMM_MR = 6;
+    template <typename T> constexpr size_t GEMM_NR = 64 / sizeof(T);
+    constexpr size_t GEMM_MC = 72;   // a multiple of MR
+    constexpr size_t GEMM_KC = 256;
+    constexpr size_t GEMM_NC = 4096; // columns of B packed at a time
+    constexpr size_t GEMM_TILE_N = 128; // C tile width handed to one thread, a multiple of NR
+
+    template <typename T>
+    void gemm_pack_a(bool trans, const T* a, size_t lda, size_t row0, size_t rows, size_t p0, size_t depth, T* out) {
+        for (size_t ir = 0; ir < rows; ir += GEMM_MR) {
+            size_t mr = std::min(GEMM_MR, rows - ir);
+            for (size_t p = 0; p < depth; ++p) {
+                for (size_t r = 0; r < GEMM_MR; ++r) {
+                    size_t i = row0 + ir + r;
+                    *out++ = r >= mr ? T(0) : (trans ? a[(p0 + p) * lda + i] : a[i * lda + p0 + p]);
+                }
+            }
+        }
+    }
+
+    template <typename T>
+    void gemm_pack_b(bool trans, const T* b, size_t ldb, size_t p0, size_t depth, size_t col0, size_t cols, T* out) {
+        constexpr size_t NR = GEMM_NR<T>;
+        for (size_t jr = 0; jr < cols; jr += NR) {
+            size_t nr = std::min(NR, cols - jr);
+            T* panel = out + jr * depth;
+            for (size_t p = 0; p < depth; ++p) {
+                for (size_t c = 0; c < NR; ++c) {
+                    size_t j = col0 + jr + c;
+                    panel[p * NR + c] = c >= nr ? T(0) : (trans ? b[j * ldb + p0 + p] : b[(p0 + p) * ldb + j]);
+                }
+            }
+        }
+    }
+
+    // Multiplies one packed MR x KC panel of A with one packed KC x NR panel of B
+    // into a full MR x NR block of C (stored, or added with 'add').
+    template <typename T>
+    void gemm_micro_scalar(size_t depth, const T* ap, const T* bp, T* c, size_t ldc, bool add) {
+        constexpr size_t NR = GEMM_NR<T>;
+        T acc[GEMM_MR][NR] = {};
+        for (size_t p = 0; p < depth; ++p, ap += GEMM_MR, bp += NR) {
+            for (size_t r = 0; r < GEMM_MR; ++r) {
+                for (size_t j = 0; j < NR; ++j) acc[r][j] += ap[r] * bp[j];
+            }
+        }
+        for (size_t r = 0; r < GEMM_MR; ++r) {
+            for (size_t j = 0; j < NR; ++j) c[r * ldc + j] = add ? c[r * ldc + j] + acc[r][j] : acc[r][j];
+        }
+    }
+
+#if KERNELS_X86
+    // Twelve accumulators (6 rows x 2 vectors) plus two B vectors and one broadcast fit in the 16 YMM registers.
+    KERNELS_AVX2 void gemm_micro_avx2(size_t depth, const double* ap, const double* bp, double* c, size_t ldc, bool add) {
+        __m256d acc[GEMM_MR][2];
+        for (size_t r = 0; r < GEMM_MR; ++r) acc[r][0] = acc[r][1] = _mm256_setzero_pd();
+        for (size_t p = 0; p < depth; ++p, ap += GEMM_MR, bp += GEMM_NR<double>) {
+            __m256d b0 = _mm256_loadu_pd(bp);
+            __m256d b1 = _mm256_loadu_pd(bp + 4);
+            for (size_t r = 0; r < GEMM_MR; ++r) {
+                __m256d av = _mm256_broadcast_sd(ap + r);
+                acc[r][0] = _mm256_fmadd_pd(av, b0, acc[r][0]);
+                acc[r][1] = _mm256_fmadd_pd(av, b1, acc[r][1]);
+            }
+        }
+        for (size_t r = 0; r < GEMM_MR; ++r) {
+            double* row = c + r * ldc;
+            if (add) {
+                acc[r][0] = _mm256_add_pd(_mm256_loadu_pd(row), acc[r][0]);
+                acc[r][1] = _mm256_add_pd(_mm256_loadu_pd(row + 4), acc[r][1]);
+            }
+            _mm256_storeu_pd(row, acc[r][0]);
+            _mm256_storeu_pd(row + 4, acc[r][1]);
+        }
+    }
+
+    // The same register layout with 8 floats per vector: twice the columns per instruction.
+    KERNELS_AVX2 void gemm_micro_avx2(size_t depth, const float* ap, const float* bp, float* c, size_t ldc, bool add) {
+        __m256 acc[GEMM_MR][2];
+        for (size_t r = 0; r < GEMM_MR; ++r) acc[r][0] = acc[r][1] = _mm256_setzero_ps();
+        for (size_t p = 0; p < depth; ++p, ap += GEMM_MR, bp += GEMM_NR<float>) {
+            __m256 b0 = _mm256_loadu_ps(bp);
+            __m256 b1 = _mm256_loadu_ps(bp + 8);
+            for (size_t r = 0; r < GEMM_MR; ++r) {
+                __m256 av = _mm256_broadcast_ss(ap + r);
+                acc[r][0] = _mm256_fmadd_ps(av, b0, acc[r][0]);
+                acc[r][1] = _mm256_fmadd_ps(av, b1, acc[r][1]);
+            }
+        }
+        for (size_t r = 0; r < GEMM_MR; ++r) {
+            float* row = c + r * ldc;
+            if (add) {
+                acc[r][0] = _mm256_add_ps(_mm256_loadu_ps(row), acc[r][0]);
+                acc[r][1] = _mm256_add_ps(_mm256_loadu_ps(row + 8), acc[r][1]);
+            }
+            _mm256_storeu_ps(row, acc[r][0]);
+            _mm256_storeu_ps(row + 8, acc[r][1]);
+        }
+    }
+#endif
+
+    // One MC x TILE_N tile of C for the current KC slice.
+    template <typename T>
+    void gemm_tile(size_t mc, size_t nc, size_t depth, const T* ap, const T* bp, T* c, size_t ldc, bool add) {
+        constexpr size_t NR = GEMM_NR<T>;
+        void (*micro)(size_t, const T*, const T*, T*, size_t, bool) = gemm_micro_scalar<T>;
+#if KERNELS_X86
+        if (level() == Level::AVX2) micro = gemm_micro_avx2;
+#endif
+        T edge[GEMM_MR * NR];
+        for (size_t jr = 0; jr < nc; jr += NR) {
+            size_t nr = std::min(NR, nc - jr);
+            for (size_t ir = 0; ir < mc; ir += GEMM_MR) {
+                size_t mr = std::min(GEMM_MR, mc - ir);
+                T* cblock = c + ir * ldc + jr;
+                if (mr == GEMM_MR && nr == NR) {
+                    micro(depth, ap + ir * depth, bp + jr * depth, cblock, ldc, add);
+                    continue;
+                }
+                // Partial block at the bottom or right edge: compute into a scratch block.
+                micro(depth, ap + ir * depth, bp + jr * depth, edge, NR, false);
+                for (size_t r = 0; r < mr; ++r) {
+                    for (size_t j = 0; j < nr; ++j) cblock[r * ldc + j] = add ? cblock[r * ldc + j] + edge[r * NR + j] : edge[r * NR + j];
+                }
+            }
+        }
+    }
+
+    template <typename T>
+    void gemm_blocked(bool trans_a, bool trans_b, size_t m, size_t n, size_t k,
+        const T* a, size_t lda, const T* b, size_t ldb,
+        T* c, size_t ldc, bool accumulate) {
+        constexpr size_t NR = GEMM_NR<T>;
+        if (m == 0 || n == 0) return;
+        if (k == 0) {
+            if (!accumulate) for (size_t i = 0; i < m; ++i) std::fill(c + i * ldc, c + i * ldc + n, T(0));
+            return;
+        }
+
+        // Small products are not worth waking the thread team for.
+        const bool parallel = static_cast<double>(m) * n * k >= 64.0 * 64.0 * 64.0;
+        const size_t m_padded = (m + GEMM_MR - 1) / GEMM_MR * GEMM_MR;
+        // The packing buffers belong to the calling thread, so a training loop that
+        // repeats the same products does not allocate them again on every call. The
+        // OpenMP workers only see them through the pointers taken below: naming the
+        // thread_local inside the parallel loops would give each worker its own empty one.
+        thread_local std::vector<T> a_buffer, b_buffer;
+        a_buffer.resize(m_padded * std::min(k, GEMM_KC));
+        T* const a_packed = a_buffer.data();
+
+        for (size_t jc = 0; jc < n; jc += GEMM_NC) {
+            size_t nc = std::min(GEMM_NC, n - jc);
+            size_t nc_padded = (nc + NR - 1) / NR * NR;
+            for (size_t pc = 0; pc < k; pc += GEMM_KC) {
+                size_t depth = std::min(GEMM_KC, k - pc);
+                bool add = accumulate || pc > 0;
+                b_buffer.resize(nc_padded * depth);
+                T* const b_packed = b_buffer.data();
+
+                // Pack the KC slices of A and B, one MC block or TILE_N strip per iteration.
+                const long long a_blocks = static_cast<long long>((m + GEMM_MC - 1) / GEMM_MC);
+                const long long b_strips = static_cast<long long>((nc + GEMM_TILE_N - 1) / GEMM_TILE_N);
+#pragma omp parallel for if(parallel) schedule(static)
+                for (long long blk = 0; blk < a_blocks + b_strips; ++blk) {
+                    if (blk < a_blocks) {
+                        size_t ic = static_cast<size_t>(blk) * GEMM_MC;
+                        gemm_pack_a(trans_a, a, lda, ic, std::min(GEMM_MC, m - ic), pc, depth, a_packed + ic * depth);
+                    }
+                    else {
+                        size_t jt = static_cast<size_t>(blk - a_blocks) * GEMM_TILE_N;
+                        gemm_pack_b(trans_b, b, ldb, pc, depth, jc + jt, std::min(GEMM_TILE_N, nc - jt), b_packed + jt * depth);
+                    }
+                }
+
+                // Every MC x TILE_N tile of C is independent.
+#pragma omp parallel for if(parallel) schedule(dynamic)
+                for (long long tile = 0; tile < a_blocks * b_strips; ++tile) {
+                    size_t ic = static_cast<size_t>(tile / b_strips) * GEMM_MC;
+                    size_t jt = static_cast<size_t>(tile % b_strips) * GEMM_TILE_N;
+                    gemm_tile(std::min(GEMM_MC, m - ic), std::min(GEMM_TILE_N, nc - jt), depth,
+                        a_packed + ic * depth, b_packed + jt * depth,
+                        c + ic * ldc + jc + jt, ldc, add);
+                }
+            }
+        }
+    }
+}
+
+namespace Kernels {
+
+    double binary(Binary op, double a, double b) {
+        switch (op) {
+        case Binary::ADD: return a + b;
+        case Binary::SUB: return a - b;
+        case Binary::MUL: return a * b;
+        case Binary::DIV: return a / b;
+        case Binary::MOD: return static_cast<double>(static_cast<long long>(a) % static_cast<long long>(b));
+        default: return std::pow(a, b);
+        }
+    }
+
+    double unary(Unary op, double x) {
+        switch (op) {
+        case Unary::SQRT: return (x < 0) ? 0.0 : std::sqrt(x);
+        case Unary::ABS: return std::abs(x);
+        case Unary::FLOOR: return std::floor(x);
+        case Unary::CEIL: return std::ceil(x);
+        case Unary::TRUNC: return std::trunc(x);
+        case Unary::SIN: return std::sin(x);
+        case Unary::COS: return std::cos(x);
+        default: return std::tan(x);
+        }
+    }
+
+    void binary(Binary op, const double* a, size_t a_step, const double* b, size_t b_step, double* out, size_t n) {
+        // x ^ 2 is the most common power in array code (distances, norms); x * x is exact.
+        if (op == Binary::POW && b_step == 0 && *b == 2.0) {
+            binary(Binary::MUL, a, a_step, a, a_step, out, n);
+            return;
+        }
+        size_t done = 0;
+#if KERNELS_X86
+        if (op != Binary::MOD && op != Binary::POW) {
+            if (level() == Level::AVX2) done = binary_avx2(op, a, a_step, b, b_step, out, n);
+            else if (level() == Level::SSE2) done = binary_sse2(op, a, a_step, b, b_step, out, n);
+        }
+#endif
+        binary_scalar(op, a, a_step, b, b_step, out, done, n);
+    }
+
+    void compare(Compare op, const double* a, size_t a_step, const double* b, size_t b_step, uint8_t* out, size_t n) {
+        size_t done = 0;
+#if KERNELS_X86
+        if (level() == Level::AVX2) done = compare_avx2(op, a, a_step, b, b_step, out, n);
+        else if (level() == Level::SSE2) done = compare_sse2(op, a, a_step, b, b_step, out, n);
+#endif
+        compare_scalar(op, a, a_step, b, b_step, out, done, n);
+    }
+
+    void unary(Unary op, const double* in, double* out, size_t n) {
+        size_t done = 0;
+#if KERNELS_X86
+        bool rounding = op == Unary::FLOOR || op == Unary::CEIL || op == Unary::TRUNC;
+        if (level() == Level::AVX2 && (op == Unary::SQRT || op == Unary::ABS || rounding)) done = unary_avx2(op, in, out, n);
+        else if (level() != Level::SCALAR && (op == Unary::SQRT || op == Unary::ABS)) done = unary_sse2(op, in, out, n);
+#endif
+        unary_scalar(op, in, out, done, n);
+    }
+
+    void gemm(bool trans_a, bool trans_b, size_t m, size_t n, size_t k,
+        const double* a, size_t lda, const double* b, size_t ldb,
+        double* c, size_t ldc, bool accumulate) {
+        gemm_blocked(trans_a, trans_b, m, n, k, a, lda, b, ldb, c, ldc, accumulate);
+    }
+
+    void gemm(bool trans_a, bool trans_b, size_t m, size_t n, size_t k,
+        const float* a, size_t lda, const float* b, size_t ldb,
+        float* c, size_t ldc, bool accumulate) {
+        gemm_blocked(trans_a, trans_b, m, n, k, a, lda, b, ldb, c, ldc, accumulate);
+    }
+
+    const char* instruction_set() {
+        switch (level()) {
+        case Level::AVX2: return "AVX2";
+        case Level::SSE2: return "SSE2";
+        default: return "scalar";
+        }
+    }
+}
@@ -11,8 +11,10 @@
 #include "DAPHandler.hpp"
 #include "Compiler.hpp"
 #include "ModuleInterface.h"
+#include "Kernels.hpp"
 #include <iostream>
 #include <fstream>   // For std::ifstream
+#include <filesystem>
 #include <string>
 #include <stdexcept>
 #include <cstring>
@@ -34,7 +36,7 @@ std::shared_ptr<Array> array_add(const std::shared_ptr<Array>& a, const std::sha
 std::shared_ptr<Array> array_subtract(const std::shared_ptr<Array>& a, const std::shared_ptr<Array>& b);
 
 
-const std::string NERELA_VERSION = "0.9.2";
+extern const std::string NERELA_VERSION = "0.9.2"; // also keys the compiled program cache (ProgramCache.cpp)
 
 void register_builtin_functions(NeReLaBasic& vm, NeReLaBasic::FunctionTable& table_to_populate);
 
@@ -71,11 +73,16 @@ void trim(std::string& s) {
 
 // --- The chain resolver now handles both UDTs (Maps) and COM Objects ---
 std::pair<BasicValue, std::string> NeReLaBasic::resolve_dot_chain(const std::string& chain_string) {
-    std::stringstream ss(chain_string);
-    std::string segment;
     std::vector<std::string> parts;
-    while (std::getline(ss, segment, '.')) {
-        parts.push_back(segment);
+    for (size_t start = 0;;) {
+        size_t dot = chain_string.find('.', start);
+        if (dot == std::string::npos) {
+            // Like getline, a trailing '.' adds no empty segment.
+            if (start < chain_string.size()) parts.push_back(chain_string.substr(start));
+            break;
+        }
+        parts.push_back(chain_string.substr(start, dot - start));
+        start = dot + 1;
     }
 
     if (parts.empty()) {
@@ -110,8 +117,10 @@ std::pair<BasicValue, std::string> NeReLaBasic::resolve_dot_chain(const std::str
         // Check if we have a UDT (Map) or a COM object
         if (std::holds_alternative<std::shared_ptr<Map>>(current_object)) {
             auto& map_ptr = std::get<std::shared_ptr<Map>>(current_object);
-            if (map_ptr && map_ptr->data.count(part)) {
-                current_object = map_ptr->data.at(part);
+            uint32_t slot = map_ptr ? map_ptr->data.slot_of(part) : MapKeys::NONE;
+            if (slot != MapKeys::NONE) {
+                BasicValue member = map_ptr->data.slot(slot);
+                current_object = std::move(member);
             }
             else {
                 Error::set(3, runtime_current_line, "Member not found: " + part); return {};
@@ -316,7 +325,20 @@ void NeReLaBasic::process_system_events() {
     // 1. Process the internal event queue (for events raised by RAISEEVENT)
     process_event_queue();
 
-    // 2. Process system-level keyboard events if not paused by OPTION "NOPAUSE"
+    // 2. Poll the keyboard and the window at most once per INPUT_POLL_INTERVAL.
+    // Both cost a system call, which used to dominate tight loops when made
+    // before every statement.
+    if (++statements_since_input_check < INPUT_CHECK_STATEMENTS) return;
+    statements_since_input_check = 0;
+    auto now = std::chrono::steady_clock::now();
+    if (now - last_input_poll < INPUT_POLL_INTERVAL) return;
+    last_input_poll = now;
+    poll_input();
+}
+
+// Turns pending key presses into KEYDOWN events and pumps the SDL window.
+void NeReLaBasic::poll_input() {
+    // Process system-level keyboard events if not paused by OPTION "NOPAUSE"
 #ifdef _WIN32
     if (!nopause_active && _kbhit()) {
         char key = _getch();
@@ -351,7 +373,7 @@ void NeReLaBasic::process_system_events() {
 
         // Raise the "KEYDOWN" event. It will be picked up by process_event_queue()
         // on the next iteration of whichever loop is currently active.
-        raise_event("KEYDOWN", key_data);
+        raise_event(EventQueue::KEYDOWN, key_data);
     }
 
 #ifdef SDL3
@@ -420,14 +442,33 @@ void NeReLaBasic::start() {
 }
 
 
+// Keeps the symbols of a REPL line or EXECUTE snippet while it runs and drops
+// them when the outermost run of that buffer ends.
+class SnippetSymbols {
+public:
+    SnippetSymbols(NeReLaBasic& vm, const std::vector<uint8_t>& code) : vm(vm), code(&code) {
+        ++vm.snippet_symbols[this->code].second;
+    }
+    ~SnippetSymbols() {
+        auto it = vm.snippet_symbols.find(code);
+        if (it != vm.snippet_symbols.end() && --it->second.second <= 0) vm.snippet_symbols.erase(it);
+    }
+    SnippetSymbols(const SnippetSymbols&) = delete;
+    SnippetSymbols& operator=(const SnippetSymbols&) = delete;
+private:
+    NeReLaBasic& vm;
+    const std::vector<uint8_t>* code;
+};
+
 void NeReLaBasic::execute_repl_command(const std::vector<uint8_t>& repl_p_code) {
     if (repl_p_code.empty()) {
         return;
     }
+    SnippetSymbols snippet(*this, repl_p_code);
 
     // --- Save the state of the main program's execution context ---
     const auto* original_active_pcode = this->active_p_code;
-    uint16_t original_pcode = this->pcode;
+    uint32_t original_pcode = this->pcode;
 
     // --- Temporarily switch context to the REPL's p-code ---
     this->active_p_code = &repl_p_code;
@@ -436,10 +477,10 @@ void NeReLaBasic::execute_repl_command(const std::vector<uint8_t>& repl_p_code)
     // --- Simplified execution loop for the REPL command ---
     // This loop does NOT check for debug state, breakpoints, or pause signals.
     while (this->pcode < this->active_p_code->size()) {
-        // The first two bytes of tokenized code are the line number (always 0 for REPL).
+        // Tokenized code starts with the line number prefix (always 0 for REPL).
         // The main `statement()` function expects `pcode` to point AFTER these bytes.
         if (this->pcode == 0) {
-            this->pcode += 2;
+            this->pcode += PCode::LINE_PREFIX_SIZE;
         }
 
         Tokens::ID token = static_cast<Tokens::ID>((*this->active_p_code)[this->pcode]);
@@ -542,12 +583,12 @@ void NeReLaBasic::handle_debug_events() {
     }
 
     // Get the line number for the *next* statement to be executed.
-    //runtime_current_line = (*active_p_code)[pcode] | ((*active_p_code)[pcode + 1] << 8);
+    //runtime_current_line = PCode::read_line(*active_p_code, pcode);
 
     //TextIO::print("D: " + std::to_string((int) (*active_p_code)[pcode - 1]) + ", " + std::to_string((int)(*active_p_code)[pcode]) + ", " + std::to_string((int)(*active_p_code)[pcode + 1]) + ", " + std::to_string((int)(*active_p_code)[pcode + 2]));
     // Skip empty and rem lines
-    if (pcode>0 && pcode < (active_p_code->size()-2))
-        if (static_cast<Tokens::ID>((*active_p_code)[pcode - 1]) == Tokens::ID::C_CR && static_cast<Tokens::ID>((*active_p_code)[pcode + 2]) == Tokens::ID::C_CR) 
+    if (pcode>0 && pcode < (active_p_code->size()-PCode::LINE_PREFIX_SIZE))
+        if (static_cast<Tokens::ID>((*active_p_code)[pcode - 1]) == Tokens::ID::C_CR && static_cast<Tokens::ID>((*active_p_code)[pcode + PCode::LINE_PREFIX_SIZE]) == Tokens::ID::C_CR) 
             { return; }
 
     bool should_pause = false;
@@ -598,35 +639,71 @@ void NeReLaBasic::handle_debug_events() {
 }
 
 void NeReLaBasic::raise_event(const std::string& event_name, BasicValue data) {
-    event_queue.push_back({ to_upper(event_name), data });
+    raise_event(events.intern(to_upper(event_name)), std::move(data));
 }
 
-void NeReLaBasic::process_event_queue() {
-    if (is_processing_event || event_queue.empty()) {
-        return;
+void NeReLaBasic::raise_event(EventQueue::EventId id, BasicValue data) {
+    // Nobody listens: drop it here instead of queueing it.
+    if (!has_event_handler(id)) return;
+
+    // OPTION "EVENTOVERFLOW=WAIT": make room by running the handlers already queued.
+    // Inside a handler that is not possible, and the queue drops the oldest event instead.
+    if (events.overflow == EventQueue::Overflow::WAIT && !is_processing_event) {
+        while (events.full() && !program_ended && Error::get() == 0) {
+            process_event_queue();
+        }
     }
+    events.push(id, std::move(data));
+}
 
-    is_processing_event = true;
+bool NeReLaBasic::has_event_handler(EventQueue::EventId id) const {
+    return id < event_handlers.size() && !event_handlers[id].function_name.empty();
+}
+
+void NeReLaBasic::set_event_handler(const std::string& event_name, const std::string& func_name, const FunctionInfo& func_info) {
+    EventQueue::EventId id = events.intern(event_name);
+    if (event_handlers.size() <= id) event_handlers.resize(id + 1);
+    event_handlers[id] = { func_name, std::make_shared<const FunctionInfo>(func_info), program_generation };
+}
 
-    auto event_pair = event_queue.front();
-    event_queue.pop_front();
+std::shared_ptr<const NeReLaBasic::FunctionInfo> NeReLaBasic::event_handler(EventQueue::EventId id) {
+    if (!has_event_handler(id)) return nullptr;
+    EventHandler& handler = event_handlers[id];
+    if (handler.program_generation != program_generation) {
+        // The program was recompiled since ON ... CALL; look the SUB up again.
+        auto it = active_function_table->find(handler.function_name);
+        handler.function = it == active_function_table->end() ? nullptr : std::make_shared<const FunctionInfo>(it->second);
+        handler.program_generation = program_generation;
+    }
+    return handler.function;
+}
 
-    std::string event_name = event_pair.first;
-    BasicValue event_data = event_pair.second;
+// Dispatches queued events until the queue is empty or EVENT_BATCH_BUDGET is used
+// up, so a burst is handled in one go instead of one event per statement.
+void NeReLaBasic::process_event_queue() {
+    if (is_processing_event || events.empty()) {
+        return;
+    }
 
-    if (event_handlers.count(event_name)) {
-        std::string handler_func_name = event_handlers.at(event_name);
-        if (active_function_table->count(handler_func_name)) {
-            const auto& func_info = active_function_table->at(handler_func_name);
+    is_processing_event = true;
+    const auto batch_start = std::chrono::steady_clock::now();
 
+    EventQueue::Event event;
+    while (events.pop(event)) {
+        // Held by value: the handler may replace itself with another ON ... CALL.
+        std::shared_ptr<const FunctionInfo> func_info = event_handler(event.id);
+        if (func_info) {
             auto args_array = std::make_shared<Array>();
             args_array->shape = { 1 };
-            args_array->data.push_back(event_data);
+            args_array->data.push_back(std::move(event.data));
 
             std::vector<BasicValue> args = { args_array };
 
-            execute_synchronous_function(func_info, args);
+            events.stats.dispatched++;
+            execute_synchronous_function(*func_info, args);
         }
+        if (program_ended || Error::get() != 0) break;
+        if (std::chrono::steady_clock::now() - batch_start >= EVENT_BATCH_BUDGET) break;
     }
     is_processing_event = false;
 }
@@ -635,6 +712,7 @@ void NeReLaBasic::process_event_queue() {
 BasicValue NeReLaBasic::execute_function_for_value(const FunctionInfo& func_info, const std::vector<BasicValue>& args) {
     // Priority 1: Check for the new ABI-safe DLL function pointer
     if (func_info.native_dll_impl != nullptr) {
+        Profiler::NativeScope profile_scope(profiler.get(), *this, func_info.name);
         BasicValue result;
         // Call it using the new "output pointer" style
         func_info.native_dll_impl(*this, args, &result);
@@ -645,6 +723,7 @@ BasicValue NeReLaBasic::execute_function_for_value(const FunctionInfo& func_info
     }
     // Priority 2: Check for the old internal function pointer
     else if (func_info.native_impl != nullptr) {
+        Profiler::NativeScope profile_scope(profiler.get(), *this, func_info.name);
         // Call it using the old "return by value" style
         return func_info.native_impl(*this, args);
     }
@@ -657,6 +736,7 @@ BasicValue NeReLaBasic::execute_function_for_value(const FunctionInfo& func_info
 // New synchronous executor for REPL and direct commands
 void NeReLaBasic::execute_synchronous_block(const std::vector<uint8_t>& code_to_run, int multiline) {
     if (code_to_run.empty()) return;
+    SnippetSymbols snippet(*this, code_to_run);
 
     auto prev_active_p_code = active_p_code;
     auto prev_pcode = pcode;
@@ -667,7 +747,7 @@ void NeReLaBasic::execute_synchronous_block(const std::vector<uint8_t>& code_to_
         process_system_events(); 
         if (program_ended) break;
 
-        if (pcode == 0) pcode += 2; // Skip line number
+        if (pcode == 0) pcode += PCode::LINE_PREFIX_SIZE; // Skip line number
         Tokens::ID token = static_cast<Tokens::ID>((*active_p_code)[pcode]);
         if (token == Tokens::ID::NOCMD || (token == Tokens::ID::C_CR && multiline == false)) break;
         try
@@ -699,11 +779,24 @@ void NeReLaBasic::execute_synchronous_block(const std::vector<uint8_t>& code_to_
     pcode = prev_pcode;
 }
 
+// Parameters occupy the first slots of a function's local layout (the compiler
+// interns them before anything in the body).
+static void set_parameter(LocalVariables& locals, const NeReLaBasic::FunctionInfo& func_info, size_t index, const BasicValue& value) {
+    if (func_info.locals) {
+        locals.slot(static_cast<uint32_t>(index)) = value;
+    }
+    else {
+        locals[func_info.parameter_names[index]] = value;
+    }
+}
+
 // New synchronous executor for user-defined functions
 BasicValue NeReLaBasic::execute_synchronous_function(const FunctionInfo& func_info, const std::vector<BasicValue>& args) {
     size_t initial_stack_depth = call_stack.size();
+    user_function_calls++;
     // --- Properly initialize the stack frame ---
     StackFrame frame;
+    frame.local_variables = LocalVariables(func_info.locals);
     frame.return_p_code_ptr = this->active_p_code;
     frame.return_pcode = this->pcode;
     frame.previous_function_table_ptr = this->active_function_table;
@@ -714,10 +807,10 @@ BasicValue NeReLaBasic::execute_synchronous_function(const FunctionInfo& func_in
 
     for (size_t i = 0; i < func_info.parameter_names.size(); ++i) {
         if (i < args.size()) {
-            frame.local_variables[func_info.parameter_names[i]] = args[i];
+            set_parameter(frame.local_variables, func_info, i, args[i]);
         }
     }
-    call_stack.push_back(frame);
+    call_stack.push_back(std::move(frame));
 
     // --- Context switch ---
     auto prev_active_func_table = this->active_function_table;
@@ -796,6 +889,7 @@ void NeReLaBasic::execute_main_program(const std::vector<uint8_t>& code_to_run,
 
     g_vm_instance_ptr = this;
     Error::clear();
+    if (!profile_output.empty()) start_profiler(profile_output);
 
     //dap_handler->send_output_message("We are in execute main.\n");
 
@@ -810,160 +904,279 @@ void NeReLaBasic::execute_main_program(const std::vector<uint8_t>& code_to_run,
     
 
     while (!task_queue.empty()) {
-        process_system_events();
+        process_system_events(); // also pumps the SDL window, setting program_ended when it is closed
         if (program_ended) {
             break;
         }
+
+        run_scheduler_round();
+
+        if (task_queue.empty() || !task_queue.count(0)) { break; }
+    }
+    finish_profiler();
+
 #ifdef SDL3
-        if (graphics_system.is_initialized) { if (!graphics_system.handle_events(*this)) break; }
+    graphics_system.shutdown();
+    sound_system.shutdown();
 #endif
+    current_task = nullptr;
+}
 
-        for (auto it = task_queue.begin(); it != task_queue.end(); ) {
-            current_task = it->second.get();
+// Gives every task in the queue one time slice (or, for a C++ background task,
+// one check of its future), and moves the tasks that finished to task_completed.
+void NeReLaBasic::run_scheduler_round() {
+    for (auto it = task_queue.begin(); it != task_queue.end(); ) {
+        current_task = it->second.get();
 
-            bool task_removed = false;
+        // A task parked inside AWAIT resumes on the C++ stack once its awaited task is done.
+        if (current_task->waiting_in_await) { ++it; continue; }
 
-            if (current_task->result_future.valid()) {
-                // Check if the future is ready without blocking the interpreter.
-                if (current_task->result_future.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
-                    // The C++ thread is done! Get the result and complete this task.
-                    try {
-                        current_task->result = current_task->result_future.get();
-                        current_task->status = TaskStatus::COMPLETED;
-                        int task_id_to_delete = current_task->id;
-                        task_completed[task_id_to_delete] = task_queue.at(task_id_to_delete);
-                        it = task_queue.erase(it);
-                        task_removed = true;
-                    }
-                    catch (const std::exception& e) {
-                        // Handle exceptions from the background C++ thread.
-                        current_task->result = "Error: " + std::string(e.what());
-                        current_task->status = TaskStatus::ERRORED;
-                    }
+        bool task_removed = false;
+
+        if (current_task->result_future.valid()) {
+            // Check if the future is ready without blocking the interpreter.
+            if (current_task->result_future.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+                // The C++ thread is done! Get the result and complete this task.
+                try {
+                    current_task->result = current_task->result_future.get();
+                    current_task->status = TaskStatus::COMPLETED;
+                    int task_id_to_delete = current_task->id;
+                    task_completed[task_id_to_delete] = task_queue.at(task_id_to_delete);
+                    it = task_queue.erase(it);
+                    task_removed = true;
+                }
+                catch (const std::exception& e) {
+                    // Handle exceptions from the background C++ thread.
+                    current_task->result = "Error: " + std::string(e.what());
+                    current_task->status = TaskStatus::ERRORED;
                 }
-                // If the future is not ready yet, we just skip to the next task.
-                if (!task_removed) ++it;
-                continue;
             }
+            // If the future is not ready yet, we just skip to the next task.
+            if (!task_removed) ++it;
+            continue;
+        }
 
-            // --- Context Switch: Load ---
-            this->pcode = current_task->p_code_counter;
-            this->active_p_code = current_task->p_code_ptr;
-            this->call_stack = current_task->call_stack;
-            this->for_stack = current_task->for_stack;
-            // Restore the correct function table for the current context
-            if (!this->call_stack.empty()) {
-                this->active_function_table = this->call_stack.back().previous_function_table_ptr;
+        // --- Context Switch: Load ---
+        this->pcode = current_task->p_code_counter;
+        this->active_p_code = current_task->p_code_ptr;
+        // The task owns its stacks; swapping them in and out is O(1) and never
+        // copies a frame.
+        std::swap(this->call_stack, current_task->call_stack);
+        std::swap(this->for_stack, current_task->for_stack);
+        // Restore the correct function table for the current context
+        if (!this->call_stack.empty()) {
+            this->active_function_table = this->call_stack.back().previous_function_table_ptr;
+        }
+        else {
+            this->active_function_table = &this->main_function_table;
+        }
+        current_task->yielded_execution = false;
+
+        // --- Task Execution Logic ---
+        if (current_task->status == TaskStatus::RUNNING) {
+            run_task_slice();
+        }
+        else if (current_task->status == TaskStatus::PAUSED_ON_AWAIT) {
+            if (current_task->awaiting_task && current_task->awaiting_task->status == TaskStatus::COMPLETED) {
+                current_task->status = TaskStatus::RUNNING;
+                current_task->awaiting_task = nullptr;
+            }
+        }
+
+    end_of_task_processing:
+        // --- Context Switch: Save ---
+        current_task->p_code_counter = this->pcode;
+        std::swap(this->call_stack, current_task->call_stack);
+        std::swap(this->for_stack, current_task->for_stack);
+
+        if (current_task->status == TaskStatus::COMPLETED || current_task->status == TaskStatus::ERRORED) {
+            int task_id_to_delete = current_task->id;
+            task_completed[task_id_to_delete] = task_queue.at(task_id_to_delete);
+            it = task_queue.erase(it);
+            task_removed = true;
+        }
+
+        if (!task_removed) { ++it; }
+    }
+}
+
+// Runs the current task, whose stacks are swapped in, for one time slice: whole
+// lines until the slice is used up (see OPTION "TIMESLICE"), or until the task
+// yields, completes or fails.
+void NeReLaBasic::run_task_slice() {
+    // Check if the task's pcode is valid *before* executing
+    //if (pcode >= active_p_code->size() || static_cast<Tokens::ID>((*active_p_code)[pcode]) == Tokens::ID::NOCMD) {
+    if (pcode >= active_p_code->size()) {
+        // This can happen if a function ends without RETURN/ENDFUNC. Mark as complete.
+        current_task->status = TaskStatus::COMPLETED;
+        handle_debug_events();
+    }
+    else {
+        // Execute whole lines of the task until its time slice is used up
+        // (one line unless OPTION "TIMESLICE" says otherwise).
+        uint32_t statements_run = 0;
+        // Only a microsecond slice needs the clock; a loop's back edge ends a line
+        // and so starts a slice every iteration.
+        const auto slice_start = time_slice_us != 0 ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point{};
+        bool slice_done = false;
+        while (!slice_done) {
+            if (current_task->resume_mid_line) {
+                current_task->resume_mid_line = false; // The last slice stopped inside this line
             }
             else {
-                this->active_function_table = &this->main_function_table;
+                runtime_current_line = PCode::read_line(*active_p_code, pcode);
+                pcode += PCode::LINE_PREFIX_SIZE;
             }
-            current_task->yielded_execution = false;
 
-            // --- Task Execution Logic ---
-            if (current_task->status == TaskStatus::RUNNING) {
-                // Check if the task's pcode is valid *before* executing
-                //if (pcode >= active_p_code->size() || static_cast<Tokens::ID>((*active_p_code)[pcode]) == Tokens::ID::NOCMD) {
-                if (pcode >= active_p_code->size()) {
-                    // This can happen if a function ends without RETURN/ENDFUNC. Mark as complete.
-                    current_task->status = TaskStatus::COMPLETED;
-                    handle_debug_events();
-                }
-                else {
-                    // Execute one line of the task
-                    runtime_current_line = (*active_p_code)[pcode] | ((*active_p_code)[pcode + 1] << 8);
-                    pcode += 2;
-
-                    handle_debug_events();
-
-                    bool line_is_done = false;
-                    while (!line_is_done && pcode < active_p_code->size()) {
-                        if (static_cast<Tokens::ID>((*active_p_code)[pcode]) != Tokens::ID::C_CR) {
-                            try
-                            {
-                                statement();
-                            }
-                            catch (const std::exception& e)
-                            {
-                                //TextIO::print("Exception " + std::string(e.what()));
-                                Error::set(1, 1, "Exception " + std::string(e.what()));
-                            }
-                            
-                        }
-                        // --- Error Handling Logic ---
-                        if (jump_to_catch_pending) {
-                            pcode = pending_catch_address;
-                            jump_to_catch_pending = false; // Reset flag
-                            Error::clear(); // Clear error now that we've jumped
-                            continue; // Continue execution in the CATCH/FINALLY block
-                        }
-                        if (Error::get() != 0) {
-                            // The new Error::set function will have already jumped to a CATCH block if one exists.
-                            // If we get here, it means the error was unhandled.
-                            current_task->status = TaskStatus::ERRORED;
-                            line_is_done = true;
-                            continue;
-                        }
-                        // If the statement caused the task to complete (e.g. RETURN) or yield (AWAIT), stop processing this line.
-                        if (current_task->status != TaskStatus::RUNNING || current_task->yielded_execution) {
-                            line_is_done = true;
-                            continue;
-                        }
+            handle_debug_events();
 
-                        // Handle multi-statement lines
-                        if (pcode < active_p_code->size()) {
-                            Tokens::ID next_token = static_cast<Tokens::ID>((*active_p_code)[pcode]);
-                            if (next_token == Tokens::ID::C_COLON) {
-                                pcode++;
-                            }
-                            else {
-                                if (next_token == Tokens::ID::C_CR || next_token == Tokens::ID::NOCMD) {
-                                    line_is_done = true;
-                                }
-                            }
-                        }
+            bool line_is_done = false;
+            while (!line_is_done && pcode < active_p_code->size()) {
+                if (static_cast<Tokens::ID>((*active_p_code)[pcode]) != Tokens::ID::C_CR) {
+                    try
+                    {
+                        statement();
+                        statements_run++;
                     }
-                    if (pcode < active_p_code->size() && static_cast<Tokens::ID>((*active_p_code)[pcode]) == Tokens::ID::C_CR) {
-                        pcode++;
+                    catch (const std::exception& e)
+                    {
+                        //TextIO::print("Exception " + std::string(e.what()));
+                        Error::set(1, 1, "Exception " + std::string(e.what()));
                     }
+                }
+                // --- Error Handling Logic ---
+                if (jump_to_catch_pending) {
+                    pcode = pending_catch_address;
+                    jump_to_catch_pending = false; // Reset flag
+                    Error::clear(); // Clear error now that we've jumped
+                    continue; // Continue execution in the CATCH/FINALLY block
+                }
+                if (Error::get() != 0) {
+                    // The new Error::set function will have already jumped to a CATCH block if one exists.
+                    // If we get here, it means the error was unhandled.
+                    current_task->status = TaskStatus::ERRORED;
+                    line_is_done = true;
+                    continue;
+                }
+                // If the statement caused the task to complete (e.g. RETURN) or yield (AWAIT), stop processing this line.
+                if (current_task->status != TaskStatus::RUNNING || current_task->yielded_execution) {
+                    line_is_done = true;
+                    continue;
+                }
 
+                // Handle multi-statement lines
+                if (pcode < active_p_code->size()) {
+                    Tokens::ID next_token = static_cast<Tokens::ID>((*active_p_code)[pcode]);
+                    if (next_token == Tokens::ID::C_COLON) {
+                        pcode++;
+                    }
+                    else {
+                        if (next_token == Tokens::ID::C_CR || next_token == Tokens::ID::NOCMD) {
+                            line_is_done = true;
+                        }
+                    }
                 }
             }
-            else if (current_task->status == TaskStatus::PAUSED_ON_AWAIT) {
-                if (current_task->awaiting_task && current_task->awaiting_task->status == TaskStatus::COMPLETED) {
-                    current_task->status = TaskStatus::RUNNING;
-                    current_task->awaiting_task = nullptr;
-                }
+            bool line_ended = false;
+            if (pcode < active_p_code->size() && static_cast<Tokens::ID>((*active_p_code)[pcode]) == Tokens::ID::C_CR) {
+                pcode++;
+                line_ended = true;
             }
 
-        end_of_task_processing:
-            // --- Context Switch: Save ---
-            current_task->p_code_counter = this->pcode;
-            current_task->call_stack = this->call_stack;
-            current_task->for_stack = this->for_stack;
+            slice_done = !line_ended || program_ended || pcode >= active_p_code->size() ||
+                current_task->status != TaskStatus::RUNNING || current_task->yielded_execution ||
+                time_slice_used_up(statements_run, slice_start);
+            current_task->resume_mid_line = !line_ended;
+        }
+    }
+}
 
-            if (current_task->status == TaskStatus::COMPLETED || current_task->status == TaskStatus::ERRORED) {
-                int task_id_to_delete = current_task->id;
-                task_completed[task_id_to_delete] = task_queue.at(task_id_to_delete);
-                it = task_queue.erase(it);
-                task_removed = true;
-            }
+// AWAIT on a task that is still queued: parks the awaiting task in the middle of
+// its statement and keeps the scheduler going, all tasks taking their turns as
+// usual, until the awaited task has finished. The awaiting task keeps its place and
+// its half-evaluated expression on the C++ stack, so nothing before the AWAIT is
+// evaluated twice, and a task that waits on a sibling (a flag set by another task,
+// say) still gets there. An AWAIT inside this nested scheduling nests once more.
+// Returns false if the task did not complete, e.g. because it is itself
+// (indirectly) waiting for the awaiting task or the program ended first.
+bool NeReLaBasic::finish_awaited_task(Task* task) {
+    if (task->waiting_in_await) return false;
+    Task* awaiting = current_task;
+    awaiting->waiting_in_await = true;
+
+    // --- Context Switch: park the awaiting task ---
+    const uint32_t saved_pcode = pcode;
+    const std::vector<uint8_t>* saved_p_code = active_p_code;
+    FunctionTable* saved_function_table = active_function_table;
+    const uint32_t saved_line = runtime_current_line;
+    std::swap(call_stack, awaiting->call_stack);
+    std::swap(for_stack, awaiting->for_stack);
+
+    while ((task->status == TaskStatus::RUNNING || task->status == TaskStatus::PAUSED_ON_AWAIT) &&
+           !program_ended && Error::get() == 0 && task_queue.count(0)) {
+        // A task that waits on one that failed never resumes.
+        if (task->status == TaskStatus::PAUSED_ON_AWAIT && task->awaiting_task &&
+            task->awaiting_task->status == TaskStatus::ERRORED) break;
+        process_system_events();
+        if (program_ended) break;
+        run_scheduler_round();
+    }
+
+    // --- Context Switch: back to the awaiting task ---
+    current_task = awaiting;
+    std::swap(call_stack, awaiting->call_stack);
+    std::swap(for_stack, awaiting->for_stack);
+    pcode = saved_pcode;
+    active_p_code = saved_p_code;
+    active_function_table = saved_function_table;
+    runtime_current_line = saved_line;
+    awaiting->waiting_in_await = false;
+    return task->status == TaskStatus::COMPLETED;
+}
 
-            if (!task_removed) { ++it; }
-        }
+// Starts sampling unless the profiler is already running. 'output_base' is the
+// report path without extension; empty means the program's file name.
+void NeReLaBasic::start_profiler(const std::string& output_base) {
+    if (profiler) return;
+    std::string base = output_base;
+    if (base.empty()) {
+        std::filesystem::path program_path(program_to_debug);
+        base = program_to_debug.empty() ? "jdbasic" : program_path.replace_extension().string();
+    }
+    profiler = std::make_unique<Profiler>(base);
+}
 
-        if (task_queue.empty() || !task_queue.count(0)) { break; }
+// Writes the profile of the run that just ended and stops the profiler.
+void NeReLaBasic::finish_profiler() {
+    if (!profiler) return;
+    const std::string base = profiler->output_base();
+    if (profiler->write_reports()) {
+        TextIO::print("Profile written to " + base + ".profile.txt and " + base + ".folded\n");
+    }
+    else {
+        TextIO::print("? Could not write the profile to " + base + ".profile.txt\n");
     }
+    profiler.reset();
+}
 
-#ifdef SDL3
-    graphics_system.shutdown();
-    sound_system.shutdown();
-#endif
-    current_task = nullptr;
+// True once the running task has had its share of the scheduler (see OPTION "TIMESLICE").
+bool NeReLaBasic::time_slice_used_up(uint32_t statements_run, std::chrono::steady_clock::time_point slice_start) const {
+    if (time_slice_statements == 0 && time_slice_us == 0) {
+        return true;
+    }
+    if (time_slice_statements != 0 && statements_run >= time_slice_statements) {
+        return true;
+    }
+    if (time_slice_us != 0) {
+        auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - slice_start);
+        return elapsed.count() >= time_slice_us;
+    }
+    return false;
 }
 
 void NeReLaBasic::statement() {
     Tokens::ID token = static_cast<Tokens::ID>((*active_p_code)[pcode]); // Peek at the token
+    Profiler::StatementScope profile_scope(profiler.get(), *this);
 
     // In trace mode, print the token being executed.
     if (trace == 1) {
@@ -1158,10 +1371,10 @@ void NeReLaBasic::statement() {
     case Tokens::ID::C_UNDERLINE:
         pcode++; // Fall through and consume C_CR
     case Tokens::ID::C_CR:
-        // This token is followed by a 2-byte line number. Skip it during execution.
+        // This token is followed by the next line's number. Skip it during execution.
         pcode++;
-        runtime_current_line = (*active_p_code)[pcode] | ((*active_p_code)[pcode + 1] << 8);
-        pcode += 2;
+        runtime_current_line = PCode::read_line(*active_p_code, pcode);
+        pcode += PCode::LINE_PREFIX_SIZE;
         break;
     case Tokens::ID::NOCMD: // we reached the end and do nothing more
         pcode++;
@@ -1199,7 +1412,9 @@ NeReLaBasic::NeReLaBasic(const NeReLaBasic& other) :
     compiled_modules(other.compiled_modules),
     user_defined_types(other.user_defined_types),
     builtin_constants(other.builtin_constants),
-    nopause_active(other.nopause_active)
+    nopause_active(other.nopause_active),
+    time_slice_statements(other.time_slice_statements),
+    time_slice_us(other.time_slice_us)
 {
     // --- 2. Initialize Runtime State to Defaults ---
     // These members represent the execution state and MUST be reset to their
@@ -1225,8 +1440,9 @@ NeReLaBasic::NeReLaBasic(const NeReLaBasic& other) :
     fgcolor = 2;
     bgcolor = 0;
 
-    // Stacks (must be empty for the new thread)
-    variables.clear();
+    // Stacks (must be empty for the new thread). The globals keep the parent's slot
+    // numbering so that the copied bytecode resolves to the same slots.
+    variables = GlobalVariables(other.variables.get_layout());
     for_stack.clear();
     call_stack.clear();
     func_stack.clear();
@@ -1267,6 +1483,18 @@ NeReLaBasic::NeReLaBasic(const NeReLaBasic& other) :
     active_p_code = &this->program_p_code;
     active_function_table = &this->main_function_table;
 
+    // The lowered bytecode is keyed by p-code buffer, so re-key it to our own copies.
+    // Its symbol ids refer to the parent's pool, which is shared read-only.
+    symbols = Bytecode::SymbolPool(other.symbols.share());
+    if (auto it = other.code_units.find(&other.program_p_code); it != other.code_units.end()) {
+        code_units[&this->program_p_code] = it->second;
+    }
+    for (const auto& [name, module] : other.compiled_modules) {
+        if (auto it = other.code_units.find(&module.p_code); it != other.code_units.end()) {
+            code_units[&compiled_modules.at(name).p_code] = it->second;
+        }
+    }
+
     // The hardware abstractions (Graphics, Sound, Network) are default-constructed,
     // which correctly gives the new instance its own non-initialized systems.
 
@@ -1275,42 +1503,67 @@ NeReLaBasic::NeReLaBasic(const NeReLaBasic& other) :
     // FunctionInfo structs are already correct.
 }
 
-BasicValue NeReLaBasic::launch_bsync_function(const FunctionInfo& func_info, const std::vector<BasicValue>& args) {
-    auto promise = std::make_shared<std::promise<BasicValue>>();
-    std::future<BasicValue> future = promise->get_future();
-
-    // The thread lambda captures the promise and arguments.
-    std::thread worker_thread([this, promise, func_info, args]() {
-        try {
-            // 1. Create a completely isolated copy of the interpreter.
-            auto thread_vm = std::make_unique<NeReLaBasic>(*this);
+void NeReLaBasic::reset_for_thread_job() {
+    // A worker interpreter keeps its program between jobs; only the runtime state
+    // left behind by the previous call is cleared (including its RETVAL).
+    variables.clear();
+    call_stack.clear();
+    for_stack.clear();
+    active_p_code = &program_p_code;
+    active_function_table = &main_function_table;
+    pcode = 0;
+    runtime_current_line = 0;
+    is_stopped = false;
+    program_ended = false;
+    jump_to_catch_pending = false;
+}
 
-            // 2. Execute the function synchronously *within this thread* using the isolated VM.
-            BasicValue result = thread_vm->execute_synchronous_function(func_info, args);
+BasicValue NeReLaBasic::launch_bsync_function(const FunctionInfo& func_info, const std::vector<BasicValue>& args) {
+    if (!thread_pool) {
+        thread_pool = std::make_unique<ThreadPool>();
+    }
 
-            // 3. Fulfill the promise with the result.
-            promise->set_value(result);
-        }
-        catch (const std::exception& e) {
-            // Handle exceptions within the thread to avoid crashing.
-            promise->set_exception(std::current_exception());
-        }
-        });
+    // Snapshot the program here, on the thread that owns it, and only when it has
+    // changed since the last THREAD call. The workers copy from the snapshot, never
+    // from this (running) instance.
+    if (!thread_program || thread_program_generation != program_generation) {
+        thread_program = std::make_shared<const NeReLaBasic>(*this);
+        thread_program_generation = program_generation;
+    }
 
-    // Get the ID of the thread we just created.
-    std::thread::id worker_id = worker_thread.get_id();
+    auto promise = std::make_shared<std::promise<BasicValue>>();
+    uint64_t job_id = next_thread_job_id++;
 
-    // Store the future so we can get the result later, keyed by the thread ID.
+    // Store the future so we can get the result later, keyed by the job number.
     {
         std::lock_guard<std::mutex> lock(background_tasks_mutex);
-        background_tasks[worker_id] = std::move(future);
+        background_tasks[job_id] = promise->get_future();
     }
 
-    // Detach the thread to let it run independently. The `future` is our way to sync with it.
-    worker_thread.detach();
+    // Only the function and its arguments are copied per call.
+    thread_pool->submit([program = thread_program, promise, func_info, args]() {
+        // Each worker reuses its interpreter until the program snapshot changes.
+        thread_local std::unique_ptr<NeReLaBasic> worker_vm;
+        thread_local std::shared_ptr<const NeReLaBasic> worker_program;
+        try {
+            if (!worker_vm || worker_program != program) {
+                worker_vm.reset();
+                worker_vm = std::make_unique<NeReLaBasic>(*program);
+                worker_program = program;
+            }
+            else {
+                worker_vm->reset_for_thread_job();
+            }
+            promise->set_value(worker_vm->execute_synchronous_function(func_info, args));
+        }
+        catch (...) {
+            // Handle exceptions within the worker to avoid crashing.
+            promise->set_exception(std::current_exception());
+        }
+        });
 
     // Return the handle to the BASIC script.
-    return ThreadHandle{ worker_id };
+    return ThreadHandle{ job_id };
 }
 
 // A generic helper to apply any binary operation element-wise.
@@ -1332,7 +1585,7 @@ static BasicValue apply_binary_op(
         result_ptr->data.reserve(left_ptr->data.size());
 
         for (size_t i = 0; i < left_ptr->data.size(); ++i) {
-            result_ptr->data.push_back(op(left_ptr->data[i], right_ptr->data[i]));
+            result_ptr->data.push_back(op(left_ptr->data.get(i), right_ptr->data.get(i)));
         }
         return result_ptr;
     }
@@ -1345,8 +1598,8 @@ static BasicValue apply_binary_op(
         result_ptr->shape = left_ptr->shape;
         result_ptr->data.reserve(left_ptr->data.size());
 
-        for (const auto& elem : left_ptr->data) {
-            result_ptr->data.push_back(op(elem, right));
+        for (size_t i = 0; i < left_ptr->data.size(); ++i) {
+            result_ptr->data.push_back(op(left_ptr->data.get(i), right));
         }
         return result_ptr;
     }
@@ -1359,8 +1612,8 @@ static BasicValue apply_binary_op(
         result_ptr->shape = right_ptr->shape;
         result_ptr->data.reserve(right_ptr->data.size());
 
-        for (const auto& elem : right_ptr->data) {
-            result_ptr->data.push_back(op(left, elem));
+        for (size_t i = 0; i < right_ptr->data.size(); ++i) {
+            result_ptr->data.push_back(op(left, right_ptr->data.get(i)));
         }
         return result_ptr;
     }
@@ -1370,6 +1623,21 @@ static BasicValue apply_binary_op(
     }
 }
 
+// Unary minus: strings are split into an array of characters, everything else is negated numerically.
+static BasicValue negate_value(const BasicValue& value) {
+    if (std::holds_alternative<BasicString>(value)) {
+        const std::string& s = std::get<BasicString>(value);
+        auto result_ptr = std::make_shared<Array>();
+        result_ptr->shape = { s.length() };
+        result_ptr->data.reserve(s.length());
+        for (char c : s) {
+            result_ptr->data.push_back(std::string(1, c));
+        }
+        return result_ptr;
+    }
+    return -to_double(value);
+}
+
 // --- CLASS MEMBER FUNCTION FOR PARSING ARRAY LITERALS ---
 BasicValue NeReLaBasic::parse_array_literal() {
     // We expect the current token to be '['
@@ -1540,7 +1808,7 @@ BasicValue NeReLaBasic::parse_primary() {
         }
         pcode++; // Consume CALLFUNC
 
-        std::string func_name = to_upper(read_string(*this));
+        const std::string& func_name = read_symbol(*this).name;
         if (!active_function_table->count(func_name)) {
             Error::set(22, runtime_current_line, "Function not found for THREAD: " + func_name);
             return {};
@@ -1565,7 +1833,7 @@ BasicValue NeReLaBasic::parse_primary() {
     }
     else if (token == Tokens::ID::OP_START_TASK) {
         pcode++; // consume OP_START_TASK
-        std::string func_name = to_upper(read_string(*this));
+        const std::string& func_name = read_symbol(*this).name;
         if (!active_function_table->count(func_name)) {
             Error::set(22, runtime_current_line, "Async function not found: " + func_name);
             return {};
@@ -1595,13 +1863,14 @@ BasicValue NeReLaBasic::parse_primary() {
         new_task->p_code_counter = func_info.start_pcode + 1; //Dirty JD was here!
 
         StackFrame frame;
+        frame.local_variables = LocalVariables(func_info.locals);
         frame.function_name = func_name;
         frame.is_async_call = func_info.is_async;
         frame.previous_function_table_ptr = this->active_function_table; //JD ??
         for (size_t i = 0; i < func_info.parameter_names.size(); ++i) {
-            if (i < args.size()) frame.local_variables[func_info.parameter_names[i]] = args[i];
+            if (i < args.size()) set_parameter(frame.local_variables, func_info, i, args[i]);
         }
-        new_task->call_stack.push_back(frame);
+        new_task->call_stack.push_back(std::move(frame));
         task_queue[new_task->id] = new_task;
         current_value = TaskRef{ new_task->id };
 
@@ -1609,7 +1878,7 @@ BasicValue NeReLaBasic::parse_primary() {
     else {
         if (token == Tokens::ID::VARIANT || token == Tokens::ID::INT || token == Tokens::ID::STRVAR) {
             pcode++;
-            std::string var_or_qual_name = to_upper(read_string(*this));
+            const std::string& var_or_qual_name = read_symbol(*this).name;
 
             if (var_or_qual_name.find('.') != std::string::npos) {
                 auto [final_obj, final_member] = resolve_dot_chain(var_or_qual_name);
@@ -1617,8 +1886,9 @@ BasicValue NeReLaBasic::parse_primary() {
                 if (final_member.empty()) { current_value = final_obj; }
                 else if (std::holds_alternative<std::shared_ptr<Map>>(final_obj)) {
                     auto& map_ptr = std::get<std::shared_ptr<Map>>(final_obj);
-                    if (map_ptr && map_ptr->data.count(final_member)) {
-                        current_value = map_ptr->data.at(final_member);
+                    uint32_t slot = map_ptr ? map_ptr->data.slot_of(final_member) : MapKeys::NONE;
+                    if (slot != MapKeys::NONE) {
+                        current_value = map_ptr->data.slot(slot);
                     }
                     else { Error::set(3, runtime_current_line, "Member not found: " + final_member); return {}; }
                 }
@@ -1659,18 +1929,21 @@ BasicValue NeReLaBasic::parse_primary() {
         }
         else if (token == Tokens::ID::CALLFUNC) {
             pcode++;
-            std::string identifier_being_called = to_upper(read_string(*this));
-            std::string real_func_to_call = identifier_being_called;
+            const std::string& identifier_being_called = read_symbol(*this).name;
+            // A variable holding a function reference calls the function it names.
+            BasicString func_ref_target;
+            const std::string* real_func_to_call = &identifier_being_called;
 
-            if (!active_function_table->count(real_func_to_call)) {
+            if (!active_function_table->count(identifier_being_called)) {
                 BasicValue& var = get_variable(*this, identifier_being_called);
                 if (std::holds_alternative<FunctionRef>(var)) {
-                    real_func_to_call = std::get<FunctionRef>(var).name;
+                    func_ref_target = std::get<FunctionRef>(var).name;
+                    real_func_to_call = &func_ref_target.str();
                 }
             }
 
-            if (active_function_table->count(real_func_to_call)) {
-                const auto& func_info = active_function_table->at(real_func_to_call);
+            if (auto func_it = active_function_table->find(*real_func_to_call); func_it != active_function_table->end()) {
+                const auto& func_info = func_it->second;
 
                 std::vector<BasicValue> args = parse_argument_list();
                 if (Error::get() != 0) return {};
@@ -1759,7 +2032,7 @@ BasicValue NeReLaBasic::parse_primary() {
 #endif
             }
             else { 
-                Error::set(22, runtime_current_line, "Unknown function: " + real_func_to_call); return {}; 
+                Error::set(22, runtime_current_line, "Unknown function: " + *real_func_to_call); return {}; 
             }
         }
         else if (token == Tokens::ID::THIS_KEYWORD) {
@@ -1790,13 +2063,13 @@ BasicValue NeReLaBasic::parse_primary() {
             current_value = value;
         }
         else if (token == Tokens::ID::STRING) {
-            pcode++; current_value = read_string(*this);
+            pcode++; current_value = read_symbol(*this).text;
         }
         else if (token == Tokens::ID::CONSTANT) {
-            pcode++; current_value = builtin_constants.at(read_string(*this));
+            pcode++; current_value = builtin_constants.at(read_symbol(*this).text);
         }
         else if (token == Tokens::ID::FUNCREF) {
-            pcode++; current_value = FunctionRef{ to_upper(read_string(*this)) };
+            pcode++; current_value = FunctionRef{ read_symbol(*this).name };
         }
         else if (token == Tokens::ID::C_LEFTBRACKET) {
             current_value = parse_array_literal();
@@ -1816,6 +2089,7 @@ BasicValue NeReLaBasic::parse_primary() {
     }
 
     // --- MAIN LOOP FOR HANDLING ACCESSORS LIKE [..], {..}, .member ---
+    bool json_accessed = false; // a JSON array at the end of the chain becomes an Array
     while (true) {
         Tokens::ID accessor_token = static_cast<Tokens::ID>((*active_p_code)[pcode]);
 
@@ -1941,7 +2215,7 @@ BasicValue NeReLaBasic::parse_primary() {
                     for (long long i = 0; i < num_reads; ++i) {
                         for (size_t dim = 0; dim < index_expressions.size(); ++dim) {
                             if (std::holds_alternative<std::shared_ptr<Array>>(index_expressions[dim])) {
-                                current_coords[dim] = static_cast<size_t>(to_double(std::get<std::shared_ptr<Array>>(index_expressions[dim])->data[i]));
+                                current_coords[dim] = static_cast<size_t>(std::get<std::shared_ptr<Array>>(index_expressions[dim])->data.number(i));
                             }
                             else {
                                 current_coords[dim] = static_cast<size_t>(to_double(index_expressions[dim]));
@@ -1949,7 +2223,7 @@ BasicValue NeReLaBasic::parse_primary() {
                         }
                         try {
                             size_t flat_index = arr_ptr->get_flat_index(current_coords);
-                            result_ptr->data.push_back(arr_ptr->data[flat_index]);
+                            result_ptr->data.push_back(arr_ptr->data.get(flat_index));
                         }
                         catch (const std::exception&) {
                             Error::set(10, runtime_current_line, "Array index out of bounds during vectorized read.");
@@ -1969,8 +2243,7 @@ BasicValue NeReLaBasic::parse_primary() {
                         if (flat_index >= arr_ptr->data.size()) {
                             throw std::out_of_range("Calculated index is out of bounds.");
                         }
-                        BasicValue next_val = arr_ptr->data[flat_index];
-                        current_value = std::move(next_val);
+                        current_value = arr_ptr->data.get(flat_index);
                     }
                     catch (const std::exception&) {
                         Error::set(10, runtime_current_line, "Array index out of bounds or dimension mismatch.");
@@ -1984,8 +2257,9 @@ BasicValue NeReLaBasic::parse_primary() {
                 }
                 size_t index = static_cast<size_t>(to_double(index_expressions[0]));
                 const auto& json_ptr = std::get<std::shared_ptr<JsonObject>>(current_value);
-                if (!json_ptr || !json_ptr->data.is_array() || index >= json_ptr->data.size()) { Error::set(10, runtime_current_line, "JSON index out of bounds."); return {}; }
-                current_value = json_to_basic_value(json_ptr->data[index]);
+                if (!json_ptr || !json_ptr->value().is_array() || index >= json_ptr->value().size()) { Error::set(10, runtime_current_line, "JSON index out of bounds."); return {}; }
+                current_value = json_view(*json_ptr, json_ptr->value()[index]);
+                json_accessed = true;
             }
             else { Error::set(15, runtime_current_line, "Indexing '[]' can only be used on an Array."); return {}; }
 
@@ -1999,14 +2273,18 @@ BasicValue NeReLaBasic::parse_primary() {
 
             if (std::holds_alternative<std::shared_ptr<Map>>(current_value)) {
                 const auto& map_ptr = std::get<std::shared_ptr<Map>>(current_value);
-                if (!map_ptr || map_ptr->data.find(key) == map_ptr->data.end()) { Error::set(3, runtime_current_line, "Map key not found: " + key); return {}; }
-                BasicValue next_val = map_ptr->data.at(key);
+                uint32_t slot = map_ptr ? map_ptr->data.slot_of(key) : MapKeys::NONE;
+                if (slot == MapKeys::NONE) { Error::set(3, runtime_current_line, "Map key not found: " + key); return {}; }
+                BasicValue next_val = map_ptr->data.slot(slot);
                 current_value = std::move(next_val);
             }
             else if (std::holds_alternative<std::shared_ptr<JsonObject>>(current_value)) {
                 const auto& json_ptr = std::get<std::shared_ptr<JsonObject>>(current_value);
-                if (!json_ptr || !json_ptr->data.is_object() || !json_ptr->data.contains(key)) { Error::set(3, runtime_current_line, "JSON key not found: " + key); return {}; }
-                current_value = json_to_basic_value(json_ptr->data.at(key));
+                if (!json_ptr || !json_ptr->value().is_object()) { Error::set(3, runtime_current_line, "JSON key not found: " + key); return {}; }
+                auto member = json_ptr->value().find(key);
+                if (member == json_ptr->value().end()) { Error::set(3, runtime_current_line, "JSON key not found: " + key); return {}; }
+                current_value = json_view(*json_ptr, *member);
+                json_accessed = true;
             }
             else { Error::set(15, runtime_current_line, "Key access '{}' can only be used on a Map or JSON object."); return {}; }
 
@@ -2018,7 +2296,7 @@ BasicValue NeReLaBasic::parse_primary() {
         //                Error::set(1, runtime_current_line, "Expected member name after '.'"); return {};
         //            }
         //            pcode++;
-        //            std::string member_name = to_upper(read_string(*this));
+        //            const std::string& member_name = read_symbol(*this).name;
         //
         //            if (std::holds_alternative<std::shared_ptr<Map>>(current_value)) {
         //                const auto& map_ptr = std::get<std::shared_ptr<Map>>(current_value);
@@ -2043,7 +2321,7 @@ BasicValue NeReLaBasic::parse_primary() {
                 Error::set(1, runtime_current_line, "Expected member name after '.'"); return {};
             }
             pcode++; // Consume the variant/int/strvar token
-            std::string member_name = to_upper(read_string(*this));
+            const std::string& member_name = read_symbol(*this).name;
 
             // --- Look ahead for a function call ---
             Tokens::ID after_member_token = static_cast<Tokens::ID>((*active_p_code)[pcode]);
@@ -2081,8 +2359,10 @@ BasicValue NeReLaBasic::parse_primary() {
                 // --- Case B: It's a DATA MEMBER ACCESS, e.g., .Name ---
                 if (std::holds_alternative<std::shared_ptr<Map>>(current_value)) {
                     const auto& map_ptr = std::get<std::shared_ptr<Map>>(current_value);
-                    if (!map_ptr || map_ptr->data.find(member_name) == map_ptr->data.end()) { Error::set(3, runtime_current_line, "Member '" + member_name + "' not found in object."); return {}; }
-                    current_value = map_ptr->data.at(member_name);
+                    uint32_t slot = map_ptr ? map_ptr->data.slot_of(member_name) : MapKeys::NONE;
+                    if (slot == MapKeys::NONE) { Error::set(3, runtime_current_line, "Member '" + member_name + "' not found in object."); return {}; }
+                    BasicValue member = map_ptr->data.slot(slot);
+                    current_value = std::move(member);
                 }
 #ifdef JDCOM
                 else if (std::holds_alternative<ComObject>(current_value)) {
@@ -2100,6 +2380,7 @@ BasicValue NeReLaBasic::parse_primary() {
             break; // No more accessors, break the loop
         }
     }
+    if (json_accessed) json_array_to_basic(current_value);
     return current_value;
 }
 
@@ -2132,6 +2413,18 @@ BasicValue NeReLaBasic::parse_unary() {
                 return false; // Dummy value, will be re-evaluated
             }
         }
+        else if (auto running = task_queue.find(task_id_to_await);
+                 current_task && running != task_queue.end() && running->second.get() != current_task) {
+            // The task is still running (it can take longer than the awaiting task's time
+            // slice). Schedule the other tasks until it is done, then continue with the
+            // rest of this expression.
+            std::shared_ptr<Task> task = running->second;
+            if (!finish_awaited_task(task.get())) {
+                return Error::get() != 0 ? BasicValue{} : BasicValue{ false };
+            }
+            task_completed.erase(task->id); // AWAIT consumes the result, as for a completed task
+            return task->result;
+        }
         else {
             // Task not found, assume it's done.
             return false; // Return default value
@@ -2141,22 +2434,7 @@ BasicValue NeReLaBasic::parse_unary() {
     if (token == Tokens::ID::C_MINUS) {
         pcode++; // Consume the '-'
         BasicValue value = parse_unary(); // Evaluate the expression first
-
-        // If the value is a string, split it into an array of characters.
-        if (std::holds_alternative<std::string>(value)) {
-            const std::string& s = std::get<std::string>(value);
-            auto result_ptr = std::make_shared<Array>();
-            result_ptr->shape = { s.length() };
-            result_ptr->data.reserve(s.length());
-            for (char c : s) {
-                result_ptr->data.push_back(std::string(1, c));
-            }
-            return result_ptr;
-        }
-        else {
-            // Otherwise, perform the original numeric negation.
-            return -to_double(value);
-        }
+        return negate_value(value);
     }    
     if (token == Tokens::ID::NOT) {
         pcode++; // Consume 'NOT'
@@ -2168,50 +2446,183 @@ BasicValue NeReLaBasic::parse_unary() {
     return parse_primary();
 }
 
+// Runs an arithmetic operator over an array through Kernels::binary. Either side
+// may be a scalar (a null array), which is broadcast over the other one.
+static BasicValue array_kernel_op(Kernels::Binary op, const std::shared_ptr<Array>& l, double l_scalar, const std::shared_ptr<Array>& r, double r_scalar) {
+    const auto& shape_src = l ? l : r;
+    std::vector<double> l_scratch, r_scratch;
+    const double* a = l ? l->data.numbers(l_scratch) : &l_scalar;
+    const double* b = r ? r->data.numbers(r_scratch) : &r_scalar;
+    auto result_ptr = std::make_shared<Array>(); result_ptr->shape = shape_src->shape;
+    std::vector<double> out(shape_src->data.size());
+    Kernels::binary(op, a, l ? 1 : 0, b, r ? 1 : 0, out.data(), out.size());
+    result_ptr->data = ArrayData::of_doubles(std::move(out));
+    return result_ptr;
+}
+
+// The same for the comparison operators; the result is a BOOL array.
+static BasicValue array_kernel_compare(Tokens::ID op, const std::shared_ptr<Array>& l, double l_scalar, const std::shared_ptr<Array>& r, double r_scalar) {
+    Kernels::Compare kernel_op;
+    switch (op) {
+    case Tokens::ID::C_EQ: kernel_op = Kernels::Compare::EQ; break;
+    case Tokens::ID::C_NE: kernel_op = Kernels::Compare::NE; break;
+    case Tokens::ID::C_LT: kernel_op = Kernels::Compare::LT; break;
+    case Tokens::ID::C_GT: kernel_op = Kernels::Compare::GT; break;
+    case Tokens::ID::C_LE: kernel_op = Kernels::Compare::LE; break;
+    default: kernel_op = Kernels::Compare::GE; break;
+    }
+    const auto& shape_src = l ? l : r;
+    std::vector<double> l_scratch, r_scratch;
+    const double* a = l ? l->data.numbers(l_scratch) : &l_scalar;
+    const double* b = r ? r->data.numbers(r_scratch) : &r_scalar;
+    auto result_ptr = std::make_shared<Array>(); result_ptr->shape = shape_src->shape;
+    std::vector<uint8_t> out(shape_src->data.size());
+    Kernels::compare(kernel_op, a, l ? 1 : 0, b, r ? 1 : 0, out.data(), out.size());
+    result_ptr->data = ArrayData::of_bools(std::move(out));
+    return result_ptr;
+}
+
+// True if a divisor array holds a zero anywhere.
+static bool has_zero_element(const Array& arr) {
+    std::vector<double> scratch;
+    const double* values = arr.data.numbers(scratch);
+    return std::find(values, values + arr.data.size(), 0.0) != values + arr.data.size();
+}
+
+// Applies ^ to two values, element-wise for arrays.
+BasicValue NeReLaBasic::apply_power_op(const BasicValue& left, const BasicValue& right) {
+    if (std::holds_alternative<std::shared_ptr<Tensor>>(left)) {
+        if (std::holds_alternative<std::shared_ptr<Tensor>>(right)) {
+            Error::set(1, runtime_current_line, "Tensor-to-Tensor power is not supported."); return {};
+        }
+        return tensor_power(*this, left, right);
+    }
+    else {
+        return std::visit([this](auto&& l, auto&& r) -> BasicValue {
+            using LeftT = std::decay_t<decltype(l)>;
+            using RightT = std::decay_t<decltype(r)>;
+
+            if constexpr (std::is_same_v<LeftT, std::shared_ptr<Array>> && std::is_same_v<RightT, std::shared_ptr<Array>>) {
+                if (l->shape != r->shape) { Error::set(15, runtime_current_line, "Shape mismatch for element-wise power."); return false; }
+                return array_kernel_op(Kernels::Binary::POW, l, 0.0, r, 0.0);
+            }
+            else if constexpr (std::is_same_v<LeftT, std::shared_ptr<Array>>) { return array_kernel_op(Kernels::Binary::POW, l, 0.0, nullptr, to_double(r)); }
+            else if constexpr (std::is_same_v<RightT, std::shared_ptr<Array>>) { return array_kernel_op(Kernels::Binary::POW, nullptr, to_double(l), r, 0.0); }
+            else { return std::pow(to_double(l), to_double(r)); }
+            }, left, right);
+    }
+}
+
 BasicValue NeReLaBasic::parse_power() {
     BasicValue left = parse_unary();
-    while (true) {
-        Tokens::ID op = static_cast<Tokens::ID>((*active_p_code)[pcode]);
-        if (op == Tokens::ID::C_CARET) {
-            pcode++;
-            BasicValue right = parse_unary();
+    while (static_cast<Tokens::ID>((*active_p_code)[pcode]) == Tokens::ID::C_CARET) {
+        pcode++;
+        BasicValue right = parse_unary();
+        left = apply_power_op(left, right);
+        if (Error::get() != 0) return {};
+    }
+    return left;
+}
+
+// Applies *, / or MOD to two values (numbers, strings, arrays or tensors).
+BasicValue NeReLaBasic::apply_factor_op(Tokens::ID op, const BasicValue& left, const BasicValue& right) {
+    bool is_left_tensor = std::holds_alternative<std::shared_ptr<Tensor>>(left);
 
-            if (std::holds_alternative<std::shared_ptr<Tensor>>(left)) {
-                if (std::holds_alternative<std::shared_ptr<Tensor>>(right)) {
-                    Error::set(1, runtime_current_line, "Tensor-to-Tensor power is not supported."); return {};
+    if (is_left_tensor) {
+        if (op == Tokens::ID::C_ASTR) {
+            if (!std::holds_alternative<std::shared_ptr<Tensor>>(right)) { Error::set(15, runtime_current_line, "Tensor can only be element-wise multiplied by another Tensor."); return {}; }
+            return tensor_elementwise_multiply(*this, left, right);
+        }
+        else if (op == Tokens::ID::C_SLASH) {
+            if (std::holds_alternative<std::shared_ptr<Tensor>>(right)) { Error::set(1, runtime_current_line, "Tensor-by-Tensor division is not supported."); return {}; }
+            return tensor_scalar_divide(*this, left, right);
+        }
+        else { // MOD
+            Error::set(1, runtime_current_line, "MOD operator is not supported for Tensors."); return {};
+        }
+    }
+    else {
+        return std::visit([op, this](auto&& l, auto&& r) -> BasicValue {
+            using LeftT = std::decay_t<decltype(l)>; using RightT = std::decay_t<decltype(r)>;
+
+            if constexpr ((std::is_same_v<LeftT, BasicString> && !std::is_same_v<RightT, BasicString> && !std::is_same_v<RightT, std::shared_ptr<Array>>) ||
+                (!std::is_same_v<LeftT, BasicString> && !std::is_same_v<LeftT, std::shared_ptr<Array>> && std::is_same_v<RightT, BasicString>)) {
+
+                if (op == Tokens::ID::C_ASTR) { // String repetition
+                    std::string s;
+                    int count;
+                    if constexpr (std::is_same_v<LeftT, BasicString>) {
+                        s = l;
+                        count = static_cast<int>(to_double(r));
+                    }
+                    else {
+                        s = r;
+                        count = static_cast<int>(to_double(l));
+                    }
+                    if (count < 0) count = 0;
+                    std::stringstream ss;
+                    for (int i = 0; i < count; ++i) {
+                        ss << s;
+                    }
+                    return ss.str();
+                }
+
+                if (op == Tokens::ID::C_SLASH) { // String slicing
+                    if constexpr (std::is_same_v<LeftT, BasicString>) { // e.g. "Atomi" / 2
+                        std::string s = l;
+                        int count = static_cast<int>(to_double(r));
+                        if (count < 0) count = 0;
+                        if (static_cast<size_t>(count) > s.length()) return s;
+                        return s.substr(s.length() - count);
+                    }
+                    else { // e.g. 2 / "Atomi"
+                        std::string s = r;
+                        int count = static_cast<int>(to_double(l));
+                        if (count < 0) count = 0;
+                        return s.substr(0, count);
+                    }
                 }
-                left = tensor_power(*this, left, right);
             }
-            else {
-                left = std::visit([this](auto&& l, auto&& r) -> BasicValue {
-                    using LeftT = std::decay_t<decltype(l)>;
-                    using RightT = std::decay_t<decltype(r)>;
-
-                    auto array_op = [this](const auto& arr, double scalar, bool arr_is_left) -> BasicValue {
-                        auto result_ptr = std::make_shared<Array>(); result_ptr->shape = arr->shape;
-                        for (const auto& elem : arr->data) {
-                            double arr_val = to_double(elem);
-                            double res = arr_is_left ? std::pow(arr_val, scalar) : std::pow(scalar, arr_val);
-                            result_ptr->data.push_back(res);
-                        }
-                        return result_ptr;
-                        };
-
-                    if constexpr (std::is_same_v<LeftT, std::shared_ptr<Array>> && std::is_same_v<RightT, std::shared_ptr<Array>>) {
-                        if (l->shape != r->shape) { Error::set(15, runtime_current_line, "Shape mismatch for element-wise power."); return false; }
-                        auto result_ptr = std::make_shared<Array>(); result_ptr->shape = l->shape;
-                        for (size_t i = 0; i < l->data.size(); ++i) { result_ptr->data.push_back(std::pow(to_double(l->data[i]), to_double(r->data[i]))); }
-                        return result_ptr;
+
+            Kernels::Binary kernel_op = op == Tokens::ID::C_ASTR ? Kernels::Binary::MUL : (op == Tokens::ID::C_SLASH ? Kernels::Binary::DIV : Kernels::Binary::MOD);
+            bool divides = kernel_op != Kernels::Binary::MUL;
+
+            // The kernels do not check divisors, so zeros are looked for up front.
+            if constexpr (std::is_same_v<LeftT, std::shared_ptr<Array>> && std::is_same_v<RightT, std::shared_ptr<Array>>) {
+                if (l->shape != r->shape) { Error::set(15, runtime_current_line, "Shape mismatch for element-wise operation."); return false; }
+                if (divides && has_zero_element(*r)) { Error::set(2, runtime_current_line, "Division by zero."); return false; }
+                return array_kernel_op(kernel_op, l, 0.0, r, 0.0);
+            }
+            else if constexpr (std::is_same_v<LeftT, std::shared_ptr<Array>>) {
+                double scalar = to_double(r);
+                if (divides && scalar == 0.0 && !l->data.empty()) { Error::set(2, runtime_current_line, "Division by zero."); return false; }
+                return array_kernel_op(kernel_op, l, 0.0, nullptr, scalar);
+            }
+            else if constexpr (std::is_same_v<RightT, std::shared_ptr<Array>>) {
+                if (divides && has_zero_element(*r)) { Error::set(2, runtime_current_line, "Division by zero."); return false; }
+                return array_kernel_op(kernel_op, nullptr, to_double(l), r, 0.0);
+            }
+            else { // scalar op
+                if constexpr (std::is_same_v<LeftT, double> || std::is_same_v<RightT, double>) {
+                    double val_l = to_double(l); double val_r = to_double(r);
+                    if (op == Tokens::ID::C_ASTR) return val_l * val_r;
+                    if (op == Tokens::ID::C_SLASH) { if (val_r == 0.0) { Error::set(2, runtime_current_line); return false; } return val_l / val_r; }
+                    if (op == Tokens::ID::MOD) { if (val_r == 0.0) { Error::set(2, runtime_current_line); return false; } return static_cast<double>(static_cast<long long>(val_l) % static_cast<long long>(val_r)); }
+                }
+                else {
+                    if (op == Tokens::ID::C_ASTR) {
+                        int left_i = to_int(l);
+                        int right_i = to_int(r);
+                        return left_i * right_i;
                     }
-                    else if constexpr (std::is_same_v<LeftT, std::shared_ptr<Array>>) { return array_op(l, to_double(r), true); }
-                    else if constexpr (std::is_same_v<RightT, std::shared_ptr<Array>>) { return array_op(r, to_double(l), false); }
-                    else { return std::pow(to_double(l), to_double(r)); }
-                    }, left, right);
+                    double val_l = to_double(l); double val_r = to_double(r);
+                    if (op == Tokens::ID::C_SLASH) { if (val_r == 0.0) { Error::set(2, runtime_current_line); return false; } return val_l / val_r; }
+                    if (op == Tokens::ID::MOD) { if (val_r == 0.0) { Error::set(2, runtime_current_line); return false; } return static_cast<double>(static_cast<long long>(val_l) % static_cast<long long>(val_r)); }
+                }
             }
-        }
-        else { break; }
+            return false;
+        }, left, right);
     }
-    return left;
 }
 
 // Level 3: Handles *, /, and MOD
@@ -2224,7 +2635,7 @@ BasicValue NeReLaBasic::parse_factor() {
 
             // --- Handle user-defined operators ---
             if (op == Tokens::ID::FUNCREF) {
-                std::string func_name = to_upper(read_string(*this));
+                const std::string& func_name = read_symbol(*this).name;
 
                 BasicValue right = parse_power();
 
@@ -2298,123 +2709,93 @@ BasicValue NeReLaBasic::parse_factor() {
             else
             {
                 BasicValue right = parse_power();
+                left = apply_factor_op(op, left, right);
+                if (Error::get() != 0) return {};
+            }
+        }
+        else { break; }
+    }
+    return left;
+}
 
-                bool is_left_tensor = std::holds_alternative<std::shared_ptr<Tensor>>(left);
-
-                if (is_left_tensor) {
-                    if (op == Tokens::ID::C_ASTR) {
-                        if (!std::holds_alternative<std::shared_ptr<Tensor>>(right)) { Error::set(15, runtime_current_line, "Tensor can only be element-wise multiplied by another Tensor."); return {}; }
-                        left = tensor_elementwise_multiply(*this, left, right);
-                    }
-                    else if (op == Tokens::ID::C_SLASH) {
-                        if (std::holds_alternative<std::shared_ptr<Tensor>>(right)) { Error::set(1, runtime_current_line, "Tensor-by-Tensor division is not supported."); return {}; }
-                        left = tensor_scalar_divide(*this, left, right);
+// Applies + or - to two values (numbers, strings, arrays or tensors).
+BasicValue NeReLaBasic::apply_term_op(Tokens::ID op, const BasicValue& left, const BasicValue& right) {
+    if (std::holds_alternative<std::shared_ptr<Tensor>>(left) || std::holds_alternative<std::shared_ptr<Tensor>>(right)) {
+        if (!std::holds_alternative<std::shared_ptr<Tensor>>(left) || !std::holds_alternative<std::shared_ptr<Tensor>>(right)) {
+            Error::set(15, runtime_current_line, "Cannot mix Tensor and non-Tensor types in add/subtract."); return {};
+        }
+        if (op == Tokens::ID::C_PLUS) { return tensor_add(*this, left, right); }
+        else { return tensor_subtract(*this, left, right); }
+    }
+    else {
+        return std::visit([op, this](auto&& l, auto&& r) -> BasicValue {
+            using LeftT = std::decay_t<decltype(l)>; using RightT = std::decay_t<decltype(r)>;
+            if constexpr (std::is_same_v<LeftT, BasicString> || std::is_same_v<RightT, BasicString>) {
+                if (op == Tokens::ID::C_PLUS) {
+                    return to_string(l) + to_string(r);
+                }
+                else { // Subtraction is now string replacement
+                    std::string s_left = to_string(l);
+                    std::string s_right = to_string(r);
+                    if (s_right.empty()) return s_left; // Avoid infinite loop
+                    size_t pos = s_left.find(s_right);
+                    while (pos != std::string::npos) {
+                        s_left.erase(pos, s_right.length());
+                        pos = s_left.find(s_right, pos);
                     }
-                    else { // MOD
-                        Error::set(1, runtime_current_line, "MOD operator is not supported for Tensors."); return {};
+                    return s_left;
+                }
+            }
+            else if constexpr (std::is_same_v<LeftT, std::shared_ptr<Array>> && std::is_same_v<RightT, std::shared_ptr<Array>>) {
+                // This uses the same array_add/subtract helpers from BuiltinFunctions.cpp
+                // Ensure they are globally accessible or duplicate the logic here.
+                if (!l || !r || l->data.empty()) { // Handle null or empty arrays
+                    if (op == Tokens::ID::C_PLUS) return r; else return l;
+                }
+                // Check if either array contains strings to decide the operation type
+                bool is_string_op = std::holds_alternative<BasicString>(l->data.get(0)) || std::holds_alternative<BasicString>(r->data.get(0));
+
+                if (op == Tokens::ID::C_PLUS && is_string_op) {
+                    // Perform element-wise string concatenation
+                    if (l->shape != r->shape) { Error::set(15, 0, "Array shapes must match for element-wise operation."); return {}; }
+                    auto result_ptr = std::make_shared<Array>();
+                    result_ptr->shape = l->shape;
+                    result_ptr->data.reserve(l->data.size());
+                    for (size_t i = 0; i < l->data.size(); ++i) {
+                        result_ptr->data.push_back(to_string(l->data.get(i)) + to_string(r->data.get(i)));
                     }
+                    return result_ptr;
                 }
                 else {
-                    left = std::visit([op, this](auto&& l, auto&& r) -> BasicValue {
-                        using LeftT = std::decay_t<decltype(l)>; using RightT = std::decay_t<decltype(r)>;
-
-                        if constexpr ((std::is_same_v<LeftT, std::string> && !std::is_same_v<RightT, std::string> && !std::is_same_v<RightT, std::shared_ptr<Array>>) ||
-                            (!std::is_same_v<LeftT, std::string> && !std::is_same_v<LeftT, std::shared_ptr<Array>> && std::is_same_v<RightT, std::string>)) {
-
-                            if (op == Tokens::ID::C_ASTR) { // String repetition
-                                std::string s;
-                                int count;
-                                if constexpr (std::is_same_v<LeftT, std::string>) {
-                                    s = l;
-                                    count = static_cast<int>(to_double(r));
-                                }
-                                else {
-                                    s = r;
-                                    count = static_cast<int>(to_double(l));
-                                }
-                                if (count < 0) count = 0;
-                                std::stringstream ss;
-                                for (int i = 0; i < count; ++i) {
-                                    ss << s;
-                                }
-                                return ss.str();
-                            }
-
-                            if (op == Tokens::ID::C_SLASH) { // String slicing
-                                if constexpr (std::is_same_v<LeftT, std::string>) { // e.g. "Atomi" / 2
-                                    std::string s = l;
-                                    int count = static_cast<int>(to_double(r));
-                                    if (count < 0) count = 0;
-                                    if (static_cast<size_t>(count) > s.length()) return s;
-                                    return s.substr(s.length() - count);
-                                }
-                                else { // e.g. 2 / "Atomi"
-                                    std::string s = r;
-                                    int count = static_cast<int>(to_double(l));
-                                    if (count < 0) count = 0;
-                                    return s.substr(0, count);
-                                }
-                            }
-                        }
-
-                        auto array_op = [op, this](const auto& arr, double scalar, bool arr_is_left) -> BasicValue {
-                            auto result_ptr = std::make_shared<Array>(); result_ptr->shape = arr->shape;
-                            for (const auto& elem : arr->data) {
-                                double arr_val = to_double(elem); double res = 0;
-                                if (op == Tokens::ID::C_ASTR) res = arr_is_left ? arr_val * scalar : scalar * arr_val;
-                                else if (op == Tokens::ID::C_SLASH) {
-                                    if ((arr_is_left && scalar == 0.0) || (!arr_is_left && arr_val == 0.0)) { Error::set(2, runtime_current_line, "Division by zero."); return false; }
-                                    res = arr_is_left ? arr_val / scalar : scalar / arr_val;
-                                }
-                                else { // MOD
-                                    if ((arr_is_left && scalar == 0.0) || (!arr_is_left && arr_val == 0.0)) { Error::set(2, runtime_current_line, "Division by zero."); return false; }
-                                    res = static_cast<double>(arr_is_left ? static_cast<long long>(arr_val) % static_cast<long long>(scalar) : static_cast<long long>(scalar) % static_cast<long long>(arr_val));
-                                }
-                                result_ptr->data.push_back(res);
-                            }
-                            return result_ptr;
-                            };
-
-                        if constexpr (std::is_same_v<LeftT, std::shared_ptr<Array>> && std::is_same_v<RightT, std::shared_ptr<Array>>) {
-                            if (l->shape != r->shape) { Error::set(15, runtime_current_line, "Shape mismatch for element-wise operation."); return false; }
-                            auto result_ptr = std::make_shared<Array>(); result_ptr->shape = l->shape;
-                            for (size_t i = 0; i < l->data.size(); ++i) {
-                                double val_l = to_double(l->data[i]); double val_r = to_double(r->data[i]); double res = 0;
-                                if (op == Tokens::ID::C_ASTR) res = val_l * val_r;
-                                else if (op == Tokens::ID::C_SLASH) { if (val_r == 0.0) { Error::set(2, runtime_current_line, "Division by zero."); return false; } res = val_l / val_r; }
-                                else { if (val_r == 0.0) { Error::set(2, runtime_current_line, "Division by zero."); return false; } res = static_cast<double>(static_cast<long long>(val_l) % static_cast<long long>(val_r)); }
-                                result_ptr->data.push_back(res);
-                            }
-                            return result_ptr;
-                        }
-                        else if constexpr (std::is_same_v<LeftT, std::shared_ptr<Array>>) { return array_op(l, to_double(r), true); }
-                        else if constexpr (std::is_same_v<RightT, std::shared_ptr<Array>>) { return array_op(r, to_double(l), false); }
-                        else { // scalar op
-                            if constexpr (std::is_same_v<LeftT, double> || std::is_same_v<RightT, double>) {
-                                double val_l = to_double(l); double val_r = to_double(r);
-                                if (op == Tokens::ID::C_ASTR) return val_l * val_r;
-                                if (op == Tokens::ID::C_SLASH) { if (val_r == 0.0) { Error::set(2, runtime_current_line); return false; } return val_l / val_r; }
-                                if (op == Tokens::ID::MOD) { if (val_r == 0.0) { Error::set(2, runtime_current_line); return false; } return static_cast<double>(static_cast<long long>(val_l) % static_cast<long long>(val_r)); }
-                            }
-                            else {
-                                if (op == Tokens::ID::C_ASTR) {
-                                    int left_i = to_int(l);
-                                    int right_i = to_int(r);
-                                    return left_i * right_i;
-                                }
-                                double val_l = to_double(l); double val_r = to_double(r);
-                                if (op == Tokens::ID::C_SLASH) { if (val_r == 0.0) { Error::set(2, runtime_current_line); return false; } return val_l / val_r; }
-                                if (op == Tokens::ID::MOD) { if (val_r == 0.0) { Error::set(2, runtime_current_line); return false; } return static_cast<double>(static_cast<long long>(val_l) % static_cast<long long>(val_r)); }
-                            }
-                        }
-                        return false;
-                    }, left, right);
+                    // Fallback to existing numeric operations
+                    if (op == Tokens::ID::C_PLUS) return array_add(l, r); else return array_subtract(l, r);
                 }
             }
-        }
-        else { break; }
+            else if constexpr (std::is_same_v<LeftT, std::shared_ptr<Array>>) {
+                return array_kernel_op(op == Tokens::ID::C_PLUS ? Kernels::Binary::ADD : Kernels::Binary::SUB, l, 0.0, nullptr, to_double(r));
+            }
+            else if constexpr (std::is_same_v<RightT, std::shared_ptr<Array>>) {
+                return array_kernel_op(op == Tokens::ID::C_PLUS ? Kernels::Binary::ADD : Kernels::Binary::SUB, nullptr, to_double(l), r, 0.0);
+            }
+            else {
+                if constexpr (std::is_same_v<LeftT, double> || std::is_same_v<RightT, double>) {
+                    double left_d = to_double(l);
+                    double right_d = to_double(r);
+                    if (op == Tokens::ID::C_PLUS) return left_d + right_d;
+                    else return left_d - right_d;
+                }
+                // Otherwise, perform integer math
+                else {
+                    int left_i = to_int(l);
+                    int right_i = to_int(r);
+                    if (op == Tokens::ID::C_PLUS) return left_i + right_i;
+                    else return left_i - right_i;
+                }
+                //if (op == Tokens::ID::C_PLUS) return to_double(l) + to_double(r);
+                //else return to_double(l) - to_double(r);
+            }
+            }, left, right);
     }
-    return left;
 }
 
 // Level 2: Handles + and -
@@ -2425,94 +2806,77 @@ BasicValue NeReLaBasic::parse_term() {
         if (op == Tokens::ID::C_PLUS || op == Tokens::ID::C_MINUS) {
             pcode++;
             BasicValue right = parse_factor();
-            if (std::holds_alternative<std::shared_ptr<Tensor>>(left) || std::holds_alternative<std::shared_ptr<Tensor>>(right)) {
-                if (!std::holds_alternative<std::shared_ptr<Tensor>>(left) || !std::holds_alternative<std::shared_ptr<Tensor>>(right)) {
-                    Error::set(15, runtime_current_line, "Cannot mix Tensor and non-Tensor types in add/subtract."); return {};
-                }
-                if (op == Tokens::ID::C_PLUS) { left = tensor_add(*this, left, right); }
-                else { left = tensor_subtract(*this, left, right); }
-            }
-            else {
-                left = std::visit([op, this](auto&& l, auto&& r) -> BasicValue {
-                    using LeftT = std::decay_t<decltype(l)>; using RightT = std::decay_t<decltype(r)>;
-                    if constexpr (std::is_same_v<LeftT, std::string> || std::is_same_v<RightT, std::string>) {
-                        if (op == Tokens::ID::C_PLUS) {
-                            return to_string(l) + to_string(r);
-                        }
-                        else { // Subtraction is now string replacement
-                            std::string s_left = to_string(l);
-                            std::string s_right = to_string(r);
-                            if (s_right.empty()) return s_left; // Avoid infinite loop
-                            size_t pos = s_left.find(s_right);
-                            while (pos != std::string::npos) {
-                                s_left.erase(pos, s_right.length());
-                                pos = s_left.find(s_right, pos);
-                            }
-                            return s_left;
-                        }
-                    }
-                    else if constexpr (std::is_same_v<LeftT, std::shared_ptr<Array>> && std::is_same_v<RightT, std::shared_ptr<Array>>) {
-                        // This uses the same array_add/subtract helpers from BuiltinFunctions.cpp
-                        // Ensure they are globally accessible or duplicate the logic here.
-                        if (!l || !r || l->data.empty()) { // Handle null or empty arrays
-                            if (op == Tokens::ID::C_PLUS) return r; else return l;
-                        }
-                        // Check if either array contains strings to decide the operation type
-                        bool is_string_op = std::holds_alternative<std::string>(l->data[0]) || std::holds_alternative<std::string>(r->data[0]);
-
-                        if (op == Tokens::ID::C_PLUS && is_string_op) {
-                            // Perform element-wise string concatenation
-                            if (l->shape != r->shape) { Error::set(15, 0, "Array shapes must match for element-wise operation."); return {}; }
-                            auto result_ptr = std::make_shared<Array>();
-                            result_ptr->shape = l->shape;
-                            result_ptr->data.reserve(l->data.size());
-                            for (size_t i = 0; i < l->data.size(); ++i) {
-                                result_ptr->data.push_back(to_string(l->data[i]) + to_string(r->data[i]));
-                            }
-                            return result_ptr;
-                        }
-                        else {
-                            // Fallback to existing numeric operations
-                            if (op == Tokens::ID::C_PLUS) return array_add(l, r); else return array_subtract(l, r);
-                        }
-                    }
-                    else if constexpr (std::is_same_v<LeftT, std::shared_ptr<Array>>) {
-                        auto result_ptr = std::make_shared<Array>(); result_ptr->shape = l->shape;
-                        double scalar = to_double(r);
-                        for (const auto& elem : l->data) { result_ptr->data.push_back(op == Tokens::ID::C_PLUS ? to_double(elem) + scalar : to_double(elem) - scalar); }
-                        return result_ptr;
-                    }
-                    else if constexpr (std::is_same_v<RightT, std::shared_ptr<Array>>) {
-                        auto result_ptr = std::make_shared<Array>(); result_ptr->shape = r->shape;
-                        double scalar = to_double(l);
-                        for (const auto& elem : r->data) { result_ptr->data.push_back(op == Tokens::ID::C_PLUS ? scalar + to_double(elem) : scalar - to_double(elem)); }
-                        return result_ptr;
-                    }
-                    else {
-                        if constexpr (std::is_same_v<LeftT, double> || std::is_same_v<RightT, double>) {
-                            double left_d = to_double(l);
-                            double right_d = to_double(r);
-                            if (op == Tokens::ID::C_PLUS) return left_d + right_d;
-                            else return left_d - right_d;
-                        }
-                        // Otherwise, perform integer math
-                        else {
-                            int left_i = to_int(l);
-                            int right_i = to_int(r);
-                            if (op == Tokens::ID::C_PLUS) return left_i + right_i;
-                            else return left_i - right_i;
-                        }
-                        //if (op == Tokens::ID::C_PLUS) return to_double(l) + to_double(r);
-                        //else return to_double(l) - to_double(r);
-                    }
-                    }, left, right);
-            }
+            left = apply_term_op(op, left, right);
+            if (Error::get() != 0) return {};
         }
         else { break; }
     }
     return left;
 }
 
+// Applies a comparison operator (=, <>, <, >, <=, >=) to two values, element-wise for arrays.
+BasicValue NeReLaBasic::apply_comparison_op(Tokens::ID op, const BasicValue& left, const BasicValue& right) {
+    // Use std::visit to handle all type combinations
+    return std::visit([op, this, &left, &right](auto&& l, auto&& r) -> BasicValue {
+        using LeftT = std::decay_t<decltype(l)>;
+        using RightT = std::decay_t<decltype(r)>;
+
+        // --- ARRAY COMPARISON LOGIC ---
+        // The element-wise results are kept unboxed.
+
+        // Case 1: Array-Array comparison
+        if constexpr (std::is_same_v<LeftT, std::shared_ptr<Array>> && std::is_same_v<RightT, std::shared_ptr<Array>>) {
+            if (!l || !r) { Error::set(15, runtime_current_line, "Comparison with null array."); return false; }
+            if (l->shape != r->shape) { Error::set(15, runtime_current_line, "Array shape mismatch in comparison."); return false; }
+            return array_kernel_compare(op, l, 0.0, r, 0.0);
+        }
+        // Case 2: Array-Scalar comparison
+        else if constexpr (std::is_same_v<LeftT, std::shared_ptr<Array>>) {
+            if (!l) { Error::set(15, runtime_current_line, "Comparison with null array."); return false; }
+            return array_kernel_compare(op, l, 0.0, nullptr, to_double(r));
+        }
+        // Case 3: Scalar-Array comparison
+        else if constexpr (std::is_same_v<RightT, std::shared_ptr<Array>>) {
+            if (!r) { Error::set(15, runtime_current_line, "Comparison with null array."); return false; }
+            return array_kernel_compare(op, nullptr, to_double(l), r, 0.0);
+        }
+
+        // --- EXISTING SCALAR COMPARISON LOGIC (Unchanged) ---
+
+        // Check the type of the ORIGINAL variant objects.
+        else if (std::holds_alternative<BasicString>(left) || std::holds_alternative<BasicString>(right)) {
+            // If either is a string, we compare them as strings.
+            if (op == Tokens::ID::C_EQ) return to_string(l) == to_string(r);
+            if (op == Tokens::ID::C_NE) return to_string(l) != to_string(r);
+            if (op == Tokens::ID::C_LT) return to_string(l) < to_string(r);
+            if (op == Tokens::ID::C_GT) return to_string(l) > to_string(r);
+            if (op == Tokens::ID::C_LE) return to_string(l) <= to_string(r);
+            if (op == Tokens::ID::C_GE) return to_string(l) >= to_string(r);
+        }
+        // Priority 2: If BOTH operands are DateTime, compare their internal time_points.
+        else if (std::holds_alternative<DateTime>(left) && std::holds_alternative<DateTime>(right)) {
+            const auto& dt_l = std::get<DateTime>(left);
+            const auto& dt_r = std::get<DateTime>(right);
+            if (op == Tokens::ID::C_EQ) return dt_l.time_point == dt_r.time_point;
+            if (op == Tokens::ID::C_NE) return dt_l.time_point != dt_r.time_point;
+            if (op == Tokens::ID::C_LT) return dt_l.time_point < dt_r.time_point;
+            if (op == Tokens::ID::C_GT) return dt_l.time_point > dt_r.time_point;
+            if (op == Tokens::ID::C_LE) return dt_l.time_point <= dt_r.time_point;
+            if (op == Tokens::ID::C_GE) return dt_l.time_point >= dt_r.time_point;
+        }
+        else {
+            // Otherwise, both are numeric (double or bool), so we compare them as numbers.
+            if (op == Tokens::ID::C_EQ) return to_double(l) == to_double(r);
+            if (op == Tokens::ID::C_NE) return to_double(l) != to_double(r);
+            if (op == Tokens::ID::C_LT) return to_double(l) < to_double(r);
+            if (op == Tokens::ID::C_GT) return to_double(l) > to_double(r);
+            if (op == Tokens::ID::C_LE) return to_double(l) <= to_double(r);
+            if (op == Tokens::ID::C_GE) return to_double(l) >= to_double(r);
+        }
+        return false; // Should not be reached
+        }, left, right);
+}
+
 // Level 2: Handles <, >, = with element-wise array operations
 BasicValue NeReLaBasic::parse_comparison() {
     BasicValue left = parse_term(); // parse_term handles + and -
@@ -2525,118 +2889,7 @@ BasicValue NeReLaBasic::parse_comparison() {
     {
         pcode++; // Consume the operator
         BasicValue right = parse_term();
-
-        // Use std::visit to handle all type combinations
-        left = std::visit([op, this, &left, &right](auto&& l, auto&& r) -> BasicValue {
-            using LeftT = std::decay_t<decltype(l)>;
-            using RightT = std::decay_t<decltype(r)>;
-
-            // --- ARRAY COMPARISON LOGIC ---
-
-            // Case 1: Array-Array comparison
-            if constexpr (std::is_same_v<LeftT, std::shared_ptr<Array>> && std::is_same_v<RightT, std::shared_ptr<Array>>) {
-                if (!l || !r) { Error::set(15, runtime_current_line, "Comparison with null array."); return false; }
-                if (l->shape != r->shape) { Error::set(15, runtime_current_line, "Array shape mismatch in comparison."); return false; }
-
-                auto result_ptr = std::make_shared<Array>();
-                result_ptr->shape = l->shape;
-                result_ptr->data.reserve(l->data.size());
-
-                for (size_t i = 0; i < l->data.size(); ++i) {
-                    double left_val = to_double(l->data[i]);
-                    double right_val = to_double(r->data[i]);
-                    bool result = false;
-                    switch (op) {
-                    case Tokens::ID::C_EQ: result = (left_val == right_val); break;
-                    case Tokens::ID::C_NE: result = (left_val != right_val); break;
-                    case Tokens::ID::C_LT: result = (left_val < right_val); break;
-                    case Tokens::ID::C_GT: result = (left_val > right_val); break;
-                    case Tokens::ID::C_LE: result = (left_val <= right_val); break;
-                    case Tokens::ID::C_GE: result = (left_val >= right_val); break;
-                    }
-                    result_ptr->data.push_back(result);
-                }
-                return result_ptr;
-            }
-            // Case 2: Array-Scalar comparison
-            else if constexpr (std::is_same_v<LeftT, std::shared_ptr<Array>>) {
-                if (!l) { Error::set(15, runtime_current_line, "Comparison with null array."); return false; }
-                double scalar = to_double(r);
-                auto result_ptr = std::make_shared<Array>();
-                result_ptr->shape = l->shape;
-                result_ptr->data.reserve(l->data.size());
-                for (const auto& elem : l->data) {
-                    double left_val = to_double(elem);
-                    bool result = false;
-                    switch (op) {
-                    case Tokens::ID::C_EQ: result = (left_val == scalar); break;
-                    case Tokens::ID::C_NE: result = (left_val != scalar); break;
-                    case Tokens::ID::C_LT: result = (left_val < scalar); break;
-                    case Tokens::ID::C_GT: result = (left_val > scalar); break;
-                    case Tokens::ID::C_LE: result = (left_val <= scalar); break;
-                    case Tokens::ID::C_GE: result = (left_val >= scalar); break;
-                    }
-                    result_ptr->data.push_back(result);
-                }
-                return result_ptr;
-            }
-            // Case 3: Scalar-Array comparison
-            else if constexpr (std::is_same_v<RightT, std::shared_ptr<Array>>) {
-                if (!r) { Error::set(15, runtime_current_line, "Comparison with null array."); return false; }
-                double scalar = to_double(l);
-                auto result_ptr = std::make_shared<Array>();
-                result_ptr->shape = r->shape;
-                result_ptr->data.reserve(r->data.size());
-                for (const auto& elem : r->data) {
-                    double right_val = to_double(elem);
-                    bool result = false;
-                    switch (op) {
-                    case Tokens::ID::C_EQ: result = (scalar == right_val); break;
-                    case Tokens::ID::C_NE: result = (scalar != right_val); break;
-                    case Tokens::ID::C_LT: result = (scalar < right_val); break;
-                    case Tokens::ID::C_GT: result = (scalar > right_val); break;
-                    case Tokens::ID::C_LE: result = (scalar <= right_val); break;
-                    case Tokens::ID::C_GE: result = (scalar >= right_val); break;
-                    }
-                    result_ptr->data.push_back(result);
-                }
-                return result_ptr;
-            }
-
-            // --- EXISTING SCALAR COMPARISON LOGIC (Unchanged) ---
-
-            // Check the type of the ORIGINAL variant objects.
-            else if (std::holds_alternative<std::string>(left) || std::holds_alternative<std::string>(right)) {
-                // If either is a string, we compare them as strings.
-                if (op == Tokens::ID::C_EQ) return to_string(l) == to_string(r);
-                if (op == Tokens::ID::C_NE) return to_string(l) != to_string(r);
-                if (op == Tokens::ID::C_LT) return to_string(l) < to_string(r);
-                if (op == Tokens::ID::C_GT) return to_string(l) > to_string(r);
-                if (op == Tokens::ID::C_LE) return to_string(l) <= to_string(r);
-                if (op == Tokens::ID::C_GE) return to_string(l) >= to_string(r);
-            }
-            // Priority 2: If BOTH operands are DateTime, compare their internal time_points.
-            else if (std::holds_alternative<DateTime>(left) && std::holds_alternative<DateTime>(right)) {
-                const auto& dt_l = std::get<DateTime>(left);
-                const auto& dt_r = std::get<DateTime>(right);
-                if (op == Tokens::ID::C_EQ) return dt_l.time_point == dt_r.time_point;
-                if (op == Tokens::ID::C_NE) return dt_l.time_point != dt_r.time_point;
-                if (op == Tokens::ID::C_LT) return dt_l.time_point < dt_r.time_point;
-                if (op == Tokens::ID::C_GT) return dt_l.time_point > dt_r.time_point;
-                if (op == Tokens::ID::C_LE) return dt_l.time_point <= dt_r.time_point;
-                if (op == Tokens::ID::C_GE) return dt_l.time_point >= dt_r.time_point;
-            }
-            else {
-                // Otherwise, both are numeric (double or bool), so we compare them as numbers.
-                if (op == Tokens::ID::C_EQ) return to_double(l) == to_double(r);
-                if (op == Tokens::ID::C_NE) return to_double(l) != to_double(r);
-                if (op == Tokens::ID::C_LT) return to_double(l) < to_double(r);
-                if (op == Tokens::ID::C_GT) return to_double(l) > to_double(r);
-                if (op == Tokens::ID::C_LE) return to_double(l) <= to_double(r);
-                if (op == Tokens::ID::C_GE) return to_double(l) >= to_double(r);
-            }
-            return false; // Should not be reached
-            }, left, right);
+        left = apply_comparison_op(op, left, right);
     }
 
     return left;
@@ -2744,10 +2997,10 @@ void NeReLaBasic::skip_primary() {
     case Tokens::ID::VARIANT:
     case Tokens::ID::FUNCREF:
     case Tokens::ID::CONSTANT:
-        read_string(*this); // Reads the string to advance pcode past it
+        read_symbol(*this); // Advances pcode past the string
         break;
     case Tokens::ID::CALLFUNC:
-        read_string(*this); // Skip function name
+        read_symbol(*this); // Skip function name
         // Now, explicitly skip the argument list that MUST follow.
         if (pcode < active_p_code->size() && static_cast<Tokens::ID>((*active_p_code)[pcode]) == Tokens::ID::C_LEFTPAREN) {
             pcode++; // Skip '('
@@ -2807,7 +3060,7 @@ void NeReLaBasic::skip_primary() {
         else if (accessor_token == Tokens::ID::C_DOT) {
             pcode++; // consume '.'
             pcode++; // consume VARIANT/CALLFUNC token
-            read_string(*this); // consume member name
+            read_symbol(*this); // consume member name
         }
         else {
             break;
@@ -2842,7 +3095,7 @@ void NeReLaBasic::skip_binary_op_chain(std::function<void()> skip_higher_precede
 
         if (is_op) {
             pcode++; // Consume the operator
-            if (op == Tokens::ID::FUNCREF) { read_string(*this); } // Custom ops have a name
+            if (op == Tokens::ID::FUNCREF) { read_symbol(*this); } // Custom ops have a name
             skip_higher_precedence(); // Skip the next operand
         }
         else {
@@ -2932,8 +3185,135 @@ BasicValue NeReLaBasic::parse_logical_or() {
     return left;
 }
 
-// Top-level expression function
+// Top-level expression function. Runs the lowered bytecode for this p-code address
+// if there is one; the first evaluation of an address lowers it (or marks it as
+// parser-only), so the recursive parser below only runs for the constructs that
+// the bytecode does not model.
 BasicValue NeReLaBasic::evaluate_expression() {
+    if (Bytecode::Chunk* chunk = lowered_expression()) {
+        return execute_chunk(*chunk);
+    }
+    return parse_expression();
+}
+
+// The lowered form of the expression at pcode, lowering it on first use. Returns
+// nullptr if the expression has to go through the parser.
+Bytecode::Chunk* NeReLaBasic::lowered_expression() {
+    Bytecode::CodeUnit* unit = find_code_unit();
+    if (!unit) return nullptr;
+    int32_t& entry = unit->entry[pcode];
+    if (entry == 0) {
+        Bytecode::Chunk chunk;
+        if (Bytecode::compile_expression(*active_p_code, pcode, chunk)) {
+            resolve_chunk_variables(chunk);
+            unit->chunks.push_back(std::move(chunk));
+            entry = static_cast<int32_t>(unit->chunks.size());
+        }
+        else {
+            entry = -1;
+        }
+    }
+    return entry > 0 ? &unit->chunks[entry - 1] : nullptr;
+}
+
+// S$ = S$ + a + b ...: appends the operands to the string in S$ instead of
+// copying it into a new string first, so building a string in a loop is linear
+// rather than quadratic. Returns false, without consuming anything, when the
+// assignment at pcode does not have that shape; the caller then evaluates it
+// normally.
+bool NeReLaBasic::assign_by_append(const std::string& name) {
+    Bytecode::Chunk* chunk = lowered_expression();
+    if (!chunk || !chunk->appends_to_variable || chunk->append_state == 2) return false;
+    const Bytecode::VarRef& ref = chunk->variables[chunk->code[0].operand];
+    if (ref.name != name) return false;
+
+    // Only where the read and the write of S$ are the same variable: a global at
+    // top level, or a local of the current frame (see get_variable/set_variable).
+    auto find_target = [&]() -> BasicString* {
+        BasicValue* target = nullptr;
+        if (call_stack.empty()) {
+            if (variables.is_defined(ref.global_slot)) target = &variables.slot(ref.global_slot);
+        }
+        else {
+            target = call_stack.back().local_variables.find(name);
+        }
+        return target ? std::get_if<BasicString>(target) : nullptr;
+    };
+    if (!find_target()) return false;
+
+    // A function among the operands may assign S$ itself, which the append would
+    // not see. The first run evaluates the whole expression and notes whether any
+    // user function ran; a later surprise (a lambda in a variable) turns it off too.
+    uint64_t calls = user_function_calls;
+    if (chunk->append_state == 0) {
+        BasicValue result = execute_chunk(*chunk);
+        if (Error::get() != 0) return true;
+        chunk->append_state = user_function_calls == calls ? 1 : 2;
+        set_variable(*this, name, result);
+        return true;
+    }
+
+    std::vector<BasicValue> operands;
+    execute_chunk(*chunk, &operands);
+    if (Error::get() != 0) return true;
+    if (user_function_calls != calls) chunk->append_state = 2;
+
+    // The operands may have called functions, so look the variable up again.
+    BasicString* target = find_target();
+    if (!target) {
+        BasicValue& var = get_variable(*this, name);
+        BasicValue result = var;
+        for (const BasicValue& operand : operands) {
+            result = apply_term_op(Tokens::ID::C_PLUS, result, operand);
+            if (Error::get() != 0) return true;
+        }
+        set_variable(*this, name, result);
+        return true;
+    }
+    for (const BasicValue& operand : operands) {
+        if (const BasicString* s = std::get_if<BasicString>(&operand)) target->append(s->str());
+        else if (std::holds_alternative<std::shared_ptr<Tensor>>(operand)) {
+            apply_term_op(Tokens::ID::C_PLUS, *target, operand); // reports the type mismatch
+            return true;
+        }
+        else target->append(to_string(operand));
+    }
+    return true;
+}
+
+// Binds the variable reads of a freshly lowered chunk to their slots. An address is
+// always executed in the same function, so the frame on top of the stack right now
+// supplies the local layout.
+void NeReLaBasic::resolve_chunk_variables(Bytecode::Chunk& chunk) {
+    const SlotLayout* layout = call_stack.empty() ? nullptr : call_stack.back().local_variables.get_layout();
+    for (Bytecode::VarRef& ref : chunk.variables) {
+        ref.global_slot = variables.intern(ref.name);
+        ref.layout = layout;
+        ref.local_slot = layout ? layout->find(ref.name) : -1;
+    }
+}
+
+// Reads a variable through its resolved slots. Falls back to the name lookup of
+// get_variable() whenever the dynamic scoping rules could see a different variable
+// than the slots (a foreign frame on top, or an undefined local with callers below).
+BasicValue& NeReLaBasic::resolve_variable(const Bytecode::VarRef& ref) {
+    if (call_stack.empty()) {
+        return variables.slot(ref.global_slot);
+    }
+    LocalVariables& locals = call_stack.back().local_variables;
+    if (ref.local_slot >= 0 && locals.get_layout() == ref.layout) {
+        if (locals.is_defined(ref.local_slot)) {
+            return locals.slot(ref.local_slot);
+        }
+        if (call_stack.size() == 1) {
+            return variables.slot(ref.global_slot);
+        }
+    }
+    return get_variable(*this, ref.name);
+}
+
+// The recursive-descent path: XOR, then the rest of the precedence chain.
+BasicValue NeReLaBasic::parse_expression() {
     BasicValue left = parse_logical_or();
 
     // The loop now only handles XOR, which is non-short-circuiting
@@ -2949,6 +3329,184 @@ BasicValue NeReLaBasic::evaluate_expression() {
     return left;
 }
 
+// Returns the bytecode unit for the active p-code buffer, or nullptr if that
+// buffer was not produced by tokenize_program (REPL lines, EXECUTE snippets).
+Bytecode::CodeUnit* NeReLaBasic::find_code_unit() {
+    if (active_p_code != cached_unit_p_code) {
+        auto it = code_units.find(active_p_code);
+        cached_unit = (it != code_units.end()) ? &it->second : nullptr;
+        cached_unit_p_code = active_p_code;
+    }
+    if (cached_unit && pcode < cached_unit->entry.size()) return cached_unit;
+    return nullptr;
+}
+
+namespace {
+    // Scalar fast path of the dispatch loop: both operands are int or double.
+    inline bool numeric_operands(const BasicValue& l, const BasicValue& r, double& a, double& b) {
+        if (const double* d = std::get_if<double>(&l)) a = *d;
+        else if (const int* i = std::get_if<int>(&l)) a = *i;
+        else return false;
+        if (const double* d = std::get_if<double>(&r)) b = *d;
+        else if (const int* i = std::get_if<int>(&r)) b = *i;
+        else return false;
+        return true;
+    }
+
+    // Restores the register stack even if a native function throws.
+    struct RegisterWindow {
+        std::vector<BasicValue>& file;
+        size_t& top;
+        size_t base;
+        size_t count;
+        RegisterWindow(std::vector<BasicValue>& f, size_t& t, size_t n) : file(f), top(t), base(t), count(n) {
+            top += count;
+            if (file.size() < top) file.resize(top);
+        }
+        ~RegisterWindow() {
+            for (size_t i = base; i < base + count; ++i) file[i] = false; // release arrays, strings, ...
+            top = base;
+        }
+    };
+}
+
+// The dispatch loop for a lowered expression. Scalar int/double operands are
+// handled inline; everything else goes through the same apply_* functions the
+// parser uses, so both paths give identical results.
+// With 'appended' (a chunk with appends_to_variable), the variable load into R0
+// is skipped and the right operands of the additions to R0 are collected instead.
+BasicValue NeReLaBasic::execute_chunk(const Bytecode::Chunk& chunk, std::vector<BasicValue>* appended) {
+    using Bytecode::Op;
+    RegisterWindow window(register_file, register_top, chunk.num_registers);
+    BasicValue* R = register_file.data() + window.base;
+    const Bytecode::Instr* code = chunk.code.data();
+    const size_t count = chunk.code.size();
+    double a, b;
+
+    for (size_t ip = 0; ip < count; ++ip) {
+        const Bytecode::Instr& in = code[ip];
+        switch (in.op) {
+        case Op::LOAD_CONST:
+            R[in.dst] = chunk.constants[in.operand];
+            break;
+        case Op::LOAD_VAR:
+            if (appended && ip == 0) break;
+            R[in.dst] = resolve_variable(chunk.variables[in.operand]);
+            break;
+        case Op::EVAL_PRIMARY: {
+            pcode = in.operand;
+            BasicValue value = parse_primary();
+            R = register_file.data() + window.base; // nested evaluations may have grown the register file
+            if (Error::get() != 0) { pcode = chunk.end_pcode; return {}; }
+            R[in.dst] = std::move(value);
+            break;
+        }
+        case Op::NEG:
+            if (const int* i = std::get_if<int>(&R[in.a])) R[in.dst] = -static_cast<double>(*i);
+            else if (const double* d = std::get_if<double>(&R[in.a])) R[in.dst] = -*d;
+            else R[in.dst] = negate_value(R[in.a]);
+            break;
+        case Op::NOT:
+            R[in.dst] = !to_bool(R[in.a]);
+            break;
+        case Op::ADD:
+        case Op::SUB: {
+            if (appended && in.dst == 0) {
+                appended->push_back(std::move(R[in.b]));
+                break;
+            }
+            const BasicValue& l = R[in.a];
+            const BasicValue& r = R[in.b];
+            BasicString* ls = in.dst == in.a && in.op == Op::ADD ? std::get_if<BasicString>(&R[in.a]) : nullptr;
+            if (ls && !std::holds_alternative<std::shared_ptr<Tensor>>(r)) {
+                // String concatenation extends the left register in place (once it
+                // no longer shares its text with a variable or constant).
+                if (const BasicString* rs = std::get_if<BasicString>(&r)) ls->append(rs->str());
+                else ls->append(to_string(r));
+            }
+            else if (std::holds_alternative<int>(l) && std::holds_alternative<int>(r)) {
+                int li = std::get<int>(l), ri = std::get<int>(r);
+                R[in.dst] = in.op == Op::ADD ? li + ri : li - ri;
+            }
+            else if (numeric_operands(l, r, a, b)) {
+                R[in.dst] = in.op == Op::ADD ? a + b : a - b;
+            }
+            else {
+                R[in.dst] = apply_term_op(in.op == Op::ADD ? Tokens::ID::C_PLUS : Tokens::ID::C_MINUS, l, r);
+            }
+            break;
+        }
+        case Op::MUL:
+            if (std::holds_alternative<int>(R[in.a]) && std::holds_alternative<int>(R[in.b])) {
+                R[in.dst] = std::get<int>(R[in.a]) * std::get<int>(R[in.b]);
+            }
+            else if (numeric_operands(R[in.a], R[in.b], a, b)) R[in.dst] = a * b;
+            else R[in.dst] = apply_factor_op(Tokens::ID::C_ASTR, R[in.a], R[in.b]);
+            break;
+        case Op::DIV:
+            if (numeric_operands(R[in.a], R[in.b], a, b) && b != 0.0) R[in.dst] = a / b;
+            else R[in.dst] = apply_factor_op(Tokens::ID::C_SLASH, R[in.a], R[in.b]);
+            break;
+        case Op::MOD:
+            if (numeric_operands(R[in.a], R[in.b], a, b) && static_cast<long long>(b) != 0) {
+                R[in.dst] = static_cast<double>(static_cast<long long>(a) % static_cast<long long>(b));
+            }
+            else R[in.dst] = apply_factor_op(Tokens::ID::MOD, R[in.a], R[in.b]);
+            break;
+        case Op::POW:
+            if (numeric_operands(R[in.a], R[in.b], a, b)) R[in.dst] = std::pow(a, b);
+            else R[in.dst] = apply_power_op(R[in.a], R[in.b]);
+            break;
+        case Op::EQ: case Op::NE: case Op::LT: case Op::GT: case Op::LE: case Op::GE:
+            if (numeric_operands(R[in.a], R[in.b], a, b)) {
+                bool result = false;
+                switch (in.op) {
+                case Op::EQ: result = a == b; break;
+                case Op::NE: result = a != b; break;
+                case Op::LT: result = a < b; break;
+                case Op::GT: result = a > b; break;
+                case Op::LE: result = a <= b; break;
+                default:     result = a >= b; break;
+                }
+                R[in.dst] = result;
+            }
+            else {
+                static const Tokens::ID comparison_tokens[] = { Tokens::ID::C_EQ, Tokens::ID::C_NE, Tokens::ID::C_LT, Tokens::ID::C_GT, Tokens::ID::C_LE, Tokens::ID::C_GE };
+                R[in.dst] = apply_comparison_op(comparison_tokens[static_cast<int>(in.op) - static_cast<int>(Op::EQ)], R[in.a], R[in.b]);
+            }
+            break;
+        case Op::AND: case Op::OR: case Op::XOR:
+            if (!std::holds_alternative<std::shared_ptr<Array>>(R[in.a]) && !std::holds_alternative<std::shared_ptr<Array>>(R[in.b])) {
+                bool l = to_bool(R[in.a]), r = to_bool(R[in.b]);
+                R[in.dst] = in.op == Op::AND ? (l && r) : in.op == Op::OR ? (l || r) : (l != r);
+            }
+            else if (in.op == Op::AND) {
+                R[in.dst] = apply_binary_op(R[in.a], R[in.b], [](const BasicValue& v1, const BasicValue& v2) -> BasicValue { return to_bool(v1) && to_bool(v2); });
+            }
+            else if (in.op == Op::OR) {
+                R[in.dst] = apply_binary_op(R[in.a], R[in.b], [](const BasicValue& v1, const BasicValue& v2) -> BasicValue { return to_bool(v1) || to_bool(v2); });
+            }
+            else {
+                R[in.dst] = apply_binary_op(R[in.a], R[in.b], [](const BasicValue& v1, const BasicValue& v2) -> BasicValue { return to_bool(v1) != to_bool(v2); });
+            }
+            break;
+        case Op::JUMP_IF_FALSE:
+        case Op::JUMP_IF_TRUE:
+            if (std::holds_alternative<std::shared_ptr<Array>>(R[in.a])) {
+                Error::set(15, runtime_current_line, std::string(in.op == Op::JUMP_IF_FALSE ? "ANDALSO" : "ORELSE") + " operator does not support array operands.");
+                pcode = chunk.end_pcode;
+                return {};
+            }
+            if (to_bool(R[in.a]) == (in.op == Op::JUMP_IF_TRUE)) ip = in.operand - 1;
+            break;
+        }
+        if (Error::get() != 0) { pcode = chunk.end_pcode; return {}; }
+    }
+
+    pcode = chunk.end_pcode;
+    return std::move(R[0]);
+}
+
 //// Level 1: Handles AND, OR, XOR with element-wise array support
 //BasicValue NeReLaBasic::evaluate_expression() {
 //    //BasicValue left = parse_comparison();
@@ -9,6 +9,7 @@
 #include <iostream>
 #include <string>
 #include <fstream>
+#include <filesystem>
 #ifdef _WIN32
 #include <windows.h> 
 #include <conio.h>
@@ -48,6 +49,8 @@ int main(int argc, char* argv[]) {
     bool dap_mode = false;
     int dap_port = 4711; // Default DAP port
     std::string filename_arg;
+    bool profile_mode = false;
+    std::string profile_base;
 
     for (int i = 1; i < argc; ++i) {
         std::string arg = argv[i];
@@ -57,6 +60,12 @@ int main(int argc, char* argv[]) {
                 dap_port = std::stoi(argv[++i]);
             }
         }
+        else if (arg == "--profile" || arg.rfind("--profile=", 0) == 0) {
+            // Profile every RUN; the reports go to <program>.profile.txt/.folded
+            // or to the path given after '='.
+            profile_base = arg.size() > 10 ? arg.substr(10) : std::string();
+            profile_mode = true;
+        }
         else {
             // Capture the first non-flag argument as a potential filename
             if (filename_arg.empty()) {
@@ -66,6 +75,11 @@ int main(int argc, char* argv[]) {
         }
     }
 
+    if (profile_mode) {
+        interpreter.profile_output = !profile_base.empty() ? profile_base
+            : filename_arg.empty() ? std::string("jdbasic") : std::filesystem::path(filename_arg).replace_extension().string();
+    }
+
     if (dap_mode) {
         DAPHandler dap_server(interpreter);
 
@@ -110,8 +124,8 @@ int main(int argc, char* argv[]) {
     else {
 
         // Check if a command-line argument (a filename) was provided
-        if (argc > 1) {
-            std::string filename = argv[1];
+        if (!filename_arg.empty()) {
+            const std::string& filename = filename_arg;
 
             // Use the new method to load the source file
             if (interpreter.loadSourceFromFile(filename)) {
@@ -15,16 +15,22 @@ NetworkManager::~NetworkManager() {
 }
 
 namespace { // Keep this helper private to this file
+    // protocol://host[:port][/path], compiled once per process (matching a const
+    // std::regex from several threads is safe).
+    const std::regex& url_regex() {
+        static const std::regex regex(R"(([^:]+)://([^:/]+)(?::(\d+))?(/.*)?)");
+        return regex;
+    }
+
     std::string httpPostOrPut(const std::string& verb, const std::string& url_str, const std::string& body, const std::string& content_type, std::map<std::string, std::string>& custom_headers, int& last_http_status_code) {
         last_http_status_code = 0;
 
         // URL Parsing logic from your httpGet - no changes needed here
-        std::regex url_regex(R"(([^:]+)://([^:/]+)(?::(\d+))?(/.*)?)");
         std::smatch matches;
         std::string protocol = "http", host, path = "/";
         int port = 0;
 
-        if (std::regex_match(url_str, matches, url_regex)) {
+        if (std::regex_match(url_str, matches, url_regex())) {
             if (matches[1].matched) protocol = matches[1].str();
             if (matches[2].matched) host = matches[2].str();
             if (matches[3].matched) port = std::stoi(matches[3].str());
@@ -103,7 +109,6 @@ std::string NetworkManager::httpGet(const std::string& url_str) {
     // Group 2: Host (e.g., "www.example.com")
     // Group 3: Port (e.g., ":8443" or empty if default)
     // Group 4: Path (e.g., "/path/to/resource?query=1" or empty if "/")
-    std::regex url_regex(R"(([^:]+)://([^:/]+)(?::(\d+))?(/.*)?)");
     std::smatch matches;
 
     std::string protocol = "http"; // Default protocol
@@ -111,7 +116,7 @@ std::string NetworkManager::httpGet(const std::string& url_str) {
     int port = 0; // 0 means default port
     std::string path = "/";
 
-    if (std::regex_match(url_str, matches, url_regex)) {
+    if (std::regex_match(url_str, matches, url_regex())) {
         if (matches[1].matched) { // Protocol
             protocol = matches[1].str();
         }
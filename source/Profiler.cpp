@@ -0,0 +1,160 @@
+// Profiler.cpp
+#include "Profiler.hpp"
+#include "NeReLaBasic.hpp"
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <set>
+#include <vector>
+
+namespace {
+    const std::string MAIN_FRAME = "<main>";
+
+    // One node of the call tree built from the collapsed stacks.
+    struct TreeNode {
+        uint64_t samples = 0;
+        std::map<std::string, std::unique_ptr<TreeNode>> children;
+    };
+
+    double percent(uint64_t part, uint64_t whole) {
+        return whole ? 100.0 * static_cast<double>(part) / static_cast<double>(whole) : 0.0;
+    }
+
+    template <typename Map>
+    std::vector<std::pair<typename Map::key_type, uint64_t>> by_samples(const Map& samples) {
+        std::vector<std::pair<typename Map::key_type, uint64_t>> sorted(samples.begin(), samples.end());
+        std::stable_sort(sorted.begin(), sorted.end(), [](const auto& a, const auto& b) { return a.second > b.second; });
+        return sorted;
+    }
+
+    void print_tree(std::ostream& out, const std::string& name, const TreeNode& node, uint64_t total, int depth) {
+        // Branches under 0.1% of the run are left out to keep the tree readable.
+        if (node.samples * 1000 < total) return;
+        out << std::setw(10) << node.samples << std::setw(8) << percent(node.samples, total) << "%  "
+            << std::string(depth * 2, ' ') << name << "\n";
+        std::vector<std::pair<const std::string*, const TreeNode*>> children;
+        for (const auto& [child_name, child] : node.children) children.push_back({ &child_name, child.get() });
+        std::stable_sort(children.begin(), children.end(), [](const auto& a, const auto& b) { return a.second->samples > b.second->samples; });
+        for (const auto& [child_name, child] : children) print_tree(out, *child_name, *child, total, depth + 1);
+    }
+}
+
+Profiler::Profiler(std::string output_base, std::chrono::microseconds interval)
+    : base(std::move(output_base)), interval(interval), started(std::chrono::steady_clock::now()) {
+    timer = std::thread([this] {
+        std::unique_lock<std::mutex> lock(timer_mutex);
+        auto next = std::chrono::steady_clock::now() + this->interval;
+        while (!timer_wakeup.wait_until(lock, next, [this] { return stopping; })) {
+            ticks.fetch_add(1, std::memory_order_relaxed);
+            next += this->interval;
+        }
+    });
+}
+
+Profiler::~Profiler() {
+    stop();
+}
+
+void Profiler::stop() {
+    {
+        std::lock_guard<std::mutex> lock(timer_mutex);
+        if (stopping) return;
+        stopping = true;
+    }
+    timer_wakeup.notify_one();
+    if (timer.joinable()) timer.join();
+    sampled = std::chrono::steady_clock::now() - started;
+}
+
+void Profiler::charge(const NeReLaBasic& vm) {
+    const uint32_t now = ticks.load(std::memory_order_relaxed);
+    const uint32_t due = now - charged;
+    charged = now;
+    if (due == 0) return;
+    total_samples += due;
+
+    const std::string& function = vm.call_stack.empty() ? MAIN_FRAME : vm.call_stack.back().function_name;
+    line_samples[{ function, vm.runtime_current_line }] += due;
+
+    std::string stack = MAIN_FRAME;
+    for (const auto& frame : vm.call_stack) {
+        stack += ';';
+        stack += frame.function_name;
+    }
+    if (native) {
+        stack += ';';
+        stack += *native;
+    }
+    stack_samples[stack] += due;
+}
+
+bool Profiler::write_reports() {
+    stop();
+
+    // Self and total samples per function, and the call tree, from the stacks.
+    std::map<std::string, uint64_t> self_samples, total_function_samples;
+    TreeNode root;
+    for (const auto& [stack, samples] : stack_samples) {
+        std::set<std::string> seen;
+        TreeNode* node = &root;
+        size_t start = 0;
+        while (true) {
+            size_t end = stack.find(';', start);
+            std::string frame = stack.substr(start, end == std::string::npos ? std::string::npos : end - start);
+            if (seen.insert(frame).second) total_function_samples[frame] += samples;
+            auto& child = node->children[frame];
+            if (!child) child = std::make_unique<TreeNode>();
+            node = child.get();
+            node->samples += samples;
+            if (end == std::string::npos) {
+                self_samples[frame] += samples;
+                break;
+            }
+            start = end + 1;
+        }
+    }
+
+    bool ok = true;
+    std::ofstream report(base + ".profile.txt");
+    if (report) {
+        report << std::fixed << std::setprecision(1);
+        report << "jdBasic profile: " << total_samples << " samples, one every " << interval.count() << " us, "
+            << std::chrono::duration<double>(sampled).count() << " s run time\n";
+
+        report << "\nHot lines (time spent on the line, including the built-ins it calls)\n";
+        report << "   samples       %      line  function\n";
+        size_t shown = 0;
+        for (const auto& [where, samples] : by_samples(line_samples)) {
+            if (shown++ == 50) break;
+            report << std::setw(10) << samples << std::setw(8) << percent(samples, total_samples) << "%"
+                << std::setw(10) << where.second << "  " << where.first << "\n";
+        }
+
+        report << "\nFunctions (built-ins and BASIC functions)\n";
+        report << "      self       %     total       %  function\n";
+        // Ordered by total samples: a function that only calls others has no self samples.
+        for (const auto& [name, total] : by_samples(total_function_samples)) {
+            uint64_t self = self_samples[name];
+            report << std::setw(10) << self << std::setw(8) << percent(self, total_samples) << "%"
+                << std::setw(10) << total << std::setw(8) << percent(total, total_samples) << "%  " << name << "\n";
+        }
+
+        report << "\nCall tree (samples including callees)\n";
+        for (const auto& [name, node] : root.children) print_tree(report, name, *node, total_samples, 0);
+        ok = static_cast<bool>(report);
+    }
+    else {
+        ok = false;
+    }
+
+    std::ofstream folded(base + ".folded");
+    if (folded) {
+        for (const auto& [stack, samples] : stack_samples) folded << stack << " " << samples << "\n";
+        ok = ok && static_cast<bool>(folded);
+    }
+    else {
+        ok = false;
+    }
+    return ok;
+}
@@ -0,0 +1,236 @@
+// ProgramCache.cpp
+#include "ProgramCache.hpp"
+#include <fstream>
+#include <sstream>
+#include <filesystem>
+#include <random>
+#include <cstring>
+
+extern const std::string NERELA_VERSION;
+
+namespace {
+    const char MAGIC[4] = { 'J', 'D', 'B', 'C' };
+
+    // --- Writing: fixed-size little-endian integers, length-prefixed strings ---
+
+    void put_u32(std::string& out, uint32_t value) {
+        for (int i = 0; i < 4; ++i) out.push_back(static_cast<char>((value >> (8 * i)) & 0xFF));
+    }
+
+    void put_u64(std::string& out, uint64_t value) {
+        for (int i = 0; i < 8; ++i) out.push_back(static_cast<char>((value >> (8 * i)) & 0xFF));
+    }
+
+    void put_string(std::string& out, const std::string& s) {
+        put_u32(out, static_cast<uint32_t>(s.size()));
+        out.append(s);
+    }
+
+    void put_function(std::string& out, const std::string& key, const NeReLaBasic::FunctionInfo& info) {
+        put_string(out, key);
+        put_string(out, info.name);
+        put_u32(out, static_cast<uint32_t>(info.arity));
+        out.push_back(static_cast<char>(info.is_procedure | (info.is_exported << 1) | (info.is_async << 2) | ((info.locals != nullptr) << 3)));
+        put_string(out, info.module_name);
+        put_u32(out, info.start_pcode);
+        put_u32(out, static_cast<uint32_t>(info.parameter_names.size()));
+        for (const auto& param : info.parameter_names) put_string(out, param);
+        if (info.locals) {
+            put_u32(out, static_cast<uint32_t>(info.locals->size()));
+            for (uint32_t slot = 0; slot < info.locals->size(); ++slot) put_string(out, info.locals->name_of(slot));
+        }
+    }
+
+    void put_function_table(std::string& out, const NeReLaBasic::FunctionTable& table) {
+        put_u32(out, static_cast<uint32_t>(table.size()));
+        for (const auto& [key, info] : table) put_function(out, key, info);
+    }
+
+    // --- Reading: every read is bounds-checked, a short file just fails ---
+
+    struct Reader {
+        const std::string& data;
+        size_t pos = 0;
+        bool ok = true;
+
+        bool take(size_t n) {
+            if (!ok || data.size() - pos < n) { ok = false; return false; }
+            return true;
+        }
+        uint32_t u32() {
+            if (!take(4)) return 0;
+            uint32_t value = 0;
+            for (int i = 0; i < 4; ++i) value |= static_cast<uint32_t>(static_cast<uint8_t>(data[pos++])) << (8 * i);
+            return value;
+        }
+        uint64_t u64() {
+            if (!take(8)) return 0;
+            uint64_t value = 0;
+            for (int i = 0; i < 8; ++i) value |= static_cast<uint64_t>(static_cast<uint8_t>(data[pos++])) << (8 * i);
+            return value;
+        }
+        uint8_t u8() {
+            if (!take(1)) return 0;
+            return static_cast<uint8_t>(data[pos++]);
+        }
+        std::string string() {
+            uint32_t length = u32();
+            if (!take(length)) return {};
+            std::string s = data.substr(pos, length);
+            pos += length;
+            return s;
+        }
+    };
+
+    void get_function(Reader& in, std::string& key, NeReLaBasic::FunctionInfo& info) {
+        key = in.string();
+        info.name = in.string();
+        info.arity = static_cast<int>(in.u32());
+        uint8_t flags = in.u8();
+        info.is_procedure = flags & 1;
+        info.is_exported = (flags >> 1) & 1;
+        info.is_async = (flags >> 2) & 1;
+        info.module_name = in.string();
+        info.start_pcode = in.u32();
+        uint32_t params = in.u32();
+        for (uint32_t i = 0; i < params && in.ok; ++i) info.parameter_names.push_back(in.string());
+        if (flags & 8) {
+            info.locals = std::make_shared<SlotLayout>();
+            uint32_t slots = in.u32();
+            for (uint32_t i = 0; i < slots && in.ok; ++i) info.locals->intern(in.string());
+        }
+    }
+
+    void get_function_table(Reader& in, NeReLaBasic::FunctionTable& table) {
+        uint32_t count = in.u32();
+        for (uint32_t i = 0; i < count && in.ok; ++i) {
+            std::string key;
+            NeReLaBasic::FunctionInfo info;
+            get_function(in, key, info);
+            table[key] = std::move(info);
+        }
+    }
+}
+
+std::string ProgramCache::path_for(const std::string& source_path) {
+    std::filesystem::path path(source_path);
+    path.replace_extension(".jdbc");
+    return path.string();
+}
+
+uint64_t ProgramCache::hash_source(const std::string& source) {
+    uint64_t hash = 14695981039346656037ull;
+    for (unsigned char c : source) {
+        hash ^= c;
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+bool ProgramCache::load(const std::string& cache_path, uint64_t source_hash, Unit& unit) {
+    std::ifstream file(cache_path, std::ios::binary);
+    if (!file) return false;
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    const std::string data = buffer.str();
+
+    Reader in{ data };
+    if (!in.take(sizeof(MAGIC)) || std::memcmp(data.data(), MAGIC, sizeof(MAGIC)) != 0) return false;
+    in.pos += sizeof(MAGIC);
+    if (in.u32() != FORMAT_VERSION) return false;
+    if (in.string() != NERELA_VERSION) return false;
+    if (in.u64() != source_hash) return false;
+
+    unit.is_module = in.u8() != 0;
+    unit.module_name = in.string();
+    uint32_t imports = in.u32();
+    for (uint32_t i = 0; i < imports && in.ok; ++i) {
+        unit.imports.push_back(in.string());
+        unit.import_hashes.push_back(in.u64());
+    }
+
+    uint32_t p_code_size = in.u32();
+    if (!in.take(p_code_size)) return false;
+    unit.p_code.assign(data.begin() + in.pos, data.begin() + in.pos + p_code_size);
+    in.pos += p_code_size;
+
+    get_function_table(in, unit.functions);
+
+    uint32_t types = in.u32();
+    for (uint32_t i = 0; i < types && in.ok; ++i) {
+        NeReLaBasic::TypeInfo type;
+        type.name = in.string();
+        uint32_t members = in.u32();
+        for (uint32_t m = 0; m < members && in.ok; ++m) {
+            NeReLaBasic::MemberInfo member;
+            member.name = in.string();
+            member.type_id = static_cast<DataType>(in.u32());
+            type.members[member.name] = member;
+        }
+        get_function_table(in, type.methods);
+        unit.types[type.name] = std::move(type);
+    }
+
+    uint32_t labels = in.u32();
+    for (uint32_t i = 0; i < labels && in.ok; ++i) {
+        std::string label = in.string();
+        unit.labels[label] = in.u32();
+    }
+
+    return in.ok && in.pos == data.size();
+}
+
+void ProgramCache::save(const std::string& cache_path, uint64_t source_hash, const Unit& unit) {
+    std::string out(MAGIC, sizeof(MAGIC));
+    put_u32(out, FORMAT_VERSION);
+    put_string(out, NERELA_VERSION);
+    put_u64(out, source_hash);
+
+    out.push_back(unit.is_module ? 1 : 0);
+    put_string(out, unit.module_name);
+    put_u32(out, static_cast<uint32_t>(unit.imports.size()));
+    for (size_t i = 0; i < unit.imports.size(); ++i) {
+        put_string(out, unit.imports[i]);
+        put_u64(out, i < unit.import_hashes.size() ? unit.import_hashes[i] : 0);
+    }
+
+    put_u32(out, static_cast<uint32_t>(unit.p_code.size()));
+    out.append(reinterpret_cast<const char*>(unit.p_code.data()), unit.p_code.size());
+
+    put_function_table(out, unit.functions);
+
+    put_u32(out, static_cast<uint32_t>(unit.types.size()));
+    for (const auto& [name, type] : unit.types) {
+        put_string(out, type.name);
+        put_u32(out, static_cast<uint32_t>(type.members.size()));
+        for (const auto& [member_name, member] : type.members) {
+            put_string(out, member.name);
+            put_u32(out, static_cast<uint32_t>(member.type_id));
+        }
+        put_function_table(out, type.methods);
+    }
+
+    put_u32(out, static_cast<uint32_t>(unit.labels.size()));
+    for (const auto& [label, address] : unit.labels) {
+        put_string(out, label);
+        put_u32(out, address);
+    }
+
+    // Many processes may start from the same source at once: each writes its own
+    // temporary file and renames it over the cache in one step.
+    std::string temp_path = cache_path + "." + std::to_string(std::random_device{}()) + ".tmp";
+    {
+        std::ofstream file(temp_path, std::ios::binary | std::ios::trunc);
+        if (!file) return;
+        file.write(out.data(), static_cast<std::streamsize>(out.size()));
+        if (!file) {
+            file.close();
+            std::error_code ignored;
+            std::filesystem::remove(temp_path, ignored);
+            return;
+        }
+    }
+    std::error_code error;
+    std::filesystem::rename(temp_path, cache_path, error);
+    if (error) std::filesystem::remove(temp_path, error);
+}
@@ -0,0 +1,57 @@
+// RegexCache.cpp
+#include "RegexCache.hpp"
+#include <list>
+#include <unordered_map>
+#include <mutex>
+
+namespace {
+    struct Entry {
+        std::string pattern;
+        std::regex::flag_type flags;
+        std::shared_ptr<const std::regex> regex;
+    };
+
+    std::mutex cache_mutex;
+    std::list<Entry> lru;   // most recently used first
+    std::unordered_map<std::string, std::list<Entry>::iterator> index;
+
+    std::string make_key(const std::string& pattern, std::regex::flag_type flags) {
+        return std::to_string(static_cast<unsigned>(flags)) + ':' + pattern;
+    }
+
+    thread_local Entry last_used;
+}
+
+std::shared_ptr<const std::regex> RegexCache::get(const std::string& pattern, std::regex::flag_type flags) {
+    if (last_used.regex && last_used.flags == flags && last_used.pattern == pattern) {
+        return last_used.regex;
+    }
+
+    const std::string key = make_key(pattern, flags);
+    {
+        std::lock_guard<std::mutex> lock(cache_mutex);
+        auto it = index.find(key);
+        if (it != index.end()) {
+            lru.splice(lru.begin(), lru, it->second);
+            last_used = *it->second;
+            return last_used.regex;
+        }
+    }
+
+    // Compile outside the lock; two threads may race to add the same pattern,
+    // which is harmless. std::regex::optimize favours matching speed over
+    // construction time, which is the right trade for a cached pattern.
+    auto regex = std::make_shared<const std::regex>(pattern, flags | std::regex::optimize);
+
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    if (!index.count(key)) {
+        lru.push_front({ pattern, flags, regex });
+        index[key] = lru.begin();
+        if (lru.size() > CAPACITY) {
+            index.erase(make_key(lru.back().pattern, lru.back().flags));
+            lru.pop_back();
+        }
+    }
+    last_used = { pattern, flags, regex };
+    return regex;
+}
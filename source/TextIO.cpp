@@ -40,12 +40,12 @@ void TextIO::print(const std::string& message) {
     std::cout << message;
 }
 
-void TextIO::print_uw(uint16_t value) {
+void TextIO::print_uw(uint32_t value) {
     // Explicitly set the stream to decimal mode before printing.
     std::cout << std::dec << value;
 }
 
-void TextIO::print_uwhex(uint16_t value) {
+void TextIO::print_uwhex(uint32_t value) {
     // std::hex makes the output hexadecimal
     // std::setw and std::setfill ensure it's padded with zeros to 4 digits
     std::cout << '$' << std::hex << std::setw(4) << std::setfill('0') << std::uppercase << value;
@@ -0,0 +1,45 @@
+// ThreadPool.cpp
+#include "ThreadPool.hpp"
+
+ThreadPool::ThreadPool(size_t size) : queue(std::make_shared<Queue>()) {
+    if (size == 0) size = std::thread::hardware_concurrency();
+    if (size == 0) size = 2; // hardware_concurrency() may not be computable
+    workers.reserve(size);
+    for (size_t i = 0; i < size; ++i) {
+        workers.emplace_back(worker_loop, queue);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(queue->mutex);
+        queue->stopping = true;
+        queue->jobs.clear();
+    }
+    queue->available.notify_all();
+    for (auto& worker : workers) {
+        if (worker.joinable()) worker.detach();
+    }
+}
+
+void ThreadPool::submit(Job job) {
+    {
+        std::lock_guard<std::mutex> lock(queue->mutex);
+        queue->jobs.push_back(std::move(job));
+    }
+    queue->available.notify_one();
+}
+
+void ThreadPool::worker_loop(std::shared_ptr<Queue> queue) {
+    while (true) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(queue->mutex);
+            queue->available.wait(lock, [&queue]() { return queue->stopping || !queue->jobs.empty(); });
+            if (queue->stopping) return;
+            job = std::move(queue->jobs.front());
+            queue->jobs.pop_front();
+        }
+        job();
+    }
+}